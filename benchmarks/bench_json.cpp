@@ -0,0 +1,405 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2025 - Present Romain Augier
+// All rights reserved.
+
+/*
+ * Json benchmarks. Representative corpora are generated in memory and every operation is timed
+ * over a few iterations. Results are written as json (to stdout, or to --output=<path>), with
+ * the throughput and the number of bytes allocated per iteration, e.g:
+ *
+ *   bench_json --size_mb=16 --iterations=10 --output=bench_json.json
+ */
+
+#include "stdromano/json.hpp"
+#include "stdromano/command_line_parser.hpp"
+#include "stdromano/memory.hpp"
+#include "stdromano/random.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+#if defined(STDROMANO_WIN)
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* defined(STDROMANO_WIN) */
+
+/* Corpora generation */
+
+using CorpusGenerator = void (*)(stdromano::StringD& out, std::size_t target_size);
+
+static std::uint64_t next_random(std::uint64_t bound) noexcept
+{
+    return stdromano::xoshiro_next_uint64() % bound;
+}
+
+/* Records of integers and floats with various magnitudes and exponents */
+static void generate_numeric(stdromano::StringD& out, std::size_t target_size)
+{
+    out.push_back('[');
+
+    for(std::size_t i = 0; out.size() < target_size; i++)
+    {
+        if(i > 0)
+            out.push_back(',');
+
+        const double x = static_cast<double>(next_random(2000000)) / 1000.0 - 1000.0;
+        const double y = static_cast<double>(next_random(1000000)) * 1e-9;
+
+        out.appendf("[{},{},{:.6e},{}]", i, x, y, -static_cast<std::int64_t>(next_random(1000000)));
+    }
+
+    out.push_back(']');
+}
+
+/* Deeply nested dicts and arrays */
+static void generate_nested(stdromano::StringD& out, std::size_t target_size)
+{
+    static constexpr std::size_t DEPTH = 48;
+
+    out.push_back('[');
+
+    for(std::size_t i = 0; out.size() < target_size; i++)
+    {
+        if(i > 0)
+            out.push_back(',');
+
+        for(std::size_t d = 0; d < DEPTH; d++)
+        {
+            if(d % 2 == 0)
+                out.appendf("{{\"level_{}\":", d);
+            else
+                out.appendf("[{},", d);
+        }
+
+        out.appendf("{}", i);
+
+        for(std::size_t d = DEPTH; d > 0; d--)
+            out.push_back((d - 1) % 2 == 0 ? '}' : ']');
+    }
+
+    out.push_back(']');
+}
+
+/* Long strings with escape sequences */
+static void generate_strings(stdromano::StringD& out, std::size_t target_size)
+{
+    static constexpr const char* words[] = { "lorem", "ipsum", "\\\"quoted\\\"", "dolor", "sit\\n",
+                                             "amet", "\\ttab", "back\\\\slash", "caf\\u00e9",
+                                             "consectetur", "adipiscing", "elit" };
+
+    static constexpr std::size_t num_words = sizeof(words) / sizeof(words[0]);
+
+    out.push_back('[');
+
+    for(std::size_t i = 0; out.size() < target_size; i++)
+    {
+        if(i > 0)
+            out.push_back(',');
+
+        out.appendf("{{\"id\":{},\"text\":\"", i);
+
+        const std::size_t num = 4 + next_random(60);
+
+        for(std::size_t w = 0; w < num; w++)
+        {
+            if(w > 0)
+                out.push_back(' ');
+
+            out.appendf("{}", words[next_random(num_words)]);
+        }
+
+        out.appendf("\"}}");
+    }
+
+    out.push_back(']');
+}
+
+/* Dicts with many keys, looked up by the dict_find benchmark */
+static constexpr std::size_t WIDE_DICT_KEYS = 256;
+
+static void generate_wide_dicts(stdromano::StringD& out, std::size_t target_size)
+{
+    out.push_back('[');
+
+    for(std::size_t i = 0; out.size() < target_size; i++)
+    {
+        if(i > 0)
+            out.push_back(',');
+
+        out.push_back('{');
+
+        for(std::size_t k = 0; k < WIDE_DICT_KEYS; k++)
+        {
+            if(k > 0)
+                out.push_back(',');
+
+            out.appendf("\"field_{:04}\":{}", k, next_random(100000));
+        }
+
+        out.push_back('}');
+    }
+
+    out.push_back(']');
+}
+
+/* Measurements */
+
+struct BenchResult
+{
+    const char* corpus;
+    const char* operation;
+    std::size_t bytes;
+    std::size_t ops;
+    std::size_t iterations;
+    std::uint64_t best_ns;
+    std::uint64_t mean_ns;
+    std::uint64_t first_alloc_bytes;
+    std::uint64_t alloc_bytes;
+};
+
+/* Runs func iterations times, bytes and ops are the amount of work done by a single call */
+template <typename F>
+static BenchResult bench(const char* corpus,
+                         const char* operation,
+                         std::size_t bytes,
+                         std::size_t ops,
+                         std::size_t iterations,
+                         F&& func)
+{
+    BenchResult result = { corpus, operation, bytes, ops, iterations, 0, 0, 0, 0 };
+
+    std::uint64_t total = 0;
+
+    for(std::size_t i = 0; i < iterations; i++)
+    {
+        const std::uint64_t allocated = stdromano::mem_thread_allocated_bytes();
+        const auto start = std::chrono::steady_clock::now();
+
+        func();
+
+        const auto end = std::chrono::steady_clock::now();
+        const std::uint64_t alloc_bytes = stdromano::mem_thread_allocated_bytes() - allocated;
+
+        const std::uint64_t ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+        total += ns;
+
+        if(i == 0 || ns < result.best_ns)
+            result.best_ns = ns;
+
+        if(i == 0)
+            result.first_alloc_bytes = alloc_bytes;
+
+        /* Allocations of the last iteration, once the buffers have been reused (steady state) */
+        result.alloc_bytes = alloc_bytes;
+    }
+
+    result.mean_ns = total / iterations;
+
+    std::fprintf(stderr,
+                 "%-12s %-10s %10.2f MB/s %12.2f Mops/s %12llu bytes allocated\n",
+                 corpus,
+                 operation,
+                 static_cast<double>(bytes) * 1e3 / static_cast<double>(result.best_ns),
+                 static_cast<double>(ops) * 1e3 / static_cast<double>(result.best_ns),
+                 static_cast<unsigned long long>(result.alloc_bytes));
+
+    return result;
+}
+
+static std::size_t count_values(const stdromano::JsonObject* value) noexcept
+{
+    std::size_t count = 1;
+
+    if(value->is_array())
+    {
+        for(const stdromano::JsonObject* element : value->array_items())
+            count += count_values(element);
+    }
+    else if(value->is_dict())
+    {
+        for(const stdromano::JsonKeyValue kv : value->dict_items())
+            count += count_values(kv.value);
+    }
+
+    return count;
+}
+
+static void write_result(stdromano::JsonWriter& writer, const BenchResult& result) noexcept
+{
+    writer.dict_start();
+
+    writer.key("corpus");
+    writer.value_str(result.corpus);
+    writer.key("operation");
+    writer.value_str(result.operation);
+    writer.key("bytes");
+    writer.value_u64(result.bytes);
+    writer.key("ops");
+    writer.value_u64(result.ops);
+    writer.key("iterations");
+    writer.value_u64(result.iterations);
+    writer.key("best_ns");
+    writer.value_u64(result.best_ns);
+    writer.key("mean_ns");
+    writer.value_u64(result.mean_ns);
+
+    /* Throughputs are computed from the best iteration */
+    writer.key("mb_per_s");
+    writer.value_f64(static_cast<double>(result.bytes) * 1e3 / static_cast<double>(result.best_ns));
+    writer.key("ops_per_s");
+    writer.value_f64(static_cast<double>(result.ops) * 1e9 / static_cast<double>(result.best_ns));
+    writer.key("first_alloc_bytes");
+    writer.value_u64(result.first_alloc_bytes);
+    writer.key("alloc_bytes");
+    writer.value_u64(result.alloc_bytes);
+
+    writer.dict_end();
+}
+
+int main(int argc, char** argv)
+{
+    stdromano::CommandLineParser cmd_line_parser;
+    cmd_line_parser.add_argument("size_mb", stdromano::ArgType_Int);
+    cmd_line_parser.add_argument("iterations", stdromano::ArgType_Int);
+    cmd_line_parser.add_argument("output", stdromano::ArgType_String);
+
+    cmd_line_parser.parse(argc, argv);
+
+    const std::size_t size_mb = static_cast<std::size_t>(cmd_line_parser.get_argument_value<int>("size_mb", 16));
+    const std::size_t iterations = static_cast<std::size_t>(cmd_line_parser.get_argument_value<int>("iterations", 10));
+    const stdromano::StringD output = cmd_line_parser.get_argument_value<stdromano::StringD>("output");
+
+    if(size_mb == 0 || iterations == 0)
+    {
+        std::fprintf(stderr, "size_mb and iterations must be positive\n");
+        return 1;
+    }
+
+    struct Corpus
+    {
+        const char* name;
+        CorpusGenerator generator;
+    };
+
+    static constexpr Corpus corpora[] = {
+        { "numeric", generate_numeric },
+        { "nested", generate_nested },
+        { "strings", generate_strings },
+        { "wide_dicts", generate_wide_dicts },
+    };
+
+    stdromano::seed_xoshiro(0x5eed);
+
+    stdromano::Vector<BenchResult> results;
+
+    for(const Corpus& corpus : corpora)
+    {
+        stdromano::StringD text;
+        corpus.generator(text, size_mb * 1024 * 1024);
+
+        stdromano::Json json;
+
+        results.push_back(bench(corpus.name, "loads", text.size(), 1, iterations, [&]() {
+            json.reset();
+
+            if(!json.loads(text.c_str(), text.size()))
+                std::fprintf(stderr, "Failed to parse the %s corpus\n", corpus.name);
+        }));
+
+        std::size_t dumped_size = 0;
+
+        results.push_back(bench(corpus.name, "dumps", text.size(), 1, iterations, [&]() {
+            dumped_size = json.dumps().size();
+        }));
+
+        STDROMANO_UNUSED(dumped_size);
+
+        std::size_t num_values = 0;
+
+        results.push_back(bench(corpus.name, "iterate", text.size(), count_values(json.root()), iterations, [&]() {
+            num_values = count_values(json.root());
+        }));
+
+        if(corpus.generator == generate_wide_dicts)
+        {
+            static constexpr std::size_t NUM_LOOKUPS = 16;
+
+            char keys[NUM_LOOKUPS][16];
+
+            for(std::size_t k = 0; k < NUM_LOOKUPS; k++)
+                std::snprintf(keys[k], sizeof(keys[k]), "field_%04zu", (k * 37) % WIDE_DICT_KEYS);
+
+            const std::size_t num_lookups = json.root()->array_size() * NUM_LOOKUPS;
+            std::uint64_t sum = 0;
+
+            results.push_back(bench(corpus.name, "dict_find", text.size(), num_lookups, iterations, [&]() {
+                for(const stdromano::JsonObject* record : json.root()->array_items())
+                {
+                    for(std::size_t k = 0; k < NUM_LOOKUPS; k++)
+                        sum += record->dict_find(keys[k])->get_u64();
+                }
+            }));
+
+            STDROMANO_UNUSED(sum);
+        }
+    }
+
+    int fd = 1;
+
+    if(!output.empty())
+    {
+#if defined(STDROMANO_WIN)
+        fd = ::_open(output.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+        fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif /* defined(STDROMANO_WIN) */
+
+        if(fd < 0)
+        {
+            std::fprintf(stderr, "Cannot open %s\n", output.c_str());
+            return 1;
+        }
+    }
+
+    bool success;
+
+    {
+        stdromano::JsonWriter writer(fd, 2);
+
+        writer.dict_start();
+        writer.key("benchmark");
+        writer.value_str("json");
+        writer.key("size_mb");
+        writer.value_u64(size_mb);
+        writer.key("results");
+        writer.array_start();
+
+        for(const BenchResult& result : results)
+            write_result(writer, result);
+
+        writer.array_end();
+        writer.dict_end();
+
+        success = writer.flush();
+    }
+
+    if(fd != 1)
+    {
+#if defined(STDROMANO_WIN)
+        ::_close(fd);
+#else
+        ::close(fd);
+#endif /* defined(STDROMANO_WIN) */
+    }
+    else
+    {
+        std::fputc('\n', stdout);
+    }
+
+    return success ? 0 : 1;
+}
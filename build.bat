@@ -11,6 +11,7 @@ call :LogInfo "Building stdromano"
 
 set BUILDTYPE=Release
 set RUNTESTS=0
+set BUILDBENCHMARKS=0
 set REMOVEOLDDIR=0
 set ARCH=x64
 set VERSION="0.0.0"
@@ -75,7 +76,7 @@ if %REMOVEOLDDIR% equ 1 (
 call :LogInfo "Build type: %BUILDTYPE%"
 call :LogInfo "Build version: %VERSION%"
 
-cmake -S . -B build -DRUN_TESTS=%RUNTESTS% -A="%ARCH%" -DVERSION=%VERSION% -DADDRSAN=%ADDRSAN% -DENABLE_OPENCL=%ENABLE_OPENCL%
+cmake -S . -B build -DRUN_TESTS=%RUNTESTS% -DBUILD_BENCHMARKS=%BUILDBENCHMARKS% -A="%ARCH%" -DVERSION=%VERSION% -DADDRSAN=%ADDRSAN% -DENABLE_OPENCL=%ENABLE_OPENCL%
 
 if %errorlevel% neq 0 (
     call :LogError "Error caught during CMake configuration"
@@ -127,6 +128,8 @@ if "%~1" equ "--reldebug" set BUILDTYPE=RelWithDebInfo
 
 if "%~1" equ "--tests" set RUNTESTS=1
 
+if "%~1" equ "--benchmarks" set BUILDBENCHMARKS=1
+
 if "%~1" equ "--clean" set REMOVEOLDDIR=1
 
 if "%~1" equ "--install" set INSTALL=1
@@ -6,6 +6,7 @@
 
 BUILDTYPE="Release"
 RUNTESTS=0
+BUILDBENCHMARKS=0
 REMOVEOLDDIR=0
 EXPORTCOMPILECOMMANDS=0
 VERSION="0.0.0"
@@ -28,6 +29,8 @@ parse_args()
 
     [[ "$1" == "--tests" ]] && RUNTESTS=1
 
+    [[ "$1" == "--benchmarks" ]] && BUILDBENCHMARKS=1
+
     [[ "$1" == "--clean" ]] && REMOVEOLDDIR=1
 
     [[ "$1" == "--install" ]] && INSTALL=1
@@ -161,6 +164,7 @@ if [[ -d "install" && $REMOVEOLDDIR -eq 1 ]]; then
 fi
 
 cmake -S . -B build -DRUN_TESTS=$RUNTESTS \
+                    -DBUILD_BENCHMARKS=$BUILDBENCHMARKS \
                     -DCMAKE_EXPORT_COMPILE_COMMANDS=$EXPORTCOMPILECOMMANDS \
                     -DCMAKE_BUILD_TYPE=$BUILDTYPE \
                     -DVERSION=$VERSION \
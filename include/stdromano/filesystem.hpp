@@ -89,6 +89,79 @@ STDROMANO_API Expected<void> write_file_content(const char* data,
                                                 const StringD& file_path,
                                                 const char* mode = "w") noexcept;
 
+// Flags controlling how map_file maps a file
+enum MapFileFlags : std::uint32_t
+{
+    MapFileFlags_CopyOnWrite = 0x1, // Mapping is writable, writes are private to the process and never reach the file
+    MapFileFlags_Sequential = 0x2, // Hint the kernel that the mapping will be read sequentially
+};
+
+// Memory mapping of an entire file, unmapped on destruction.
+// The mapping is read-only unless created with MapFileFlags_CopyOnWrite, and is move-only (non-copyable)
+class STDROMANO_API MappedFile
+{
+    friend STDROMANO_API Expected<MappedFile> map_file(const StringD&, const std::uint32_t) noexcept;
+
+    char* _data = nullptr;
+    std::size_t _size = 0;
+
+#if defined(STDROMANO_WIN)
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#endif /* defined(STDROMANO_WIN) */
+
+public:
+    MappedFile() = default;
+
+    STDROMANO_NON_COPYABLE(MappedFile);
+
+    MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if(this != &other)
+        {
+            this->unmap();
+
+            this->_data = other._data;
+            this->_size = other._size;
+
+            other._data = nullptr;
+            other._size = 0;
+
+#if defined(STDROMANO_WIN)
+            this->_file = other._file;
+            this->_mapping = other._mapping;
+
+            other._file = INVALID_HANDLE_VALUE;
+            other._mapping = nullptr;
+#endif /* defined(STDROMANO_WIN) */
+        }
+
+        return *this;
+    }
+
+    ~MappedFile() { this->unmap(); }
+
+    // Returns a pointer to the mapped content, only writable with MapFileFlags_CopyOnWrite
+    char* data() const noexcept { return this->_data; }
+
+    // Returns the size of the mapped content in bytes
+    std::size_t size() const noexcept { return this->_size; }
+
+    bool is_mapped() const noexcept { return this->_data != nullptr; }
+
+    // Unmaps the file, no-op if not mapped
+    void unmap() noexcept;
+};
+
+// Maps the entire file at file_path in memory. Empty files cannot be mapped and return an error
+STDROMANO_API Expected<MappedFile> map_file(const StringD& file_path,
+                                            const std::uint32_t flags = 0) noexcept;
+
 // Flags controlling which entries list_dir yields
 enum ListDirFlags : std::uint32_t
 {
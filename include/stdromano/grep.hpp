@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2025 - Present Romain Augier
+// All rights reserved.
+
+#pragma once
+
+#if !defined(__STDROMANO_GREP)
+#define __STDROMANO_GREP
+
+#include "stdromano/regex.hpp"
+
+#include <functional>
+
+STDROMANO_NAMESPACE_BEGIN
+
+enum GrepFlags_ : std::uint32_t
+{
+    // The pattern is a literal string instead of a regex
+    GrepFlags_Literal = 0x1,
+    // Hidden directories are searched too
+    GrepFlags_Hidden = 0x2,
+    // Binary files (containing a null byte in their first kilobytes) are searched too
+    GrepFlags_Binary = 0x4,
+};
+
+// A line containing a match. The path and the line reference memory owned by the search, so a
+// GrepLine is only valid during the callback
+
+struct GrepLine
+{
+    StringD path;
+    StringD line;
+
+    // 1-based
+    std::size_t line_number;
+
+    // First match in the line, as offsets in the line
+    std::size_t match_start;
+    std::size_t match_end;
+};
+
+/*
+ * Parallel grep over files and directory trees. The tree is walked on the calling thread while
+ * the files found are loaded (large ones memory-mapped) and searched concurrently on the global
+ * thread pool. Binary files are skipped, and each line is reported once, with its first match.
+ * Results are delivered from the calling thread in walk order (and in line order within a file),
+ * a bounded number of files being in flight at a time
+ */
+
+class STDROMANO_API Grep
+{
+    friend struct Grep_;
+
+    Regex _regex;
+    StringD _literal;
+
+    std::uint32_t _flags;
+
+    std::size_t _num_files;
+    std::size_t _num_binary_files;
+    std::size_t _num_errors;
+    std::size_t _num_lines;
+
+public:
+    using Callback = std::function<void(const GrepLine& line)>;
+
+    explicit Grep(const StringD& pattern, std::uint32_t flags = 0) noexcept;
+
+    // False if the pattern is empty, or is an invalid regex
+
+    bool valid() const noexcept;
+
+    // Searches the file at path, or all the files under path if it is a directory. Returns false
+    // if the pattern is invalid or path does not exist
+
+    bool search(const StringD& path, const Callback& callback) noexcept;
+
+    // Searches a buffer, path is only passed through to the lines. Runs on the calling thread
+
+    bool search_buffer(const char* data, std::size_t size, const StringD& path, const Callback& callback) noexcept;
+
+    // Statistics of the last search, empty files are not counted
+
+    std::size_t num_files() const noexcept { return this->_num_files; }
+    std::size_t num_binary_files() const noexcept { return this->_num_binary_files; }
+
+    // Files found by the walk that could not be read (e.g. their size or content), they are skipped
+
+    std::size_t num_errors() const noexcept { return this->_num_errors; }
+    std::size_t num_lines() const noexcept { return this->_num_lines; }
+};
+
+STDROMANO_NAMESPACE_END
+
+#endif /* !defined(__STDROMANO_GREP) */
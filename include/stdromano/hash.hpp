@@ -13,7 +13,7 @@
 
 STDROMANO_NAMESPACE_BEGIN
 
-static STDROMANO_FORCE_INLINE uint32_t hash_fnv1a(char* data, const size_t n)
+static STDROMANO_FORCE_INLINE uint32_t hash_fnv1a(const char* data, const size_t n)
 {
     uint32_t result = static_cast<uint32_t>(0x811c9dc5UL);
 
@@ -8,18 +8,41 @@
 #define __STDROMANO_JSON
 
 #include "stdromano/string.hpp"
+#include "stdromano/vector.hpp"
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <type_traits>
 
 STDROMANO_NAMESPACE_BEGIN
 
 /* Internal forward declarations (opaque to the user) */
 struct JsonParser_;
 struct JsonWriter_;
+struct JsonDict_;
+struct JsonLazy_;
+struct JsonStreamParser_;
+struct JsonLinesReader_;
+struct JsonBinary_;
+struct JsonPath_;
+struct JsonLinesChunk;
 
 class Json;
 
+namespace fs { class MappedFile; }
+
+enum JsonLoadFlags_ : std::uint32_t
+{
+    // The file is memory-mapped (copy-on-write) and parsed in place: strings without escape
+    // sequences reference the mapping instead of being copied, and the mapping lives as long
+    // as the Json document
+    JsonLoadFlags_ZeroCopy = 0x1,
+};
+
 struct JsonKeyValue
 {
     const char* key;
@@ -31,6 +54,8 @@ class STDROMANO_API JsonObject
     friend class Json;
     friend struct JsonParser_;
     friend struct JsonWriter_;
+    friend struct JsonDict_;
+    friend struct JsonBinary_;
 
     uint64_t _tags;
 
@@ -78,22 +103,39 @@ public:
     std::size_t array_size() const noexcept;
     std::size_t dict_size() const noexcept;
 
+    // Array random access, returns nullptr if the index is out of bounds
+
+    JsonObject* array_at(std::size_t index) const noexcept;
+
     // Dict lookup
+    // Dicts bigger than a few entries keep a hash index, so lookups do not depend on the dict size
 
     JsonObject* dict_find(const char* key) const noexcept;
+    JsonObject* dict_find(const char* key, std::size_t key_sz) const noexcept;
 
     // Iterators
 
+    // Arrays are stored contiguously, iterating over them only walks a pointer array
+
     class ArrayIterator
     {
-        void* _current;
+        JsonObject* const* _current;
 
     public:
-        explicit ArrayIterator(void* current) noexcept : _current(current) {}
+        explicit ArrayIterator(JsonObject* const* current) noexcept : _current(current) {}
 
-        JsonObject* operator*() const noexcept;
-        ArrayIterator& operator++() noexcept;
-        bool operator!=(const ArrayIterator& other) const noexcept;
+        JsonObject* operator*() const noexcept { return *this->_current; }
+
+        ArrayIterator& operator++() noexcept
+        {
+            ++this->_current;
+            return *this;
+        }
+
+        bool operator!=(const ArrayIterator& other) const noexcept
+        {
+            return this->_current != other._current;
+        }
     };
 
     class DictIterator
@@ -110,13 +152,15 @@ public:
 
     class ArrayRange
     {
-        void* _head;
+        JsonObject* const* _begin;
+        JsonObject* const* _end;
 
     public:
-        explicit ArrayRange(void* head) noexcept : _head(head) {}
+        ArrayRange(JsonObject* const* begin, JsonObject* const* end) noexcept : _begin(begin),
+                                                                                _end(end) {}
 
-        ArrayIterator begin() const noexcept;
-        ArrayIterator end() const noexcept;
+        ArrayIterator begin() const noexcept { return ArrayIterator(this->_begin); }
+        ArrayIterator end() const noexcept { return ArrayIterator(this->_end); }
     };
 
     class DictRange
@@ -138,17 +182,34 @@ class STDROMANO_API Json
 {
     friend struct JsonParser_;
     friend struct JsonWriter_;
+    friend struct JsonDict_;
+    friend struct JsonBinary_;
 
     JsonObject* _root;
     Arena _string_arena;
     Arena _value_arena;
 
+    /* Mapped input referenced by the strings of a document loaded with JsonLoadFlags_ZeroCopy */
+    fs::MappedFile* _source;
+
+    /* Scratch stack of the parser, kept so that parsing into a warm document does not allocate */
+    Vector<JsonObject*> _parse_stack;
+
 public:
     Json() noexcept;
     ~Json() noexcept;
 
     STDROMANO_NON_COPYABLE(Json);
-    STDROMANO_NON_MOVABLE(Json);
+
+    // Values and strings stay at the same address, JsonObject pointers remain valid after a move.
+    // A moved-from Json is an empty document, and can be reset and reused
+    Json(Json&& other) noexcept;
+    Json& operator=(Json&& other) noexcept;
+
+    // Drops the document but keeps the arenas capacity, so that parsing a document of similar
+    // size into a reset Json does not allocate. Previously returned JsonObject pointers are
+    // invalidated
+    void reset() noexcept;
 
     // Root access
 
@@ -177,6 +238,10 @@ public:
 
     // Array operations
 
+    // Appending is amortized O(1), array_reserve can be used to avoid growing the storage
+    // when the final size is known
+
+    void array_reserve(JsonObject* array, std::size_t capacity) noexcept;
     void array_append(JsonObject* array, JsonObject* value, bool reference = false) noexcept;
     void array_pop(JsonObject* array, std::size_t index) noexcept;
 
@@ -192,14 +257,945 @@ public:
     // Parse
 
     bool loads(const char* str, std::size_t len) noexcept;
-    bool loadf(const StringD& path) noexcept;
+
+    // Parses a caller-owned buffer in place: strings without escape sequences are not copied and
+    // point into the buffer, which is modified (closing quotes are replaced by null terminators).
+    // The buffer must outlive the document
+    bool loads_inplace(char* str, std::size_t len) noexcept;
+
+    // The file is memory-mapped instead of being read into a temporary buffer,
+    // see JsonLoadFlags_ for the available flags
+    bool loadf(const StringD& path, std::uint32_t flags = 0) noexcept;
 
     // Dump
 
     StringD dumps(std::size_t indent_size = 0) const noexcept;
     bool dumpf(std::size_t indent_size, const StringD& path) const noexcept;
+
+    // Binary encoding, see JsonBinary. Reloading a binary document does not involve any text
+    // parsing, and the file can also be navigated directly with JsonBinary without loading it
+
+    bool dumpb(const StringD& path) const noexcept;
+
+    // Fails on invalid documents, and on documents nested more than 1024 levels deep
+
+    bool loadb(const char* data, std::size_t size) noexcept;
+
+    // With JsonLoadFlags_ZeroCopy, strings and keys reference the mapped file instead of being copied
+    bool loadb(const StringD& path, std::uint32_t flags = 0) noexcept;
+};
+
+/*
+ * Thread-safe pool of reusable documents. Released documents are reset and keep their arenas,
+ * so once the pool is warm, parsing many small payloads does not hit the allocator.
+ * At most max_documents documents are kept, the extra ones are deleted on release
+ */
+
+class STDROMANO_API JsonPool
+{
+    Vector<Json*> _documents;
+    std::size_t _max_documents;
+    mutable std::mutex _mutex;
+
+public:
+    static constexpr std::size_t DEFAULT_MAX_DOCUMENTS = 64;
+
+    explicit JsonPool(std::size_t max_documents = DEFAULT_MAX_DOCUMENTS) noexcept;
+    ~JsonPool() noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonPool);
+    STDROMANO_NON_MOVABLE(JsonPool);
+
+    // Returns an empty document, allocating a new one if the pool is empty
+    Json* acquire() noexcept;
+
+    // The document must have been acquired from this pool and must not be used afterwards
+    void release(Json* json) noexcept;
+
+    // Number of documents waiting to be reused
+    std::size_t size() const noexcept;
+};
+
+/*
+ * Compact binary json, written by Json::dumpb. Values are stored with their type and size,
+ * strings are length-prefixed and null-terminated, and arrays/dicts hold offset tables
+ * (dicts also have a key-sorted table), so a binary document can be memory-mapped and
+ * navigated in place: array access is O(1), dict lookup O(log n) and strings are not copied.
+ * Offsets are 32 bits, limiting binary documents to 4GB
+ */
+
+class STDROMANO_API JsonBinaryValue
+{
+    friend class JsonBinary;
+    friend struct JsonBinary_;
+
+    const char* _data;
+    std::size_t _size;
+
+    /* Offset of the value in the document, 0 (the header) when invalid */
+    std::uint32_t _offset;
+
+    JsonBinaryValue(const char* data, std::size_t size, std::uint32_t offset) noexcept : _data(data),
+                                                                                        _size(size),
+                                                                                        _offset(offset) {}
+
+public:
+    JsonBinaryValue() noexcept : _data(nullptr), _size(0), _offset(0) {}
+
+    // Returns false for missing keys, out of bounds indices and out of bounds offsets
+
+    bool is_valid() const noexcept { return this->_offset != 0; }
+
+    // Type checks
+
+    bool is_null() const noexcept;
+    bool is_bool() const noexcept;
+    bool is_u64() const noexcept;
+    bool is_i64() const noexcept;
+    bool is_f64() const noexcept;
+    bool is_str() const noexcept;
+    bool is_array() const noexcept;
+    bool is_dict() const noexcept;
+
+    // Getters, strings point into the document
+
+    bool get_bool() const noexcept;
+    std::uint64_t get_u64() const noexcept;
+    std::int64_t get_i64() const noexcept;
+    double get_f64() const noexcept;
+    const char* get_str() const noexcept;
+    std::size_t get_str_size() const noexcept;
+
+    // Containers
+
+    std::size_t array_size() const noexcept;
+    std::size_t dict_size() const noexcept;
+
+    JsonBinaryValue array_at(std::size_t index) const noexcept;
+
+    JsonBinaryValue dict_find(const char* key) const noexcept;
+    JsonBinaryValue dict_find(const char* key, std::size_t key_sz) const noexcept;
+
+    // Dict entries in insertion order
+
+    const char* dict_key_at(std::size_t index) const noexcept;
+    JsonBinaryValue dict_value_at(std::size_t index) const noexcept;
+};
+
+class STDROMANO_API JsonBinary
+{
+    const char* _data;
+    std::size_t _size;
+    std::uint32_t _root;
+
+    /* Mapped input when loaded with loadf */
+    fs::MappedFile* _source;
+
+public:
+    JsonBinary() noexcept;
+    ~JsonBinary() noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonBinary);
+    STDROMANO_NON_MOVABLE(JsonBinary);
+
+    // Only checks the header and the root offset. The buffer is not copied and must outlive the
+    // document, and must be 4-byte aligned
+
+    bool load(const char* data, std::size_t size) noexcept;
+
+    // The file is memory-mapped and the mapping lives as long as the document
+
+    bool loadf(const StringD& path) noexcept;
+
+    JsonBinaryValue root() const noexcept;
+};
+
+/*
+ * Streaming json output: values go through a fixed-size buffer which is flushed to a file
+ * descriptor (or appended to a string) when full, so dumping a document uses constant memory.
+ * Documents can either be written from a JsonObject tree, or event by event without building one
+ */
+
+class STDROMANO_API JsonWriter
+{
+    friend struct JsonWriter_;
+
+    char* _buffer;
+    std::size_t _buffer_capacity;
+    std::size_t _buffer_size;
+
+    /* Output, either a file descriptor or a string */
+    int _fd;
+    StringD* _out;
+
+    std::size_t _indent_size;
+    std::size_t _indent;
+    std::uint32_t _depth;
+
+    bool _needs_comma;
+    bool _after_key;
+    bool _error;
+
+public:
+    static constexpr std::size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    JsonWriter(int fd, std::size_t indent_size = 0, std::size_t buffer_size = DEFAULT_BUFFER_SIZE) noexcept;
+    JsonWriter(StringD* out, std::size_t indent_size = 0, std::size_t buffer_size = DEFAULT_BUFFER_SIZE) noexcept;
+
+    // Flushes the remaining buffered output
+    ~JsonWriter() noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonWriter);
+    STDROMANO_NON_MOVABLE(JsonWriter);
+
+    // Events, commas and indentation are handled by the writer
+
+    void dict_start() noexcept;
+    void dict_end() noexcept;
+    void array_start() noexcept;
+    void array_end() noexcept;
+
+    void key(const char* key, std::size_t key_sz) noexcept;
+    void key(const char* key) noexcept;
+
+    void value_null() noexcept;
+    void value_bool(bool b) noexcept;
+    void value_u64(std::uint64_t u64) noexcept;
+    void value_i64(std::int64_t i64) noexcept;
+    void value_f64(double f64) noexcept;
+    void value_str(const char* str, std::size_t str_sz) noexcept;
+    void value_str(const char* str) noexcept;
+
+    // Writes a value and all its children
+
+    bool write(const JsonObject* value) noexcept;
+
+    bool flush() noexcept;
+
+    // Returns true if writing to the file descriptor failed at some point
+    bool has_error() const noexcept { return this->_error; }
+};
+
+/*
+ * On-demand access to a json document: nothing is parsed until a value is accessed, so reading
+ * a few fields of a large document only costs the part of the input that is walked.
+ * Dict lookups and array indexing skip over the values they do not need (containers are skipped
+ * with a SIMD scan of the structural characters), and scalars are decoded when a getter is called.
+ * Lookups are linear in the size of the container, use Json when a document is accessed repeatedly.
+ */
+
+class STDROMANO_API JsonLazyValue
+{
+    friend class JsonLazy;
+    friend struct JsonLazy_;
+    friend struct JsonPath_;
+
+    const char* _str;
+    std::size_t _len;
+
+    /* Offset of the first character of the value, INVALID_POS when the path did not resolve */
+    std::size_t _pos;
+
+    JsonLazyValue(const char* str, std::size_t len, std::size_t pos) noexcept : _str(str),
+                                                                               _len(len),
+                                                                               _pos(pos) {}
+
+public:
+    static constexpr std::size_t INVALID_POS = static_cast<std::size_t>(-1);
+
+    JsonLazyValue() noexcept : _str(nullptr), _len(0), _pos(INVALID_POS) {}
+
+    // Returns false if the path used to reach this value does not exist in the document
+    // (missing key, out of bounds index, or access through a non-container value)
+
+    bool is_valid() const noexcept { return this->_pos != INVALID_POS; }
+
+    // Type checks, they only look at the first characters of the value
+
+    bool is_null() const noexcept;
+    bool is_bool() const noexcept;
+    bool is_u64() const noexcept;
+    bool is_i64() const noexcept;
+    bool is_f64() const noexcept;
+    bool is_str() const noexcept;
+    bool is_array() const noexcept;
+    bool is_dict() const noexcept;
+
+    // Getters, they decode the value and behave like the JsonObject ones (0/false when the type
+    // does not match). Strings are unescaped into the returned StringD
+
+    bool get_bool() const noexcept;
+    std::uint64_t get_u64() const noexcept;
+    std::int64_t get_i64() const noexcept;
+    double get_f64() const noexcept;
+    StringD get_str() const noexcept;
+
+    // Container sizes, they walk the whole container
+
+    std::size_t array_size() const noexcept;
+    std::size_t dict_size() const noexcept;
+
+    // Navigation, skips the preceding elements of the container
+
+    JsonLazyValue operator[](const char* key) const noexcept;
+    JsonLazyValue operator[](std::size_t index) const noexcept;
+    JsonLazyValue operator[](int index) const noexcept { return this->operator[](static_cast<std::size_t>(index)); }
+
+    // Parses this value and its children into json, returns nullptr on failure
+
+    JsonObject* materialize(Json& json) const noexcept;
+
+    class ArrayIterator
+    {
+        const char* _str;
+        std::size_t _len;
+        std::size_t _pos;
+
+    public:
+        ArrayIterator(const char* str, std::size_t len, std::size_t pos) noexcept : _str(str),
+                                                                                    _len(len),
+                                                                                    _pos(pos) {}
+
+        JsonLazyValue operator*() const noexcept;
+        ArrayIterator& operator++() noexcept;
+
+        bool operator!=(const ArrayIterator& other) const noexcept
+        {
+            return this->_pos != other._pos;
+        }
+    };
+
+    class ArrayRange
+    {
+        const char* _str;
+        std::size_t _len;
+        std::size_t _pos;
+
+    public:
+        ArrayRange(const char* str, std::size_t len, std::size_t pos) noexcept : _str(str),
+                                                                                 _len(len),
+                                                                                 _pos(pos) {}
+
+        ArrayIterator begin() const noexcept;
+        ArrayIterator end() const noexcept;
+    };
+
+    // Iterates over the elements of an array, each element is skipped once when advancing
+
+    ArrayRange array_items() const noexcept { return ArrayRange(this->_str, this->_len, this->_pos); }
 };
 
+class STDROMANO_API JsonLazy
+{
+    friend struct JsonLazy_;
+
+    const char* _str;
+    std::size_t _len;
+    std::size_t _root;
+
+    /* Mapped input when loaded with loadf */
+    fs::MappedFile* _source;
+
+public:
+    JsonLazy() noexcept;
+    ~JsonLazy() noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonLazy);
+    STDROMANO_NON_MOVABLE(JsonLazy);
+
+    // Only checks that the containers are balanced, the strings terminated and that there is a
+    // single root value. Separators and scalars are not checked (e.g. [1 2] is accepted), they are
+    // only looked at when a value is accessed. The buffer is not copied and must outlive the
+    // document
+
+    bool loads(const char* str, std::size_t len) noexcept;
+
+    // The file is memory-mapped and the mapping lives as long as the document
+
+    bool loadf(const StringD& path) noexcept;
+
+    JsonLazyValue root() const noexcept;
+
+    JsonLazyValue operator[](const char* key) const noexcept { return this->root()[key]; }
+    JsonLazyValue operator[](std::size_t index) const noexcept { return this->root()[index]; }
+    JsonLazyValue operator[](int index) const noexcept { return this->root()[index]; }
+};
+
+enum JsonPathSegmentType_ : std::uint32_t
+{
+    JsonPathSegmentType_Key = 0,
+    JsonPathSegmentType_Index = 1,
+    JsonPathSegmentType_Wildcard = 2,
+    JsonPathSegmentType_Slice = 3,
+    JsonPathSegmentType_Filter = 4,
+};
+
+enum JsonPathLiteral_ : std::uint32_t
+{
+    JsonPathLiteral_Null = 0,
+    JsonPathLiteral_Bool = 1,
+    JsonPathLiteral_Number = 2,
+    JsonPathLiteral_Str = 3,
+};
+
+/* A single compiled step of a JsonPath */
+struct JsonPathSegment
+{
+    std::uint32_t type = JsonPathSegmentType_Key;
+
+    /* Key: dict key (also matched as an array index by JSON Pointer). Filter: string literal */
+    StringD key;
+
+    /* Key: array index or -1. Index: index, negative from the end. Slice: start/end/step */
+    std::int64_t index = -1;
+    std::int64_t start = 0;
+    std::int64_t end = 0;
+    std::int64_t step = 1;
+    bool has_start = false;
+    bool has_end = false;
+
+    /* Filter: keys leading from the element to the compared value, and the literal */
+    Vector<StringD> filter_keys;
+    std::uint32_t literal_type = JsonPathLiteral_Null;
+    JsonObject literal_number;
+    bool literal_bool = false;
+    bool negate = false;
+};
+
+/*
+ * Compiled query over json documents, so that the same extraction can be run against many
+ * documents without re-parsing the path. Two syntaxes are accepted:
+ * - JSON Pointer (RFC 6901) when the path is empty or starts with '/': "/store/books/0/title"
+ * - A JSONPath subset when the path starts with '$': member access (.name, ['name']), array
+ *   indices ([0], [-1]), wildcards (.*, [*]), slices ([start:end:step]) and filters comparing a
+ *   scalar for equality ([?(@.author == 'Tolkien')], [?(@.price != 10)], [?(@ == true)])
+ * Queries run on trees (JsonObject) or directly on the raw text (JsonLazyValue), in which case
+ * only the parts of the document the path goes through are scanned
+ */
+
+class STDROMANO_API JsonPath
+{
+    friend struct JsonPath_;
+
+    Vector<JsonPathSegment> _segments;
+
+    bool _valid;
+
+    bool compile(const StringD& path) noexcept;
+
+public:
+    JsonPath() noexcept : _valid(false) {}
+
+    JsonPath(const StringD& path) noexcept : _valid(false)
+    {
+        this->_valid = this->compile(path);
+    }
+
+    bool valid() const noexcept { return this->_valid; }
+
+    // Returns true if the path resolves to at most one value (no wildcard, slice or filter)
+    bool is_single() const noexcept;
+
+    // Returns the first match, nullptr/an invalid value if there is none
+
+    JsonObject* find(JsonObject* root) const noexcept;
+    JsonLazyValue find(const JsonLazyValue& root) const noexcept;
+
+    // Appends all the matches to out, in document order unless a slice has a negative step.
+    // Returns the number of matches
+
+    std::size_t find_all(JsonObject* root, Vector<JsonObject*>& out) const noexcept;
+    std::size_t find_all(const JsonLazyValue& root, Vector<JsonLazyValue>& out) const noexcept;
+};
+
+/*
+ * SAX-style events emitted by JsonStreamParser. Returning false from any of them stops the parsing.
+ * Keys and strings are unescaped and are only valid during the call, they are not null-terminated
+ */
+
+class STDROMANO_API JsonStreamHandler
+{
+public:
+    virtual ~JsonStreamHandler() noexcept = default;
+
+    virtual bool dict_start() noexcept { return true; }
+    virtual bool dict_end() noexcept { return true; }
+    virtual bool array_start() noexcept { return true; }
+    virtual bool array_end() noexcept { return true; }
+
+    virtual bool key(const char* key, std::size_t key_sz) noexcept
+    {
+        STDROMANO_UNUSED(key);
+        STDROMANO_UNUSED(key_sz);
+        return true;
+    }
+
+    virtual bool value_null() noexcept { return true; }
+    virtual bool value_bool(bool b) noexcept { STDROMANO_UNUSED(b); return true; }
+    virtual bool value_u64(std::uint64_t u64) noexcept { STDROMANO_UNUSED(u64); return true; }
+    virtual bool value_i64(std::int64_t i64) noexcept { STDROMANO_UNUSED(i64); return true; }
+    virtual bool value_f64(double f64) noexcept { STDROMANO_UNUSED(f64); return true; }
+
+    virtual bool value_str(const char* str, std::size_t str_sz) noexcept
+    {
+        STDROMANO_UNUSED(str);
+        STDROMANO_UNUSED(str_sz);
+        return true;
+    }
+};
+
+/*
+ * Incremental push parser: the input can be split anywhere (even in the middle of a token) and
+ * fed chunk by chunk. Memory usage only depends on the nesting depth and on the size of the
+ * tokens split across chunks, not on the size of the input.
+ * The input is a stream of zero or more json values (a single document, or concatenated/ndjson)
+ */
+
+class STDROMANO_API JsonStreamParser
+{
+    friend struct JsonStreamParser_;
+
+    JsonStreamHandler* _handler;
+
+    /* Open containers, 1 for dicts and 0 for arrays */
+    Vector<std::uint8_t> _containers;
+
+    /* Raw bytes of the token being parsed when it is split across chunks */
+    Vector<char> _token;
+
+    /* Scratch buffer for unescaped strings */
+    Vector<char> _unescaped;
+
+    std::size_t _offset;
+    std::uint32_t _state;
+    bool _token_split;
+    bool _is_key;
+    bool _has_escape;
+    bool _escape_pending;
+
+public:
+    explicit JsonStreamParser(JsonStreamHandler* handler) noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonStreamParser);
+    STDROMANO_NON_MOVABLE(JsonStreamParser);
+
+    // Parses the next chunk of input, returns false on a syntax error or if the handler stopped
+    // the parsing, in which case all subsequent calls fail until reset is called
+
+    bool feed(const char* chunk, std::size_t len) noexcept;
+
+    // Signals the end of the input (a number at the very end of the input can only be emitted
+    // here), returns false if the input ends in the middle of a value
+
+    bool finish() noexcept;
+
+    void reset() noexcept;
+
+    // Number of bytes consumed so far, on error it is the offset of the token that failed
+
+    std::size_t offset() const noexcept { return this->_offset; }
+};
+
+enum JsonLinesFlags_ : std::uint32_t
+{
+    // Records are delivered in input order, from the calling thread. Otherwise they are delivered
+    // from the worker threads as soon as their chunk is parsed, and the callback must be thread-safe
+    JsonLinesFlags_Ordered = 0x1,
+    // Lines that cannot be parsed are counted and skipped instead of stopping the read
+    JsonLinesFlags_SkipInvalid = 0x2,
+};
+
+/*
+ * Parallel reader for newline-delimited json (ndjson / json lines). The input is split into
+ * line-aligned chunks which are parsed concurrently on the global thread pool. The documents
+ * used to parse the chunks are recycled (across reads too), so a record is only valid during the
+ * callback. Empty lines are skipped
+ */
+
+class STDROMANO_API JsonLinesReader
+{
+    friend struct JsonLinesReader_;
+
+    std::size_t _chunk_size;
+    std::uint32_t _flags;
+
+    std::size_t _num_records;
+    std::size_t _num_invalid;
+    std::size_t _error_offset;
+
+    /* Parsing state of the chunks in flight, kept between reads */
+    JsonLinesChunk* _slots;
+    std::size_t _num_slots;
+
+public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+    // record is the parsed line, offset is the offset of the line in the input
+    using Callback = std::function<void(JsonObject* record, std::size_t offset)>;
+
+    explicit JsonLinesReader(std::uint32_t flags = 0, std::size_t chunk_size = DEFAULT_CHUNK_SIZE) noexcept;
+    ~JsonLinesReader() noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonLinesReader);
+    STDROMANO_NON_MOVABLE(JsonLinesReader);
+
+    // Returns false if a line cannot be parsed (and JsonLinesFlags_SkipInvalid is not set), its
+    // offset is then given by error_offset(). The records before the invalid line are delivered.
+    // When reading unordered, records from chunks following it may have been delivered too
+
+    bool read(const char* str, std::size_t len, const Callback& callback) noexcept;
+
+    // The file is memory-mapped for the duration of the read
+
+    bool readf(const StringD& path, const Callback& callback) noexcept;
+
+    // Statistics of the last read
+
+    std::size_t num_records() const noexcept { return this->_num_records; }
+    std::size_t num_invalid() const noexcept { return this->_num_invalid; }
+
+    // Offset of the line that stopped the last read
+    std::size_t error_offset() const noexcept { return this->_error_offset; }
+};
+
+/*
+ * Pull reader over json text, reading values one by one in document order without building a
+ * tree. It backs the struct binding (see STDROMANO_JSON_FIELDS) and can also be used directly.
+ * Any syntax or type error puts the reader in an error state in which all reads fail
+ */
+
+class STDROMANO_API JsonTokenReader
+{
+    friend struct JsonTokenReader_;
+
+    const char* _str;
+    std::size_t _len;
+    std::size_t _pos;
+
+    /* Scratch buffer for keys containing escape sequences */
+    Vector<char> _key;
+
+    /* Set after a container start, until its first element */
+    bool _first;
+    bool _error;
+
+public:
+    JsonTokenReader(const char* str, std::size_t len) noexcept;
+
+    STDROMANO_NON_COPYABLE(JsonTokenReader);
+    STDROMANO_NON_MOVABLE(JsonTokenReader);
+
+    // Containers. next_key/next_element return false once the container is closed (or on error),
+    // the value following a key/element must be read or skipped before the next call.
+    // Keys point into the input (or into a scratch buffer for escaped keys) until the next read
+
+    bool dict_start() noexcept;
+    bool next_key(const char** key, std::size_t* key_sz) noexcept;
+    bool array_start() noexcept;
+    bool next_element() noexcept;
+
+    // Scalars, reading a value of another type is an error. Integers are range-checked and
+    // read_f64 accepts any number
+
+    bool is_null() noexcept;
+    bool read_null() noexcept;
+    bool read_bool(bool& b) noexcept;
+    bool read_u64(std::uint64_t& u64) noexcept;
+    bool read_i64(std::int64_t& i64) noexcept;
+    bool read_f64(double& f64) noexcept;
+    bool read_str(StringD& str) noexcept;
+
+    // Skips the next value, including all its children
+    bool skip() noexcept;
+
+    // Returns true if only whitespace remains after the values read so far
+    bool finish() noexcept;
+
+    bool has_error() const noexcept { return this->_error; }
+};
+
+/*
+ * Binding between a C++ type and json, used by json_loads/json_dumps. Scalars, StringD and
+ * Vector are supported out of the box, other types are looked up through the json_read and
+ * json_write functions (found by ADL) that STDROMANO_JSON_FIELDS generates
+ */
+
+template <typename T, typename Enable = void>
+struct JsonBind
+{
+    static bool read(JsonTokenReader& reader, T& value) noexcept { return json_read(reader, value); }
+    static void write(JsonWriter& writer, const T& value) noexcept { json_write(writer, value); }
+};
+
+template <>
+struct JsonBind<bool>
+{
+    static bool read(JsonTokenReader& reader, bool& value) noexcept { return reader.read_bool(value); }
+    static void write(JsonWriter& writer, const bool& value) noexcept { writer.value_bool(value); }
+};
+
+template <typename T>
+struct JsonBind<T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool>>>
+{
+    static bool read(JsonTokenReader& reader, T& value) noexcept
+    {
+        std::uint64_t u64;
+
+        if(!reader.read_u64(u64) || u64 > static_cast<std::uint64_t>(std::numeric_limits<T>::max()))
+            return false;
+
+        value = static_cast<T>(u64);
+
+        return true;
+    }
+
+    static void write(JsonWriter& writer, const T& value) noexcept
+    {
+        writer.value_u64(static_cast<std::uint64_t>(value));
+    }
+};
+
+template <typename T>
+struct JsonBind<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>>>
+{
+    static bool read(JsonTokenReader& reader, T& value) noexcept
+    {
+        std::int64_t i64;
+
+        if(!reader.read_i64(i64) ||
+           i64 < static_cast<std::int64_t>(std::numeric_limits<T>::min()) ||
+           i64 > static_cast<std::int64_t>(std::numeric_limits<T>::max()))
+        {
+            return false;
+        }
+
+        value = static_cast<T>(i64);
+
+        return true;
+    }
+
+    static void write(JsonWriter& writer, const T& value) noexcept
+    {
+        if(value >= 0)
+            writer.value_u64(static_cast<std::uint64_t>(value));
+        else
+            writer.value_i64(static_cast<std::int64_t>(value));
+    }
+};
+
+template <typename T>
+struct JsonBind<T, std::enable_if_t<std::is_floating_point_v<T>>>
+{
+    static bool read(JsonTokenReader& reader, T& value) noexcept
+    {
+        double f64;
+
+        if(!reader.read_f64(f64))
+            return false;
+
+        value = static_cast<T>(f64);
+
+        return true;
+    }
+
+    static void write(JsonWriter& writer, const T& value) noexcept
+    {
+        writer.value_f64(static_cast<double>(value));
+    }
+};
+
+template <>
+struct JsonBind<StringD>
+{
+    static bool read(JsonTokenReader& reader, StringD& value) noexcept { return reader.read_str(value); }
+
+    static void write(JsonWriter& writer, const StringD& value) noexcept
+    {
+        writer.value_str(value.c_str(), value.size());
+    }
+};
+
+template <typename T>
+struct JsonBind<Vector<T>>
+{
+    static bool read(JsonTokenReader& reader, Vector<T>& value) noexcept
+    {
+        value.clear();
+
+        if(!reader.array_start())
+            return false;
+
+        while(reader.next_element())
+        {
+            value.emplace_back();
+
+            if(!JsonBind<T>::read(reader, value.back()))
+                return false;
+        }
+
+        return !reader.has_error();
+    }
+
+    static void write(JsonWriter& writer, const Vector<T>& value) noexcept
+    {
+        writer.array_start();
+
+        for(const T& element : value)
+            JsonBind<T>::write(writer, element);
+
+        writer.array_end();
+    }
+};
+
+// Decodes a json document directly into value, without building a tree. Unknown dict keys are
+// skipped and missing ones leave the corresponding fields untouched
+template <typename T>
+bool json_loads(const char* str, std::size_t len, T& value) noexcept
+{
+    JsonTokenReader reader(str, len);
+
+    return JsonBind<T>::read(reader, value) && reader.finish();
+}
+
+template <typename T>
+StringD json_dumps(const T& value, std::size_t indent_size = 0) noexcept
+{
+    StringD out;
+
+    {
+        JsonWriter writer(&out, indent_size);
+        JsonBind<T>::write(writer, value);
+    }
+
+    return out;
+}
+
 STDROMANO_NAMESPACE_END
 
+/* Struct binding, see STDROMANO_JSON_FIELDS */
+
+#define STDROMANO_JSON_EXPAND(__x__) __x__
+
+#define STDROMANO_JSON_FOR_EACH_1(__m__, __x__) __m__(__x__)
+#define STDROMANO_JSON_FOR_EACH_2(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_1(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_3(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_2(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_4(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_3(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_5(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_4(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_6(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_5(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_7(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_6(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_8(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_7(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_9(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_8(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_10(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_9(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_11(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_10(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_12(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_11(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_13(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_12(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_14(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_13(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_15(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_14(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_16(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_15(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_17(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_16(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_18(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_17(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_19(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_18(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_20(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_19(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_21(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_20(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_22(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_21(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_23(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_22(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_24(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_23(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_25(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_24(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_26(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_25(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_27(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_26(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_28(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_27(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_29(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_28(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_30(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_29(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_31(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_30(__m__, __VA_ARGS__))
+#define STDROMANO_JSON_FOR_EACH_32(__m__, __x__, ...) \
+    __m__(__x__) STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_31(__m__, __VA_ARGS__))
+
+#define STDROMANO_JSON_FOR_EACH_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+                                       _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, \
+                                       __name__, ...) __name__
+
+#define STDROMANO_JSON_FOR_EACH(__m__, ...) \
+    STDROMANO_JSON_EXPAND(STDROMANO_JSON_FOR_EACH_SELECT(__VA_ARGS__, \
+                                                          STDROMANO_JSON_FOR_EACH_32, STDROMANO_JSON_FOR_EACH_31, STDROMANO_JSON_FOR_EACH_30, \
+                                                          STDROMANO_JSON_FOR_EACH_29, STDROMANO_JSON_FOR_EACH_28, STDROMANO_JSON_FOR_EACH_27, \
+                                                          STDROMANO_JSON_FOR_EACH_26, STDROMANO_JSON_FOR_EACH_25, STDROMANO_JSON_FOR_EACH_24, \
+                                                          STDROMANO_JSON_FOR_EACH_23, STDROMANO_JSON_FOR_EACH_22, STDROMANO_JSON_FOR_EACH_21, \
+                                                          STDROMANO_JSON_FOR_EACH_20, STDROMANO_JSON_FOR_EACH_19, STDROMANO_JSON_FOR_EACH_18, \
+                                                          STDROMANO_JSON_FOR_EACH_17, STDROMANO_JSON_FOR_EACH_16, STDROMANO_JSON_FOR_EACH_15, \
+                                                          STDROMANO_JSON_FOR_EACH_14, STDROMANO_JSON_FOR_EACH_13, STDROMANO_JSON_FOR_EACH_12, \
+                                                          STDROMANO_JSON_FOR_EACH_11, STDROMANO_JSON_FOR_EACH_10, STDROMANO_JSON_FOR_EACH_9, \
+                                                          STDROMANO_JSON_FOR_EACH_8, STDROMANO_JSON_FOR_EACH_7, STDROMANO_JSON_FOR_EACH_6, \
+                                                          STDROMANO_JSON_FOR_EACH_5, STDROMANO_JSON_FOR_EACH_4, STDROMANO_JSON_FOR_EACH_3, \
+                                                          STDROMANO_JSON_FOR_EACH_2, STDROMANO_JSON_FOR_EACH_1)(__m__, __VA_ARGS__))
+
+#define STDROMANO_JSON_READ_FIELD(__field__)                                                       \
+    else if(key_sz == sizeof(#__field__) - 1 && std::memcmp(key, #__field__, key_sz) == 0)         \
+    {                                                                                              \
+        if(!stdromano::JsonBind<decltype(value.__field__)>::read(reader, value.__field__))         \
+            return false;                                                                          \
+    }
+
+#define STDROMANO_JSON_WRITE_FIELD(__field__)                                                      \
+    writer.key(#__field__, sizeof(#__field__) - 1);                                                \
+    stdromano::JsonBind<decltype(value.__field__)>::write(writer, value.__field__);
+
+// Generates the json binding of a struct from the list of its fields (up to 32), to be used at
+// the namespace scope of the struct. Fields are mapped to dict keys of the same name
+#define STDROMANO_JSON_FIELDS(__struct__, ...)                                                     \
+    inline bool json_read(stdromano::JsonTokenReader& reader, __struct__& value) noexcept          \
+    {                                                                                              \
+        if(!reader.dict_start())                                                                   \
+            return false;                                                                          \
+                                                                                                   \
+        const char* key;                                                                           \
+        std::size_t key_sz;                                                                        \
+                                                                                                   \
+        while(reader.next_key(&key, &key_sz))                                                      \
+        {                                                                                          \
+            if(false) {}                                                                           \
+            STDROMANO_JSON_FOR_EACH(STDROMANO_JSON_READ_FIELD, __VA_ARGS__)                        \
+            else if(!reader.skip())                                                                \
+                return false;                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return !reader.has_error();                                                                \
+    }                                                                                              \
+                                                                                                   \
+    inline void json_write(stdromano::JsonWriter& writer, const __struct__& value) noexcept        \
+    {                                                                                              \
+        writer.dict_start();                                                                       \
+        STDROMANO_JSON_FOR_EACH(STDROMANO_JSON_WRITE_FIELD, __VA_ARGS__)                           \
+        writer.dict_end();                                                                         \
+    }
+
 #endif /* !defined(__STDROMANO_JSON) */
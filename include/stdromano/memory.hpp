@@ -284,6 +284,10 @@ constexpr STDROMANO_FORCE_INLINE void mem_set(void* __restrict dst,
 
 STDROMANO_API void format_byte_size(float size, char* buffer) noexcept;
 
+// Total number of bytes allocated by the calling thread through mem_alloc and friends, as
+// tracked by jemalloc. Returns 0 if jemalloc statistics are not available
+STDROMANO_API std::uint64_t mem_thread_allocated_bytes() noexcept;
+
 // Simple Arena allocator
 class STDROMANO_API Arena
 {
@@ -343,7 +347,7 @@ class STDROMANO_API Arena
         return (this->_current_block->_offset + size) > this->_current_block->_size;
     }
 
-    void grow() noexcept;
+    void grow(const std::size_t min_size = 0) noexcept;
 
     template <typename T>
     static void dtor_func(void* ptr)
@@ -357,6 +361,13 @@ public:
 
     ~Arena();
 
+    STDROMANO_NON_COPYABLE(Arena);
+
+    // A moved-from arena can only be destroyed or assigned to
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    // Rewinds to the first block, blocks are kept and reused by the next allocations
     void clear() noexcept;
 
     template <typename T, typename... Args>
@@ -393,10 +404,16 @@ public:
         return object;
     }
 
-    STDROMANO_FORCE_INLINE void* allocate(std::size_t n) noexcept
+    // Allocates n bytes, blocks are grown to fit allocations bigger than the block size
+    STDROMANO_FORCE_INLINE void* allocate(std::size_t n, const std::size_t alignment = 1) noexcept
     {
-        if(this->check_resize(static_cast<std::uint32_t>(n)))
-            this->grow();
+        const std::size_t padded_size = n + alignment - 1;
+
+        if(this->check_resize(static_cast<std::uint32_t>(padded_size)))
+            this->grow(padded_size);
+
+        if(alignment > 1)
+            this->_current_block->_offset = this->align_offset(alignment);
 
         void* address = this->current_address();
 
@@ -10,6 +10,11 @@
 #include "stdromano/string.hpp"
 #include "stdromano/vector.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
 #include "spdlog/spdlog.h"
 
 STDROMANO_NAMESPACE_BEGIN
@@ -25,14 +30,18 @@ STDROMANO_NAMESPACE_BEGIN
 
 PYTHON_NAMESPACE_BEGIN
 
-// Helps debugging the parser
-#define STDROMANO_PYTHON_PARSER_ASSERT_ON_ERROR
+// Helps debugging the parser, aborts on the first parsing error instead of reporting it
+// #define STDROMANO_PYTHON_PARSER_ASSERT_ON_ERROR
 
 // Lexer Token
+//
+// Tokens do not own their text, they reference the source code buffer they were lexed from
+// (string literals reference their body, without the prefix and quotes, and indents the leading
+// spaces). Lexing does not allocate besides the token vector
 
 struct Token
 {
-    enum Kind : std::uint32_t
+    enum Kind : std::uint8_t
     {
         Identifier = 0,
         Keyword = 1,
@@ -44,24 +53,41 @@ struct Token
         Dedent = 7,
     };
 
-    StringD value;
+    std::uint32_t offset;
+    std::uint32_t length;
+
+    std::uint32_t line;
+
+    // Saturates for very long lines, only used for diagnostics
+    std::uint16_t column;
 
     Kind kind;
 
-    std::uint32_t type;
+    // Keyword, Literal, Operator or Delimiter
+    std::uint8_t type;
 
-    std::uint32_t column;
-    std::uint32_t line;
+    Token() = default;
 
-    Token(StringD value, Kind kind, std::uint32_t type, std::uint32_t column, std::uint32_t line) : value(std::move(value)),
-                                                                                                    kind(kind),
-                                                                                                    type(type),
-                                                                                                    column(column),
-                                                                                                    line(line) {}
+    Token(Kind kind,
+          std::uint32_t type,
+          std::uint32_t offset,
+          std::uint32_t length,
+          std::uint32_t column,
+          std::uint32_t line) noexcept : offset(offset),
+                                         length(length),
+                                         line(line),
+                                         column(static_cast<std::uint16_t>(std::min(column, 0xFFFFu))),
+                                         kind(kind),
+                                         type(static_cast<std::uint8_t>(type)) {}
+
+    StringD value(const char* source) const noexcept { return StringD::make_ref(source + this->offset, this->length); }
 
     static const char* kind_as_string(Kind kind) noexcept;
 };
 
+static_assert(sizeof(Token) == 16, "Token should stay compact");
+static_assert(std::is_trivially_copyable<Token>::value, "Token should stay trivially copyable");
+
 enum Keyword : std::uint32_t
 {
     False = 0,
@@ -282,6 +308,84 @@ enum ASTNodeType : std::uint32_t
     ASTNodeCount,
 };
 
+// Node types, in ASTNodeType order: X(Name, Type, String). The node types are only referenced once
+// expanded, so the list can be used before they are declared
+
+#define STDROMANO_PYTHON_AST_NODES(X) \
+    X(Module,             ModuleNode,             "MODULE")           \
+    X(Decorator,          DecoratorNode,          "DECORATOR")        \
+    X(FunctionArg,        FunctionArgNode,        "FUNC_ARG")         \
+    X(FunctionDef,        FunctionDefNode,        "FUNC_DEF")         \
+    X(AsyncFunctionDef,   AsyncFunctionDefNode,   "ASYNC_FUNC_DEF")   \
+    X(ClassDef,           ClassDefNode,           "CLASS_DEF")        \
+    X(Return,             ReturnNode,             "RETURN")           \
+    X(Assign,             AssignNode,             "ASSIGN")           \
+    X(AnnAssign,          AnnAssignNode,          "ANN_ASSIGN")       \
+    X(MultiAssign,        MultiAssignNode,        "MULTI_ASSIGN")     \
+    X(AugAssign,          AugAssignNode,          "AUG_ASSIGN")       \
+    X(WalrusAssign,       WalrusAssignNode,       "WALRUS_ASSIGN")    \
+    X(For,                ForNode,                "FOR")              \
+    X(AsyncFor,           AsyncForNode,           "ASYNC_FOR")        \
+    X(While,              WhileNode,              "WHILE")            \
+    X(If,                 IfNode,                 "IF")               \
+    X(Pass,               PassNode,               "PASS")             \
+    X(Break,              BreakNode,              "BREAK")            \
+    X(Continue,           ContinueNode,           "CONTINUE")         \
+    X(Import,             ImportNode,             "IMPORT")           \
+    X(ImportFrom,         ImportFromNode,         "IMPORT_FROM")      \
+    X(Expr,               ExprNode,               "EXPR")             \
+    X(Raise,              RaiseNode,              "RAISE")            \
+    X(Try,                TryNode,                "TRY")              \
+    X(Except,             ExceptNode,             "EXCEPT")           \
+    X(BinOp,              BinOpNode,              "BINARY_OP")        \
+    X(UnaryOp,            UnaryOpNode,            "UNARY_OP")         \
+    X(TernaryOp,          TernaryOpNode,          "TERNARY_OP")       \
+    X(BoolOp,             BoolOpNode,             "BOOL_OP")          \
+    X(CompareOp,          CompareOp,              "COMPARE")          \
+    X(KeywordArg,         KeywordArgNode,         "KEYWORD_ARG")      \
+    X(Call,               CallNode,               "CALL")             \
+    X(Name,               NameNode,               "NAME")             \
+    X(Constant,           ConstantNode,           "CONSTANT")         \
+    X(Attribute,          AttributeNode,          "ATTRIBUTE")        \
+    X(Subscript,          SubscriptNode,          "SUBSCRIPT")        \
+    X(Starred,            StarredNode,            "STARRED")          \
+    X(List,               ListNode,               "LIST")             \
+    X(Set,                SetNode,                "SET")              \
+    X(Tuple,              TupleNode,              "TUPLE")            \
+    X(Dict,               DictNode,               "DICT")             \
+    X(Comprehension,      ComprehensionNode,      "COMP")             \
+    X(AsyncComprehension, AsyncComprehensionNode, "ASYNC_COMP")       \
+    X(ListComp,           ListCompNode,           "LIST_COMP")        \
+    X(SetComp,            SetCompNode,            "SET_COMP")         \
+    X(DictComp,           DictCompNode,           "DICT_COMP")        \
+    X(GeneratorExpr,      GeneratorExprNode,      "GENERATOR_EXPR")   \
+    X(Lambda,             LambdaNode,             "LAMBDA")           \
+    X(Match,              MatchNode,              "MATCH")            \
+    X(MatchCase,          MatchCaseNode,          "MATCH_CASE")       \
+    X(MatchOr,            MatchOrNode,            "MATCH_OR")         \
+    X(MatchAs,            MatchAsNode,            "MATCH_AS")         \
+    X(MatchValue,         MatchValueNode,         "MATCH_VALUE")      \
+    X(MatchSingleton,     MatchSingletonNode,     "MATCH_SINGLETON")  \
+    X(MatchSequence,      MatchSequenceNode,      "MATCH_SEQUENCE")   \
+    X(MatchMapping,       MatchMappingNode,       "MATCH_MAPPING")    \
+    X(MatchClass,         MatchClassNode,         "MATCH_CLASS")      \
+    X(MatchStar,          MatchStarNode,          "MATCH_STAR")       \
+    X(Yield,              YieldNode,              "YIELD")            \
+    X(YieldFrom,          YieldFromNode,          "YIELD_FROM")       \
+    X(TypeParam,          TypeParamNode,          "TYPE_PARAM")       \
+    X(TypeAlias,          TypeAliasNode,          "TYPE_ALIAS")       \
+    X(Global,             GlobalNode,             "GLOBAL")           \
+    X(NonLocal,           NonLocalNode,           "NONLOCAL")         \
+    X(Del,                DelNode,                "DEL")              \
+    X(Await,              AwaitNode,              "AWAIT")            \
+    X(WithItem,           WithItemNode,           "WITH_ITEM")        \
+    X(With,               WithNode,               "WITH")             \
+    X(AsyncWith,          AsyncWithNode,          "ASYNC_WITH")       \
+    X(Assertion,          AssertionNode,          "ASSERTION")        \
+    X(Slice,              SliceNode,              "SLICE")
+
+STDROMANO_API const char* node_type_as_string(std::uint32_t type) noexcept;
+
 struct Node
 {
     std::uint32_t _type;
@@ -296,7 +400,7 @@ struct Node
     std::uint32_t line() const noexcept { return _line; }
     std::uint32_t column() const noexcept { return _column; }
 
-    virtual const char* type_str() const noexcept { return "NODE"; }
+    const char* type_str() const noexcept { return node_type_as_string(this->_type); }
 
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept
     {
@@ -304,16 +408,64 @@ struct Node
     }
 };
 
+// Exact-size array allocated in the AST arena, used for the child lists (and names) of the nodes.
+// Lists are built on a scratch stack while parsing and copied to the arena once complete. An
+// array does not own its memory, it is released with the nodes when the arena is cleared
+
+template<typename T>
+class ArenaArray
+{
+    T* _data = nullptr;
+    std::uint32_t _size = 0;
+
+public:
+    using value_type = T;
+
+    ArenaArray() = default;
+
+    ArenaArray(T* data, std::uint32_t size) noexcept : _data(data), _size(size) {}
+
+    std::size_t size() const noexcept { return this->_size; }
+    bool empty() const noexcept { return this->_size == 0; }
+
+    T* data() noexcept { return this->_data; }
+    const T* data() const noexcept { return this->_data; }
+
+    T& operator[](const std::size_t i) noexcept
+    {
+        STDROMANO_ASSERT(i < this->_size, "Out of bounds access");
+        return this->_data[i];
+    }
+
+    const T& operator[](const std::size_t i) const noexcept
+    {
+        STDROMANO_ASSERT(i < this->_size, "Out of bounds access");
+        return this->_data[i];
+    }
+
+    T& front() noexcept { return this->operator[](0); }
+    const T& front() const noexcept { return this->operator[](0); }
+
+    T& back() noexcept { return this->operator[](this->_size - 1); }
+    const T& back() const noexcept { return this->operator[](this->_size - 1); }
+
+    T* begin() noexcept { return this->_data; }
+    T* end() noexcept { return this->_data + this->_size; }
+
+    const T* begin() const noexcept { return this->_data; }
+    const T* end() const noexcept { return this->_data + this->_size; }
+};
+
+using NodeList = ArenaArray<Node*>;
+
 // Module (top-level node for files)
 
 struct ModuleNode : Node
 {
-    Vector<Node*> body;
+    NodeList body;
 
     ModuleNode() : Node(ASTNodeModule, 0, 0) {}
 
-    virtual const char* type_str() const noexcept override { return "MODULE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MODULE", "", indent);
@@ -334,8 +486,6 @@ struct DecoratorNode : Node
                                           expr(expr),
                                           target(target) {}
 
-        virtual const char* type_str() const noexcept override { return "DECORATOR"; }
-
         virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
         {
             logger->debug("{0: ^{1}}DECORATOR", "", indent);
@@ -359,8 +509,6 @@ struct FunctionArgNode : Node
                                                                                                 is_vararg(false),
                                                                                                 is_kwarg(false) {}
 
-    virtual const char* type_str() const noexcept override { return "FUNC_ARG"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}FUNCARG ({2})", "", indent, this->name);
@@ -370,10 +518,10 @@ struct FunctionArgNode : Node
 struct FunctionDefNode : Node
 {
     StringD name;
-    Vector<Node*> args;
-    Vector<Node*> body;
+    NodeList args;
+    NodeList body;
     Node* return_annotation = nullptr;
-    Vector<Node*> type_params;
+    NodeList type_params;
     std::int32_t posonly_index = -1; // index of '/' separator, -1 if absent
     std::int32_t kwonly_index = -1; // index of bare '*' separator, -1 if absent
 
@@ -381,8 +529,6 @@ struct FunctionDefNode : Node
                                                                               name(std::move(name)),
                                                                               return_annotation(nullptr) {}
 
-    virtual const char* type_str() const noexcept override { return "FUNC_DEF"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}FUNCDEF ({2})", "", indent, this->name);
@@ -392,18 +538,16 @@ struct FunctionDefNode : Node
 struct AsyncFunctionDefNode : Node
 {
     StringD name;
-    Vector<Node*> args;
-    Vector<Node*> body;
+    NodeList args;
+    NodeList body;
     Node* return_annotation = nullptr;
-    Vector<Node*> type_params;
+    NodeList type_params;
     std::int32_t posonly_index = -1; // index of '/' separator, -1 if absent
     std::int32_t kwonly_index = -1; // index of bare '*' separator, -1 if absent
 
     AsyncFunctionDefNode(StringD name, std::uint32_t line, std::uint32_t column) : Node(ASTNodeAsyncFunctionDef, line, column),
                                                                                    name(std::move(name)) {}
 
-    virtual const char* type_str() const noexcept override { return "ASYNC_FUNC_DEF"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ASYNC_FUNC_DEF ({2})", "", indent, this->name);
@@ -415,15 +559,13 @@ struct AsyncFunctionDefNode : Node
 struct ClassDefNode : Node
 {
     StringD name;
-    Vector<Node*> bases;
-    Vector<Node*> body;
-    Vector<Node*> type_params;
+    NodeList bases;
+    NodeList body;
+    NodeList type_params;
 
     ClassDefNode(StringD name, std::uint32_t line, std::uint32_t column) : Node(ASTNodeClassDef, line, column),
                                                                            name(std::move(name)) {}
 
-    virtual const char* type_str() const noexcept override { return "CLASS_DEF"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}CLASSDEF ({2})", "", indent, this->name);
@@ -439,8 +581,6 @@ struct ReturnNode : Node
     ReturnNode(Node* value, std::uint32_t line, std::uint32_t column) : Node(ASTNodeReturn, line, column),
                                                                         value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "RETURN"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}RETURN", "", indent);
@@ -451,14 +591,12 @@ struct ReturnNode : Node
 
 struct AssignNode : Node
 {
-    Vector<Node*> targets;
+    NodeList targets;
     Node* value;
 
     AssignNode(Node* value, std::uint32_t line, std::uint32_t column) : Node(ASTNodeAssign, line, column),
                                                                         value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "ASSIGN"; };
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ASSIGN", "", indent);
@@ -476,8 +614,6 @@ struct AnnAssignNode : Node
                                                                                                     value(value),
                                                                                                     ann(ann) {}
 
-    virtual const char* type_str() const noexcept override { return "ANN_ASSIGN"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ANNASSIGN", "", indent);
@@ -486,13 +622,11 @@ struct AnnAssignNode : Node
 
 struct MultiAssignNode : Node
 {
-    Vector<Node*> targets;
-    Vector<Node*> values;
+    NodeList targets;
+    NodeList values;
 
     MultiAssignNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeMultiAssign, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "MULTI_ASSIGN"; };
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MULTIASSIGN", "", indent);
@@ -510,8 +644,6 @@ struct AugAssignNode : Node
                                                                                                       op(op),
                                                                                                       value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "AUG_ASSIGN"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}AUGASSIGN ({2})", "", indent, this->op);
@@ -527,8 +659,6 @@ struct WalrusAssignNode : Node
                                                                                             target(target),
                                                                                             value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "WALRUS_ASSIGN"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}WALRUSASSIGN", "", indent);
@@ -539,16 +669,14 @@ struct WalrusAssignNode : Node
 
 struct ForNode : Node
 {
-    Vector<Node*> targets;
+    NodeList targets;
     Node* iter;
-    Vector<Node*> body;
-    Vector<Node*> orelse;
+    NodeList body;
+    NodeList orelse;
 
     ForNode(Node* iter, std::uint32_t line, std::uint32_t column) : Node(ASTNodeFor, line, column),
                                                                     iter(iter) {}
 
-    virtual const char* type_str() const noexcept override { return "FOR"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}FOR", "", indent);
@@ -557,16 +685,14 @@ struct ForNode : Node
 
 struct AsyncForNode : Node
 {
-    Vector<Node*> targets;
+    NodeList targets;
     Node* iter;
-    Vector<Node*> body;
-    Vector<Node*> orelse;
+    NodeList body;
+    NodeList orelse;
 
     AsyncForNode(Node* iter, std::uint32_t line, std::uint32_t column) : Node(ASTNodeAsyncFor, line, column),
                                                                          iter(iter) {}
 
-    virtual const char* type_str() const noexcept override { return "ASYNC_FOR"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ASYNC_FOR", "", indent);
@@ -576,14 +702,12 @@ struct AsyncForNode : Node
 struct WhileNode : Node
 {
     Node* test;
-    Vector<Node*> body;
-    Vector<Node*> orelse;
+    NodeList body;
+    NodeList orelse;
 
     WhileNode(Node* test, std::uint32_t line, std::uint32_t column) : Node(ASTNodeWhile, line, column),
                                                                       test(test) {}
 
-    virtual const char* type_str() const noexcept override { return "WHILE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}WHILE", "", indent);
@@ -593,14 +717,12 @@ struct WhileNode : Node
 struct IfNode : Node
 {
     Node* test;
-    Vector<Node*> body;
-    Vector<Node*> orelse;
+    NodeList body;
+    NodeList orelse;
 
     IfNode(Node* test, std::uint32_t line, std::uint32_t column) : Node(ASTNodeIf, line, column),
                                                                    test(test) {}
 
-    virtual const char* type_str() const noexcept override { return "IF"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}IF","", indent);
@@ -611,8 +733,6 @@ struct PassNode : Node
 {
     PassNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodePass, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "PASS"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}PASS", "", indent);
@@ -623,8 +743,6 @@ struct BreakNode : Node
 {
     BreakNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeBreak, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "BREAK"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}BREAK", "", indent);
@@ -635,8 +753,6 @@ struct ContinueNode : Node
 {
     ContinueNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeContinue, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "CONTINUE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}CONTINUE", "", indent);
@@ -647,13 +763,11 @@ struct ContinueNode : Node
 
 struct ImportNode : Node
 {
-    Vector<StringD> names;
-    Vector<StringD> aliases;
+    ArenaArray<StringD> names;
+    ArenaArray<StringD> aliases;
 
     ImportNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeImport, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "IMPORT"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         const StringD import_names = join(this->names, [](StringD name) { return name; }, ", ");
@@ -665,14 +779,12 @@ struct ImportNode : Node
 struct ImportFromNode : Node
 {
     StringD module;
-    Vector<StringD> names;
-    Vector<StringD> aliases;
+    ArenaArray<StringD> names;
+    ArenaArray<StringD> aliases;
 
     ImportFromNode(StringD module, std::uint32_t line, std::uint32_t column) : Node(ASTNodeImportFrom, line, column),
                                                                                module(std::move(module)) {}
 
-    virtual const char* type_str() const noexcept override { return "IMPORT_FROM"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}IMPORT FROM ({2})", "", indent, this->module);
@@ -688,8 +800,6 @@ struct ExprNode : Node
     ExprNode(Node* value, std::uint32_t line, std::uint32_t column) : Node(ASTNodeExpr, line, column),
                                                                       value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "EXPR"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}EXPR", "", indent);
@@ -707,8 +817,6 @@ struct RaiseNode : Node
                                                                                   exc(exc),
                                                                                   cause(cause) {}
 
-    virtual const char* type_str() const noexcept override { return "RAISE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}RAISE", "", indent);
@@ -717,15 +825,13 @@ struct RaiseNode : Node
 
 struct TryNode : Node
 {
-    Vector<Node*> body;
-    Vector<Node*> excepts;
-    Vector<Node*> orelse; // else block
-    Vector<Node*> finalbody; // finally block
+    NodeList body;
+    NodeList excepts;
+    NodeList orelse; // else block
+    NodeList finalbody; // finally block
 
     TryNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeTry, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "TRY"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}TRY", "", indent);
@@ -734,16 +840,14 @@ struct TryNode : Node
 
 struct ExceptNode : Node
 {
-    Vector<Node*> types; // exception type, empty for 'except:'
-    Vector<StringD> names;
-    Vector<Node*> body;
+    NodeList types; // exception type, empty for 'except:'
+    ArenaArray<StringD> names;
+    NodeList body;
     bool is_star; // except* for exception groups
 
     ExceptNode(bool is_star, std::uint32_t line, std::uint32_t column) : Node(ASTNodeExcept, line, column),
                                                                          is_star(is_star) {}
 
-    virtual const char* type_str() const noexcept override { return "EXCEPT"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}EXCEPT", "", indent);
@@ -761,8 +865,6 @@ struct UnaryOpNode : Node
                                                                                         op(op),
                                                                                         operand(operand) {}
 
-    virtual const char* type_str() const noexcept override { return "UNARY_OP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}UNOP ({2})", "", indent, this->op);
@@ -780,8 +882,6 @@ struct BinOpNode : Node
                                                                                                 op(op),
                                                                                                 right(right) {}
 
-    virtual const char* type_str() const noexcept override { return "BINARY_OP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}BINOP ({2})", "", indent, this->op);
@@ -803,8 +903,6 @@ struct TernaryOpNode : Node
                                           test(test),
                                           orelse(orelse) {}
 
-    virtual const char* type_str() const noexcept override { return "TERNARY_OP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}TERNARYOP", "", indent);
@@ -814,13 +912,11 @@ struct TernaryOpNode : Node
 struct BoolOpNode : Node
 {
     Operator op;
-    Vector<Node*> values;
+    NodeList values;
 
     BoolOpNode(Operator op, std::uint32_t line, std::uint32_t column) : Node(ASTNodeBoolOp, line, column),
                                                                         op(op) {}
 
-    virtual const char* type_str() const noexcept override { return "BOOL_OP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}BOOLOP ({2})", "", indent, this->op);
@@ -830,14 +926,12 @@ struct BoolOpNode : Node
 struct CompareOp : Node
 {
     Node* left;
-    Vector<Operator> ops;
-    Vector<Node*> comparators;
+    ArenaArray<Operator> ops;
+    NodeList comparators;
 
     CompareOp(Node* left, std::uint32_t line, std::uint32_t column) : Node(ASTNodeCompareOp, line, column),
                                                                         left(left) {}
 
-    virtual const char* type_str() const noexcept override { return "COMPARE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}COMPARE", "", indent);
@@ -858,8 +952,6 @@ struct KeywordArgNode : Node
                                            name(std::move(name)),
                                            value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "KEYWORD_ARG"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}KEYWORDARG", "", indent);
@@ -869,13 +961,11 @@ struct KeywordArgNode : Node
 struct CallNode : Node
 {
     Node* func;
-    Vector<Node*> args;
+    NodeList args;
 
     CallNode(Node* func, std::uint32_t line, std::uint32_t column) : Node(ASTNodeCall, line, column),
                                                                      func(func) {}
 
-    virtual const char* type_str() const noexcept override { return "CALL"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}CALL", "", indent);
@@ -893,8 +983,6 @@ struct NameNode : Node
     NameNode(StringD id, std::uint32_t line, std::uint32_t column) : Node(ASTNodeName, line, column),
                                                                      id(std::move(id)) {}
 
-    virtual const char* type_str() const noexcept override { return "NAME"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}NAME (\"{2}\")", "", indent, this->id);
@@ -910,8 +998,6 @@ struct ConstantNode : Node
                                                                                                 raw(std::move(raw)),
                                                                                                 literal_type(literal_type) {}
 
-    virtual const char* type_str() const noexcept override { return "CONSTANT"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}CONSTANT ({2}: {3})", "", indent, this->literal_type, this->raw);
@@ -930,8 +1016,6 @@ struct AttributeNode : Node
                                                                                          value(value),
                                                                                          attr(std::move(attr)) {}
 
-    virtual const char* type_str() const noexcept override { return "ATTRIBUTE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ATTRIBUTE ({2})", "", indent, this->attr);
@@ -947,8 +1031,6 @@ struct SubscriptNode : Node
                                                                                         value(value),
                                                                                         slice(slice) {}
 
-    virtual const char* type_str() const noexcept override { return "SUBSCRIPT"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}SUBSCRIPT", "", indent);
@@ -964,8 +1046,6 @@ struct StarredNode : Node
     StarredNode(Node* value, std::uint32_t line, std::uint32_t column) : Node(ASTNodeStarred, line, column),
                                                                          value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "STARRED"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}STARRED", "", indent);
@@ -976,12 +1056,10 @@ struct StarredNode : Node
 
 struct ListNode : Node
 {
-    Vector<Node*> elts;
+    NodeList elts;
 
     ListNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeList, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "LIST"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}LIST ({2} elements)", "", indent, this->elts.size());
@@ -990,12 +1068,10 @@ struct ListNode : Node
 
 struct SetNode : Node
 {
-    Vector<Node*> elts;
+    NodeList elts;
 
     SetNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeSet, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "SET"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}SET ({2} elements)", "", indent, this->elts.size());
@@ -1004,12 +1080,10 @@ struct SetNode : Node
 
 struct TupleNode : Node
 {
-    Vector<Node*> elts;
+    NodeList elts;
 
     TupleNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeTuple, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "TUPLE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}TUPLE ({2} elements)", "", indent, this->elts.size());
@@ -1018,13 +1092,11 @@ struct TupleNode : Node
 
 struct DictNode : Node
 {
-    Vector<Node*> keys;
-    Vector<Node*> values;
+    NodeList keys;
+    NodeList values;
 
     DictNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeDict, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "DICT"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}DICT ({2} elements)", "", indent, this->keys.size());
@@ -1037,7 +1109,7 @@ struct ComprehensionNode : Node
 {
     Node* target;
     Node* iter;
-    Vector<Node*> ifs;
+    NodeList ifs;
 
     ComprehensionNode(Node* target,
                       Node* iter,
@@ -1046,8 +1118,6 @@ struct ComprehensionNode : Node
                                               target(target),
                                               iter(iter) {}
 
-    virtual const char* type_str() const noexcept override { return "COMP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}COMP", "", indent);
@@ -1058,7 +1128,7 @@ struct AsyncComprehensionNode : Node
 {
     Node* target;
     Node* iter;
-    Vector<Node*> ifs;
+    NodeList ifs;
 
     AsyncComprehensionNode(Node* target,
                            Node* iter,
@@ -1067,8 +1137,6 @@ struct AsyncComprehensionNode : Node
                                                    target(target),
                                                    iter(iter) {}
 
-    virtual const char* type_str() const noexcept override { return "ASYNC_COMP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ASYNC_COMP", "", indent);
@@ -1078,13 +1146,11 @@ struct AsyncComprehensionNode : Node
 struct ListCompNode : Node
 {
     Node* elt;
-    Vector<Node*> generators;
+    NodeList generators;
 
     ListCompNode(Node* elt, std::uint32_t line, std::uint32_t column) : Node(ASTNodeListComp, line, column),
                                                                         elt(elt) {}
 
-    virtual const char* type_str() const noexcept override { return "LIST_COMP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}LISTCOMP", "", indent);
@@ -1094,13 +1160,11 @@ struct ListCompNode : Node
 struct SetCompNode : Node
 {
     Node* elt;
-    Vector<Node*> generators;
+    NodeList generators;
 
     SetCompNode(Node* elt, std::uint32_t line, std::uint32_t column) : Node(ASTNodeSetComp, line, column),
                                                                        elt(elt) {}
 
-    virtual const char* type_str() const noexcept override { return "SET_COMP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}SETCOMP", "", indent);
@@ -1111,14 +1175,12 @@ struct DictCompNode : Node
 {
     Node* key;
     Node* value;
-    Vector<Node*> generators;
+    NodeList generators;
 
     DictCompNode(Node* key, Node* value, std::uint32_t line, std::uint32_t column) : Node(ASTNodeDictComp, line, column),
                                                                                      key(key),
                                                                                      value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "DICT_COMP"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}DICTCOMP", "", indent);
@@ -1128,13 +1190,11 @@ struct DictCompNode : Node
 struct GeneratorExprNode : Node
 {
     Node* elt;
-    Vector<Node*> generators;
+    NodeList generators;
 
     GeneratorExprNode(Node* elt, std::uint32_t line, std::uint32_t column) : Node(ASTNodeGeneratorExpr, line, column),
                                                                              elt(elt) {}
 
-    virtual const char* type_str() const noexcept override { return "GENERATOR_EXPR"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}GENERATOREXPR", "", indent);
@@ -1145,7 +1205,7 @@ struct GeneratorExprNode : Node
 
 struct LambdaNode : Node
 {
-    Vector<Node*> args;
+    NodeList args;
     Node* body;
     std::int32_t posonly_index = -1;
     std::int32_t kwonly_index = -1;
@@ -1153,8 +1213,6 @@ struct LambdaNode : Node
     LambdaNode(Node* body, std::uint32_t line, std::uint32_t column) : Node(ASTNodeLambda, line, column),
                                                                        body(body) {}
 
-    virtual const char* type_str() const noexcept override { return "LAMBDA"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}LAMBDA ({2} args)", "", indent, this->args.size());
@@ -1166,15 +1224,13 @@ struct LambdaNode : Node
 struct MatchNode : Node
 {
     Node* subject;
-    Vector<Node*> cases;
+    NodeList cases;
 
     MatchNode(Node* subject,
               std::uint32_t line,
               std::uint32_t column) : Node(ASTNodeMatch, line, column),
                                       subject(subject) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCH", "", indent);
@@ -1185,7 +1241,7 @@ struct MatchCaseNode : Node
 {
     Node* pattern;
     Node* guard; // optional 'if' condition, nullptr if absent
-    Vector<Node*> body;
+    NodeList body;
 
     MatchCaseNode(Node* pattern,
                   Node* guard,
@@ -1194,8 +1250,6 @@ struct MatchCaseNode : Node
                                           pattern(pattern),
                                           guard(guard) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_CASE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHCASE", "", indent);
@@ -1205,13 +1259,11 @@ struct MatchCaseNode : Node
 // pattern1 | pattern2 | ...
 struct MatchOrNode : Node
 {
-    Vector<Node*> patterns;
+    NodeList patterns;
 
     MatchOrNode(std::uint32_t line,
                 std::uint32_t column) : Node(ASTNodeMatchOr, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_OR"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHOR", "", indent);
@@ -1231,8 +1283,6 @@ struct MatchAsNode : Node
                                         pattern(pattern),
                                         name(std::move(name)) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_AS"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHAS", "", indent);
@@ -1249,8 +1299,6 @@ struct MatchValueNode : Node
                    std::uint32_t column) : Node(ASTNodeMatchValue, line, column),
                                            value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_VALUE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHVALUE", "", indent);
@@ -1267,8 +1315,6 @@ struct MatchSingletonNode : Node
                        std::uint32_t column) : Node(ASTNodeMatchSingleton, line, column),
                                                value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_SINGLETON"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHSINGLETON", "", indent);
@@ -1278,13 +1324,11 @@ struct MatchSingletonNode : Node
 // [p1, p2, *rest, p3]
 struct MatchSequenceNode : Node
 {
-    Vector<Node*> patterns;
+    NodeList patterns;
 
     MatchSequenceNode(std::uint32_t line,
                       std::uint32_t column) : Node(ASTNodeMatchSequence, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_SEQUENCE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHSEQUENCE", "", indent);
@@ -1294,15 +1338,13 @@ struct MatchSequenceNode : Node
 // {"key": pattern, **rest}
 struct MatchMappingNode : Node
 {
-    Vector<Node*> keys;
-    Vector<Node*> patterns;
+    NodeList keys;
+    NodeList patterns;
     StringD rest; // **rest name, empty if absent
 
     MatchMappingNode(std::uint32_t line,
                      std::uint32_t column) : Node(ASTNodeMatchMapping, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_MAPPING"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHMAPPING", "", indent);
@@ -1313,17 +1355,15 @@ struct MatchMappingNode : Node
 struct MatchClassNode : Node
 {
     Node* cls;
-    Vector<Node*> patterns;
-    Vector<StringD> kwd_attrs;
-    Vector<Node*> kwd_patterns;
+    NodeList patterns;
+    ArenaArray<StringD> kwd_attrs;
+    NodeList kwd_patterns;
 
     MatchClassNode(Node* cls,
                    std::uint32_t line,
                    std::uint32_t column) : Node(ASTNodeMatchClass, line, column),
                                            cls(cls) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_CLASS"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHCLASS", "", indent);
@@ -1340,8 +1380,6 @@ struct MatchStarNode : Node
                   std::uint32_t column) : Node(ASTNodeMatchStar, line, column),
                                           name(std::move(name)) {}
 
-    virtual const char* type_str() const noexcept override { return "MATCH_STAR"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}MATCHSTAR", "", indent);
@@ -1359,8 +1397,6 @@ struct YieldNode : Node
               std::uint32_t column) : Node(ASTNodeYield, line, column),
                                       value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "YIELD"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}YIELD", "", indent);
@@ -1376,8 +1412,6 @@ struct YieldFromNode : Node
                   std::uint32_t column) : Node(ASTNodeYieldFrom, line, column),
                                           value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "YIELD_FROM"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}YIELDFROM", "", indent);
@@ -1400,8 +1434,6 @@ struct TypeParamNode : Node
                   std::uint32_t column) : Node(ASTNodeTypeParam, line, column),
                                           name(std::move(name)) {}
 
-    virtual const char* type_str() const noexcept override { return "TYPE_PARAM"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}TYPEPARAM", "", indent);
@@ -1411,7 +1443,7 @@ struct TypeParamNode : Node
 struct TypeAliasNode : Node
 {
     StringD name;
-    Vector<Node*> type_params;
+    NodeList type_params;
     Node* value;
 
     TypeAliasNode(StringD name,
@@ -1421,8 +1453,6 @@ struct TypeAliasNode : Node
                                           name(std::move(name)),
                                           value(value) {}
 
-    virtual const char* type_str() const noexcept override { return "TYPE_ALIAS"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}TYPEPALIAS", "", indent);
@@ -1433,12 +1463,10 @@ struct TypeAliasNode : Node
 
 struct GlobalNode : Node
 {
-    Vector<Node*> names;
+    NodeList names;
 
     GlobalNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeGlobal, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "GLOBAL"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}GLOBAL", "", indent);
@@ -1447,12 +1475,10 @@ struct GlobalNode : Node
 
 struct NonLocalNode : Node
 {
-    Vector<Node*> names;
+    NodeList names;
 
     NonLocalNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeNonLocal, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "NONLOCAL"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}NONLOCAL", "", indent);
@@ -1463,12 +1489,10 @@ struct NonLocalNode : Node
 
 struct DelNode : Node
 {
-    Vector<Node*> names;
+    NodeList names;
 
     DelNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeDel, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "DEL"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}DEL", "", indent);
@@ -1484,8 +1508,6 @@ struct AwaitNode : Node
     AwaitNode(Node* expr, std::uint32_t line, std::uint32_t column) : Node(ASTNodeAwait, line, column),
                                                                       expr(expr) {}
 
-    virtual const char* type_str() const noexcept override { return "AWAIT"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}AWAIT", "", indent);
@@ -1503,8 +1525,6 @@ struct WithItemNode : Node
                                                                                                       context_expr(context_expr),
                                                                                                       optional_vars(optional_vars) {}
 
-    virtual const char* type_str() const noexcept override { return "WITH_ITEM"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}WITH_ITEM", "", indent);
@@ -1513,13 +1533,11 @@ struct WithItemNode : Node
 
 struct WithNode : Node
 {
-    Vector<Node*> items;
-    Vector<Node*> body;
+    NodeList items;
+    NodeList body;
 
     WithNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeWith, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "WITH"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}WITH", "", indent);
@@ -1528,13 +1546,11 @@ struct WithNode : Node
 
 struct AsyncWithNode : Node
 {
-    Vector<Node*> items;
-    Vector<Node*> body;
+    NodeList items;
+    NodeList body;
 
     AsyncWithNode(std::uint32_t line, std::uint32_t column) : Node(ASTNodeAsyncWith, line, column) {}
 
-    virtual const char* type_str() const noexcept override { return "ASYNC_WITH"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ASYNC_WITH", "", indent);
@@ -1552,8 +1568,6 @@ struct AssertionNode : Node
                                                                                          expr(expr),
                                                                                          message(message) {}
 
-    virtual const char* type_str() const noexcept override { return "ASSERTION"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}ASSERTION", "", indent);
@@ -1573,8 +1587,6 @@ struct SliceNode : Node
                                                                                                 upper(upper),
                                                                                                 step(step) {}
 
-    virtual const char* type_str() const noexcept override { return "SLICE"; }
-
     virtual void debug(std::shared_ptr<spdlog::logger> logger, std::uint32_t indent) const noexcept override
     {
         logger->debug("{0: ^{1}}SLICE", "", indent);
@@ -1587,24 +1599,144 @@ struct SliceNode : Node
 // Used by the generic visitor to recurse automatically.
 STDROMANO_API void node_children(Node* node, Vector<Node*>& out) noexcept;
 
+// Depth-first traversal with an explicit stack. The stack and the children buffer are kept across
+// walks, so walking a tree does not allocate once they have grown to its depth. A walker cannot be
+// used by nested walks
+
+class Walker
+{
+    struct Entry
+    {
+        Node* node;
+        std::uint32_t depth;
+        bool leave;
+    };
+
+    Vector<Entry> _stack;
+    Vector<Node*> _children;
+
+public:
+    Walker() = default;
+
+    STDROMANO_NON_COPYABLE(Walker);
+
+    // pre(node, depth) is called before the children of node and returns false to skip them.
+    // post(node, depth) is called after them, for the nodes whose children were not skipped
+
+    template<typename Pre, typename Post>
+    void walk(Node* root, Pre&& pre, Post&& post, const std::uint32_t depth = 0) noexcept
+    {
+        if(root == nullptr)
+            return;
+
+        this->_stack.clear();
+        this->_stack.push_back({ root, depth, false });
+
+        while(!this->_stack.empty())
+        {
+            const Entry entry = this->_stack.pop_back();
+
+            if(entry.leave)
+            {
+                post(entry.node, entry.depth);
+                continue;
+            }
+
+            if(!pre(entry.node, entry.depth))
+                continue;
+
+            this->_stack.push_back({ entry.node, entry.depth, true });
+
+            this->_children.clear();
+            node_children(entry.node, this->_children);
+
+            // Pushed in reverse, to be visited in order
+            for(std::size_t i = this->_children.size(); i > 0; --i)
+            {
+                if(this->_children[i - 1] != nullptr)
+                    this->_stack.push_back({ this->_children[i - 1], entry.depth + 1, false });
+            }
+        }
+    }
+
+    template<typename Pre>
+    void walk(Node* root, Pre&& pre, const std::uint32_t depth = 0) noexcept
+    {
+        this->walk(root, std::forward<Pre>(pre), [](Node*, std::uint32_t) {}, depth);
+    }
+};
+
 // Visit all nodes depth-first. The visitor callable receives Node* and returns
 // true to recurse into children, false to skip them.
 template<typename F>
 void visit(Node* node, F&& visitor, std::uint32_t depth = 0) noexcept
 {
-    if(node == nullptr)
-        return;
+    Walker walker;
+    walker.walk(node, std::forward<F>(visitor), depth);
+}
 
-    if(!visitor(node, depth))
-        return;
+// Visitor dispatching on the node type at compile time. The derived visitor defines the hooks it
+// needs, hiding the default ones:
+//
+//   struct CallCounter : Visitor<CallCounter>
+//   {
+//       std::size_t num_calls = 0;
+//
+//       bool visit_Call(CallNode* node) noexcept { this->num_calls++; return true; }
+//   };
+//
+// pre(node, depth) is called first for each node, then visit_<Name>(node) with the node cast to
+// its type. Both return false to skip the children of the node. post(node, depth) is called once
+// the children were visited. There are no virtual calls, and the walker of the visitor is reused
+// across walks
 
-    Vector<Node*> children;
+template<typename Derived>
+class Visitor
+{
+    Walker _walker;
 
-    node_children(node, children);
+public:
+    void walk(Node* root) noexcept
+    {
+        Derived* self = static_cast<Derived*>(this);
 
-    for(auto* child : children)
-        visit(child, visitor, depth + 1);
-}
+        this->_walker.walk(root,
+                           [self](Node* node, std::uint32_t depth) -> bool {
+                               return self->pre(node, depth) && Visitor::dispatch(self, node);
+                           },
+                           [self](Node* node, std::uint32_t depth) {
+                               self->post(node, depth);
+                           });
+    }
+
+    bool pre(Node*, std::uint32_t) noexcept { return true; }
+    void post(Node*, std::uint32_t) noexcept {}
+
+#define STDROMANO_PYTHON_VISITOR_HOOK(Name, Type, String) \
+    bool visit_##Name(Type*) noexcept { return true; }
+
+    STDROMANO_PYTHON_AST_NODES(STDROMANO_PYTHON_VISITOR_HOOK)
+
+#undef STDROMANO_PYTHON_VISITOR_HOOK
+
+private:
+    static bool dispatch(Derived* self, Node* node) noexcept
+    {
+        switch(node->type())
+        {
+#define STDROMANO_PYTHON_VISITOR_CASE(Name, Type, String) \
+            case ASTNode##Name:                            \
+                return self->visit_##Name(static_cast<Type*>(node));
+
+            STDROMANO_PYTHON_AST_NODES(STDROMANO_PYTHON_VISITOR_CASE)
+
+#undef STDROMANO_PYTHON_VISITOR_CASE
+
+            default:
+                return true;
+        }
+    }
+};
 
 class STDROMANO_API AST
 {
@@ -1628,6 +1760,213 @@ public:
     bool from_text(const StringD& buffer, const bool debug = false) noexcept;
 };
 
+// File parsed by an ASTBatch
+
+struct ParsedFile
+{
+    StringD path;
+
+    // Null if the file cannot be read or lexed. If it cannot be parsed, holds the statements
+    // parsed before the error
+    ModuleNode* root = nullptr;
+
+    // Errors logged while lexing and parsing the file, one per line
+    StringD diagnostics;
+
+    bool success = false;
+};
+
+// Parses many files concurrently on the global thread pool. Each worker allocates the ASTs it
+// parses in its own arena, and logs to its own logger capturing the diagnostics of the file being
+// parsed. Files are reported in the order they were given, the ASTs being valid until the next
+// parse or the destruction of the batch
+
+class STDROMANO_API ASTBatch
+{
+    friend struct ASTBatch_;
+
+    Vector<ParsedFile> _files;
+
+    std::unique_ptr<Arena[]> _arenas;
+    std::size_t _num_arenas;
+
+    std::size_t _num_errors;
+
+public:
+    ASTBatch() noexcept : _num_arenas(0), _num_errors(0) {}
+
+    STDROMANO_NON_COPYABLE(ASTBatch);
+
+    // Parses the files, returns false if any of them cannot be parsed
+
+    bool parse_files(const Vector<StringD>& paths) noexcept;
+
+    // Parses all the .py files under path, in walk order. Returns false if path does not exist or
+    // any of the files cannot be parsed
+
+    bool parse_tree(const StringD& path) noexcept;
+
+    const Vector<ParsedFile>& files() const noexcept { return this->_files; }
+
+    std::size_t num_files() const noexcept { return this->_files.size(); }
+    std::size_t num_errors() const noexcept { return this->_num_errors; }
+};
+
+// Compact AST
+
+// Index of an absent node
+static constexpr std::uint32_t FLAT_NONE = 0xFFFFFFFF;
+
+// Node indices of a list of children, in the extra data of a flat AST
+
+struct FlatList
+{
+    const std::uint32_t* data = nullptr;
+    std::uint32_t size = 0;
+
+    const std::uint32_t* begin() const noexcept { return this->data; }
+    const std::uint32_t* end() const noexcept { return this->data + this->size; }
+
+    std::uint32_t operator[](const std::uint32_t i) const noexcept
+    {
+        STDROMANO_ASSERT(i < this->size, "Index out of bounds");
+        return this->data[i];
+    }
+};
+
+// Reads the fields of a node record in order, see FlatAST
+
+class FlatRecord
+{
+    const std::uint32_t* _data;
+
+public:
+    explicit FlatRecord(const std::uint32_t* data) noexcept : _data(data) {}
+
+    // Scalar, string offset or node index
+    std::uint32_t word() noexcept { return *this->_data++; }
+
+    // Count, followed by as many words
+    FlatList list() noexcept
+    {
+        FlatList list;
+        list.size = *this->_data++;
+        list.data = this->_data;
+
+        this->_data += list.size;
+
+        return list;
+    }
+};
+
+// Flat representation of an AST, for keeping the ASTs of large code bases in memory and scanning
+// them. Nodes are stored in pre-order as parallel arrays addressed by 32-bit indices: the subtree
+// of a node spans the indices [node, end(node)), so a traversal is a linear scan.
+//
+// The fields of a node are stored in its record, in the extra data:
+//   - the scalar fields, in declaration order: strings as offsets in the string table (0 for the
+//     empty string), string and operator lists as a count followed by the values, enums, flags and
+//     indices as a word
+//   - the child fields, in traversal order (see node_children): single children as a node index
+//     (FLAT_NONE if absent), lists of children as a count followed by the node indices
+//
+// The arrays only reference each other by index, and can be copied or mapped as they are, then
+// loaded back with from_arrays
+
+// Raw arrays of a flat AST, the per-node arrays having num_nodes elements
+
+struct FlatArrays
+{
+    const std::uint8_t* types = nullptr;
+    const std::uint32_t* lines = nullptr;
+    const std::uint32_t* columns = nullptr;
+    const std::uint32_t* parents = nullptr;
+    const std::uint32_t* ends = nullptr;
+    const std::uint32_t* records = nullptr;
+    std::uint32_t num_nodes = 0;
+
+    const std::uint32_t* extra = nullptr;
+    std::uint32_t extra_size = 0;
+
+    const char* strings = nullptr;
+    std::uint32_t strings_size = 0;
+};
+
+class STDROMANO_API FlatAST
+{
+    friend struct FlatAST_;
+
+    Vector<std::uint8_t> _types;
+    Vector<std::uint32_t> _lines;
+    Vector<std::uint32_t> _columns;
+    Vector<std::uint32_t> _parents;
+    Vector<std::uint32_t> _ends;
+    Vector<std::uint32_t> _records;
+
+    Vector<std::uint32_t> _extra;
+
+    // Null-terminated strings, each stored once
+    Vector<char> _strings;
+
+public:
+    FlatAST() = default;
+
+    STDROMANO_NON_COPYABLE(FlatAST);
+
+    FlatAST(FlatAST&& other) noexcept = default;
+    FlatAST& operator=(FlatAST&& other) noexcept = default;
+
+    // Converts the tree under root. Returns false, leaving the flat AST empty, if the tree has too
+    // many nodes to be indexed
+
+    bool from_tree(const Node* root) noexcept;
+
+    // Copies the raw arrays of a flat AST, e.g. read from a file. Returns false, leaving the flat
+    // AST empty, if the node arrays or the string table are inconsistent. The layout of the
+    // records is not checked, the arrays must come from a flat AST built by the same version
+
+    bool from_arrays(const FlatArrays& arrays) noexcept;
+
+    void clear() noexcept;
+
+    std::uint32_t size() const noexcept { return static_cast<std::uint32_t>(this->_types.size()); }
+    bool empty() const noexcept { return this->_types.empty(); }
+
+    std::uint32_t type(const std::uint32_t node) const noexcept { return this->_types[node]; }
+    std::uint32_t line(const std::uint32_t node) const noexcept { return this->_lines[node]; }
+    std::uint32_t column(const std::uint32_t node) const noexcept { return this->_columns[node]; }
+
+    // FLAT_NONE for the root
+    std::uint32_t parent(const std::uint32_t node) const noexcept { return this->_parents[node]; }
+
+    // One past the last node of the subtree of node
+    std::uint32_t end(const std::uint32_t node) const noexcept { return this->_ends[node]; }
+
+    FlatRecord record(const std::uint32_t node) const noexcept
+    {
+        return FlatRecord(this->_extra.data() + this->_records[node]);
+    }
+
+    StringD string(const std::uint32_t offset) const noexcept
+    {
+        const char* str = this->_strings.data() + offset;
+        return StringD::make_ref(str, std::strlen(str));
+    }
+
+    // Raw arrays
+
+    FlatArrays arrays() const noexcept;
+
+    const Vector<std::uint8_t>& types() const noexcept { return this->_types; }
+    const Vector<std::uint32_t>& lines() const noexcept { return this->_lines; }
+    const Vector<std::uint32_t>& columns() const noexcept { return this->_columns; }
+    const Vector<std::uint32_t>& parents() const noexcept { return this->_parents; }
+    const Vector<std::uint32_t>& ends() const noexcept { return this->_ends; }
+    const Vector<std::uint32_t>& records() const noexcept { return this->_records; }
+    const Vector<std::uint32_t>& extra() const noexcept { return this->_extra; }
+    const Vector<char>& strings() const noexcept { return this->_strings; }
+};
+
 PYTHON_NAMESPACE_END
 
 STDROMANO_NAMESPACE_END
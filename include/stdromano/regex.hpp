@@ -10,7 +10,9 @@
 #include "stdromano/vector.hpp"
 #include "stdromano/string.hpp"
 
-#include <functional>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
 
 STDROMANO_NAMESPACE_BEGIN
 
@@ -21,6 +23,8 @@ STDROMANO_NAMESPACE_BEGIN
 enum RegexFlags_ : std::uint32_t
 {
     RegexFlags_DebugCompilation = 0x1,
+    /* Translates the program to native code when supported (x86-64), see Regex::jitted() */
+    RegexFlags_Jit = 0x2,
 };
 
 static constexpr std::size_t REGEX_MAX_GROUPS = 16;
@@ -39,26 +43,27 @@ struct STDROMANO_API RegexGroup
     STDROMANO_FORCE_INLINE bool matched() const noexcept { return this->start != this->end; }
 };
 
-/* Result of a regex match operation */
+/* Result of a regex match operation. The match references the input string (nothing is copied),
+   which must outlive it */
 class STDROMANO_API RegexMatch
 {
 private:
-    StringD _source;
+    const char* _source;
     RegexGroup _groups[REGEX_MAX_GROUPS];
     std::uint32_t _group_count;
     bool _matched;
 
 public:
-    RegexMatch() : _group_count(0), _matched(false) {}
+    RegexMatch() : _source(nullptr), _group_count(0), _matched(false) {}
 
-    RegexMatch(const StringD& source,
+    RegexMatch(const char* source,
                bool matched,
                const RegexGroup* groups,
                std::uint32_t group_count) : _source(source),
-                                            _group_count(group_count),
+                                            _group_count(std::min<std::uint32_t>(group_count, REGEX_MAX_GROUPS)),
                                             _matched(matched)
     {
-        for(std::uint32_t i = 0; i < group_count && i < REGEX_MAX_GROUPS; ++i)
+        for(std::uint32_t i = 0; i < this->_group_count; ++i)
             this->_groups[i] = groups[i];
     }
 
@@ -74,11 +79,11 @@ public:
         return RegexGroup();
     }
 
-    /* Returns the matched substring for a given group */
+    /* Returns the matched substring for a given group, as a reference to the input string */
     StringD group_str(std::uint32_t index) const noexcept
     {
         if(index < this->_group_count && this->_groups[index].matched())
-            return StringD::make_ref(this->_source.data() + this->_groups[index].start,
+            return StringD::make_ref(this->_source + this->_groups[index].start,
                                      this->_groups[index].length());
 
         return StringD();
@@ -94,6 +99,44 @@ public:
     std::size_t end() const noexcept { return this->_groups[0].end; }
 
     std::uint32_t group_count() const noexcept { return this->_group_count; }
+
+    /* Input string the match references */
+    const char* source() const noexcept { return this->_source; }
+};
+
+/* Reusable buffer of matches, filled by Regex::match_all. The groups of all the matches are stored
+   contiguously and the storage is kept between calls, so refilling it does not allocate once it
+   has grown. Like RegexMatch, it references the input string */
+class STDROMANO_API RegexMatches
+{
+private:
+    const char* _source = nullptr;
+    std::uint32_t _group_count = 0;
+    Vector<RegexGroup> _groups;
+
+    friend class Regex;
+
+public:
+    RegexMatches() = default;
+
+    std::size_t size() const noexcept { return this->_group_count == 0 ? 0 : this->_groups.size() / this->_group_count; }
+
+    bool empty() const noexcept { return this->_groups.empty(); }
+
+    void clear() noexcept { this->_groups.clear(); }
+
+    RegexGroup group(std::size_t index, std::uint32_t group_index) const noexcept
+    {
+        if(group_index < this->_group_count)
+            return this->_groups[index * this->_group_count + group_index];
+
+        return RegexGroup();
+    }
+
+    RegexMatch operator[](std::size_t index) const noexcept
+    {
+        return RegexMatch(this->_source, true, this->_groups.data() + index * this->_group_count, this->_group_count);
+    }
 };
 
 class STDROMANO_API Regex
@@ -101,19 +144,61 @@ class STDROMANO_API Regex
 public:
     using ByteCode = Vector<std::byte>;
 
-private:
-    ByteCode _bytecode;
+    /* Compiled program, immutable once compiled and shared between the copies of a Regex (and
+       through the global regex cache) */
+    struct Program
+    {
+        ByteCode bytecode;
 
-    std::uint32_t _group_count;
+        std::uint32_t group_count = 0;
+
+        /* Identifies the program in the per-thread lazy DFA caches */
+        std::uint64_t id = 0;
+
+        /* Literal starting every match, and longest literal contained in every match, used to skip
+           ahead/reject the input before running the automata */
+        StringD prefix;
+        StringD required;
+
+        /* Native code telling if there is a match (anchored at start, or anywhere after start),
+           returns the end of the earliest match + 1, 0 if there is none. Only set for programs
+           compiled with RegexFlags_Jit, when the JIT supports them */
+        using JitFunc = std::size_t (*)(const char* str, std::size_t len, std::size_t start);
+
+        JitFunc jit_anchored = nullptr;
+        JitFunc jit_unanchored = nullptr;
+
+        void* jit_memory = nullptr;
+        std::size_t jit_memory_size = 0;
+
+        Program() = default;
+        Program(const Program&) = delete;
+        Program& operator=(const Program&) = delete;
+
+        ~Program();
+    };
+
+private:
+    std::shared_ptr<const Program> _program;
 
     bool compile(const StringD& regex, std::uint32_t flags) noexcept;
 
+    /* Anchored at start_pos */
     bool exec_at(const StringD& str, std::size_t start_pos, RegexGroup* groups) const noexcept;
 
+    /* Leftmost-first match starting at or after start_pos, in a single pass */
+    bool search_at(const StringD& str, std::size_t start_pos, RegexGroup* groups) const noexcept;
+
+    explicit Regex(std::shared_ptr<const Program> program) : _program(std::move(program)) {}
+
+    friend STDROMANO_API Regex regex_cache_get(const StringD& pattern, std::uint32_t flags) noexcept;
+
+    friend class RegexSet;
+
 public:
-    Regex() : _group_count(0) {}
+    Regex() = default;
 
-    Regex(const StringD& regex, std::uint32_t flags = 0) : _group_count(0)
+    Regex(const StringD& regex, std::uint32_t flags = 0)
     {
         this->compile(regex, flags);
     }
@@ -122,21 +207,190 @@ public:
 
     RegexMatch search(const StringD& str) const noexcept;
 
-    void match_iter(const StringD& str,
-                    const std::function<void(const RegexMatch&)>& callback) const noexcept;
+    /* Returns true if the regex matches anywhere in str. Captures are not extracted, which lets
+       it run entirely on the lazy DFA */
+    bool test(const StringD& str) const noexcept;
+
+    /* Calls callback(const RegexMatch&) on the successive non-overlapping matches of str. Nothing
+       is allocated per match */
+    template <typename F>
+    void match_iter(const StringD& str, F&& callback) const noexcept
+    {
+        if(!this->valid())
+            return;
+
+        std::size_t search_start = 0;
+
+        while(search_start <= str.size())
+        {
+            RegexGroup groups[REGEX_MAX_GROUPS] = {};
+
+            if(!this->search_at(str, search_start, groups))
+                break;
+
+            /* Skip empty matches to avoid infinite loops */
+            if(groups[0].end == groups[0].start)
+            {
+                search_start = groups[0].end + 1;
+                continue;
+            }
+
+            callback(RegexMatch(str.data(), true, groups, this->_program->group_count));
+
+            search_start = groups[0].end;
+        }
+    }
+
+    /* Replaces the matches of str. The callback either returns the replacement (StringD
+       callback(const RegexMatch&)), or appends it to the result (void callback(const RegexMatch&,
+       StringD& out)), which avoids building a string per match */
+    template <typename F>
+    StringD replace_iter(const StringD& str, F&& callback) const noexcept
+    {
+        if(!this->valid())
+            return StringD();
+
+        StringD res;
 
-    StringD replace_iter(const StringD& str,
-                         const std::function<StringD(const RegexMatch&)>& callback) const noexcept;
+        std::size_t search_start = 0;
+
+        while(search_start <= str.size())
+        {
+            RegexGroup groups[REGEX_MAX_GROUPS] = {};
+
+            if(!this->search_at(str, search_start, groups))
+                break;
+
+            /* Empty matches are not replaced */
+            if(groups[0].end == groups[0].start)
+            {
+                const std::size_t copy_end = std::min(groups[0].end + 1, str.size());
+
+                if(copy_end > search_start)
+                    res.appendc(str.data() + search_start, copy_end - search_start);
+
+                search_start = groups[0].end + 1;
+                continue;
+            }
+
+            if(groups[0].start > search_start)
+                res.appendc(str.data() + search_start, groups[0].start - search_start);
+
+            const RegexMatch m(str.data(), true, groups, this->_program->group_count);
+
+            if constexpr(std::is_invocable_v<F, const RegexMatch&, StringD&>)
+                callback(m, res);
+            else
+                res.appends(callback(m));
+
+            search_start = groups[0].end;
+        }
+
+        if(search_start < str.size())
+            res.appendc(str.data() + search_start, str.size() - search_start);
+
+        return res;
+    }
 
     Vector<RegexMatch> match_all(const StringD& str) const noexcept;
 
+    /* Fills matches with the matches of str, reusing its storage. Returns the number of matches */
+    std::size_t match_all(const StringD& str, RegexMatches& matches) const noexcept;
+
     StringD replace_all(const StringD& str, const StringD& replace) const noexcept;
 
-    bool valid() const noexcept { return !this->_bytecode.empty(); }
+    bool valid() const noexcept { return this->_program != nullptr && !this->_program->bytecode.empty(); }
 
-    std::uint32_t group_count() const noexcept { return this->_group_count; }
+    std::uint32_t group_count() const noexcept { return this->_program != nullptr ? this->_program->group_count : 0; }
+
+    /* Returns true if the program runs as native code (compiled with RegexFlags_Jit, on a
+       supported platform, for a pattern small enough) */
+    bool jitted() const noexcept { return this->_program != nullptr && this->_program->jit_unanchored != nullptr; }
+};
+
+/* Pattern of a RegexSet found in the input, with the location of its leftmost-first match */
+struct RegexSetMatch
+{
+    std::uint32_t index;
+    RegexGroup location;
 };
 
+/*
+    Set of patterns combined into a single automaton, telling which patterns match the input in a
+    single scan of it (instead of one scan per pattern), e.g:
+
+        RegexSet set({ "error", "warn(ing)?", "\\d+ms" });
+
+        Vector<std::uint32_t> indices;
+        set.matches(line, indices);
+
+    Locations are only computed for the patterns that matched.
+*/
+class STDROMANO_API RegexSet
+{
+private:
+    Vector<Regex> _regexes;
+
+    /* Alternation of all the patterns, each one accepting with its index */
+    std::shared_ptr<const Regex::Program> _program;
+
+    /* Sets flags[i] to 1 if the pattern i matches anywhere in str */
+    void scan(const StringD& str, std::uint8_t* flags) const noexcept;
+
+public:
+    RegexSet() = default;
+
+    /* The set is invalid if any of the patterns is invalid */
+    RegexSet(const Vector<StringD>& patterns, std::uint32_t flags = 0);
+
+    bool valid() const noexcept { return this->_program != nullptr; }
+
+    std::size_t size() const noexcept { return this->_regexes.size(); }
+
+    const Regex& regex(std::size_t index) const noexcept { return this->_regexes[index]; }
+
+    /* Returns true if any of the patterns matches anywhere in str */
+    bool test(const StringD& str) const noexcept;
+
+    /* Fills indices with the (sorted) indices of the patterns matching anywhere in str, returns
+       true if any matched */
+    bool matches(const StringD& str, Vector<std::uint32_t>& indices) const noexcept;
+
+    /* Same as matches, with the location of the leftmost-first match of each pattern */
+    bool search_all(const StringD& str, Vector<RegexSetMatch>& matches) const noexcept;
+};
+
+/*
+    Process-wide cache of compiled regexes, keyed by (pattern, flags). Repeated patterns are compiled
+    once and the returned Regex objects share the same immutable program, e.g:
+
+        if(regex_cache_get("\\d+ms").test(line)) ...
+
+    The least recently used patterns are evicted when the cache is full.
+*/
+
+struct RegexCacheStats
+{
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t evictions;
+    std::size_t size;
+    std::size_t capacity;
+};
+
+static constexpr std::size_t REGEX_CACHE_DEFAULT_CAPACITY = 256;
+
+/* Returns the compiled regex from the cache, compiling it on a miss. Invalid patterns are not cached */
+STDROMANO_API Regex regex_cache_get(const StringD& pattern, std::uint32_t flags = 0) noexcept;
+
+STDROMANO_API RegexCacheStats regex_cache_stats() noexcept;
+
+/* Sets the maximum number of programs held by the cache, evicting if needed */
+STDROMANO_API void regex_cache_set_capacity(std::size_t capacity) noexcept;
+
+/* Empties the cache and resets the stats. Regex objects returned before keep their program */
+STDROMANO_API void regex_cache_clear() noexcept;
+
 STDROMANO_NAMESPACE_END
 
 #endif /* !defined(__STDROMANO_REGEX) */
@@ -154,6 +154,13 @@ STDROMANO_API bool validate_utf8(const char* str, std::size_t size) noexcept;
 /* Finds the last occurence of needle in haystack (reverse strstr) */
 STDROMANO_API char* strrstr(const char* haystack, const char* needle) noexcept;
 
+/* Finds the first occurence of needle in haystack, neither needs to be null-terminated. Returns nullptr
+   if not found */
+STDROMANO_API const char* strfind(const char* haystack,
+                                  std::size_t haystack_size,
+                                  const char* needle,
+                                  std::size_t needle_size) noexcept;
+
 template <std::size_t LocalCapacity = 7>
 class String
 {
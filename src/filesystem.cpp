@@ -27,6 +27,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <ftw.h>
+#include <sys/mman.h>
 #endif // defined(STDROMANO_WIN)
 
 #include <stack>
@@ -658,6 +659,121 @@ Expected<void> write_file_content(const char* data,
     return Ok();
 }
 
+void MappedFile::unmap() noexcept
+{
+#if defined(STDROMANO_WIN)
+    if(this->_data != nullptr)
+        UnmapViewOfFile(this->_data);
+
+    if(this->_mapping != nullptr)
+        CloseHandle(this->_mapping);
+
+    if(this->_file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->_file);
+
+    this->_mapping = nullptr;
+    this->_file = INVALID_HANDLE_VALUE;
+#elif defined(STDROMANO_LINUX)
+    if(this->_data != nullptr)
+        munmap(this->_data, this->_size);
+#endif /* defined(STDROMANO_WIN) */
+
+    this->_data = nullptr;
+    this->_size = 0;
+}
+
+Expected<MappedFile> map_file(const StringD& file_path, const std::uint32_t flags) noexcept
+{
+    const StringD path = file_path.is_ref() ? file_path.copy() : file_path;
+    const bool copy_on_write = (flags & MapFileFlags_CopyOnWrite) != 0;
+
+    MappedFile mapped;
+
+#if defined(STDROMANO_WIN)
+    mapped._file = CreateFileA(path.c_str(),
+                               GENERIC_READ,
+                               FILE_SHARE_READ,
+                               nullptr,
+                               OPEN_EXISTING,
+                               (flags & MapFileFlags_Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN :
+                                                                   FILE_ATTRIBUTE_NORMAL,
+                               nullptr);
+
+    if(mapped._file == INVALID_HANDLE_VALUE)
+        return Error::from_win32_last_error();
+
+    LARGE_INTEGER file_size;
+
+    if(!GetFileSizeEx(mapped._file, &file_size))
+        return Error::from_win32_last_error();
+
+    if(file_size.QuadPart == 0)
+        return Error(StringD::make_fmt("Cannot map empty file {}", path));
+
+    mapped._mapping = CreateFileMappingA(mapped._file,
+                                         nullptr,
+                                         copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY,
+                                         0,
+                                         0,
+                                         nullptr);
+
+    if(mapped._mapping == nullptr)
+        return Error::from_win32_last_error();
+
+    mapped._data = static_cast<char*>(MapViewOfFile(mapped._mapping,
+                                                    copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ,
+                                                    0,
+                                                    0,
+                                                    0));
+
+    if(mapped._data == nullptr)
+        return Error::from_win32_last_error();
+
+    mapped._size = static_cast<std::size_t>(file_size.QuadPart);
+#elif defined(STDROMANO_LINUX)
+    const int fd = open(path.c_str(), O_RDONLY);
+
+    if(fd == -1)
+        return Error::from_unix_errno();
+
+    struct stat sb;
+
+    if(fstat(fd, &sb) == -1)
+    {
+        Error err = Error::from_unix_errno();
+        close(fd);
+        return err;
+    }
+
+    if(sb.st_size == 0)
+    {
+        close(fd);
+        return Error(StringD::make_fmt("Cannot map empty file {}", path));
+    }
+
+    void* data = mmap(nullptr,
+                      static_cast<std::size_t>(sb.st_size),
+                      copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_PRIVATE,
+                      fd,
+                      0);
+
+    /* The mapping keeps its own reference to the file */
+    close(fd);
+
+    if(data == MAP_FAILED)
+        return Error::from_unix_errno();
+
+    if(flags & MapFileFlags_Sequential)
+        madvise(data, static_cast<std::size_t>(sb.st_size), MADV_SEQUENTIAL);
+
+    mapped._data = static_cast<char*>(data);
+    mapped._size = static_cast<std::size_t>(sb.st_size);
+#endif /* defined(STDROMANO_WIN) */
+
+    return std::move(mapped);
+}
+
 ListDirIterator::~ListDirIterator()
 {
 #if defined(STDROMANO_WIN)
@@ -1075,12 +1191,18 @@ bool WalkIterator::process_current_directory() noexcept
         this->_pending_dirs.pop();
 
         this->_dir = opendir(this->_current_dir.c_str());
+
+        if(this->_dir == nullptr)
+            return false;
     }
 
     struct dirent* entry;
 
     while((entry = readdir(this->_dir)))
     {
+        if(this->should_skip_entry(entry->d_name))
+            continue;
+
         bool is_hidden = entry->d_name[0] == '.';
 
         if(is_hidden && !(this->_flags & WalkFlags_ListHidden))
@@ -0,0 +1,354 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2025 - Present Romain Augier
+// All rights reserved.
+
+#include "stdromano/grep.hpp"
+#include "stdromano/filesystem.hpp"
+#include "stdromano/threading.hpp"
+
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+STDROMANO_NAMESPACE_BEGIN
+
+/* Files with a null byte in their first kilobytes are considered binary, like grep does */
+static constexpr std::size_t GREP_BINARY_CHECK_SIZE = 8192;
+
+/* Smaller files are read into a buffer reused by the slot, mapping them costs more than the copy */
+static constexpr std::size_t GREP_MAP_MIN_SIZE = 1024 * 1024;
+
+/* Matching line, as offsets in the file */
+struct GrepLineSpan
+{
+    std::size_t line_start;
+    std::size_t line_end;
+    std::size_t line_number;
+    std::size_t match_start;
+    std::size_t match_end;
+};
+
+struct GrepFile
+{
+    StringD path;
+    fs::MappedFile file;
+    Vector<char> buffer;
+
+    const char* data;
+    std::size_t size;
+
+    /* Reused across the files mapped to this slot */
+    Vector<GrepLineSpan> lines;
+
+    bool searched;
+    bool binary;
+    bool error;
+
+    /* Protected by the mutex of the search */
+    bool done;
+};
+
+/* Signaled by the workers when a file is done, the calling thread sleeps until the next file to
+   deliver is */
+struct GrepDone
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+/* Turns the matches (in increasing order) into lines, counting the newlines incrementally */
+struct GrepLineCounter
+{
+    const char* data;
+    std::size_t size;
+
+    std::size_t line_number = 1;
+    std::size_t counted = 0;
+    std::size_t line_start = 0;
+
+    /* Matches before are in a line already reported */
+    std::size_t next_line_start = 0;
+
+    GrepLineCounter(const char* data_, std::size_t size_) : data(data_), size(size_) {}
+
+    void add(std::size_t match_start, std::size_t match_end, Vector<GrepLineSpan>& lines) noexcept
+    {
+        if(match_start < this->next_line_start)
+            return;
+
+        while(this->counted < match_start)
+        {
+            const char* eol = static_cast<const char*>(std::memchr(this->data + this->counted, '\n', match_start - this->counted));
+
+            if(eol == nullptr)
+            {
+                this->counted = match_start;
+                break;
+            }
+
+            this->line_number++;
+            this->counted = static_cast<std::size_t>(eol - this->data) + 1;
+            this->line_start = this->counted;
+        }
+
+        const char* eol = static_cast<const char*>(std::memchr(this->data + match_start, '\n', this->size - match_start));
+        const std::size_t line_end = eol != nullptr ? static_cast<std::size_t>(eol - this->data) : this->size;
+
+        lines.push_back({ this->line_start, line_end, this->line_number, match_start, std::min(match_end, line_end) });
+
+        this->next_line_start = line_end + 1;
+    }
+};
+
+struct Grep_
+{
+    static void search_data(const Grep* grep, const char* data, std::size_t size, Vector<GrepLineSpan>& lines) noexcept
+    {
+        GrepLineCounter counter(data, size);
+
+        if(grep->_flags & GrepFlags_Literal)
+        {
+            std::size_t pos = 0;
+
+            while(pos < size)
+            {
+                const char* found = strfind(data + pos, size - pos, grep->_literal.data(), grep->_literal.size());
+
+                if(found == nullptr)
+                    break;
+
+                const std::size_t start = static_cast<std::size_t>(found - data);
+
+                counter.add(start, start + grep->_literal.size(), lines);
+
+                /* The rest of the line is not searched */
+                pos = counter.next_line_start;
+            }
+
+            return;
+        }
+
+        const StringD content = StringD::make_ref(data, size);
+
+        /* Most files do not match, the DFA/JIT rejects them without extracting any match */
+        if(!grep->_regex.test(content))
+            return;
+
+        grep->_regex.match_iter(content, [&](const RegexMatch& m) {
+            counter.add(m.start(), m.end(), lines);
+        });
+    }
+
+    /* Returns false if the file cannot be read. Empty files are loaded with a size of 0 */
+    static bool load_file(GrepFile* file) noexcept
+    {
+        const Expected<std::size_t> size = fs::filesize(file->path);
+
+        if(size.has_error())
+            return false;
+
+        if(size.value() == 0)
+            return true;
+
+        if(size.value() >= GREP_MAP_MIN_SIZE)
+        {
+            auto mapped = fs::map_file(file->path, fs::MapFileFlags_Sequential);
+
+            if(!mapped.has_value())
+                return false;
+
+            file->file = mapped.value();
+            file->data = file->file.data();
+            file->size = file->file.size();
+
+            return true;
+        }
+
+        std::FILE* handle = std::fopen(file->path.c_str(), "rb");
+
+        if(handle == nullptr)
+            return false;
+
+        file->buffer.resize(size.value());
+
+        file->size = std::fread(file->buffer.data(), sizeof(char), size.value(), handle);
+        file->data = file->buffer.data();
+
+        const bool error = std::ferror(handle) != 0;
+
+        std::fclose(handle);
+
+        return !error;
+    }
+
+    static void search_file(const Grep* grep, GrepFile* file, GrepDone* done) noexcept
+    {
+        if(!Grep_::load_file(file))
+        {
+            file->error = true;
+        }
+        else if(file->size > 0) /* Empty files have no match */
+        {
+            file->searched = true;
+            file->binary = std::memchr(file->data, 0, std::min(file->size, GREP_BINARY_CHECK_SIZE)) != nullptr;
+
+            if(!file->binary || (grep->_flags & GrepFlags_Binary))
+                Grep_::search_data(grep, file->data, file->size, file->lines);
+        }
+
+        std::lock_guard<std::mutex> lock(done->mutex);
+        file->done = true;
+        done->cv.notify_one();
+    }
+
+    static void deliver(Grep* grep,
+                        const StringD& path,
+                        const char* data,
+                        const Vector<GrepLineSpan>& lines,
+                        const Grep::Callback& callback) noexcept
+    {
+        for(const GrepLineSpan& span : lines)
+        {
+            GrepLine line;
+            line.path = StringD::make_ref(path);
+            line.line = StringD::make_ref(data + span.line_start, span.line_end - span.line_start);
+            line.line_number = span.line_number;
+            line.match_start = span.match_start - span.line_start;
+            line.match_end = span.match_end - span.line_start;
+
+            callback(line);
+        }
+
+        grep->_num_lines += lines.size();
+    }
+};
+
+Grep::Grep(const StringD& pattern, std::uint32_t flags) noexcept : _flags(flags),
+                                                                   _num_files(0),
+                                                                   _num_binary_files(0),
+                                                                   _num_errors(0),
+                                                                   _num_lines(0)
+{
+    if(flags & GrepFlags_Literal)
+        this->_literal = pattern.is_ref() ? pattern.copy() : pattern;
+    else
+        this->_regex = Regex(pattern, RegexFlags_Jit);
+}
+
+bool Grep::valid() const noexcept
+{
+    return (this->_flags & GrepFlags_Literal) ? !this->_literal.empty() : this->_regex.valid();
+}
+
+bool Grep::search_buffer(const char* data, std::size_t size, const StringD& path, const Callback& callback) noexcept
+{
+    this->_num_files = 0;
+    this->_num_binary_files = 0;
+    this->_num_errors = 0;
+    this->_num_lines = 0;
+
+    if(!this->valid())
+        return false;
+
+    Vector<GrepLineSpan> lines;
+
+    Grep_::search_data(this, data, size, lines);
+    Grep_::deliver(this, path, data, lines, callback);
+
+    this->_num_files = 1;
+
+    return true;
+}
+
+bool Grep::search(const StringD& path, const Callback& callback) noexcept
+{
+    this->_num_files = 0;
+    this->_num_binary_files = 0;
+    this->_num_errors = 0;
+    this->_num_lines = 0;
+
+    if(!this->valid() || !fs::path_exists(path))
+        return false;
+
+    const std::uint32_t walk_flags = fs::WalkFlags_ListFiles |
+                                     fs::WalkFlags_Recursive |
+                                     ((this->_flags & GrepFlags_Hidden) ? fs::WalkFlags_ListHidden : 0);
+
+    fs::WalkIterator it(path, walk_flags);
+
+    /* A path that cannot be walked is a file (or an empty directory, which cannot be read) */
+    const bool single_file = it == fs::WalkIterator();
+
+    /* File i is searched in slot i % num_slots, bounding the number of mapped files */
+    const std::size_t num_slots = global_threadpool().num_workers() * 4;
+
+    std::unique_ptr<GrepFile[]> slots(new GrepFile[num_slots]);
+
+    ThreadPoolWaiter waiter;
+    GrepDone done;
+
+    std::size_t next_submit = 0;
+    std::size_t next_deliver = 0;
+
+    const auto submit = [&](const StringD& file_path) {
+        GrepFile* file = &slots[next_submit % num_slots];
+        file->path = file_path.is_ref() ? file_path.copy() : file_path;
+        file->data = nullptr;
+        file->size = 0;
+        file->searched = false;
+        file->binary = false;
+        file->error = false;
+        file->done = false;
+
+        global_threadpool().add_work([this, file, &done]() {
+            Grep_::search_file(this, file, &done);
+        }, &waiter);
+
+        next_submit++;
+    };
+
+    const auto deliver_next = [&]() {
+        GrepFile* file = &slots[next_deliver % num_slots];
+
+        {
+            std::unique_lock<std::mutex> lock(done.mutex);
+            done.cv.wait(lock, [file]() { return file->done; });
+        }
+
+        Grep_::deliver(this, file->path, file->data, file->lines, callback);
+
+        this->_num_files += file->searched ? 1 : 0;
+        this->_num_binary_files += file->binary ? 1 : 0;
+        this->_num_errors += file->error ? 1 : 0;
+
+        file->lines.clear();
+        file->file.unmap();
+
+        next_deliver++;
+    };
+
+    while(single_file || it != fs::WalkIterator())
+    {
+        if(next_submit - next_deliver == num_slots)
+            deliver_next();
+
+        if(single_file)
+        {
+            submit(path);
+            break;
+        }
+
+        submit(it->get_current_path());
+        ++it;
+    }
+
+    while(next_deliver < next_submit)
+        deliver_next();
+
+    waiter.wait();
+
+    return true;
+}
+
+STDROMANO_NAMESPACE_END
@@ -3,10 +3,34 @@
 // All rights reserved.
 
 #include "stdromano/json.hpp"
-
+#include "stdromano/filesystem.hpp"
+#include "stdromano/hash.hpp"
+#include "stdromano/bits.hpp"
+#include "stdromano/endian.hpp"
+#include "stdromano/hashmap.hpp"
+#include "stdromano/simd.hpp"
+#include "stdromano/threading.hpp"
+#include "stdromano/vector.hpp"
+
+#if defined(STDROMANO_WIN)
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* defined(STDROMANO_WIN) */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
 #include <cstdio>
+#include <memory>
+#include <mutex>
 #include <new>
 
 STDROMANO_NAMESPACE_BEGIN
@@ -83,30 +107,176 @@ STDROMANO_FORCE_INLINE bool tag_get_invalid(std::uint64_t& tags) noexcept
 /* Internal container structs  */
 /*******************************/
 
-struct JsonArrayElement
-{
-    JsonObject* value;
-    JsonArrayElement* next;
-};
+/* Arrays are contiguous vectors of value pointers allocated in the value arena */
+
+static constexpr std::uint32_t JSON_ARRAY_MIN_CAPACITY = 8;
 
 struct JsonArrayInfo
 {
-    JsonArrayElement* head;
-    JsonArrayElement* tail;
+    JsonObject** data;
+    std::uint32_t capacity;
 };
 
+static void json_array_set_capacity(Arena& arena,
+                                    JsonArrayInfo* info,
+                                    std::uint32_t size,
+                                    std::uint32_t capacity) noexcept
+{
+    auto** data = static_cast<JsonObject**>(arena.allocate(capacity * sizeof(JsonObject*),
+                                                           alignof(JsonObject*)));
+
+    if(size > 0)
+        std::memcpy(data, info->data, size * sizeof(JsonObject*));
+
+    info->data = data;
+    info->capacity = capacity;
+}
+
 struct JsonDictElement
 {
     JsonKeyValue kv;
     JsonDictElement* next;
+    JsonDictElement* prev;
+    std::uint32_t key_sz;
+    std::uint32_t hash; /* only computed once the dict is indexed */
 };
 
+/*
+ * Dicts keep their elements in a doubly linked list to preserve insertion order, and once they
+ * reach JSON_DICT_INDEX_THRESHOLD elements an open-addressing (linear probing) index pointing to
+ * the elements is built in the value arena. The index is kept at most half full
+ */
+
+static constexpr std::uint32_t JSON_DICT_INDEX_THRESHOLD = 16;
+static constexpr std::uint32_t JSON_DICT_INDEX_INITIAL_CAPACITY = 64;
+
 struct JsonDictInfo
 {
     JsonDictElement* head;
     JsonDictElement* tail;
+    JsonDictElement** index;
+    std::uint32_t index_mask;
+};
+
+struct JsonDict_
+{
+    static STDROMANO_FORCE_INLINE std::uint32_t hash_key(const char* key, std::size_t key_sz) noexcept
+    {
+        return hash_fnv1a(key, key_sz);
+    }
+
+    static STDROMANO_FORCE_INLINE bool key_equals(const JsonDictElement* element,
+                                                  const char* key,
+                                                  std::size_t key_sz) noexcept
+    {
+        return element->key_sz == key_sz && std::memcmp(element->kv.key, key, key_sz) == 0;
+    }
+
+    static JsonDictElement* find(const JsonDictInfo* info, const char* key, std::size_t key_sz) noexcept;
+
+    static void index_insert(JsonDictInfo* info, JsonDictElement* element) noexcept;
+    static void index_erase(JsonDictInfo* info, JsonDictElement* element) noexcept;
+    static void build_index(Arena& arena, JsonDictInfo* info, std::uint32_t capacity) noexcept;
+
+    static void insert(Json* json,
+                       JsonObject* dict,
+                       const char* key,
+                       std::size_t key_sz,
+                       JsonObject* value) noexcept;
+
+    static void erase(JsonObject* dict, JsonDictElement* element) noexcept;
 };
 
+JsonDictElement* JsonDict_::find(const JsonDictInfo* info, const char* key, std::size_t key_sz) noexcept
+{
+    if(info->index == nullptr)
+    {
+        for(auto* current = info->head; current != nullptr; current = current->next)
+            if(JsonDict_::key_equals(current, key, key_sz))
+                return current;
+
+        return nullptr;
+    }
+
+    const std::uint32_t hash = JsonDict_::hash_key(key, key_sz);
+    std::uint32_t slot = hash & info->index_mask;
+
+    while(info->index[slot] != nullptr)
+    {
+        JsonDictElement* element = info->index[slot];
+
+        if(element->hash == hash && JsonDict_::key_equals(element, key, key_sz))
+            return element;
+
+        slot = (slot + 1) & info->index_mask;
+    }
+
+    return nullptr;
+}
+
+void JsonDict_::index_insert(JsonDictInfo* info, JsonDictElement* element) noexcept
+{
+    std::uint32_t slot = element->hash & info->index_mask;
+
+    while(info->index[slot] != nullptr)
+        slot = (slot + 1) & info->index_mask;
+
+    info->index[slot] = element;
+}
+
+void JsonDict_::index_erase(JsonDictInfo* info, JsonDictElement* element) noexcept
+{
+    std::uint32_t slot = element->hash & info->index_mask;
+
+    while(info->index[slot] != element)
+        slot = (slot + 1) & info->index_mask;
+
+    /* Backward shift deletion, no tombstones needed */
+    std::uint32_t next = slot;
+
+    while(true)
+    {
+        next = (next + 1) & info->index_mask;
+
+        JsonDictElement* candidate = info->index[next];
+
+        if(candidate == nullptr)
+            break;
+
+        const std::uint32_t home = candidate->hash & info->index_mask;
+
+        const bool can_move = slot <= next ? (home <= slot || home > next) :
+                                             (home <= slot && home > next);
+
+        if(can_move)
+        {
+            info->index[slot] = candidate;
+            slot = next;
+        }
+    }
+
+    info->index[slot] = nullptr;
+}
+
+void JsonDict_::build_index(Arena& arena, JsonDictInfo* info, std::uint32_t capacity) noexcept
+{
+    const bool compute_hashes = info->index == nullptr;
+
+    info->index = static_cast<JsonDictElement**>(arena.allocate(capacity * sizeof(JsonDictElement*),
+                                                                alignof(JsonDictElement*)));
+    info->index_mask = capacity - 1;
+
+    std::memset(info->index, 0, capacity * sizeof(JsonDictElement*));
+
+    for(auto* current = info->head; current != nullptr; current = current->next)
+    {
+        if(compute_hashes)
+            current->hash = JsonDict_::hash_key(current->kv.key, current->key_sz);
+
+        JsonDict_::index_insert(info, current);
+    }
+}
+
 /****************************/
 /* JsonObject: type checks  */
 /****************************/
@@ -188,49 +358,33 @@ size_t JsonObject::dict_size() const noexcept
     return static_cast<size_t>(tag_get_sz(this->_tags));
 }
 
-JsonObject* JsonObject::dict_find(const char* key) const noexcept
+JsonObject* JsonObject::array_at(std::size_t index) const noexcept
 {
-    if(!(this->_tags & JsonTag_Dict))
+    if(!(this->_tags & JsonTag_Array) || index >= tag_get_sz(this->_tags))
         return nullptr;
 
-    const auto* info = static_cast<const JsonDictInfo*>(_value.ptr);
-    auto* current = info->head;
-
-    const std::size_t key_sz = std::strlen(key);
+    return static_cast<const JsonArrayInfo*>(this->_value.ptr)->data[index];
+}
 
-    while(current != nullptr)
-    {
-        const std::size_t current_key_sz = std::strlen(key);
+JsonObject* JsonObject::dict_find(const char* key) const noexcept
+{
+    return this->dict_find(key, std::strlen(key));
+}
 
-        if(key_sz == current_key_sz && detail::strcmp(current->kv.key, key, key_sz) == 0)
-            return current->kv.value;
+JsonObject* JsonObject::dict_find(const char* key, std::size_t key_sz) const noexcept
+{
+    if(!(this->_tags & JsonTag_Dict))
+        return nullptr;
 
-        current = current->next;
-    }
+    const auto* element = JsonDict_::find(static_cast<const JsonDictInfo*>(_value.ptr), key, key_sz);
 
-    return nullptr;
+    return element != nullptr ? element->kv.value : nullptr;
 }
 
 /*************************************/
 /* JsonObject: iterator impls        */
 /*************************************/
 
-JsonObject* JsonObject::ArrayIterator::operator*() const noexcept
-{
-    return static_cast<JsonArrayElement*>(this->_current)->value;
-}
-
-JsonObject::ArrayIterator& JsonObject::ArrayIterator::operator++() noexcept
-{
-    this->_current = static_cast<JsonArrayElement*>(this->_current)->next;
-    return *this;
-}
-
-bool JsonObject::ArrayIterator::operator!=(const ArrayIterator& other) const noexcept
-{
-    return this->_current != other._current;
-}
-
 JsonKeyValue JsonObject::DictIterator::operator*() const noexcept
 {
     return static_cast<JsonDictElement*>(this->_current)->kv;
@@ -247,16 +401,6 @@ bool JsonObject::DictIterator::operator!=(const DictIterator& other) const noexc
     return this->_current != other._current;
 }
 
-JsonObject::ArrayIterator JsonObject::ArrayRange::begin() const noexcept
-{
-    return ArrayIterator(this->_head);
-}
-
-JsonObject::ArrayIterator JsonObject::ArrayRange::end() const noexcept
-{
-    return ArrayIterator(nullptr);
-}
-
 JsonObject::DictIterator JsonObject::DictRange::begin() const noexcept
 {
     return DictIterator(this->_head);
@@ -270,9 +414,11 @@ JsonObject::DictIterator JsonObject::DictRange::end() const noexcept
 JsonObject::ArrayRange JsonObject::array_items() const noexcept
 {
     if(!(this->_tags & JsonTag_Array))
-        return ArrayRange(nullptr);
+        return ArrayRange(nullptr, nullptr);
 
-    return ArrayRange(static_cast<const JsonArrayInfo*>(this->_value.ptr)->head);
+    const auto* info = static_cast<const JsonArrayInfo*>(this->_value.ptr);
+
+    return ArrayRange(info->data, info->data + tag_get_sz(this->_tags));
 }
 
 JsonObject::DictRange JsonObject::dict_items() const noexcept
@@ -289,11 +435,48 @@ JsonObject::DictRange JsonObject::dict_items() const noexcept
 
 Json::Json() noexcept : _root(nullptr),
                         _string_arena(128 * 1024),
-                        _value_arena(1024 * sizeof(JsonObject))
+                        _value_arena(1024 * sizeof(JsonObject)),
+                        _source(nullptr)
+{
+}
+
+Json::~Json() noexcept
+{
+    delete this->_source;
+}
+
+/* Swaps with an empty document, so that other keeps valid arenas */
+Json::Json(Json&& other) noexcept : Json()
+{
+    *this = std::move(other);
+}
+
+Json& Json::operator=(Json&& other) noexcept
 {
+    if(this != &other)
+    {
+        /* Arenas are swapped, the previous document is released by other's destructor */
+        this->_root = other._root;
+        this->_string_arena = std::move(other._string_arena);
+        this->_value_arena = std::move(other._value_arena);
+        std::swap(this->_source, other._source);
+        std::swap(this->_parse_stack, other._parse_stack);
+
+        other._root = nullptr;
+    }
+
+    return *this;
 }
 
-Json::~Json() noexcept = default;
+void Json::reset() noexcept
+{
+    this->_root = nullptr;
+    this->_string_arena.clear();
+    this->_value_arena.clear();
+
+    if(this->_source != nullptr)
+        this->_source->unmap();
+}
 
 JsonObject* Json::root() const noexcept { return this->_root; }
 
@@ -363,8 +546,8 @@ JsonObject* Json::make_array() noexcept
     auto* obj = this->_value_arena.emplace<JsonObject>();
     auto* info = this->_value_arena.emplace<JsonArrayInfo>();
 
-    info->head = nullptr;
-    info->tail = nullptr;
+    info->data = nullptr;
+    info->capacity = 0;
 
     tag_set_type(obj->_tags, JsonTag_Array);
     obj->_value.ptr = info;
@@ -379,6 +562,8 @@ JsonObject* Json::make_dict() noexcept
 
     info->head = nullptr;
     info->tail = nullptr;
+    info->index = nullptr;
+    info->index_mask = 0;
 
     tag_set_type(obj->_tags, JsonTag_Dict);
     obj->_value.ptr = info;
@@ -436,35 +621,39 @@ void Json::set_str(JsonObject* obj, const char* str) noexcept
 /* Json: array operations     */
 /******************************/
 
-void Json::array_append(JsonObject* array, JsonObject* value, bool reference) noexcept
+void Json::array_reserve(JsonObject* array, std::size_t capacity) noexcept
 {
     auto* info = static_cast<JsonArrayInfo*>(array->_value.ptr);
-    auto* element = this->_value_arena.emplace<JsonArrayElement>();
 
-    element->next = nullptr;
+    if(capacity <= info->capacity)
+        return;
 
-    if(info->head == nullptr)
-    {
-        info->head = element;
-        info->tail = element;
-    }
-    else
-    {
-        info->tail->next = element;
-        info->tail = element;
-    }
+    json_array_set_capacity(this->_value_arena,
+                            info,
+                            tag_get_sz(array->_tags),
+                            static_cast<std::uint32_t>(capacity));
+}
+
+void Json::array_append(JsonObject* array, JsonObject* value, bool reference) noexcept
+{
+    auto* info = static_cast<JsonArrayInfo*>(array->_value.ptr);
+    const std::uint32_t sz = tag_get_sz(array->_tags);
+
+    if(sz == info->capacity)
+        json_array_set_capacity(this->_value_arena,
+                                info,
+                                sz,
+                                std::max(info->capacity * 2, JSON_ARRAY_MIN_CAPACITY));
 
     if(!reference)
     {
         auto* new_value = _value_arena.emplace<JsonObject>();
         std::memcpy(new_value, value, sizeof(JsonObject));
-        element->value = new_value;
-    }
-    else
-    {
-        element->value = value;
+        value = new_value;
     }
 
+    info->data[sz] = value;
+
     tag_incr_sz(array->_tags);
 }
 
@@ -477,27 +666,9 @@ void Json::array_pop(JsonObject* array, std::size_t index) noexcept
 
     auto* info = static_cast<JsonArrayInfo*>(array->_value.ptr);
 
-    if(index == 0)
-    {
-        info->head = info->head->next;
-
-        if(info->head == nullptr)
-            info->tail = nullptr;
-
-        tag_decr_sz(array->_tags);
-        return;
-    }
-
-    auto* previous = info->head;
-
-    for(std::size_t i = 0; i < index - 1; i++)
-        previous = previous->next;
-
-    auto* target = previous->next;
-    previous->next = target->next;
-
-    if(target == info->tail)
-        info->tail = previous;
+    std::memmove(info->data + index,
+                 info->data + index + 1,
+                 (sz - index - 1) * sizeof(JsonObject*));
 
     tag_decr_sz(array->_tags);
 }
@@ -506,27 +677,73 @@ void Json::array_pop(JsonObject* array, std::size_t index) noexcept
 /* Json: dict operations      */
 /******************************/
 
-void Json::dict_append(JsonObject* dict,
+void JsonDict_::insert(Json* json,
+                       JsonObject* dict,
                        const char* key,
-                       JsonObject* value,
-                       bool reference) noexcept
+                       std::size_t key_sz,
+                       JsonObject* value) noexcept
 {
     auto* info = static_cast<JsonDictInfo*>(dict->_value.ptr);
-    auto* element = _value_arena.emplace<JsonDictElement>();
+    auto* element = json->_value_arena.emplace<JsonDictElement>();
 
+    element->kv.key = key;
+    element->kv.value = value;
     element->next = nullptr;
+    element->prev = info->tail;
+    element->key_sz = static_cast<std::uint32_t>(key_sz);
+    element->hash = 0;
 
     if(info->head == nullptr)
-    {
         info->head = element;
-        info->tail = element;
-    }
     else
-    {
         info->tail->next = element;
-        info->tail = element;
+
+    info->tail = element;
+
+    tag_incr_sz(dict->_tags);
+
+    const std::uint32_t sz = tag_get_sz(dict->_tags);
+
+    if(info->index != nullptr)
+    {
+        element->hash = JsonDict_::hash_key(key, key_sz);
+
+        if(sz * 2 > info->index_mask + 1)
+            JsonDict_::build_index(json->_value_arena, info, (info->index_mask + 1) * 2);
+        else
+            JsonDict_::index_insert(info, element);
+    }
+    else if(sz >= JSON_DICT_INDEX_THRESHOLD)
+    {
+        JsonDict_::build_index(json->_value_arena, info, JSON_DICT_INDEX_INITIAL_CAPACITY);
     }
+}
+
+void JsonDict_::erase(JsonObject* dict, JsonDictElement* element) noexcept
+{
+    auto* info = static_cast<JsonDictInfo*>(dict->_value.ptr);
+
+    if(element->prev == nullptr)
+        info->head = element->next;
+    else
+        element->prev->next = element->next;
+
+    if(element->next == nullptr)
+        info->tail = element->prev;
+    else
+        element->next->prev = element->prev;
+
+    if(info->index != nullptr)
+        JsonDict_::index_erase(info, element);
+
+    tag_decr_sz(dict->_tags);
+}
 
+void Json::dict_append(JsonObject* dict,
+                       const char* key,
+                       JsonObject* value,
+                       bool reference) noexcept
+{
     const size_t key_sz = std::strlen(key);
     char* new_key = static_cast<char*>(this->_string_arena.allocate(key_sz + 1));
 
@@ -537,58 +754,87 @@ void Json::dict_append(JsonObject* dict,
     {
         auto* new_value = _value_arena.emplace<JsonObject>();
         std::memcpy(new_value, value, sizeof(JsonObject));
-        element->kv.value = new_value;
-    }
-    else
-    {
-        element->kv.value = value;
+        value = new_value;
     }
 
-    element->kv.key = new_key;
-
-    tag_incr_sz(dict->_tags);
+    JsonDict_::insert(this, dict, new_key, key_sz, value);
 }
 
 void Json::dict_pop(JsonObject* dict, const char* key) noexcept
 {
     auto* info = static_cast<JsonDictInfo*>(dict->_value.ptr);
+    auto* element = JsonDict_::find(info, key, std::strlen(key));
 
-    JsonDictElement* previous = nullptr;
-    auto* current = info->head;
-
-    while(current != nullptr)
-    {
-        if(std::strcmp(current->kv.key, key) == 0)
-            break;
+    if(element == nullptr)
+        return;
 
-        previous = current;
-        current = current->next;
-    }
+    JsonDict_::erase(dict, element);
+}
 
-    if(current == nullptr)
-        return;
+/****************/
+/* Json parser  */
+/****************/
 
-    if(previous == nullptr)
-    {
-        info->head = current->next;
+/* Unescapes n bytes of a raw json string (without quotes) into dst, returns the unescaped size */
+static std::size_t json_unescape(const char* src, std::size_t n, char* dst) noexcept
+{
+    std::size_t j = 0;
 
-        if(info->head == nullptr)
-            info->tail = nullptr;
-    }
-    else
+    for(std::size_t i = 0; i < n; i++)
     {
-        previous->next = current->next;
+        if(src[i] == '\\')
+        {
+            i++;
 
-        if(current == info->tail)
-            info->tail = previous;
+            switch(src[i])
+            {
+                case '"':  dst[j++] = '"';  break;
+                case '\\': dst[j++] = '\\'; break;
+                case '/':  dst[j++] = '/';  break;
+                case 'b':  dst[j++] = '\b'; break;
+                case 'f':  dst[j++] = '\f'; break;
+                case 'n':  dst[j++] = '\n'; break;
+                case 'r':  dst[j++] = '\r'; break;
+                case 't':  dst[j++] = '\t'; break;
+                case 'u':
+                {
+                    /* TODO: proper unicode handling */
+                    i += 4;
+                    dst[j++] = '?';
+                    break;
+                }
+                default: dst[j++] = src[i]; break;
+            }
+        }
+        else
+        {
+            dst[j++] = src[i];
+        }
     }
 
-    tag_decr_sz(dict->_tags);
+    return j;
 }
 
-/****************/
-/* Json parser  */
-/****************/
+STDROMANO_FORCE_INLINE std::size_t json_skip_whitespace(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    static constexpr bool ws[256] = {
+            //  0      1      2      3      4      5      6      7
+            //  NUL    SOH    STX    ETX    EOT    ENQ    ACK    BEL
+                false, false, false, false, false, false, false, false,
+            //  BS     HT     LF     VT     FF     CR     SO     SI
+                false, true,  true,  true,  true,  true,  false, false,
+            //  16-31
+                false, false, false, false, false, false, false, false,
+                false, false, false, false, false, false, false, false,
+            //  SP     !
+                true,  false,
+    };
+
+    while(pos < len && ws[(std::uint8_t)str[pos]])
+        pos++;
+
+    return pos;
+}
 
 struct JsonParser_
 {
@@ -597,37 +843,39 @@ struct JsonParser_
     std::size_t len;
     Json* json;
 
+    /* Same buffer as str when parsing in place, nullptr otherwise */
+    char* inplace_str;
+
+    /* Elements of the arrays being parsed, arrays get an exact-size storage once closed. Owned by
+       the document, and reused across parses */
+    Vector<JsonObject*>& stack;
+
+    /* Parses a whole document into json, its scratch stack is reused */
+    static JsonObject* parse(Json* json, const char* str, char* inplace_str, size_t len) noexcept;
+
     STDROMANO_FORCE_INLINE void skip_whitespace() noexcept
     {
-        static constexpr bool ws[256] = {
-                //  0      1      2      3      4      5      6      7
-                //  NUL    SOH    STX    ETX    EOT    ENQ    ACK    BEL
-                    false, false, false, false, false, false, false, false,
-                //  BS     HT     LF     VT     FF     CR     SO     SI
-                    false, true,  true,  true,  true,  true,  false, false,
-                //  16-31
-                    false, false, false, false, false, false, false, false,
-                    false, false, false, false, false, false, false, false,
-                //  SP     !
-                    true,  false,
-        };
-
-        while(this->pos < this->len && ws[(std::uint8_t)this->str[this->pos]])
-            this->pos++;
+        this->pos = json_skip_whitespace(this->str, this->pos, this->len);
     }
 
+    bool parse_raw_string(const char** out, std::size_t* out_sz) noexcept;
+
     JsonObject* parse_value() noexcept;
     JsonObject* parse_string() noexcept;
     JsonObject* parse_number() noexcept;
+
+    /* Parses a number into out, without allocating (also used by JsonLazy) */
+    static bool parse_number(const char* str, std::size_t& pos, std::size_t len, JsonObject* out) noexcept;
     JsonObject* parse_array() noexcept;
     JsonObject* parse_dict() noexcept;
     JsonObject* parse_literal() noexcept;
 };
 
-JsonObject* JsonParser_::parse_string() noexcept
+/* Parses a string into the string arena, without creating a value (used for dict keys) */
+bool JsonParser_::parse_raw_string(const char** out, std::size_t* out_sz) noexcept
 {
     if(pos >= len || str[pos] != '"')
-        return nullptr;
+        return false;
 
     pos++;
 
@@ -649,19 +897,19 @@ JsonObject* JsonParser_::parse_string() noexcept
             pos++;
 
             if(pos >= len)
-                return nullptr;
+                return false;
 
             if(str[pos] == 'u')
             {
                 pos += 4;
 
                 if(pos >= len)
-                    return nullptr;
+                    return false;
             }
         }
         else if(static_cast<unsigned char>(c) < 0x20)
         {
-            return nullptr;
+            return false;
         }
 
         pos++;
@@ -669,12 +917,16 @@ JsonObject* JsonParser_::parse_string() noexcept
     }
 
     if(pos >= len)
-        return nullptr;
+        return false;
 
-    JsonObject* obj = json->_value_arena.emplace<JsonObject>();
     char* s;
 
-    if(!has_escape)
+    if(!has_escape && inplace_str != nullptr)
+    {
+        s = inplace_str + start;
+        s[slen] = '\0';
+    }
+    else if(!has_escape)
     {
         s = static_cast<char*>(json->_string_arena.allocate(slen + 1));
         std::memcpy(s, str + start, slen);
@@ -683,46 +935,28 @@ JsonObject* JsonParser_::parse_string() noexcept
     else
     {
         s = static_cast<char*>(json->_string_arena.allocate(slen + 1));
-        std::size_t j = 0;
-
-        for(std::size_t i = start; i < pos; i++)
-        {
-            if(str[i] == '\\')
-            {
-                i++;
-
-                switch(str[i])
-                {
-                    case '"':  s[j++] = '"';  break;
-                    case '\\': s[j++] = '\\'; break;
-                    case '/':  s[j++] = '/';  break;
-                    case 'b':  s[j++] = '\b'; break;
-                    case 'f':  s[j++] = '\f'; break;
-                    case 'n':  s[j++] = '\n'; break;
-                    case 'r':  s[j++] = '\r'; break;
-                    case 't':  s[j++] = '\t'; break;
-                    case 'u':
-                    {
-                        /* TODO: proper unicode handling */
-                        i += 4;
-                        s[j++] = '?';
-                        break;
-                    }
-                    default: s[j++] = str[i]; break;
-                }
-            }
-            else
-            {
-                s[j++] = str[i];
-            }
-        }
-
-        s[j] = '\0';
-        slen = j;
+        slen = json_unescape(str + start, pos - start, s);
+        s[slen] = '\0';
     }
 
     pos++;
 
+    *out = s;
+    *out_sz = slen;
+
+    return true;
+}
+
+JsonObject* JsonParser_::parse_string() noexcept
+{
+    const char* s;
+    std::size_t slen;
+
+    if(!this->parse_raw_string(&s, &slen))
+        return nullptr;
+
+    JsonObject* obj = json->_value_arena.emplace<JsonObject>();
+
     tag_set_type(obj->_tags, JsonTag_Str);
     tag_set_sz(obj->_tags, static_cast<std::uint32_t>(slen));
     obj->_value.str = s;
@@ -748,6 +982,19 @@ static constexpr std::size_t POW10_TABLE_SIZE     = sizeof(pow10_table) / sizeof
 static constexpr std::size_t POW10_INT_TABLE_SIZE = sizeof(pow10_int_table) / sizeof(pow10_int_table[0]);
 
 JsonObject* JsonParser_::parse_number() noexcept
+{
+    JsonObject number;
+
+    if(!JsonParser_::parse_number(this->str, this->pos, this->len, &number))
+        return nullptr;
+
+    JsonObject* obj = json->_value_arena.emplace<JsonObject>();
+    *obj = number;
+
+    return obj;
+}
+
+bool JsonParser_::parse_number(const char* str, std::size_t& pos, std::size_t len, JsonObject* out) noexcept
 {
     bool is_negative = false;
     bool is_float = false;
@@ -763,7 +1010,7 @@ JsonObject* JsonParser_::parse_number() noexcept
     }
 
     if(pos >= len || !is_digit(str[pos]))
-        return nullptr;
+        return false;
 
     while(pos < len && is_digit(str[pos]))
     {
@@ -778,7 +1025,7 @@ JsonObject* JsonParser_::parse_number() noexcept
         pos++;
 
         if(pos >= len || !is_digit(str[pos]))
-            return nullptr;
+            return false;
 
         int frac_digits = 0;
         std::uint64_t frac_int = 0;
@@ -816,7 +1063,7 @@ JsonObject* JsonParser_::parse_number() noexcept
         }
 
         if(pos >= len || !is_digit(str[pos]))
-            return nullptr;
+            return false;
 
         while(pos < len && is_digit(str[pos]))
         {
@@ -846,13 +1093,24 @@ JsonObject* JsonParser_::parse_number() noexcept
         if(is_negative)
             float_val = -float_val;
 
-        return json->make_f64(float_val);
+        tag_set_type(out->_tags, JsonTag_F64);
+        out->_value.f64 = float_val;
+
+        return true;
     }
 
     if(is_negative)
-        return json->make_i64(-int_val);
+    {
+        tag_set_type(out->_tags, JsonTag_I64);
+        out->_value.i64 = -int_val;
 
-    return json->make_u64(static_cast<uint64_t>(int_val));
+        return true;
+    }
+
+    tag_set_type(out->_tags, JsonTag_U64);
+    out->_value.u64 = static_cast<uint64_t>(int_val);
+
+    return true;
 }
 
 JsonObject* JsonParser_::parse_array() noexcept
@@ -871,6 +1129,8 @@ JsonObject* JsonParser_::parse_array() noexcept
         return array;
     }
 
+    const std::size_t stack_base = this->stack.size();
+
     while(pos < len)
     {
         JsonObject* element = parse_value();
@@ -878,7 +1138,7 @@ JsonObject* JsonParser_::parse_array() noexcept
         if(element == nullptr)
             return nullptr;
 
-        json->array_append(array, element, true);
+        this->stack.push_back(element);
         this->skip_whitespace();
 
         if(pos >= len)
@@ -892,6 +1152,17 @@ JsonObject* JsonParser_::parse_array() noexcept
         else if(str[pos] == ']')
         {
             pos++;
+
+            const auto sz = static_cast<std::uint32_t>(this->stack.size() - stack_base);
+            auto* info = static_cast<JsonArrayInfo*>(array->_value.ptr);
+
+            json_array_set_capacity(json->_value_arena, info, 0, sz);
+            std::memcpy(info->data, this->stack.data() + stack_base, sz * sizeof(JsonObject*));
+            tag_set_sz(array->_tags, sz);
+
+            this->stack.erase(this->stack.begin() + static_cast<Vector<JsonObject*>::difference_type>(stack_base),
+                              this->stack.end());
+
             return array;
         }
         else
@@ -926,13 +1197,12 @@ JsonObject* JsonParser_::parse_dict() noexcept
         if(pos >= len || str[pos] != '"')
             return nullptr;
 
-        JsonObject* key_val = this->parse_string();
+        const char* key;
+        std::size_t key_sz;
 
-        if(key_val == nullptr)
+        if(!this->parse_raw_string(&key, &key_sz))
             return nullptr;
 
-        const char* key = key_val->_value.str;
-
         this->skip_whitespace();
 
         if(pos >= len || str[pos] != ':')
@@ -946,7 +1216,7 @@ JsonObject* JsonParser_::parse_dict() noexcept
         if(value == nullptr)
             return nullptr;
 
-        json->dict_append(dict, key, value, true);
+        JsonDict_::insert(json, dict, key, key_sz, value);
         this->skip_whitespace();
 
         if(pos >= len)
@@ -1021,39 +1291,22 @@ JsonObject* JsonParser_::parse_value() noexcept
 /* Json writer  */
 /****************/
 
-struct JsonWriter_
-{
-    const Json* json;
-    StringD* out;
-    std::size_t indent_size;
-    std::size_t indent;
+/* Newline followed by spaces, indentation up to this depth is written with a single copy */
+static constexpr std::size_t JSON_INDENT_TABLE_SIZE = 128;
 
-    STDROMANO_FORCE_INLINE void write_indent() noexcept
-    {
-        out->appendf("{:{}}", "", indent);
-    }
+static constexpr auto json_indent_table = []() {
+    std::array<char, JSON_INDENT_TABLE_SIZE + 1> table{};
+    table[0] = '\n';
 
-    bool write_value(const JsonObject* value) noexcept;
-    void write_str(const char* s) noexcept;
-    bool write_array(const JsonObject* array) noexcept;
-    bool write_dict(const JsonObject* dict) noexcept;
-};
+    for(std::size_t i = 1; i < table.size(); i++)
+        table[i] = ' ';
+
+    return table;
+}();
 
 STDROMANO_FORCE_INLINE bool char_needs_escape(char c) noexcept
 {
-    switch(c)
-    {
-        case '"':
-        case '\\':
-        case '\b':
-        case '\f':
-        case '\n':
-        case '\r':
-        case '\t':
-            return true;
-        default:
-            return false;
-    }
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
 }
 
 STDROMANO_FORCE_INLINE char escape_char(char c) noexcept
@@ -1067,226 +1320,513 @@ STDROMANO_FORCE_INLINE char escape_char(char c) noexcept
         case '\n': return 'n';
         case '\r': return 'r';
         case '\t': return 't';
-        default:   return c;
+        default:   return 0;
     }
 }
 
-void JsonWriter_::write_str(const char* s) noexcept
+/* Escape scanning, finds the next character needing an escape 16/32 bytes at a time */
+
+std::size_t json_escape_scan_scalar_kernel(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    while(pos < len && !char_needs_escape(str[pos]))
+        pos++;
+
+    return pos;
+}
+
+std::size_t json_escape_scan_sse_kernel(const char* str, std::size_t pos, std::size_t len) noexcept
 {
-    out->appendc("\"", 1);
+    constexpr std::size_t simd_width = 16;
 
-    const char* seg_start = s;
-    const char* p = s;
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
 
-    while(*p != '\0')
+    for(; pos + simd_width <= len; pos += simd_width)
     {
-        if(char_needs_escape(*p))
-        {
-            if(p > seg_start)
-                out->appendc(seg_start, static_cast<size_t>(p - seg_start));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos));
 
-            const char esc[2] = { '\\', escape_char(*p) };
-            out->appendc(esc, 2);
-            seg_start = p + 1;
-        }
+        __m128i matches = _mm_cmpeq_epi8(c, quote);
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, backslash));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(_mm_max_epu8(c, control), control));
 
-        p++;
-    }
+        const std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(matches));
 
-    if(p > seg_start)
-        out->appendc(seg_start, static_cast<size_t>(p - seg_start));
+        if(mask != 0)
+            return pos + ctz_u64(mask);
+    }
 
-    out->appendc("\"", 1);
+    return json_escape_scan_scalar_kernel(str, pos, len);
 }
 
-bool JsonWriter_::write_array(const JsonObject* array) noexcept
+std::size_t json_escape_scan_avx_kernel(const char* str, std::size_t pos, std::size_t len) noexcept
 {
-    out->appendc("[", 1);
+    constexpr std::size_t simd_width = 32;
+
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+
+    for(; pos + simd_width <= len; pos += simd_width)
+    {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos));
+
+        __m256i matches = _mm256_cmpeq_epi8(c, quote);
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(c, backslash));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(_mm256_max_epu8(c, control), control));
 
-    if(indent_size > 0)
-        indent += indent_size;
+        const std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(matches));
 
-    size_t i = 0;
+        if(mask != 0)
+            return pos + ctz_u64(mask);
+    }
+
+    return json_escape_scan_sse_kernel(str, pos, len);
+}
 
-    for(auto* element : array->array_items())
+STDROMANO_FORCE_INLINE std::size_t json_escape_scan(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    switch(simd_get_vectorization_mode())
     {
-        if(i > 0)
-            out->appendc(",", 1);
+        default:
+        case VectorizationMode_Scalar:
+            return json_escape_scan_scalar_kernel(str, pos, len);
+        case VectorizationMode_SSE:
+        case VectorizationMode_AVX:
+            return json_escape_scan_sse_kernel(str, pos, len);
+        case VectorizationMode_AVX2:
+            return json_escape_scan_avx_kernel(str, pos, len);
+    }
+}
 
-        if(indent_size > 0)
+struct JsonWriter_
+{
+    static void output(JsonWriter* writer, const char* data, std::size_t size) noexcept
+    {
+        if(writer->_out != nullptr)
         {
-            out->appendc("\n", 1);
-            write_indent();
+            writer->_out->appendc(data, size);
+            return;
         }
 
-        if(!write_value(element))
-            return false;
+        while(size > 0 && !writer->_error)
+        {
+#if defined(STDROMANO_WIN)
+            const int written = ::_write(writer->_fd, data, static_cast<unsigned int>(std::min(size, static_cast<std::size_t>(INT_MAX))));
+#else
+            const ssize_t written = ::write(writer->_fd, data, size);
+#endif /* defined(STDROMANO_WIN) */
+
+            if(written < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+
+                writer->_error = true;
+                return;
+            }
 
-        i++;
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
     }
 
-    if(indent_size > 0)
+    STDROMANO_FORCE_INLINE static void write(JsonWriter* writer, const char* data, std::size_t size) noexcept
     {
-        out->appendc("\n", 1);
-        indent -= indent_size;
-        write_indent();
+        if(writer->_buffer_size + size > writer->_buffer_capacity)
+        {
+            writer->flush();
+
+            /* Does not fit in the buffer, no need to copy it */
+            if(size > writer->_buffer_capacity)
+            {
+                JsonWriter_::output(writer, data, size);
+                return;
+            }
+        }
+
+        std::memcpy(writer->_buffer + writer->_buffer_size, data, size);
+        writer->_buffer_size += size;
     }
 
-    out->appendc("]", 1);
-    return true;
-}
+    STDROMANO_FORCE_INLINE static void write_char(JsonWriter* writer, char c) noexcept
+    {
+        if(writer->_buffer_size == writer->_buffer_capacity)
+            writer->flush();
 
-bool JsonWriter_::write_dict(const JsonObject* dict) noexcept
-{
-    out->appendc("{", 1);
+        writer->_buffer[writer->_buffer_size++] = c;
+    }
 
-    if(indent_size > 0)
-        indent += indent_size;
+    static void write_newline_indent(JsonWriter* writer) noexcept
+    {
+        std::size_t indent = writer->_indent;
+        const std::size_t first = std::min(indent, JSON_INDENT_TABLE_SIZE);
+
+        JsonWriter_::write(writer, json_indent_table.data(), first + 1);
+        indent -= first;
 
-    size_t i = 0;
+        while(indent > 0)
+        {
+            const std::size_t n = std::min(indent, JSON_INDENT_TABLE_SIZE);
+            JsonWriter_::write(writer, json_indent_table.data() + 1, n);
+            indent -= n;
+        }
+    }
 
-    for(auto [key, value] : dict->dict_items())
+    /* Separator and indentation before a value or a key */
+    static void value_prefix(JsonWriter* writer) noexcept
     {
-        if(i > 0)
-            out->appendc(",", 1);
+        if(writer->_after_key)
+        {
+            writer->_after_key = false;
+            return;
+        }
 
-        if(indent_size > 0)
+        if(writer->_depth == 0)
         {
-            out->appendc("\n", 1);
-            write_indent();
+            /* Values following each other at the root are separated by a newline (ndjson) */
+            if(writer->_needs_comma)
+                JsonWriter_::write_char(writer, '\n');
+
+            return;
         }
 
-        write_str(key);
-        out->appendc(": ", 2);
+        if(writer->_needs_comma)
+            JsonWriter_::write_char(writer, ',');
 
-        if(!write_value(value))
-            return false;
+        if(writer->_indent_size > 0)
+            JsonWriter_::write_newline_indent(writer);
+    }
+
+    static void container_start(JsonWriter* writer, char c) noexcept
+    {
+        JsonWriter_::value_prefix(writer);
+        JsonWriter_::write_char(writer, c);
 
-        i++;
+        writer->_depth++;
+        writer->_indent += writer->_indent_size;
+        writer->_needs_comma = false;
     }
 
-    if(indent_size > 0)
+    static void container_end(JsonWriter* writer, char c) noexcept
     {
-        out->appendc("\n", 1);
-        indent -= indent_size;
-        write_indent();
+        writer->_depth--;
+        writer->_indent -= writer->_indent_size;
+
+        if(writer->_indent_size > 0)
+            JsonWriter_::write_newline_indent(writer);
+
+        JsonWriter_::write_char(writer, c);
+        writer->_needs_comma = true;
     }
 
-    out->appendc("}", 1);
-    return true;
+    static void write_str(JsonWriter* writer, const char* s, std::size_t len) noexcept
+    {
+        JsonWriter_::write_char(writer, '"');
+
+        std::size_t start = 0;
+
+        while(true)
+        {
+            const std::size_t pos = json_escape_scan(s, start, len);
+
+            if(pos > start)
+                JsonWriter_::write(writer, s + start, pos - start);
+
+            if(pos >= len)
+                break;
+
+            const char esc = escape_char(s[pos]);
+
+            if(esc != 0)
+            {
+                const char escaped[2] = { '\\', esc };
+                JsonWriter_::write(writer, escaped, 2);
+            }
+            else
+            {
+                static constexpr char hex[] = "0123456789abcdef";
+                const auto c = static_cast<unsigned char>(s[pos]);
+                const char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                JsonWriter_::write(writer, escaped, 6);
+            }
+
+            start = pos + 1;
+        }
+
+        JsonWriter_::write_char(writer, '"');
+    }
+
+    static bool write_value(JsonWriter* writer, const JsonObject* value) noexcept
+    {
+        const std::uint64_t tag = value->_tags & JSON_TAGS_MASK;
+
+        switch(tag)
+        {
+            case JsonTag_Null:
+                writer->value_null();
+                return true;
+
+            case JsonTag_Bool:
+                writer->value_bool(value->_value.b);
+                return true;
+
+            case JsonTag_U64:
+                writer->value_u64(value->_value.u64);
+                return true;
+
+            case JsonTag_I64:
+                writer->value_i64(value->_value.i64);
+                return true;
+
+            case JsonTag_F64:
+                writer->value_f64(value->_value.f64);
+                return true;
+
+            case JsonTag_Str:
+                writer->value_str(value->_value.str, tag_get_sz(value->_tags));
+                return true;
+
+            case JsonTag_Array:
+            {
+                writer->array_start();
+
+                for(auto* element : value->array_items())
+                    if(!JsonWriter_::write_value(writer, element))
+                        return false;
+
+                writer->array_end();
+                return true;
+            }
+
+            case JsonTag_Dict:
+            {
+                writer->dict_start();
+
+                const auto* info = static_cast<const JsonDictInfo*>(value->_value.ptr);
+
+                for(const JsonDictElement* element = info->head; element != nullptr; element = element->next)
+                {
+                    writer->key(element->kv.key, element->key_sz);
+
+                    if(!JsonWriter_::write_value(writer, element->kv.value))
+                        return false;
+                }
+
+                writer->dict_end();
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+};
+
+JsonWriter::JsonWriter(int fd, std::size_t indent_size, std::size_t buffer_size) noexcept : _buffer(nullptr),
+                                                                                          _buffer_capacity(std::max(buffer_size, JSON_INDENT_TABLE_SIZE + 1)),
+                                                                                          _buffer_size(0),
+                                                                                          _fd(fd),
+                                                                                          _out(nullptr),
+                                                                                          _indent_size(indent_size),
+                                                                                          _indent(0),
+                                                                                          _depth(0),
+                                                                                          _needs_comma(false),
+                                                                                          _after_key(false),
+                                                                                          _error(false)
+{
+    this->_buffer = mem_alloc<char>(this->_buffer_capacity);
 }
 
-bool JsonWriter_::write_value(const JsonObject* value) noexcept
+JsonWriter::JsonWriter(StringD* out, std::size_t indent_size, std::size_t buffer_size) noexcept : JsonWriter(-1, indent_size, buffer_size)
 {
-    const std::uint64_t tag = value->_tags & JSON_TAGS_MASK;
+    this->_out = out;
+}
 
-    switch(tag)
-    {
-        case JsonTag_Null:
-            out->appendc("null", 4);
-            return true;
+JsonWriter::~JsonWriter() noexcept
+{
+    this->flush();
+    mem_free(this->_buffer);
+}
 
-        case JsonTag_Bool:
-            if(value->_value.b)
-                out->appendc("true", 4);
-            else
-                out->appendc("false", 5);
-            return true;
+void JsonWriter::dict_start() noexcept { JsonWriter_::container_start(this, '{'); }
 
-        case JsonTag_U64:
-            out->appendf("{}", value->_value.u64);
-            return true;
+void JsonWriter::dict_end() noexcept { JsonWriter_::container_end(this, '}'); }
 
-        case JsonTag_I64:
-            out->appendf("{}", value->_value.i64);
-            return true;
+void JsonWriter::array_start() noexcept { JsonWriter_::container_start(this, '['); }
 
-        case JsonTag_F64:
-            out->appendf("{:.3f}", value->_value.f64);
-            return true;
+void JsonWriter::array_end() noexcept { JsonWriter_::container_end(this, ']'); }
 
-        case JsonTag_Str:
-            write_str(value->_value.str);
-            return true;
+void JsonWriter::key(const char* key, std::size_t key_sz) noexcept
+{
+    JsonWriter_::value_prefix(this);
+    JsonWriter_::write_str(this, key, key_sz);
+    JsonWriter_::write(this, ": ", 2);
+
+    this->_after_key = true;
+}
 
-        case JsonTag_Array:
-            return write_array(value);
+void JsonWriter::key(const char* key) noexcept
+{
+    this->key(key, std::strlen(key));
+}
+
+void JsonWriter::value_null() noexcept
+{
+    JsonWriter_::value_prefix(this);
+    JsonWriter_::write(this, "null", 4);
+    this->_needs_comma = true;
+}
 
-        case JsonTag_Dict:
-            return write_dict(value);
+void JsonWriter::value_bool(bool b) noexcept
+{
+    JsonWriter_::value_prefix(this);
 
-        default:
-            return false;
+    if(b)
+        JsonWriter_::write(this, "true", 4);
+    else
+        JsonWriter_::write(this, "false", 5);
+
+    this->_needs_comma = true;
+}
+
+void JsonWriter::value_u64(std::uint64_t u64) noexcept
+{
+    JsonWriter_::value_prefix(this);
+
+    const fmt::format_int formatted(u64);
+    JsonWriter_::write(this, formatted.data(), formatted.size());
+
+    this->_needs_comma = true;
+}
+
+void JsonWriter::value_i64(std::int64_t i64) noexcept
+{
+    JsonWriter_::value_prefix(this);
+
+    const fmt::format_int formatted(i64);
+    JsonWriter_::write(this, formatted.data(), formatted.size());
+
+    this->_needs_comma = true;
+}
+
+void JsonWriter::value_f64(double f64) noexcept
+{
+    JsonWriter_::value_prefix(this);
+
+    fmt::memory_buffer formatted;
+    fmt::format_to(std::back_inserter(formatted), "{:.3f}", f64);
+    JsonWriter_::write(this, formatted.data(), formatted.size());
+
+    this->_needs_comma = true;
+}
+
+void JsonWriter::value_str(const char* str, std::size_t str_sz) noexcept
+{
+    JsonWriter_::value_prefix(this);
+    JsonWriter_::write_str(this, str, str_sz);
+    this->_needs_comma = true;
+}
+
+void JsonWriter::value_str(const char* str) noexcept
+{
+    this->value_str(str, std::strlen(str));
+}
+
+bool JsonWriter::write(const JsonObject* value) noexcept
+{
+    return value != nullptr && JsonWriter_::write_value(this, value);
+}
+
+bool JsonWriter::flush() noexcept
+{
+    if(this->_buffer_size > 0)
+    {
+        JsonWriter_::output(this, this->_buffer, this->_buffer_size);
+        this->_buffer_size = 0;
     }
+
+    return !this->_error;
 }
 
 /******************************/
 /* Json: parse / dump         */
 /******************************/
 
-bool Json::loads(const char* str, size_t len) noexcept
+JsonObject* JsonParser_::parse(Json* json, const char* str, char* inplace_str, size_t len) noexcept
 {
-    if(str == nullptr || len == 0)
-        return false;
+    json->_parse_stack.clear();
 
-    JsonParser_ parser;
-    parser.str = str;
-    parser.pos = 0;
-    parser.len = len;
-    parser.json = this;
+    JsonParser_ parser{ str, 0, len, json, inplace_str, json->_parse_stack };
 
     JsonObject* root = parser.parse_value();
 
     if(root == nullptr)
-    {
-        return false;
-    }
+        return nullptr;
 
     parser.skip_whitespace();
 
     if(parser.pos != parser.len)
-    {
+        return nullptr;
+
+    return root;
+}
+
+bool Json::loads(const char* str, size_t len) noexcept
+{
+    if(str == nullptr || len == 0)
+        return false;
+
+    JsonObject* root = JsonParser_::parse(this, str, nullptr, len);
+
+    if(root == nullptr)
         return false;
-    }
 
     this->_root = root;
 
     return true;
 }
 
-bool Json::loadf(const StringD& path) noexcept
+bool Json::loads_inplace(char* str, size_t len) noexcept
 {
-    FILE* file = std::fopen(path.c_str(), "rb");
+    if(str == nullptr || len == 0)
+        return false;
+
+    JsonObject* root = JsonParser_::parse(this, str, str, len);
 
-    if(file == nullptr)
+    if(root == nullptr)
         return false;
 
-    std::fseek(file, 0, SEEK_END);
-    const auto file_size = static_cast<size_t>(std::ftell(file));
-    std::rewind(file);
+    this->_root = root;
+
+    return true;
+}
+
+bool Json::loadf(const StringD& path, std::uint32_t flags) noexcept
+{
+    const bool zero_copy = (flags & JsonLoadFlags_ZeroCopy) != 0;
 
-    auto* buffer = static_cast<char*>(std::calloc(file_size, sizeof(char)));
+    auto mapped = fs::map_file(path,
+                               fs::MapFileFlags_Sequential |
+                               (zero_copy ? fs::MapFileFlags_CopyOnWrite : 0));
 
-    if(buffer == nullptr)
-    {
-        std::fclose(file);
+    if(!mapped.has_value())
         return false;
-    }
 
-    const size_t read_size = std::fread(buffer, sizeof(char), file_size, file);
-    std::fclose(file);
+    fs::MappedFile file = mapped.value();
 
-    if(read_size != file_size)
-    {
-        std::free(buffer);
+    if(!zero_copy)
+        return this->loads(file.data(), file.size());
+
+    if(!this->loads_inplace(file.data(), file.size()))
         return false;
-    }
 
-    bool res = loads(buffer, file_size);
+    if(this->_source == nullptr)
+        this->_source = new fs::MappedFile();
 
-    std::free(buffer);
+    *this->_source = std::move(file);
 
-    return res;
+    return true;
 }
 
 StringD Json::dumps(size_t indent_size) const noexcept
@@ -1296,31 +1836,3096 @@ StringD Json::dumps(size_t indent_size) const noexcept
     if(this->_root == nullptr)
         return result;
 
-    JsonWriter_ writer;
-    writer.json = this;
-    writer.out = &result;
-    writer.indent_size = indent_size;
-    writer.indent = 0;
-
-    writer.write_value(this->_root);
+    JsonWriter writer(&result, indent_size);
+    writer.write(this->_root);
+    writer.flush();
 
     return result;
 }
 
 bool Json::dumpf(size_t indent_size, const StringD& path) const noexcept
 {
-    StringD written = this->dumps(indent_size);
+#if defined(STDROMANO_WIN)
+    const int fd = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif /* defined(STDROMANO_WIN) */
+
+    if(fd < 0)
+        return false;
+
+    bool res;
 
-    FILE* file = std::fopen(path.c_str(), "wb");
+    {
+        JsonWriter writer(fd, indent_size);
+        res = this->_root == nullptr || writer.write(this->_root);
+        res = writer.flush() && res;
+    }
+
+#if defined(STDROMANO_WIN)
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif /* defined(STDROMANO_WIN) */
+
+    return res;
+}
 
-    if(file == nullptr)
+/**************/
+/* JsonPool   */
+/**************/
+
+JsonPool::JsonPool(std::size_t max_documents) noexcept : _max_documents(max_documents)
+{
+}
+
+JsonPool::~JsonPool() noexcept
+{
+    for(Json* json : this->_documents)
+        delete json;
+}
+
+Json* JsonPool::acquire() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+
+        if(!this->_documents.empty())
+            return this->_documents.pop_back();
+    }
+
+    return new Json();
+}
+
+void JsonPool::release(Json* json) noexcept
+{
+    if(json == nullptr)
+        return;
+
+    /* Reset outside of the lock, running the arenas destructors may take a while */
+    json->reset();
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+
+        if(this->_documents.size() < this->_max_documents)
+        {
+            this->_documents.push_back(json);
+            return;
+        }
+    }
+
+    delete json;
+}
+
+std::size_t JsonPool::size() const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    return this->_documents.size();
+}
+
+/**********************************/
+/* JsonLazy: structural scanning  */
+/**********************************/
+
+/*
+ * Skipping a value only needs the string delimiters and the container brackets, the scan kernels
+ * look for them 16/32 bytes at a time. Outside of strings we look for '"', '[', ']', '{' and '}',
+ * inside of strings for '"' and '\\'
+ */
+
+template <bool InString>
+STDROMANO_FORCE_INLINE bool json_is_structural(char c) noexcept
+{
+    if constexpr(InString)
+        return c == '"' || c == '\\';
+    else
+        return c == '"' || c == '[' || c == ']' || c == '{' || c == '}';
+}
+
+template <bool InString>
+std::size_t json_scan_scalar_kernel(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    while(pos < len && !json_is_structural<InString>(str[pos]))
+        pos++;
+
+    return pos;
+}
+
+template <bool InString>
+std::size_t json_scan_sse_kernel(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    constexpr std::size_t simd_width = 16;
+
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open_array = _mm_set1_epi8('[');
+    const __m128i close_array = _mm_set1_epi8(']');
+    const __m128i open_dict = _mm_set1_epi8('{');
+    const __m128i close_dict = _mm_set1_epi8('}');
+
+    for(; pos + simd_width <= len; pos += simd_width)
+    {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos));
+
+        __m128i matches = _mm_cmpeq_epi8(c, quote);
+
+        if constexpr(InString)
+        {
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, backslash));
+        }
+        else
+        {
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, open_array));
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, close_array));
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, open_dict));
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, close_dict));
+        }
+
+        const std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(matches));
+
+        if(mask != 0)
+            return pos + ctz_u64(mask);
+    }
+
+    return json_scan_scalar_kernel<InString>(str, pos, len);
+}
+
+template <bool InString>
+std::size_t json_scan_avx_kernel(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    constexpr std::size_t simd_width = 32;
+
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i open_array = _mm256_set1_epi8('[');
+    const __m256i close_array = _mm256_set1_epi8(']');
+    const __m256i open_dict = _mm256_set1_epi8('{');
+    const __m256i close_dict = _mm256_set1_epi8('}');
+
+    for(; pos + simd_width <= len; pos += simd_width)
+    {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos));
+
+        __m256i matches = _mm256_cmpeq_epi8(c, quote);
+
+        if constexpr(InString)
+        {
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(c, backslash));
+        }
+        else
+        {
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(c, open_array));
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(c, close_array));
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(c, open_dict));
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(c, close_dict));
+        }
+
+        const std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(matches));
+
+        if(mask != 0)
+            return pos + ctz_u64(mask);
+    }
+
+    return json_scan_sse_kernel<InString>(str, pos, len);
+}
+
+/* Returns the offset of the first structural character at or after pos, len if there is none */
+template <bool InString>
+STDROMANO_FORCE_INLINE std::size_t json_scan(const char* str, std::size_t pos, std::size_t len) noexcept
+{
+    switch(simd_get_vectorization_mode())
+    {
+        default:
+        case VectorizationMode_Scalar:
+            return json_scan_scalar_kernel<InString>(str, pos, len);
+        case VectorizationMode_SSE:
+        case VectorizationMode_AVX:
+            return json_scan_sse_kernel<InString>(str, pos, len);
+        case VectorizationMode_AVX2:
+            return json_scan_avx_kernel<InString>(str, pos, len);
+    }
+}
+
+struct JsonLazy_
+{
+    static constexpr std::size_t INVALID_POS = JsonLazyValue::INVALID_POS;
+
+    /* pos is on the opening quote, returns the offset after the closing quote */
+    static std::size_t skip_string(const char* str, std::size_t pos, std::size_t len, bool* has_escape) noexcept
+    {
+        pos++;
+
+        while(true)
+        {
+            pos = json_scan<true>(str, pos, len);
+
+            if(pos >= len)
+                return INVALID_POS;
+
+            if(str[pos] == '"')
+                return pos + 1;
+
+            *has_escape = true;
+            pos += 2;
+        }
+    }
+
+    /* Skips a container, when validating the brackets are checked to be matching */
+    template <bool Validate>
+    static std::size_t skip_container(const char* str, std::size_t pos, std::size_t len) noexcept
+    {
+        Vector<char> closers;
+        std::size_t depth = 0;
+
+        while(true)
+        {
+            pos = json_scan<false>(str, pos, len);
+
+            if(pos >= len)
+                return INVALID_POS;
+
+            const char c = str[pos];
+
+            if(c == '"')
+            {
+                bool has_escape = false;
+                pos = JsonLazy_::skip_string(str, pos, len, &has_escape);
+
+                if(pos == INVALID_POS)
+                    return INVALID_POS;
+
+                continue;
+            }
+
+            pos++;
+
+            if(c == '[' || c == '{')
+            {
+                if constexpr(Validate)
+                    closers.push_back(c == '[' ? ']' : '}');
+
+                depth++;
+                continue;
+            }
+
+            if constexpr(Validate)
+            {
+                if(depth == 0 || closers.pop_back() != c)
+                    return INVALID_POS;
+            }
+
+            if(--depth == 0)
+                return pos;
+        }
+    }
+
+    /* Returns the offset right after the value starting at pos */
+    template <bool Validate>
+    static std::size_t skip_value(const char* str, std::size_t pos, std::size_t len) noexcept
+    {
+        if(pos >= len)
+            return INVALID_POS;
+
+        const char c = str[pos];
+
+        if(c == '"')
+        {
+            bool has_escape = false;
+            return JsonLazy_::skip_string(str, pos, len, &has_escape);
+        }
+
+        if(c == '[' || c == '{')
+            return JsonLazy_::skip_container<Validate>(str, pos, len);
+
+        if(c == ']' || c == '}' || c == ',' || c == ':')
+            return INVALID_POS;
+
+        /* Scalars end at the next delimiter or whitespace */
+        const std::size_t start = pos;
+
+        while(pos < len && str[pos] != ',' && str[pos] != ']' && str[pos] != '}' &&
+              json_skip_whitespace(str, pos, len) == pos)
+        {
+            pos++;
+        }
+
+        return pos > start ? pos : INVALID_POS;
+    }
+
+    /* Returns the offset of the first element of the container starting at pos */
+    static std::size_t first_element(const char* str, std::size_t pos, std::size_t len, char closer) noexcept
+    {
+        pos = json_skip_whitespace(str, pos + 1, len);
+
+        if(pos >= len || str[pos] == closer)
+            return INVALID_POS;
+
+        return pos;
+    }
+
+    /* Returns the offset of the element following the value ending at pos */
+    static std::size_t next_element(const char* str, std::size_t pos, std::size_t len) noexcept
+    {
+        pos = json_skip_whitespace(str, pos, len);
+
+        if(pos >= len || str[pos] != ',')
+            return INVALID_POS;
+
+        return json_skip_whitespace(str, pos + 1, len);
+    }
+
+    static bool key_equals(const char* raw,
+                           std::size_t raw_sz,
+                           bool has_escape,
+                           const char* key,
+                           std::size_t key_sz) noexcept
+    {
+        if(!has_escape)
+            return raw_sz == key_sz && std::memcmp(raw, key, key_sz) == 0;
+
+        if(key_sz > raw_sz)
+            return false;
+
+        StringD unescaped = StringD::make_zeroed(raw_sz);
+        const std::size_t unescaped_sz = json_unescape(raw, raw_sz, unescaped.data());
+
+        return unescaped_sz == key_sz && std::memcmp(unescaped.data(), key, key_sz) == 0;
+    }
+
+    static bool parse_number(const JsonLazyValue& value, JsonObject* out) noexcept
+    {
+        if(!value.is_valid())
+            return false;
+
+        std::size_t pos = value._pos;
+
+        return JsonParser_::parse_number(value._str, pos, value._len, out);
+    }
+};
+
+/****************************/
+/* JsonLazyValue: accessors */
+/****************************/
+
+bool JsonLazyValue::is_null() const noexcept
+{
+    return this->is_valid() && this->_str[this->_pos] == 'n';
+}
+
+bool JsonLazyValue::is_bool() const noexcept
+{
+    return this->is_valid() && (this->_str[this->_pos] == 't' || this->_str[this->_pos] == 'f');
+}
+
+bool JsonLazyValue::is_u64() const noexcept
+{
+    JsonObject number;
+    return JsonLazy_::parse_number(*this, &number) && number.is_u64();
+}
+
+bool JsonLazyValue::is_i64() const noexcept
+{
+    JsonObject number;
+    return JsonLazy_::parse_number(*this, &number) && number.is_i64();
+}
+
+bool JsonLazyValue::is_f64() const noexcept
+{
+    JsonObject number;
+    return JsonLazy_::parse_number(*this, &number) && number.is_f64();
+}
+
+bool JsonLazyValue::is_str() const noexcept
+{
+    return this->is_valid() && this->_str[this->_pos] == '"';
+}
+
+bool JsonLazyValue::is_array() const noexcept
+{
+    return this->is_valid() && this->_str[this->_pos] == '[';
+}
+
+bool JsonLazyValue::is_dict() const noexcept
+{
+    return this->is_valid() && this->_str[this->_pos] == '{';
+}
+
+bool JsonLazyValue::get_bool() const noexcept
+{
+    return this->is_valid() && this->_pos + 4 <= this->_len &&
+           std::memcmp(this->_str + this->_pos, "true", 4) == 0;
+}
+
+std::uint64_t JsonLazyValue::get_u64() const noexcept
+{
+    JsonObject number;
+    return JsonLazy_::parse_number(*this, &number) ? number.get_u64() : 0;
+}
+
+std::int64_t JsonLazyValue::get_i64() const noexcept
+{
+    JsonObject number;
+    return JsonLazy_::parse_number(*this, &number) ? number.get_i64() : 0;
+}
+
+double JsonLazyValue::get_f64() const noexcept
+{
+    JsonObject number;
+    return JsonLazy_::parse_number(*this, &number) ? number.get_f64() : 0.0;
+}
+
+StringD JsonLazyValue::get_str() const noexcept
+{
+    if(!this->is_str())
+        return StringD();
+
+    bool has_escape = false;
+    const std::size_t end = JsonLazy_::skip_string(this->_str, this->_pos, this->_len, &has_escape);
+
+    if(end == JsonLazy_::INVALID_POS)
+        return StringD();
+
+    const char* raw = this->_str + this->_pos + 1;
+    const std::size_t raw_sz = end - this->_pos - 2;
+
+    if(!has_escape)
+        return StringD(raw, raw_sz);
+
+    StringD unescaped = StringD::make_zeroed(raw_sz);
+    const std::size_t unescaped_sz = json_unescape(raw, raw_sz, unescaped.data());
+
+    return StringD(unescaped.c_str(), unescaped_sz);
+}
+
+std::size_t JsonLazyValue::array_size() const noexcept
+{
+    std::size_t size = 0;
+
+    for(const JsonLazyValue element : this->array_items())
+    {
+        STDROMANO_UNUSED(element);
+        size++;
+    }
+
+    return size;
+}
+
+std::size_t JsonLazyValue::dict_size() const noexcept
+{
+    if(!this->is_dict())
+        return 0;
+
+    std::size_t size = 0;
+    std::size_t pos = JsonLazy_::first_element(this->_str, this->_pos, this->_len, '}');
+
+    while(pos != JsonLazy_::INVALID_POS)
+    {
+        /* Key, colon, value */
+        pos = JsonLazy_::skip_value<false>(this->_str, pos, this->_len);
+
+        if(pos == JsonLazy_::INVALID_POS)
+            break;
+
+        pos = json_skip_whitespace(this->_str, pos, this->_len);
+
+        if(pos >= this->_len || this->_str[pos] != ':')
+            break;
+
+        pos = json_skip_whitespace(this->_str, pos + 1, this->_len);
+        pos = JsonLazy_::skip_value<false>(this->_str, pos, this->_len);
+
+        if(pos == JsonLazy_::INVALID_POS)
+            break;
+
+        size++;
+        pos = JsonLazy_::next_element(this->_str, pos, this->_len);
+    }
+
+    return size;
+}
+
+JsonLazyValue JsonLazyValue::operator[](const char* key) const noexcept
+{
+    if(!this->is_dict())
+        return JsonLazyValue();
+
+    const std::size_t key_sz = std::strlen(key);
+    std::size_t pos = JsonLazy_::first_element(this->_str, this->_pos, this->_len, '}');
+
+    while(pos != JsonLazy_::INVALID_POS)
+    {
+        if(this->_str[pos] != '"')
+            break;
+
+        bool has_escape = false;
+        const std::size_t key_end = JsonLazy_::skip_string(this->_str, pos, this->_len, &has_escape);
+
+        if(key_end == JsonLazy_::INVALID_POS)
+            break;
+
+        const bool found = JsonLazy_::key_equals(this->_str + pos + 1,
+                                                 key_end - pos - 2,
+                                                 has_escape,
+                                                 key,
+                                                 key_sz);
+
+        pos = json_skip_whitespace(this->_str, key_end, this->_len);
+
+        if(pos >= this->_len || this->_str[pos] != ':')
+            break;
+
+        pos = json_skip_whitespace(this->_str, pos + 1, this->_len);
+
+        if(found)
+            return JsonLazyValue(this->_str, this->_len, pos);
+
+        pos = JsonLazy_::skip_value<false>(this->_str, pos, this->_len);
+
+        if(pos == JsonLazy_::INVALID_POS)
+            break;
+
+        pos = JsonLazy_::next_element(this->_str, pos, this->_len);
+    }
+
+    return JsonLazyValue();
+}
+
+JsonLazyValue JsonLazyValue::operator[](std::size_t index) const noexcept
+{
+    for(const JsonLazyValue element : this->array_items())
+    {
+        if(index-- == 0)
+            return element;
+    }
+
+    return JsonLazyValue();
+}
+
+JsonObject* JsonLazyValue::materialize(Json& json) const noexcept
+{
+    if(!this->is_valid())
+        return nullptr;
+
+    const std::size_t end = JsonLazy_::skip_value<false>(this->_str, this->_pos, this->_len);
+
+    if(end == JsonLazy_::INVALID_POS)
+        return nullptr;
+
+    return JsonParser_::parse(&json, this->_str + this->_pos, nullptr, end - this->_pos);
+}
+
+JsonLazyValue JsonLazyValue::ArrayIterator::operator*() const noexcept
+{
+    return JsonLazyValue(this->_str, this->_len, this->_pos);
+}
+
+JsonLazyValue::ArrayIterator& JsonLazyValue::ArrayIterator::operator++() noexcept
+{
+    std::size_t pos = JsonLazy_::skip_value<false>(this->_str, this->_pos, this->_len);
+
+    if(pos != JsonLazy_::INVALID_POS)
+        pos = JsonLazy_::next_element(this->_str, pos, this->_len);
+
+    this->_pos = pos;
+
+    return *this;
+}
+
+JsonLazyValue::ArrayIterator JsonLazyValue::ArrayRange::begin() const noexcept
+{
+    if(this->_pos == INVALID_POS || this->_str[this->_pos] != '[')
+        return this->end();
+
+    return ArrayIterator(this->_str,
+                         this->_len,
+                         JsonLazy_::first_element(this->_str, this->_pos, this->_len, ']'));
+}
+
+JsonLazyValue::ArrayIterator JsonLazyValue::ArrayRange::end() const noexcept
+{
+    return ArrayIterator(this->_str, this->_len, INVALID_POS);
+}
+
+/**********************/
+/* JsonLazy: loading  */
+/**********************/
+
+JsonLazy::JsonLazy() noexcept : _str(nullptr),
+                                _len(0),
+                                _root(JsonLazyValue::INVALID_POS),
+                                _source(nullptr)
+{
+}
+
+JsonLazy::~JsonLazy() noexcept
+{
+    delete this->_source;
+}
+
+bool JsonLazy::loads(const char* str, std::size_t len) noexcept
+{
+    this->_root = JsonLazyValue::INVALID_POS;
+
+    if(str == nullptr || len == 0)
+        return false;
+
+    const std::size_t root = json_skip_whitespace(str, 0, len);
+    const std::size_t end = JsonLazy_::skip_value<true>(str, root, len);
+
+    if(end == JsonLazy_::INVALID_POS || json_skip_whitespace(str, end, len) != len)
+        return false;
+
+    this->_str = str;
+    this->_len = len;
+    this->_root = root;
+
+    return true;
+}
+
+bool JsonLazy::loadf(const StringD& path) noexcept
+{
+    auto mapped = fs::map_file(path);
+
+    if(!mapped.has_value())
+        return false;
+
+    fs::MappedFile file = mapped.value();
+
+    if(!this->loads(file.data(), file.size()))
+        return false;
+
+    if(this->_source == nullptr)
+        this->_source = new fs::MappedFile();
+
+    *this->_source = std::move(file);
+
+    return true;
+}
+
+JsonLazyValue JsonLazy::root() const noexcept
+{
+    return JsonLazyValue(this->_str, this->_len, this->_root);
+}
+
+/**************/
+/* JsonPath   */
+/**************/
+
+/* Evaluation of the path segments on trees */
+struct JsonPathTree
+{
+    using Value = JsonObject*;
+
+    static bool valid(Value value) noexcept { return value != nullptr; }
+    static bool is_array(Value value) noexcept { return value->is_array(); }
+    static bool is_dict(Value value) noexcept { return value->is_dict(); }
+    static std::size_t array_size(Value value) noexcept { return value->array_size(); }
+    static Value array_at(Value value, std::size_t index) noexcept { return value->array_at(index); }
+
+    static Value dict_find(Value value, const char* key, std::size_t key_sz) noexcept
+    {
+        return value->dict_find(key, key_sz);
+    }
+
+    template <typename F>
+    static bool for_each_element(Value value, F&& f) noexcept
+    {
+        for(JsonObject* element : value->array_items())
+        {
+            if(!f(element))
+                return false;
+        }
+
+        return true;
+    }
+
+    template <typename F>
+    static bool for_each_value(Value value, F&& f) noexcept
+    {
+        for(const JsonKeyValue kv : value->dict_items())
+        {
+            if(!f(kv.value))
+                return false;
+        }
+
+        return true;
+    }
+
+    static bool equals(Value value, const JsonPathSegment& segment) noexcept;
+};
+
+/* Evaluation of the path segments on raw text, containers are scanned as the path goes */
+struct JsonPathLazy
+{
+    using Value = JsonLazyValue;
+
+    static bool valid(const Value& value) noexcept { return value.is_valid(); }
+    static bool is_array(const Value& value) noexcept { return value.is_array(); }
+    static bool is_dict(const Value& value) noexcept { return value.is_dict(); }
+    static std::size_t array_size(const Value& value) noexcept { return value.array_size(); }
+    static Value array_at(const Value& value, std::size_t index) noexcept { return value[index]; }
+
+    static Value dict_find(const Value& value, const char* key, std::size_t key_sz) noexcept;
+
+    template <typename F>
+    static bool for_each_element(const Value& value, F&& f) noexcept
+    {
+        for(const JsonLazyValue element : value.array_items())
+        {
+            if(!f(element))
+                return false;
+        }
+
+        return true;
+    }
+
+    template <typename F>
+    static bool for_each_value(const Value& value, F&& f) noexcept;
+
+    static bool equals(const Value& value, const JsonPathSegment& segment) noexcept;
+};
+
+struct JsonPath_
+{
+    /* Compilation */
+
+    static std::size_t skip_spaces(const char* str, std::size_t pos, std::size_t len) noexcept
+    {
+        while(pos < len && str[pos] == ' ')
+            pos++;
+
+        return pos;
+    }
+
+    static bool parse_int(const char* str, std::size_t& pos, std::size_t len, std::int64_t* out) noexcept
+    {
+        const bool negative = pos < len && str[pos] == '-';
+
+        if(negative)
+            pos++;
+
+        if(pos >= len || !is_digit(str[pos]))
+            return false;
+
+        std::int64_t value = 0;
+
+        while(pos < len && is_digit(str[pos]))
+        {
+            if(value > (std::numeric_limits<std::int64_t>::max() - (str[pos] - '0')) / 10)
+                return false;
+
+            value = value * 10 + (str[pos++] - '0');
+        }
+
+        *out = negative ? -value : value;
+
+        return true;
+    }
+
+    /* Quoted name, backslashes escape the following character */
+    static bool parse_quoted(const char* str, std::size_t& pos, std::size_t len, StringD* out) noexcept
+    {
+        const char quote = str[pos++];
+
+        while(pos < len && str[pos] != quote)
+        {
+            if(str[pos] == '\\' && ++pos >= len)
+                return false;
+
+            out->push_back(str[pos++]);
+        }
+
+        if(pos >= len)
+            return false;
+
+        pos++;
+
+        return true;
+    }
+
+    /* Array index of a JSON Pointer reference token, -1 if it is not one */
+    static std::int64_t pointer_index(const StringD& token) noexcept
+    {
+        if(token.empty() || token.size() > 18 || (token.size() > 1 && token[0] == '0'))
+            return -1;
+
+        std::int64_t index = 0;
+
+        for(std::size_t i = 0; i < token.size(); i++)
+        {
+            if(!is_digit(token[i]))
+                return -1;
+
+            index = index * 10 + (token[i] - '0');
+        }
+
+        return index;
+    }
+
+    static bool compile_pointer(JsonPath* path, const char* str, std::size_t len) noexcept
+    {
+        std::size_t pos = 0;
+
+        while(pos < len)
+        {
+            if(str[pos++] != '/')
+                return false;
+
+            JsonPathSegment segment;
+
+            while(pos < len && str[pos] != '/')
+            {
+                char c = str[pos++];
+
+                if(c == '~')
+                {
+                    if(pos >= len || (str[pos] != '0' && str[pos] != '1'))
+                        return false;
+
+                    c = str[pos++] == '0' ? '~' : '/';
+                }
+
+                segment.key.push_back(c);
+            }
+
+            segment.index = JsonPath_::pointer_index(segment.key);
+
+            path->_segments.push_back(std::move(segment));
+        }
+
+        return true;
+    }
+
+    /* [?(@.a.b == literal)], pos is after the question mark */
+    static bool compile_filter(JsonPathSegment* segment, const char* str, std::size_t& pos, std::size_t len) noexcept
+    {
+        segment->type = JsonPathSegmentType_Filter;
+
+        pos = JsonPath_::skip_spaces(str, pos, len);
+
+        if(pos >= len || str[pos++] != '(')
+            return false;
+
+        pos = JsonPath_::skip_spaces(str, pos, len);
+
+        if(pos >= len || str[pos++] != '@')
+            return false;
+
+        while(pos < len && (str[pos] == '.' || str[pos] == '['))
+        {
+            StringD key;
+
+            if(str[pos] == '.')
+            {
+                const std::size_t start = ++pos;
+
+                while(pos < len && (is_alnum(str[pos]) || str[pos] == '_' || str[pos] == '-'))
+                    pos++;
+
+                if(pos == start)
+                    return false;
+
+                key = StringD(str + start, pos - start);
+            }
+            else
+            {
+                pos = JsonPath_::skip_spaces(str, pos + 1, len);
+
+                if(pos >= len || (str[pos] != '\'' && str[pos] != '"'))
+                    return false;
+
+                if(!JsonPath_::parse_quoted(str, pos, len, &key))
+                    return false;
+
+                pos = JsonPath_::skip_spaces(str, pos, len);
+
+                if(pos >= len || str[pos++] != ']')
+                    return false;
+            }
+
+            segment->filter_keys.push_back(std::move(key));
+        }
+
+        pos = JsonPath_::skip_spaces(str, pos, len);
+
+        if(pos + 2 > len || (str[pos] != '=' && str[pos] != '!') || str[pos + 1] != '=')
+            return false;
+
+        segment->negate = str[pos] == '!';
+        pos = JsonPath_::skip_spaces(str, pos + 2, len);
+
+        if(pos >= len)
+            return false;
+
+        const char c = str[pos];
+
+        if(c == '\'' || c == '"')
+        {
+            segment->literal_type = JsonPathLiteral_Str;
+
+            if(!JsonPath_::parse_quoted(str, pos, len, &segment->key))
+                return false;
+        }
+        else if(len - pos >= 4 && std::memcmp(str + pos, "true", 4) == 0)
+        {
+            segment->literal_type = JsonPathLiteral_Bool;
+            segment->literal_bool = true;
+            pos += 4;
+        }
+        else if(len - pos >= 5 && std::memcmp(str + pos, "false", 5) == 0)
+        {
+            segment->literal_type = JsonPathLiteral_Bool;
+            segment->literal_bool = false;
+            pos += 5;
+        }
+        else if(len - pos >= 4 && std::memcmp(str + pos, "null", 4) == 0)
+        {
+            segment->literal_type = JsonPathLiteral_Null;
+            pos += 4;
+        }
+        else
+        {
+            segment->literal_type = JsonPathLiteral_Number;
+
+            if(!JsonParser_::parse_number(str, pos, len, &segment->literal_number))
+                return false;
+        }
+
+        pos = JsonPath_::skip_spaces(str, pos, len);
+
+        return pos < len && str[pos++] == ')';
+    }
+
+    /* Bracketed segment, pos is after the opening bracket */
+    static bool compile_bracket(JsonPathSegment* segment, const char* str, std::size_t& pos, std::size_t len) noexcept
+    {
+        pos = JsonPath_::skip_spaces(str, pos, len);
+
+        if(pos >= len)
+            return false;
+
+        const char c = str[pos];
+
+        if(c == '*')
+        {
+            segment->type = JsonPathSegmentType_Wildcard;
+            pos++;
+        }
+        else if(c == '\'' || c == '"')
+        {
+            segment->type = JsonPathSegmentType_Key;
+
+            if(!JsonPath_::parse_quoted(str, pos, len, &segment->key))
+                return false;
+        }
+        else if(c == '?')
+        {
+            if(!JsonPath_::compile_filter(segment, str, ++pos, len))
+                return false;
+        }
+        else
+        {
+            /* index, or slice when there is a colon */
+            std::int64_t bounds[3] = { 0, 0, 1 };
+            bool has_bound[3] = { false, false, false };
+            std::size_t num_colons = 0;
+
+            while(true)
+            {
+                pos = JsonPath_::skip_spaces(str, pos, len);
+
+                if(pos < len && (str[pos] == '-' || is_digit(str[pos])))
+                {
+                    if(!JsonPath_::parse_int(str, pos, len, &bounds[num_colons]))
+                        return false;
+
+                    has_bound[num_colons] = true;
+                    pos = JsonPath_::skip_spaces(str, pos, len);
+                }
+
+                if(pos >= len || str[pos] != ':' || num_colons == 2)
+                    break;
+
+                num_colons++;
+                pos++;
+            }
+
+            if(num_colons == 0)
+            {
+                if(!has_bound[0])
+                    return false;
+
+                segment->type = JsonPathSegmentType_Index;
+                segment->index = bounds[0];
+            }
+            else
+            {
+                if(bounds[2] == 0)
+                    return false;
+
+                segment->type = JsonPathSegmentType_Slice;
+                segment->start = bounds[0];
+                segment->end = bounds[1];
+                segment->step = bounds[2];
+                segment->has_start = has_bound[0];
+                segment->has_end = has_bound[1];
+            }
+        }
+
+        pos = JsonPath_::skip_spaces(str, pos, len);
+
+        return pos < len && str[pos++] == ']';
+    }
+
+    static bool compile_path(JsonPath* path, const char* str, std::size_t len) noexcept
+    {
+        std::size_t pos = 1;
+
+        while(pos < len)
+        {
+            JsonPathSegment segment;
+
+            if(str[pos] == '.')
+            {
+                pos++;
+
+                if(pos < len && str[pos] == '*')
+                {
+                    segment.type = JsonPathSegmentType_Wildcard;
+                    pos++;
+                }
+                else
+                {
+                    /* Recursive descent (..) is not supported */
+                    const std::size_t start = pos;
+
+                    while(pos < len && str[pos] != '.' && str[pos] != '[')
+                        pos++;
+
+                    if(pos == start)
+                        return false;
+
+                    segment.key = StringD(str + start, pos - start);
+                }
+            }
+            else if(str[pos] == '[')
+            {
+                if(!JsonPath_::compile_bracket(&segment, str, ++pos, len))
+                    return false;
+            }
+            else
+            {
+                return false;
+            }
+
+            path->_segments.push_back(std::move(segment));
+        }
+
+        return true;
+    }
+
+    /* Evaluation */
+
+    static bool number_equals(const JsonObject& lhs, const JsonObject& rhs) noexcept
+    {
+        if(lhs.is_f64() || rhs.is_f64())
+        {
+            const double l = lhs.is_f64() ? lhs.get_f64() : lhs.is_i64() ? static_cast<double>(lhs.get_i64()) : static_cast<double>(lhs.get_u64());
+            const double r = rhs.is_f64() ? rhs.get_f64() : rhs.is_i64() ? static_cast<double>(rhs.get_i64()) : static_cast<double>(rhs.get_u64());
+
+            return l == r;
+        }
+
+        if(lhs.is_u64() && rhs.is_u64())
+            return lhs.get_u64() == rhs.get_u64();
+
+        if(lhs.is_i64() && rhs.is_i64())
+            return lhs.get_i64() == rhs.get_i64();
+
+        /* Mixed signedness, only non-negative i64 values can be equal */
+        if(lhs.is_i64() && rhs.is_u64())
+            return lhs.get_i64() >= 0 && static_cast<std::uint64_t>(lhs.get_i64()) == rhs.get_u64();
+
+        if(lhs.is_u64() && rhs.is_i64())
+            return rhs.get_i64() >= 0 && static_cast<std::uint64_t>(rhs.get_i64()) == lhs.get_u64();
+
+        return false;
+    }
+
+    template <typename Adapter>
+    static bool filter_matches(const JsonPathSegment& segment, typename Adapter::Value value) noexcept
+    {
+        /* A missing value is never equal to the literal */
+        for(const StringD& key : segment.filter_keys)
+        {
+            if(!Adapter::is_dict(value))
+                return segment.negate;
+
+            value = Adapter::dict_find(value, key.c_str(), key.size());
+
+            if(!Adapter::valid(value))
+                return segment.negate;
+        }
+
+        return Adapter::equals(value, segment) != segment.negate;
+    }
+
+    /* Calls callback on the matches of the segments starting at index, returns false when stopped */
+    template <typename Adapter, typename Callback>
+    static bool walk(const JsonPath* path,
+                     std::size_t index,
+                     typename Adapter::Value value,
+                     Callback& callback) noexcept
+    {
+        using Value = typename Adapter::Value;
+
+        if(index == path->_segments.size())
+            return callback(value);
+
+        const JsonPathSegment& segment = path->_segments[index];
+
+        const auto next = [&](Value child) noexcept -> bool {
+            return JsonPath_::walk<Adapter>(path, index + 1, child, callback);
+        };
+
+        switch(segment.type)
+        {
+            case JsonPathSegmentType_Key:
+            {
+                Value child{};
+
+                if(Adapter::is_dict(value))
+                    child = Adapter::dict_find(value, segment.key.c_str(), segment.key.size());
+                else if(segment.index >= 0 && Adapter::is_array(value))
+                    child = Adapter::array_at(value, static_cast<std::size_t>(segment.index));
+
+                return !Adapter::valid(child) || next(child);
+            }
+            case JsonPathSegmentType_Index:
+            {
+                if(!Adapter::is_array(value))
+                    return true;
+
+                std::int64_t i = segment.index;
+
+                if(i < 0)
+                    i += static_cast<std::int64_t>(Adapter::array_size(value));
+
+                if(i < 0)
+                    return true;
+
+                const Value child = Adapter::array_at(value, static_cast<std::size_t>(i));
+
+                return !Adapter::valid(child) || next(child);
+            }
+            case JsonPathSegmentType_Wildcard:
+            {
+                if(Adapter::is_array(value))
+                    return Adapter::for_each_element(value, next);
+
+                if(Adapter::is_dict(value))
+                    return Adapter::for_each_value(value, next);
+
+                return true;
+            }
+            case JsonPathSegmentType_Slice:
+            {
+                if(!Adapter::is_array(value))
+                    return true;
+
+                return JsonPath_::walk_slice<Adapter>(segment, value, next);
+            }
+            case JsonPathSegmentType_Filter:
+            {
+                const auto filtered = [&](Value child) noexcept -> bool {
+                    return !JsonPath_::filter_matches<Adapter>(segment, child) || next(child);
+                };
+
+                if(Adapter::is_array(value))
+                    return Adapter::for_each_element(value, filtered);
+
+                if(Adapter::is_dict(value))
+                    return Adapter::for_each_value(value, filtered);
+
+                return true;
+            }
+        }
+
+        return true;
+    }
+
+    /* Slices follow the Python semantics, the array size is only computed when needed */
+    template <typename Adapter, typename Next>
+    static bool walk_slice(const JsonPathSegment& segment, typename Adapter::Value value, const Next& next) noexcept
+    {
+        using Value = typename Adapter::Value;
+
+        const std::int64_t step = segment.step;
+        const bool needs_size = step < 0 ||
+                                (segment.has_start && segment.start < 0) ||
+                                (segment.has_end && segment.end < 0);
+
+        const std::int64_t size = needs_size ? static_cast<std::int64_t>(Adapter::array_size(value)) : 0;
+
+        const auto normalize = [size](std::int64_t bound, std::int64_t lower, std::int64_t upper) noexcept {
+            if(bound < 0)
+                bound += size;
+
+            return bound < lower ? lower : (upper >= 0 && bound > upper ? upper : bound);
+        };
+
+        if(step > 0)
+        {
+            const std::int64_t start = segment.has_start ? normalize(segment.start, 0, needs_size ? size : -1) : 0;
+            const std::int64_t end = segment.has_end ? normalize(segment.end, 0, needs_size ? size : -1)
+                                                     : std::numeric_limits<std::int64_t>::max();
+
+            std::int64_t i = 0;
+            bool stopped = false;
+
+            Adapter::for_each_element(value, [&](Value element) noexcept -> bool {
+                if(i >= end)
+                    return false;
+
+                if(i >= start && (i - start) % step == 0 && !next(element))
+                {
+                    stopped = true;
+                    return false;
+                }
+
+                i++;
+
+                return true;
+            });
+
+            return !stopped;
+        }
+
+        /* Negative steps walk backwards, the elements are gathered first */
+        Vector<Value> elements;
+
+        Adapter::for_each_element(value, [&elements](Value element) noexcept -> bool {
+            elements.push_back(element);
+            return true;
+        });
+
+        const std::int64_t start = segment.has_start ? normalize(segment.start, -1, size - 1) : size - 1;
+        const std::int64_t end = segment.has_end ? normalize(segment.end, -1, size - 1) : -1;
+
+        for(std::int64_t i = start; i > end; i += step)
+        {
+            if(!next(elements[static_cast<std::size_t>(i)]))
+                return false;
+        }
+
+        return true;
+    }
+
+    /* Iterates over the entries of a raw dict, f(raw_key, raw_key_sz, has_escape, value) */
+    template <typename F>
+    static bool lazy_for_each_entry(const JsonLazyValue& dict, F&& f) noexcept
+    {
+        const char* str = dict._str;
+        const std::size_t len = dict._len;
+
+        std::size_t pos = JsonLazy_::first_element(str, dict._pos, len, '}');
+
+        while(pos != JsonLazy_::INVALID_POS)
+        {
+            if(str[pos] != '"')
+                break;
+
+            bool has_escape = false;
+            const std::size_t key_end = JsonLazy_::skip_string(str, pos, len, &has_escape);
+
+            if(key_end == JsonLazy_::INVALID_POS)
+                break;
+
+            std::size_t value_pos = json_skip_whitespace(str, key_end, len);
+
+            if(value_pos >= len || str[value_pos] != ':')
+                break;
+
+            value_pos = json_skip_whitespace(str, value_pos + 1, len);
+
+            if(!f(str + pos + 1, key_end - pos - 2, has_escape, JsonLazyValue(str, len, value_pos)))
+                return false;
+
+            pos = JsonLazy_::skip_value<false>(str, value_pos, len);
+
+            if(pos == JsonLazy_::INVALID_POS)
+                break;
+
+            pos = JsonLazy_::next_element(str, pos, len);
+        }
+
+        return true;
+    }
+
+    static bool lazy_equals(const JsonLazyValue& value, const JsonPathSegment& segment) noexcept
+    {
+        if(!value.is_valid())
+            return false;
+
+        switch(segment.literal_type)
+        {
+            case JsonPathLiteral_Null:
+                return value.is_null();
+            case JsonPathLiteral_Bool:
+                return value.is_bool() && value.get_bool() == segment.literal_bool;
+            case JsonPathLiteral_Number:
+            {
+                JsonObject number;
+                return JsonLazy_::parse_number(value, &number) &&
+                       JsonPath_::number_equals(number, segment.literal_number);
+            }
+            case JsonPathLiteral_Str:
+            {
+                if(value._str[value._pos] != '"')
+                    return false;
+
+                bool has_escape = false;
+                const std::size_t end = JsonLazy_::skip_string(value._str, value._pos, value._len, &has_escape);
+
+                return end != JsonLazy_::INVALID_POS &&
+                       JsonLazy_::key_equals(value._str + value._pos + 1,
+                                             end - value._pos - 2,
+                                             has_escape,
+                                             segment.key.c_str(),
+                                             segment.key.size());
+            }
+        }
+
+        return false;
+    }
+};
+
+bool JsonPathTree::equals(Value value, const JsonPathSegment& segment) noexcept
+{
+    switch(segment.literal_type)
+    {
+        case JsonPathLiteral_Null:
+            return value->is_null();
+        case JsonPathLiteral_Bool:
+            return value->is_bool() && value->get_bool() == segment.literal_bool;
+        case JsonPathLiteral_Number:
+            return (value->is_u64() || value->is_i64() || value->is_f64()) &&
+                   JsonPath_::number_equals(*value, segment.literal_number);
+        case JsonPathLiteral_Str:
+            return value->is_str() &&
+                   value->get_str_size() == segment.key.size() &&
+                   std::memcmp(value->get_str(), segment.key.c_str(), segment.key.size()) == 0;
+    }
+
+    return false;
+}
+
+JsonLazyValue JsonPathLazy::dict_find(const Value& value, const char* key, std::size_t key_sz) noexcept
+{
+    JsonLazyValue found;
+
+    JsonPath_::lazy_for_each_entry(value, [&](const char* raw, std::size_t raw_sz, bool has_escape, JsonLazyValue entry) noexcept {
+        if(!JsonLazy_::key_equals(raw, raw_sz, has_escape, key, key_sz))
+            return true;
+
+        found = entry;
+
+        return false;
+    });
+
+    return found;
+}
+
+template <typename F>
+bool JsonPathLazy::for_each_value(const Value& value, F&& f) noexcept
+{
+    return JsonPath_::lazy_for_each_entry(value, [&f](const char*, std::size_t, bool, JsonLazyValue entry) noexcept {
+        return f(entry);
+    });
+}
+
+bool JsonPathLazy::equals(const Value& value, const JsonPathSegment& segment) noexcept
+{
+    return JsonPath_::lazy_equals(value, segment);
+}
+
+bool JsonPath::compile(const StringD& path) noexcept
+{
+    this->_segments.clear();
+
+    if(path.empty() || path[0] == '/')
+        return JsonPath_::compile_pointer(this, path.c_str(), path.size());
+
+    if(path[0] == '$')
+        return JsonPath_::compile_path(this, path.c_str(), path.size());
+
+    return false;
+}
+
+bool JsonPath::is_single() const noexcept
+{
+    for(const JsonPathSegment& segment : this->_segments)
+    {
+        if(segment.type != JsonPathSegmentType_Key && segment.type != JsonPathSegmentType_Index)
+            return false;
+    }
+
+    return true;
+}
+
+JsonObject* JsonPath::find(JsonObject* root) const noexcept
+{
+    JsonObject* found = nullptr;
+
+    if(!this->_valid || root == nullptr)
+        return found;
+
+    auto callback = [&found](JsonObject* value) noexcept {
+        found = value;
+        return false;
+    };
+
+    JsonPath_::walk<JsonPathTree>(this, 0, root, callback);
+
+    return found;
+}
+
+JsonLazyValue JsonPath::find(const JsonLazyValue& root) const noexcept
+{
+    JsonLazyValue found;
+
+    if(!this->_valid || !root.is_valid())
+        return found;
+
+    auto callback = [&found](const JsonLazyValue& value) noexcept {
+        found = value;
+        return false;
+    };
+
+    JsonPath_::walk<JsonPathLazy>(this, 0, root, callback);
+
+    return found;
+}
+
+std::size_t JsonPath::find_all(JsonObject* root, Vector<JsonObject*>& out) const noexcept
+{
+    const std::size_t size = out.size();
+
+    if(!this->_valid || root == nullptr)
+        return 0;
+
+    auto callback = [&out](JsonObject* value) noexcept {
+        out.push_back(value);
+        return true;
+    };
+
+    JsonPath_::walk<JsonPathTree>(this, 0, root, callback);
+
+    return out.size() - size;
+}
+
+std::size_t JsonPath::find_all(const JsonLazyValue& root, Vector<JsonLazyValue>& out) const noexcept
+{
+    const std::size_t size = out.size();
+
+    if(!this->_valid || !root.is_valid())
+        return 0;
+
+    auto callback = [&out](const JsonLazyValue& value) noexcept {
+        out.push_back(value);
+        return true;
+    };
+
+    JsonPath_::walk<JsonPathLazy>(this, 0, root, callback);
+
+    return out.size() - size;
+}
+
+/**************************/
+/* JsonStreamParser       */
+/**************************/
+
+enum JsonStreamState : std::uint32_t
+{
+    JsonStreamState_Value = 0,  /* Expecting a value */
+    JsonStreamState_ArrayFirst, /* After '[', a value or ']' */
+    JsonStreamState_ArrayNext,  /* After an array element, ',' or ']' */
+    JsonStreamState_DictFirst,  /* After '{', a key or '}' */
+    JsonStreamState_DictKey,    /* After ',' in a dict, a key */
+    JsonStreamState_DictColon,  /* After a key, ':' */
+    JsonStreamState_DictNext,   /* After a dict value, ',' or '}' */
+    JsonStreamState_String,     /* Inside a string or a key */
+    JsonStreamState_Scalar,     /* Inside a number or a literal */
+    JsonStreamState_Error,
+};
+
+STDROMANO_FORCE_INLINE bool json_is_scalar_char(char c) noexcept
+{
+    return is_digit(c) || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+struct JsonStreamParser_
+{
+    static void append_token(JsonStreamParser* parser, const char* data, std::size_t size) noexcept
+    {
+        parser->_token.insert(parser->_token.end(), data, data + size);
+    }
+
+    static bool value_done(JsonStreamParser* parser) noexcept
+    {
+        if(parser->_containers.empty())
+            parser->_state = JsonStreamState_Value;
+        else if(parser->_containers.back() == 1)
+            parser->_state = JsonStreamState_DictNext;
+        else
+            parser->_state = JsonStreamState_ArrayNext;
+
+        return true;
+    }
+
+    static bool container_end(JsonStreamParser* parser, char c) noexcept
+    {
+        const std::uint8_t is_dict = parser->_containers.pop_back();
+
+        if((c == '}') != (is_dict == 1))
+            return false;
+
+        if(!(is_dict ? parser->_handler->dict_end() : parser->_handler->array_end()))
+            return false;
+
+        return JsonStreamParser_::value_done(parser);
+    }
+
+    /* c is the first character of a value, the scalars are not consumed */
+    static bool value_start(JsonStreamParser* parser, char c, std::size_t& pos) noexcept
+    {
+        switch(c)
+        {
+            case '"':
+                parser->_state = JsonStreamState_String;
+                parser->_is_key = false;
+                parser->_has_escape = false;
+                parser->_token_split = false;
+                pos++;
+                return true;
+            case '{':
+                parser->_containers.push_back(1);
+                parser->_state = JsonStreamState_DictFirst;
+                pos++;
+                return parser->_handler->dict_start();
+            case '[':
+                parser->_containers.push_back(0);
+                parser->_state = JsonStreamState_ArrayFirst;
+                pos++;
+                return parser->_handler->array_start();
+            default:
+                if(c != '-' && c != 't' && c != 'f' && c != 'n' && !is_digit(c))
+                    return false;
+
+                parser->_state = JsonStreamState_Scalar;
+                parser->_token_split = false;
+                return true;
+        }
+    }
+
+    static bool emit_scalar(JsonStreamParser* parser, const char* token, std::size_t token_sz) noexcept
+    {
+        switch(token[0])
+        {
+            case 't':
+                return token_sz == 4 && std::memcmp(token, "true", 4) == 0 && parser->_handler->value_bool(true);
+            case 'f':
+                return token_sz == 5 && std::memcmp(token, "false", 5) == 0 && parser->_handler->value_bool(false);
+            case 'n':
+                return token_sz == 4 && std::memcmp(token, "null", 4) == 0 && parser->_handler->value_null();
+            default:
+                break;
+        }
+
+        JsonObject number;
+        std::size_t pos = 0;
+
+        if(!JsonParser_::parse_number(token, pos, token_sz, &number) || pos != token_sz)
+            return false;
+
+        if(number.is_u64())
+            return parser->_handler->value_u64(number.get_u64());
+        else if(number.is_i64())
+            return parser->_handler->value_i64(number.get_i64());
+
+        return parser->_handler->value_f64(number.get_f64());
+    }
+
+    static bool emit_string(JsonStreamParser* parser, const char* raw, std::size_t raw_sz) noexcept
+    {
+        const char* str = raw;
+        std::size_t str_sz = raw_sz;
+
+        if(parser->_has_escape)
+        {
+            parser->_unescaped.resize(raw_sz + 1);
+            str = parser->_unescaped.data();
+            str_sz = json_unescape(raw, raw_sz, parser->_unescaped.data());
+        }
+
+        if(parser->_is_key)
+        {
+            parser->_state = JsonStreamState_DictColon;
+            return parser->_handler->key(str, str_sz);
+        }
+
+        return parser->_handler->value_str(str, str_sz) && JsonStreamParser_::value_done(parser);
+    }
+
+    /* Consumes string bytes until the closing quote or the end of the chunk */
+    static bool feed_string(JsonStreamParser* parser, const char* chunk, std::size_t& pos, std::size_t len) noexcept
+    {
+        const std::size_t start = pos;
+
+        if(parser->_escape_pending)
+        {
+            parser->_escape_pending = false;
+            pos++;
+        }
+
+        while(true)
+        {
+            pos = json_scan<true>(chunk, pos, len);
+
+            if(pos >= len)
+            {
+                JsonStreamParser_::append_token(parser, chunk + start, len - start);
+                parser->_token_split = true;
+                return true;
+            }
+
+            if(chunk[pos] == '\\')
+            {
+                parser->_has_escape = true;
+
+                if(pos + 1 >= len)
+                {
+                    JsonStreamParser_::append_token(parser, chunk + start, len - start);
+                    parser->_token_split = true;
+                    parser->_escape_pending = true;
+                    pos = len;
+                    return true;
+                }
+
+                pos += 2;
+                continue;
+            }
+
+            break;
+        }
+
+        const std::size_t end = pos++;
+
+        if(!parser->_token_split)
+            return JsonStreamParser_::emit_string(parser, chunk + start, end - start);
+
+        JsonStreamParser_::append_token(parser, chunk + start, end - start);
+
+        const bool res = JsonStreamParser_::emit_string(parser, parser->_token.data(), parser->_token.size());
+        parser->_token.clear();
+
+        return res;
+    }
+
+    /* Consumes number/literal bytes until a delimiter or the end of the chunk */
+    static bool feed_scalar(JsonStreamParser* parser, const char* chunk, std::size_t& pos, std::size_t len) noexcept
+    {
+        const std::size_t start = pos;
+
+        while(pos < len && json_is_scalar_char(chunk[pos]))
+            pos++;
+
+        if(pos >= len)
+        {
+            JsonStreamParser_::append_token(parser, chunk + start, len - start);
+            parser->_token_split = true;
+            return true;
+        }
+
+        bool res;
+
+        if(!parser->_token_split)
+        {
+            res = JsonStreamParser_::emit_scalar(parser, chunk + start, pos - start);
+        }
+        else
+        {
+            JsonStreamParser_::append_token(parser, chunk + start, pos - start);
+            res = JsonStreamParser_::emit_scalar(parser, parser->_token.data(), parser->_token.size());
+            parser->_token.clear();
+        }
+
+        return res && JsonStreamParser_::value_done(parser);
+    }
+
+    static bool feed_structural(JsonStreamParser* parser, char c, std::size_t& pos) noexcept
+    {
+        switch(parser->_state)
+        {
+            case JsonStreamState_ArrayFirst:
+                if(c == ']')
+                {
+                    pos++;
+                    return JsonStreamParser_::container_end(parser, c);
+                }
+
+                return JsonStreamParser_::value_start(parser, c, pos);
+            case JsonStreamState_Value:
+                return JsonStreamParser_::value_start(parser, c, pos);
+            case JsonStreamState_DictFirst:
+                if(c == '}')
+                {
+                    pos++;
+                    return JsonStreamParser_::container_end(parser, c);
+                }
+
+                /* Fallthrough */
+            case JsonStreamState_DictKey:
+                if(c != '"')
+                    return false;
+
+                parser->_state = JsonStreamState_String;
+                parser->_is_key = true;
+                parser->_has_escape = false;
+                parser->_token_split = false;
+                pos++;
+                return true;
+            case JsonStreamState_DictColon:
+                if(c != ':')
+                    return false;
+
+                parser->_state = JsonStreamState_Value;
+                pos++;
+                return true;
+            case JsonStreamState_ArrayNext:
+            case JsonStreamState_DictNext:
+                pos++;
+
+                if(c == ',')
+                {
+                    parser->_state = parser->_state == JsonStreamState_ArrayNext ? JsonStreamState_Value :
+                                                                                   JsonStreamState_DictKey;
+                    return true;
+                }
+
+                if(c == ']' || c == '}')
+                    return JsonStreamParser_::container_end(parser, c);
+
+                return false;
+            default:
+                return false;
+        }
+    }
+};
+
+JsonStreamParser::JsonStreamParser(JsonStreamHandler* handler) noexcept : _handler(handler)
+{
+    this->reset();
+}
+
+void JsonStreamParser::reset() noexcept
+{
+    this->_containers.clear();
+    this->_token.clear();
+    this->_offset = 0;
+    this->_state = JsonStreamState_Value;
+    this->_token_split = false;
+    this->_is_key = false;
+    this->_has_escape = false;
+    this->_escape_pending = false;
+}
+
+bool JsonStreamParser::feed(const char* chunk, std::size_t len) noexcept
+{
+    if(this->_state == JsonStreamState_Error)
+        return false;
+
+    std::size_t pos = 0;
+    std::size_t token_pos = 0;
+    bool res = true;
+
+    while(res && pos < len)
+    {
+        token_pos = pos;
+
+        switch(this->_state)
+        {
+            case JsonStreamState_String:
+                res = JsonStreamParser_::feed_string(this, chunk, pos, len);
+                break;
+            case JsonStreamState_Scalar:
+                res = JsonStreamParser_::feed_scalar(this, chunk, pos, len);
+                break;
+            default:
+                pos = json_skip_whitespace(chunk, pos, len);
+                token_pos = pos;
+
+                if(pos < len)
+                    res = JsonStreamParser_::feed_structural(this, chunk[pos], pos);
+
+                break;
+        }
+    }
+
+    if(!res)
+    {
+        this->_state = JsonStreamState_Error;
+        this->_offset += token_pos;
+        return false;
+    }
+
+    this->_offset += len;
+
+    return true;
+}
+
+bool JsonStreamParser::finish() noexcept
+{
+    if(this->_state == JsonStreamState_Scalar)
+    {
+        const bool res = JsonStreamParser_::emit_scalar(this, this->_token.data(), this->_token.size());
+        this->_token.clear();
+
+        if(!res)
+        {
+            this->_state = JsonStreamState_Error;
+            return false;
+        }
+
+        JsonStreamParser_::value_done(this);
+    }
+
+    return this->_state == JsonStreamState_Value && this->_containers.empty();
+}
+
+/**********************/
+/* JsonLinesReader    */
+/**********************/
+
+struct JsonLinesRecord
+{
+    JsonObject* value;
+    std::size_t offset;
+};
+
+struct JsonLinesChunk
+{
+    std::size_t begin;
+    std::size_t end;
+
+    /* Reused across the chunks mapped to this slot */
+    Json json;
+    Vector<JsonLinesRecord> records;
+
+    std::size_t num_invalid;
+    bool failed;
+
+    /* Offset of the line that failed */
+    std::size_t error_offset;
+
+    /* Protected by the mutex of the read */
+    bool done;
+};
+
+/* Signaled by the workers when a chunk is parsed, the calling thread sleeps until the chunk it
+   waits for is */
+struct JsonLinesDone
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+struct JsonLinesReader_
+{
+    static void parse_chunk(const JsonLinesReader* reader,
+                            const char* str,
+                            JsonLinesChunk* chunk,
+                            JsonLinesDone* done,
+                            const JsonLinesReader::Callback& callback) noexcept
+    {
+        std::size_t pos = chunk->begin;
+
+        while(pos < chunk->end)
+        {
+            const char* eol = static_cast<const char*>(std::memchr(str + pos, '\n', chunk->end - pos));
+            const std::size_t line_end = eol != nullptr ? static_cast<std::size_t>(eol - str) : chunk->end;
+
+            if(json_skip_whitespace(str, pos, line_end) < line_end)
+            {
+                JsonObject* record = JsonParser_::parse(&chunk->json, str + pos, nullptr, line_end - pos);
+
+                if(record != nullptr)
+                {
+                    chunk->records.push_back(JsonLinesRecord{ record, pos });
+                }
+                else if(reader->_flags & JsonLinesFlags_SkipInvalid)
+                {
+                    chunk->num_invalid++;
+                }
+                else
+                {
+                    chunk->failed = true;
+                    chunk->error_offset = pos;
+                    break;
+                }
+            }
+
+            pos = line_end + 1;
+        }
+
+        /* The records before an invalid line are delivered too */
+        if(!(reader->_flags & JsonLinesFlags_Ordered))
+            for(const JsonLinesRecord& record : chunk->records)
+                callback(record.value, record.offset);
+
+        std::lock_guard<std::mutex> lock(done->mutex);
+        chunk->done = true;
+        done->cv.notify_one();
+    }
+
+    static void wait(JsonLinesDone* done, const JsonLinesChunk* chunk) noexcept
+    {
+        std::unique_lock<std::mutex> lock(done->mutex);
+        done->cv.wait(lock, [chunk]() { return chunk->done; });
+    }
+};
+
+JsonLinesReader::JsonLinesReader(std::uint32_t flags, std::size_t chunk_size) noexcept : _chunk_size(std::max(chunk_size, static_cast<std::size_t>(1))),
+                                                                                        _flags(flags),
+                                                                                        _num_records(0),
+                                                                                        _num_invalid(0),
+                                                                                        _error_offset(0),
+                                                                                        _slots(nullptr),
+                                                                                        _num_slots(0)
+{
+}
+
+JsonLinesReader::~JsonLinesReader() noexcept
+{
+    delete[] this->_slots;
+}
+
+bool JsonLinesReader::read(const char* str, std::size_t len, const Callback& callback) noexcept
+{
+    this->_num_records = 0;
+    this->_num_invalid = 0;
+    this->_error_offset = 0;
+
+    /* Chunk boundaries are moved to the end of the line they fall in */
+    Vector<std::size_t> boundaries;
+    boundaries.push_back(0);
+
+    while(boundaries.back() < len)
+    {
+        const std::size_t begin = boundaries.back();
+        std::size_t end = std::min(begin + this->_chunk_size, len);
+
+        if(end < len)
+        {
+            const char* eol = static_cast<const char*>(std::memchr(str + end, '\n', len - end));
+            end = eol != nullptr ? static_cast<std::size_t>(eol - str) + 1 : len;
+        }
+
+        boundaries.push_back(end);
+    }
+
+    const std::size_t num_chunks = boundaries.size() - 1;
+
+    /* Chunk i is parsed in slot i % num_slots, bounding the memory used by in-flight chunks. The
+       slots, and the arenas of their documents, are kept for the next reads */
+    const std::size_t max_slots = global_threadpool().num_workers() * 2;
+
+    if(this->_num_slots < max_slots)
+    {
+        delete[] this->_slots;
+        this->_slots = new JsonLinesChunk[max_slots];
+        this->_num_slots = max_slots;
+    }
+
+    const std::size_t num_slots = std::min(num_chunks, max_slots);
+
+    JsonLinesChunk* slots = this->_slots;
+
+    ThreadPoolWaiter waiter;
+    JsonLinesDone done;
+
+    std::size_t next_submit = 0;
+    std::size_t next_deliver = 0;
+    bool failed = false;
+
+    for(; next_deliver < num_chunks; next_deliver++)
+    {
+        for(; next_submit < num_chunks && next_submit - next_deliver < num_slots; next_submit++)
+        {
+            JsonLinesChunk* chunk = &slots[next_submit % num_slots];
+            chunk->begin = boundaries[next_submit];
+            chunk->end = boundaries[next_submit + 1];
+            chunk->records.clear();
+            chunk->json.reset();
+            chunk->num_invalid = 0;
+            chunk->failed = false;
+            chunk->error_offset = 0;
+            chunk->done = false;
+
+            global_threadpool().add_work([this, str, chunk, &done, &callback]() {
+                JsonLinesReader_::parse_chunk(this, str, chunk, &done, callback);
+            }, &waiter);
+        }
+
+        const JsonLinesChunk* chunk = &slots[next_deliver % num_slots];
+
+        JsonLinesReader_::wait(&done, chunk);
+
+        if(this->_flags & JsonLinesFlags_Ordered)
+            for(const JsonLinesRecord& record : chunk->records)
+                callback(record.value, record.offset);
+
+        this->_num_records += chunk->records.size();
+        this->_num_invalid += chunk->num_invalid;
+
+        if(chunk->failed)
+        {
+            this->_error_offset = chunk->error_offset;
+            failed = true;
+            break;
+        }
+    }
+
+    /* Chunks still in flight after a failure */
+    for(std::size_t i = next_deliver + (failed ? 1 : 0); i < next_submit; i++)
+        JsonLinesReader_::wait(&done, &slots[i % num_slots]);
+
+    waiter.wait();
+
+    return !failed;
+}
+
+bool JsonLinesReader::readf(const StringD& path, const Callback& callback) noexcept
+{
+    auto mapped = fs::map_file(path, fs::MapFileFlags_Sequential);
+
+    if(!mapped.has_value())
+        return false;
+
+    fs::MappedFile file = mapped.value();
+
+    return this->read(file.data(), file.size(), callback);
+}
+
+/*****************/
+/* Binary json   */
+/*****************/
+
+/*
+ * Layout (little-endian, every value starts on a 4 bytes boundary):
+ *   Header  : "SRJB" | u32 version
+ *   Values  : u32 type (JsonTag) | u32 size, followed by
+ *               null/bool   : nothing, the bool is stored in size
+ *               u64/i64/f64 : 8 bytes
+ *               str         : size bytes and a null terminator, padded to 4 bytes
+ *               array       : u32 offsets[size]
+ *               dict        : { u32 key offset, u32 value offset }[size] in insertion order,
+ *                             followed by u32 sorted[size], the entries sorted by key
+ *   Trailer : u32 root offset
+ * Children are written before their parent (so a child offset is always lower than its
+ * parent's), and keys are str values written once and shared by all the dicts using them
+ */
+
+static constexpr char JSON_BINARY_MAGIC[4] = { 'S', 'R', 'J', 'B' };
+static constexpr std::uint32_t JSON_BINARY_VERSION = 1;
+static constexpr std::uint32_t JSON_BINARY_HEADER_SIZE = 8;
+static constexpr std::uint32_t JSON_BINARY_VALUE_HEADER_SIZE = 8;
+
+/* Loading recurses once per nesting level, deeper documents are rejected */
+static constexpr std::uint32_t JSON_BINARY_MAX_DEPTH = 1024;
+
+struct JsonBinaryKeyHash
+{
+    std::size_t operator()(const StringD& key) const noexcept
+    {
+        return static_cast<std::size_t>(hash_fnv1a(key.data(), key.size()));
+    }
+};
+
+struct JsonBinaryWriter
+{
+    JsonWriter* sink;
+    std::uint64_t offset;
+    HashMap<StringD, std::uint32_t, JsonBinaryKeyHash> keys;
+};
+
+STDROMANO_FORCE_INLINE int json_binary_compare_keys(const char* lhs,
+                                                    std::size_t lhs_sz,
+                                                    const char* rhs,
+                                                    std::size_t rhs_sz) noexcept
+{
+    const int res = std::memcmp(lhs, rhs, std::min(lhs_sz, rhs_sz));
+
+    if(res != 0)
+        return res;
+
+    return lhs_sz < rhs_sz ? -1 : (lhs_sz > rhs_sz ? 1 : 0);
+}
+
+struct JsonBinary_
+{
+    /* Reading */
+
+    STDROMANO_FORCE_INLINE static std::uint32_t read_u32(const char* data, std::size_t offset) noexcept
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data + offset, sizeof(std::uint32_t));
+        return le32toh(value);
+    }
+
+    STDROMANO_FORCE_INLINE static std::uint64_t read_u64(const char* data, std::size_t offset) noexcept
+    {
+        std::uint64_t value;
+        std::memcpy(&value, data + offset, sizeof(std::uint64_t));
+        return le64toh(value);
+    }
+
+    /* Returns an invalid value if the value header or its payload is out of bounds, or if a str is
+       not null-terminated */
+    static JsonBinaryValue value_at(const char* data, std::size_t size, std::uint32_t offset) noexcept
+    {
+        if(offset < JSON_BINARY_HEADER_SIZE || offset % 4 != 0 ||
+           static_cast<std::size_t>(offset) + JSON_BINARY_VALUE_HEADER_SIZE > size)
+            return JsonBinaryValue();
+
+        const std::uint32_t type = JsonBinary_::read_u32(data, offset);
+        const std::uint64_t count = JsonBinary_::read_u32(data, offset + 4);
+        std::uint64_t payload = 0;
+
+        switch(type)
+        {
+            case JsonTag_Null:
+            case JsonTag_Bool:
+                break;
+            case JsonTag_U64:
+            case JsonTag_I64:
+            case JsonTag_F64:
+                payload = 8;
+                break;
+            case JsonTag_Str:
+                payload = count + 1;
+                break;
+            case JsonTag_Array:
+                payload = count * 4;
+                break;
+            case JsonTag_Dict:
+                payload = count * 12;
+                break;
+            default:
+                return JsonBinaryValue();
+        }
+
+        if(offset + JSON_BINARY_VALUE_HEADER_SIZE + payload > size)
+            return JsonBinaryValue();
+
+        /* Strings are read as null-terminated */
+        if(type == JsonTag_Str && data[offset + JSON_BINARY_VALUE_HEADER_SIZE + count] != '\0')
+            return JsonBinaryValue();
+
+        return JsonBinaryValue(data, size, offset);
+    }
+
+    STDROMANO_FORCE_INLINE static std::uint32_t type(const JsonBinaryValue& value) noexcept
+    {
+        return value.is_valid() ? JsonBinary_::read_u32(value._data, value._offset) : 0;
+    }
+
+    STDROMANO_FORCE_INLINE static std::uint32_t size(const JsonBinaryValue& value) noexcept
+    {
+        return JsonBinary_::read_u32(value._data, value._offset + 4);
+    }
+
+    STDROMANO_FORCE_INLINE static std::uint32_t table_at(const JsonBinaryValue& value, std::size_t index) noexcept
+    {
+        return JsonBinary_::read_u32(value._data, value._offset + JSON_BINARY_VALUE_HEADER_SIZE + index * 4);
+    }
+
+    /* Writing */
+
+    static void write(JsonBinaryWriter* writer, const void* data, std::size_t size) noexcept
+    {
+        JsonWriter_::write(writer->sink, static_cast<const char*>(data), size);
+        writer->offset += size;
+    }
+
+    static void write_u32(JsonBinaryWriter* writer, std::uint32_t value) noexcept
+    {
+        value = htole32(value);
+        JsonBinary_::write(writer, &value, sizeof(std::uint32_t));
+    }
+
+    static void write_u64(JsonBinaryWriter* writer, std::uint64_t value) noexcept
+    {
+        value = htole64(value);
+        JsonBinary_::write(writer, &value, sizeof(std::uint64_t));
+    }
+
+    static std::uint32_t write_header(JsonBinaryWriter* writer, std::uint32_t type, std::uint32_t size) noexcept
+    {
+        const auto offset = static_cast<std::uint32_t>(writer->offset);
+
+        JsonBinary_::write_u32(writer, type);
+        JsonBinary_::write_u32(writer, size);
+
+        return offset;
+    }
+
+    static std::uint32_t write_str(JsonBinaryWriter* writer, const char* str, std::size_t str_sz) noexcept
+    {
+        static constexpr char padding[4] = { 0, 0, 0, 0 };
+
+        const std::uint32_t offset = JsonBinary_::write_header(writer, JsonTag_Str, static_cast<std::uint32_t>(str_sz));
+
+        JsonBinary_::write(writer, str, str_sz);
+        JsonBinary_::write(writer, padding, 4 - (str_sz % 4));
+
+        return offset;
+    }
+
+    static std::uint32_t write_key(JsonBinaryWriter* writer, const char* key, std::size_t key_sz) noexcept
+    {
+        const StringD key_ref = StringD::make_ref(key, key_sz);
+        auto it = writer->keys.find(key_ref);
+
+        if(it != writer->keys.end())
+            return it->second;
+
+        const std::uint32_t offset = JsonBinary_::write_str(writer, key, key_sz);
+        writer->keys.insert(std::make_pair(key_ref, offset));
+
+        return offset;
+    }
+
+    static std::uint32_t write_value(JsonBinaryWriter* writer, const JsonObject* value) noexcept
+    {
+        const std::uint64_t tag = value->_tags & JSON_TAGS_MASK;
+
+        switch(tag)
+        {
+            case JsonTag_Null:
+                return JsonBinary_::write_header(writer, JsonTag_Null, 0);
+
+            case JsonTag_Bool:
+                return JsonBinary_::write_header(writer, JsonTag_Bool, value->_value.b ? 1 : 0);
+
+            case JsonTag_U64:
+            case JsonTag_I64:
+            case JsonTag_F64:
+            {
+                const std::uint32_t offset = JsonBinary_::write_header(writer, static_cast<std::uint32_t>(tag), 0);
+                JsonBinary_::write_u64(writer, value->_value.u64);
+                return offset;
+            }
+
+            case JsonTag_Str:
+                return JsonBinary_::write_str(writer, value->_value.str, tag_get_sz(value->_tags));
+
+            case JsonTag_Array:
+            {
+                Vector<std::uint32_t> offsets;
+
+                for(const JsonObject* element : value->array_items())
+                    offsets.push_back(JsonBinary_::write_value(writer, element));
+
+                const std::uint32_t offset = JsonBinary_::write_header(writer,
+                                                                       JsonTag_Array,
+                                                                       static_cast<std::uint32_t>(offsets.size()));
+
+                for(const std::uint32_t element_offset : offsets)
+                    JsonBinary_::write_u32(writer, element_offset);
+
+                return offset;
+            }
+
+            case JsonTag_Dict:
+            {
+                const auto* info = static_cast<const JsonDictInfo*>(value->_value.ptr);
+
+                Vector<const JsonDictElement*> elements;
+                Vector<std::uint32_t> offsets;
+                Vector<std::uint32_t> sorted;
+
+                for(const JsonDictElement* element = info->head; element != nullptr; element = element->next)
+                {
+                    sorted.push_back(static_cast<std::uint32_t>(elements.size()));
+                    elements.push_back(element);
+                    offsets.push_back(JsonBinary_::write_key(writer, element->kv.key, element->key_sz));
+                    offsets.push_back(JsonBinary_::write_value(writer, element->kv.value));
+                }
+
+                std::sort(sorted.data(),
+                          sorted.data() + sorted.size(),
+                          [&elements](std::uint32_t lhs, std::uint32_t rhs) {
+                              return json_binary_compare_keys(elements[lhs]->kv.key,
+                                                              elements[lhs]->key_sz,
+                                                              elements[rhs]->kv.key,
+                                                              elements[rhs]->key_sz) < 0;
+                          });
+
+                const std::uint32_t offset = JsonBinary_::write_header(writer,
+                                                                       JsonTag_Dict,
+                                                                       static_cast<std::uint32_t>(elements.size()));
+
+                for(const std::uint32_t entry_offset : offsets)
+                    JsonBinary_::write_u32(writer, entry_offset);
+
+                for(const std::uint32_t index : sorted)
+                    JsonBinary_::write_u32(writer, index);
+
+                return offset;
+            }
+
+            default:
+                return 0;
+        }
+    }
+
+    /* Loading, children must be located before their parent which prevents cycles */
+
+    static const char* load_str(Json* json, const JsonBinaryValue& str, bool zero_copy) noexcept
+    {
+        const char* data = str._data + str._offset + JSON_BINARY_VALUE_HEADER_SIZE;
+
+        if(zero_copy)
+            return data;
+
+        const std::size_t str_sz = JsonBinary_::size(str);
+        char* copy = static_cast<char*>(json->_string_arena.allocate(str_sz + 1));
+        std::memcpy(copy, data, str_sz + 1);
+
+        return copy;
+    }
+
+    /*
+     * Each value but the root is referenced by at least one u32 offset, so a document of size
+     * bytes has less than size / 4 values. Values can still be referenced several times, and a
+     * crafted document sharing children would expand exponentially when loaded: loading fails
+     * once this many values have been materialized
+     */
+    STDROMANO_FORCE_INLINE static std::size_t max_loaded_values(std::size_t size) noexcept
+    {
+        return size / 4 + 1;
+    }
+
+    static JsonObject* load_value(Json* json,
+                                  const JsonBinaryValue& value,
+                                  bool zero_copy,
+                                  std::size_t& budget,
+                                  std::uint32_t depth) noexcept
+    {
+        if(budget == 0 || depth > JSON_BINARY_MAX_DEPTH)
+            return nullptr;
+
+        budget--;
+
+        const std::uint32_t type = JsonBinary_::type(value);
+        const std::uint32_t size = value.is_valid() ? JsonBinary_::size(value) : 0;
+
+        switch(type)
+        {
+            case JsonTag_Null:
+                return json->make_null();
+
+            case JsonTag_Bool:
+                return json->make_bool(size != 0);
+
+            case JsonTag_U64:
+            case JsonTag_I64:
+            case JsonTag_F64:
+            {
+                JsonObject* obj = json->_value_arena.emplace<JsonObject>();
+                tag_set_type(obj->_tags, type);
+                obj->_value.u64 = JsonBinary_::read_u64(value._data, value._offset + JSON_BINARY_VALUE_HEADER_SIZE);
+                return obj;
+            }
+
+            case JsonTag_Str:
+            {
+                JsonObject* obj = json->_value_arena.emplace<JsonObject>();
+                tag_set_type(obj->_tags, JsonTag_Str);
+                tag_set_sz(obj->_tags, size);
+                obj->_value.str = JsonBinary_::load_str(json, value, zero_copy);
+                return obj;
+            }
+
+            case JsonTag_Array:
+            {
+                JsonObject* array = json->make_array();
+                auto* info = static_cast<JsonArrayInfo*>(array->_value.ptr);
+
+                if(size > 0)
+                    json_array_set_capacity(json->_value_arena, info, 0, size);
+
+                for(std::uint32_t i = 0; i < size; i++)
+                {
+                    const std::uint32_t offset = JsonBinary_::table_at(value, i);
+
+                    if(offset >= value._offset)
+                        return nullptr;
+
+                    JsonObject* element = JsonBinary_::load_value(json,
+                                                                  JsonBinary_::value_at(value._data, value._size, offset),
+                                                                  zero_copy,
+                                                                  budget,
+                                                                  depth + 1);
+
+                    if(element == nullptr)
+                        return nullptr;
+
+                    info->data[i] = element;
+                }
+
+                tag_set_sz(array->_tags, size);
+
+                return array;
+            }
+
+            case JsonTag_Dict:
+            {
+                JsonObject* dict = json->make_dict();
+
+                for(std::uint32_t i = 0; i < size; i++)
+                {
+                    const std::uint32_t key_offset = JsonBinary_::table_at(value, i * 2);
+                    const std::uint32_t value_offset = JsonBinary_::table_at(value, i * 2 + 1);
+
+                    if(key_offset >= value._offset || value_offset >= value._offset)
+                        return nullptr;
+
+                    const JsonBinaryValue key = JsonBinary_::value_at(value._data, value._size, key_offset);
+
+                    if(JsonBinary_::type(key) != JsonTag_Str)
+                        return nullptr;
+
+                    JsonObject* element = JsonBinary_::load_value(json,
+                                                                  JsonBinary_::value_at(value._data, value._size, value_offset),
+                                                                  zero_copy,
+                                                                  budget,
+                                                                  depth + 1);
+
+                    if(element == nullptr)
+                        return nullptr;
+
+                    JsonDict_::insert(json,
+                                      dict,
+                                      JsonBinary_::load_str(json, key, zero_copy),
+                                      JsonBinary_::size(key),
+                                      element);
+                }
+
+                return dict;
+            }
+
+            default:
+                return nullptr;
+        }
+    }
+
+    /* Checks the header and returns the root offset, 0 if the document is invalid */
+    static std::uint32_t root_offset(const char* data, std::size_t size) noexcept
+    {
+        if(data == nullptr || size < JSON_BINARY_HEADER_SIZE + JSON_BINARY_VALUE_HEADER_SIZE + 4 ||
+           size > static_cast<std::size_t>(UINT32_MAX) + 4)
+            return 0;
+
+        if(std::memcmp(data, JSON_BINARY_MAGIC, 4) != 0 ||
+           JsonBinary_::read_u32(data, 4) != JSON_BINARY_VERSION)
+            return 0;
+
+        const std::uint32_t root = JsonBinary_::read_u32(data, size - 4);
+
+        return JsonBinary_::value_at(data, size - 4, root)._offset;
+    }
+};
+
+/****************************/
+/* JsonBinaryValue          */
+/****************************/
+
+bool JsonBinaryValue::is_null() const noexcept { return JsonBinary_::type(*this) == JsonTag_Null; }
+bool JsonBinaryValue::is_bool() const noexcept { return JsonBinary_::type(*this) == JsonTag_Bool; }
+bool JsonBinaryValue::is_u64() const noexcept { return JsonBinary_::type(*this) == JsonTag_U64; }
+bool JsonBinaryValue::is_i64() const noexcept { return JsonBinary_::type(*this) == JsonTag_I64; }
+bool JsonBinaryValue::is_f64() const noexcept { return JsonBinary_::type(*this) == JsonTag_F64; }
+bool JsonBinaryValue::is_str() const noexcept { return JsonBinary_::type(*this) == JsonTag_Str; }
+bool JsonBinaryValue::is_array() const noexcept { return JsonBinary_::type(*this) == JsonTag_Array; }
+bool JsonBinaryValue::is_dict() const noexcept { return JsonBinary_::type(*this) == JsonTag_Dict; }
+
+bool JsonBinaryValue::get_bool() const noexcept
+{
+    return this->is_bool() && JsonBinary_::size(*this) != 0;
+}
+
+std::uint64_t JsonBinaryValue::get_u64() const noexcept
+{
+    if(!this->is_u64())
+        return 0;
+
+    return JsonBinary_::read_u64(this->_data, this->_offset + JSON_BINARY_VALUE_HEADER_SIZE);
+}
+
+std::int64_t JsonBinaryValue::get_i64() const noexcept
+{
+    if(!this->is_i64())
+        return 0;
+
+    return static_cast<std::int64_t>(JsonBinary_::read_u64(this->_data, this->_offset + JSON_BINARY_VALUE_HEADER_SIZE));
+}
+
+double JsonBinaryValue::get_f64() const noexcept
+{
+    if(!this->is_f64())
+        return 0.0;
+
+    return bit_cast<std::uint64_t, double>(JsonBinary_::read_u64(this->_data, this->_offset + JSON_BINARY_VALUE_HEADER_SIZE));
+}
+
+const char* JsonBinaryValue::get_str() const noexcept
+{
+    if(!this->is_str())
+        return nullptr;
+
+    return this->_data + this->_offset + JSON_BINARY_VALUE_HEADER_SIZE;
+}
+
+std::size_t JsonBinaryValue::get_str_size() const noexcept
+{
+    return this->is_str() ? JsonBinary_::size(*this) : 0;
+}
+
+std::size_t JsonBinaryValue::array_size() const noexcept
+{
+    return this->is_array() ? JsonBinary_::size(*this) : 0;
+}
+
+std::size_t JsonBinaryValue::dict_size() const noexcept
+{
+    return this->is_dict() ? JsonBinary_::size(*this) : 0;
+}
+
+JsonBinaryValue JsonBinaryValue::array_at(std::size_t index) const noexcept
+{
+    if(index >= this->array_size())
+        return JsonBinaryValue();
+
+    return JsonBinary_::value_at(this->_data, this->_size, JsonBinary_::table_at(*this, index));
+}
+
+JsonBinaryValue JsonBinaryValue::dict_find(const char* key) const noexcept
+{
+    return this->dict_find(key, std::strlen(key));
+}
+
+JsonBinaryValue JsonBinaryValue::dict_find(const char* key, std::size_t key_sz) const noexcept
+{
+    const std::size_t size = this->dict_size();
+
+    std::size_t low = 0;
+    std::size_t high = size;
+
+    while(low < high)
+    {
+        const std::size_t mid = low + (high - low) / 2;
+        const std::uint32_t index = JsonBinary_::table_at(*this, size * 2 + mid);
+
+        if(index >= size)
+            return JsonBinaryValue();
+
+        const JsonBinaryValue entry_key = JsonBinary_::value_at(this->_data,
+                                                                this->_size,
+                                                                JsonBinary_::table_at(*this, index * 2));
+
+        if(!entry_key.is_str())
+            return JsonBinaryValue();
+
+        const int cmp = json_binary_compare_keys(entry_key.get_str(), entry_key.get_str_size(), key, key_sz);
+
+        if(cmp == 0)
+            return JsonBinary_::value_at(this->_data, this->_size, JsonBinary_::table_at(*this, index * 2 + 1));
+
+        if(cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return JsonBinaryValue();
+}
+
+const char* JsonBinaryValue::dict_key_at(std::size_t index) const noexcept
+{
+    if(index >= this->dict_size())
+        return nullptr;
+
+    return JsonBinary_::value_at(this->_data, this->_size, JsonBinary_::table_at(*this, index * 2)).get_str();
+}
+
+JsonBinaryValue JsonBinaryValue::dict_value_at(std::size_t index) const noexcept
+{
+    if(index >= this->dict_size())
+        return JsonBinaryValue();
+
+    return JsonBinary_::value_at(this->_data, this->_size, JsonBinary_::table_at(*this, index * 2 + 1));
+}
+
+/****************************/
+/* JsonBinary               */
+/****************************/
+
+JsonBinary::JsonBinary() noexcept : _data(nullptr),
+                                    _size(0),
+                                    _root(0),
+                                    _source(nullptr)
+{
+}
+
+JsonBinary::~JsonBinary() noexcept
+{
+    delete this->_source;
+}
+
+bool JsonBinary::load(const char* data, std::size_t size) noexcept
+{
+    this->_root = JsonBinary_::root_offset(data, size);
+
+    if(this->_root == 0)
+        return false;
+
+    this->_data = data;
+    this->_size = size - 4;
+
+    return true;
+}
+
+bool JsonBinary::loadf(const StringD& path) noexcept
+{
+    auto mapped = fs::map_file(path);
+
+    if(!mapped.has_value())
+        return false;
+
+    fs::MappedFile file = mapped.value();
+
+    if(!this->load(file.data(), file.size()))
+        return false;
+
+    if(this->_source == nullptr)
+        this->_source = new fs::MappedFile();
+
+    *this->_source = std::move(file);
+
+    return true;
+}
+
+JsonBinaryValue JsonBinary::root() const noexcept
+{
+    return JsonBinaryValue(this->_data, this->_size, this->_root);
+}
+
+/****************************/
+/* Json: binary dump / load */
+/****************************/
+
+bool Json::dumpb(const StringD& path) const noexcept
+{
+    if(this->_root == nullptr)
+        return false;
+
+#if defined(STDROMANO_WIN)
+    const int fd = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif /* defined(STDROMANO_WIN) */
+
+    if(fd < 0)
+        return false;
+
+    bool res;
+
+    {
+        JsonWriter sink(fd);
+
+        JsonBinaryWriter writer;
+        writer.sink = &sink;
+        writer.offset = 0;
+
+        JsonBinary_::write(&writer, JSON_BINARY_MAGIC, 4);
+        JsonBinary_::write_u32(&writer, JSON_BINARY_VERSION);
+
+        const std::uint32_t root = JsonBinary_::write_value(&writer, this->_root);
+        JsonBinary_::write_u32(&writer, root);
+
+        res = sink.flush() && writer.offset <= static_cast<std::uint64_t>(UINT32_MAX) + 4;
+    }
+
+#if defined(STDROMANO_WIN)
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif /* defined(STDROMANO_WIN) */
+
+    return res;
+}
+
+bool Json::loadb(const char* data, std::size_t size) noexcept
+{
+    const std::uint32_t root = JsonBinary_::root_offset(data, size);
+
+    if(root == 0)
+        return false;
+
+    std::size_t budget = JsonBinary_::max_loaded_values(size);
+
+    JsonObject* obj = JsonBinary_::load_value(this, JsonBinary_::value_at(data, size - 4, root), false, budget, 0);
+
+    if(obj == nullptr)
+        return false;
+
+    this->_root = obj;
+
+    return true;
+}
+
+bool Json::loadb(const StringD& path, std::uint32_t flags) noexcept
+{
+    auto mapped = fs::map_file(path, fs::MapFileFlags_Sequential);
+
+    if(!mapped.has_value())
+        return false;
+
+    fs::MappedFile file = mapped.value();
+
+    if(!(flags & JsonLoadFlags_ZeroCopy))
+        return this->loadb(file.data(), file.size());
+
+    const std::uint32_t root = JsonBinary_::root_offset(file.data(), file.size());
+
+    if(root == 0)
+        return false;
+
+    std::size_t budget = JsonBinary_::max_loaded_values(file.size());
+
+    JsonObject* obj = JsonBinary_::load_value(this,
+                                              JsonBinary_::value_at(file.data(), file.size() - 4, root),
+                                              true,
+                                              budget,
+                                              0);
+
+    if(obj == nullptr)
+        return false;
+
+    this->_root = obj;
+
+    if(this->_source == nullptr)
+        this->_source = new fs::MappedFile();
+
+    *this->_source = std::move(file);
+
+    return true;
+}
+
+/**********************/
+/* JsonTokenReader    */
+/**********************/
+
+struct JsonTokenReader_
+{
+    static bool fail(JsonTokenReader* reader) noexcept
+    {
+        reader->_error = true;
+        return false;
+    }
+
+    /* Skips whitespace and returns the next character, 0 at the end of the input */
+    static char peek(JsonTokenReader* reader) noexcept
+    {
+        reader->_pos = json_skip_whitespace(reader->_str, reader->_pos, reader->_len);
+
+        return reader->_pos < reader->_len ? reader->_str[reader->_pos] : '\0';
+    }
+
+    static bool expect(JsonTokenReader* reader, char c) noexcept
+    {
+        if(reader->_error || JsonTokenReader_::peek(reader) != c)
+            return JsonTokenReader_::fail(reader);
+
+        reader->_pos++;
+
+        return true;
+    }
+
+    static bool literal(JsonTokenReader* reader, const char* lit, std::size_t lit_sz) noexcept
+    {
+        if(reader->_error)
+            return false;
+
+        JsonTokenReader_::peek(reader);
+
+        if(reader->_len - reader->_pos < lit_sz || std::memcmp(reader->_str + reader->_pos, lit, lit_sz) != 0)
+            return JsonTokenReader_::fail(reader);
+
+        reader->_pos += lit_sz;
+
+        return true;
+    }
+
+    static bool number(JsonTokenReader* reader, JsonObject* out) noexcept
+    {
+        if(reader->_error)
+            return false;
+
+        JsonTokenReader_::peek(reader);
+
+        if(!JsonParser_::parse_number(reader->_str, reader->_pos, reader->_len, out))
+            return JsonTokenReader_::fail(reader);
+
+        return true;
+    }
+
+    /* Reads the string at the current position, raw is its content without the quotes */
+    static bool raw_string(JsonTokenReader* reader,
+                           const char** raw,
+                           std::size_t* raw_sz,
+                           bool* has_escape) noexcept
+    {
+        if(reader->_error || JsonTokenReader_::peek(reader) != '"')
+            return JsonTokenReader_::fail(reader);
+
+        const std::size_t end = JsonLazy_::skip_string(reader->_str, reader->_pos, reader->_len, has_escape);
+
+        if(end == JsonLazy_::INVALID_POS)
+            return JsonTokenReader_::fail(reader);
+
+        *raw = reader->_str + reader->_pos + 1;
+        *raw_sz = end - reader->_pos - 2;
+        reader->_pos = end;
+
+        return true;
+    }
+
+    /* Consumes the separator preceding the next element of a container, false once closed */
+    static bool next(JsonTokenReader* reader, char closer) noexcept
+    {
+        if(reader->_error)
+            return false;
+
+        const char c = JsonTokenReader_::peek(reader);
+
+        if(c == closer)
+        {
+            reader->_pos++;
+            reader->_first = false;
+            return false;
+        }
+
+        if(!reader->_first)
+        {
+            if(c != ',')
+                return JsonTokenReader_::fail(reader);
+
+            reader->_pos++;
+        }
+
+        reader->_first = false;
+
+        return true;
+    }
+};
+
+JsonTokenReader::JsonTokenReader(const char* str, std::size_t len) noexcept : _str(str),
+                                                                              _len(str != nullptr ? len : 0),
+                                                                              _pos(0),
+                                                                              _first(false),
+                                                                              _error(false)
+{
+}
+
+bool JsonTokenReader::dict_start() noexcept
+{
+    if(!JsonTokenReader_::expect(this, '{'))
+        return false;
+
+    this->_first = true;
+
+    return true;
+}
+
+bool JsonTokenReader::next_key(const char** key, std::size_t* key_sz) noexcept
+{
+    if(!JsonTokenReader_::next(this, '}'))
+        return false;
+
+    const char* raw;
+    std::size_t raw_sz;
+    bool has_escape = false;
+
+    if(!JsonTokenReader_::raw_string(this, &raw, &raw_sz, &has_escape) ||
+       !JsonTokenReader_::expect(this, ':'))
+    {
+        return false;
+    }
+
+    if(has_escape)
+    {
+        this->_key.resize(raw_sz + 1);
+        raw_sz = json_unescape(raw, raw_sz, this->_key.data());
+        raw = this->_key.data();
+    }
+
+    *key = raw;
+    *key_sz = raw_sz;
+
+    return true;
+}
+
+bool JsonTokenReader::array_start() noexcept
+{
+    if(!JsonTokenReader_::expect(this, '['))
+        return false;
+
+    this->_first = true;
+
+    return true;
+}
+
+bool JsonTokenReader::next_element() noexcept
+{
+    return JsonTokenReader_::next(this, ']');
+}
+
+bool JsonTokenReader::is_null() noexcept
+{
+    return !this->_error && JsonTokenReader_::peek(this) == 'n';
+}
+
+bool JsonTokenReader::read_null() noexcept
+{
+    return JsonTokenReader_::literal(this, "null", 4);
+}
+
+bool JsonTokenReader::read_bool(bool& b) noexcept
+{
+    if(this->_error)
+        return false;
+
+    b = JsonTokenReader_::peek(this) == 't';
+
+    return b ? JsonTokenReader_::literal(this, "true", 4) : JsonTokenReader_::literal(this, "false", 5);
+}
+
+bool JsonTokenReader::read_u64(std::uint64_t& u64) noexcept
+{
+    JsonObject number;
+
+    if(!JsonTokenReader_::number(this, &number))
+        return false;
+
+    if(!number.is_u64())
+        return JsonTokenReader_::fail(this);
+
+    u64 = number.get_u64();
+
+    return true;
+}
+
+bool JsonTokenReader::read_i64(std::int64_t& i64) noexcept
+{
+    JsonObject number;
+
+    if(!JsonTokenReader_::number(this, &number))
+        return false;
+
+    if(number.is_i64())
+    {
+        i64 = number.get_i64();
+        return true;
+    }
+
+    if(!number.is_u64() || number.get_u64() > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+        return JsonTokenReader_::fail(this);
+
+    i64 = static_cast<std::int64_t>(number.get_u64());
+
+    return true;
+}
+
+bool JsonTokenReader::read_f64(double& f64) noexcept
+{
+    JsonObject number;
+
+    if(!JsonTokenReader_::number(this, &number))
+        return false;
+
+    if(number.is_f64())
+        f64 = number.get_f64();
+    else if(number.is_i64())
+        f64 = static_cast<double>(number.get_i64());
+    else
+        f64 = static_cast<double>(number.get_u64());
+
+    return true;
+}
+
+bool JsonTokenReader::read_str(StringD& str) noexcept
+{
+    const char* raw;
+    std::size_t raw_sz;
+    bool has_escape = false;
+
+    if(!JsonTokenReader_::raw_string(this, &raw, &raw_sz, &has_escape))
+        return false;
+
+    if(!has_escape)
+    {
+        str = StringD(raw, raw_sz);
+        return true;
+    }
+
+    StringD unescaped = StringD::make_zeroed(raw_sz);
+    const std::size_t unescaped_sz = json_unescape(raw, raw_sz, unescaped.data());
+
+    str = StringD(unescaped.c_str(), unescaped_sz);
+
+    return true;
+}
+
+bool JsonTokenReader::skip() noexcept
+{
+    if(this->_error)
+        return false;
+
+    JsonTokenReader_::peek(this);
+
+    const std::size_t end = JsonLazy_::skip_value<true>(this->_str, this->_pos, this->_len);
+
+    if(end == JsonLazy_::INVALID_POS)
+        return JsonTokenReader_::fail(this);
+
+    this->_pos = end;
+
+    return true;
+}
+
+bool JsonTokenReader::finish() noexcept
+{
+    if(this->_error)
         return false;
 
-    const size_t str_sz = written.size();
-    const size_t fwritten = std::fwrite(written.data(), sizeof(char), str_sz, file);
-    std::fclose(file);
+    JsonTokenReader_::peek(this);
 
-    return fwritten == str_sz;
+    return this->_pos >= this->_len;
 }
 
 STDROMANO_NAMESPACE_END
@@ -7,6 +7,7 @@
 #include "jemalloc/jemalloc.h"
 
 #include <algorithm>
+#include <utility>
 
 STDROMANO_NAMESPACE_BEGIN
 
@@ -82,6 +83,17 @@ void format_byte_size(float size, char* buffer) noexcept
     std::snprintf(buffer, 16, "%.02f %s", size, units[unit]);
 }
 
+std::uint64_t mem_thread_allocated_bytes() noexcept
+{
+    std::uint64_t allocated = 0;
+    std::size_t size = sizeof(allocated);
+
+    if(je_mallctl("thread.allocated", &allocated, &size, nullptr, 0) != 0)
+        return 0;
+
+    return allocated;
+}
+
 Arena::Arena(const std::size_t initial_size,
              const std::size_t block_size)
 {
@@ -90,6 +102,29 @@ Arena::Arena(const std::size_t initial_size,
     this->_block_size = block_size;
 }
 
+Arena::Arena(Arena&& other) noexcept : _current_block(other._current_block),
+                                       _capacity(other._capacity),
+                                       _block_size(other._block_size),
+                                       _destructors(other._destructors)
+{
+    other._current_block = nullptr;
+    other._capacity = 0;
+    other._destructors = nullptr;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+    if(this != &other)
+    {
+        std::swap(this->_current_block, other._current_block);
+        std::swap(this->_capacity, other._capacity);
+        std::swap(this->_block_size, other._block_size);
+        std::swap(this->_destructors, other._destructors);
+    }
+
+    return *this;
+}
+
 Arena::Block* Arena::allocate_block(const std::size_t size) noexcept
 {
     const std::size_t total_size = size + sizeof(Block);
@@ -108,18 +143,24 @@ Arena::Block* Arena::allocate_block(const std::size_t size) noexcept
     return static_cast<Block*>(addr);
 }
 
-void Arena::grow() noexcept
+void Arena::grow(const std::size_t min_size) noexcept
 {
-    Block* next_block;
+    Block* next_block = this->_current_block->_next;
 
-    if(this->_current_block->_next != nullptr)
-    {
-        next_block = this->_current_block->_next;
-    }
-    else
+    if(next_block == nullptr || next_block->_size < min_size)
     {
-        next_block = Arena::allocate_block(this->_block_size);
-        this->_capacity += this->_block_size;
+        /* Oversized allocations get their own block, inserted before the next reusable one */
+        const std::size_t size = std::max(static_cast<std::size_t>(this->_block_size), min_size);
+
+        Block* new_block = Arena::allocate_block(size);
+        this->_capacity += size;
+
+        new_block->_next = next_block;
+
+        if(next_block != nullptr)
+            next_block->_prev = new_block;
+
+        next_block = new_block;
     }
 
     next_block->_prev = this->_current_block;
@@ -156,6 +197,7 @@ void Arena::clear() noexcept
 
 Arena::~Arena()
 {
+    /* clear rewinds to the first block */
     this->clear();
 
     Block* current = this->_current_block;
@@ -163,7 +205,7 @@ Arena::~Arena()
     while(current != nullptr)
     {
         Block* tmp = current;
-        current = tmp->_prev;
+        current = tmp->_next;
         mem_free(tmp);
     }
 }
@@ -2,11 +2,18 @@
 // Copyright (c) 2025 - Present Romain Augier
 // All rights reserved.
 
+#include "stdromano/filesystem.hpp"
 #include "stdromano/hashmap.hpp"
 #include "stdromano/python.hpp"
 #include "stdromano/stackvector.hpp"
+#include "stdromano/threading.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/sinks/base_sink.h"
 
 STDROMANO_NAMESPACE_BEGIN
 
@@ -25,6 +32,23 @@ const char* Token::kind_as_string(Token::Kind kind) noexcept
     return k < 8 ? g_token_kind_names[k] : nullptr;
 }
 
+const char* node_type_as_string(std::uint32_t type) noexcept
+{
+    switch(type)
+    {
+#define STDROMANO_PYTHON_NODE_TYPE_STRING(Name, Type, String) \
+        case ASTNode##Name:                                    \
+            return String;
+
+        STDROMANO_PYTHON_AST_NODES(STDROMANO_PYTHON_NODE_TYPE_STRING)
+
+#undef STDROMANO_PYTHON_NODE_TYPE_STRING
+
+        default:
+            return "NODE";
+    }
+}
+
 // Lexer
 
 struct Lexer
@@ -40,7 +64,6 @@ struct Lexer
 
     std::shared_ptr<spdlog::logger> logger;
 
-    static const HashMap<StringD, Keyword>    keyword_map;
     static const HashMap<StringD, Delimiter>  delimiter_map;
     static const HashMap<StringD, Operator>   operator_map;
 
@@ -86,51 +109,93 @@ private:
 
     bool emit_indentation(std::uint32_t spaces, Vector<Token>& out) noexcept;
 
+    void emit(Vector<Token>& out,
+              Token::Kind kind,
+              std::uint32_t type,
+              const char* start,
+              std::uint32_t length,
+              std::uint32_t column) const noexcept
+    {
+        out.emplace_back(kind, type, static_cast<std::uint32_t>(start - this->buffer), length, column, this->line);
+    }
+
     template<typename... Args>
     void report_error(fmt::format_string<Args...> fmt, Args&&... args) noexcept;
 };
 
-const HashMap<StringD, Keyword> Lexer::keyword_map = {
-    { StringD::make_ref("False"), Keyword::False },
-    { StringD::make_ref("await"), Keyword::Await },
-    { StringD::make_ref("else"), Keyword::Else },
-    { StringD::make_ref("import"), Keyword::Import },
-    { StringD::make_ref("pass"), Keyword::Pass },
-    { StringD::make_ref("None"), Keyword::None },
-    { StringD::make_ref("break"), Keyword::Break },
-    { StringD::make_ref("except"), Keyword::Except },
-    { StringD::make_ref("in"), Keyword::In },
-    { StringD::make_ref("raise"), Keyword::Raise },
-    { StringD::make_ref("True"), Keyword::True },
-    { StringD::make_ref("class"), Keyword::Class },
-    { StringD::make_ref("finally"), Keyword::Finally },
-    { StringD::make_ref("is"), Keyword::Is },
-    { StringD::make_ref("return"), Keyword::Return },
-    { StringD::make_ref("and"), Keyword::And },
-    { StringD::make_ref("continue"), Keyword::Continue },
-    { StringD::make_ref("for"), Keyword::For },
-    { StringD::make_ref("lambda"), Keyword::Lambda },
-    { StringD::make_ref("try"), Keyword::Try },
-    { StringD::make_ref("as"), Keyword::As },
-    { StringD::make_ref("def"), Keyword::Def },
-    { StringD::make_ref("from"), Keyword::From },
-    { StringD::make_ref("nonlocal"), Keyword::Nonlocal },
-    { StringD::make_ref("while"), Keyword::While },
-    { StringD::make_ref("assert"), Keyword::Assert },
-    { StringD::make_ref("del"), Keyword::Del },
-    { StringD::make_ref("global"), Keyword::Global },
-    { StringD::make_ref("not"), Keyword::Not },
-    { StringD::make_ref("with"), Keyword::With },
-    { StringD::make_ref("async"), Keyword::Async },
-    { StringD::make_ref("elif"), Keyword::Elif },
-    { StringD::make_ref("if"), Keyword::If },
-    { StringD::make_ref("or"), Keyword::Or },
-    { StringD::make_ref("yield"), Keyword::Yield },
-    // { StringD::make_ref("match"), Keyword::Match}, // soft keyword
-    // { StringD::make_ref("case"), Keyword::Case }, // soft keyword
-    // { StringD::make_ref("type"), Keyword::Type }, // soft keyword
+// Keywords, bucketed by length so an identifier is classified with a few comparisons against the
+// source buffer, without building a string
+
+struct KeywordEntry
+{
+    const char* word;
+    Keyword keyword;
+};
+
+static const KeywordEntry g_keywords_2[] = {
+    { "in", Keyword::In }, { "is", Keyword::Is }, { "as", Keyword::As }, { "if", Keyword::If }, { "or", Keyword::Or },
+};
+
+static const KeywordEntry g_keywords_3[] = {
+    { "and", Keyword::And }, { "for", Keyword::For }, { "try", Keyword::Try },
+    { "def", Keyword::Def }, { "del", Keyword::Del }, { "not", Keyword::Not },
+};
+
+static const KeywordEntry g_keywords_4[] = {
+    { "else", Keyword::Else }, { "pass", Keyword::Pass }, { "None", Keyword::None }, { "True", Keyword::True },
+    { "from", Keyword::From }, { "with", Keyword::With }, { "elif", Keyword::Elif },
+};
+
+static const KeywordEntry g_keywords_5[] = {
+    { "False", Keyword::False }, { "await", Keyword::Await }, { "break", Keyword::Break },
+    { "raise", Keyword::Raise }, { "class", Keyword::Class }, { "while", Keyword::While },
+    { "async", Keyword::Async }, { "yield", Keyword::Yield },
 };
 
+static const KeywordEntry g_keywords_6[] = {
+    { "import", Keyword::Import }, { "except", Keyword::Except }, { "return", Keyword::Return },
+    { "lambda", Keyword::Lambda }, { "assert", Keyword::Assert }, { "global", Keyword::Global },
+};
+
+static const KeywordEntry g_keywords_7[] = {
+    { "finally", Keyword::Finally },
+};
+
+static const KeywordEntry g_keywords_8[] = {
+    { "continue", Keyword::Continue }, { "nonlocal", Keyword::Nonlocal },
+};
+
+// match, case and type are soft keywords, lexed as identifiers
+
+static bool find_keyword(const char* word, std::uint32_t length, Keyword& keyword) noexcept
+{
+    const KeywordEntry* entries;
+    std::size_t count;
+
+    switch(length)
+    {
+        case 2: entries = g_keywords_2; count = std::size(g_keywords_2); break;
+        case 3: entries = g_keywords_3; count = std::size(g_keywords_3); break;
+        case 4: entries = g_keywords_4; count = std::size(g_keywords_4); break;
+        case 5: entries = g_keywords_5; count = std::size(g_keywords_5); break;
+        case 6: entries = g_keywords_6; count = std::size(g_keywords_6); break;
+        case 7: entries = g_keywords_7; count = std::size(g_keywords_7); break;
+        case 8: entries = g_keywords_8; count = std::size(g_keywords_8); break;
+        default: return false;
+    }
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        if(entries[i].word[0] == word[0] && std::memcmp(entries[i].word, word, length) == 0)
+        {
+            keyword = entries[i].keyword;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 const HashMap<StringD, Delimiter> Lexer::delimiter_map = {
     { StringD::make_ref("("), Delimiter::LParen },
     { StringD::make_ref(")"), Delimiter::RParen },
@@ -438,11 +503,7 @@ bool Lexer::lex_string(Vector<Token>& out) noexcept
     char* body_end = triple ? (this->cursor - 3) : (this->cursor - 1);
     std::uint32_t body_len = static_cast<std::uint32_t>(body_end - body_start);
 
-    out.emplace_back(StringD::make_ref(body_start, body_len),
-                     Token::Kind::Literal,
-                     static_cast<std::uint32_t>(lit_type),
-                     col_start,
-                     this->line);
+    this->emit(out, Token::Kind::Literal, static_cast<std::uint32_t>(lit_type), body_start, body_len, col_start);
     return true;
 }
 
@@ -575,11 +636,7 @@ emit:
     if(length == 0)
         return false;
 
-    out.emplace_back(StringD::make_ref(start, length),
-                     Token::Kind::Literal,
-                     static_cast<std::uint32_t>(lit),
-                     col_start,
-                     line);
+    this->emit(out, Token::Kind::Literal, static_cast<std::uint32_t>(lit), start, length, col_start);
     return true;
 }
 
@@ -610,35 +667,16 @@ bool Lexer::lex_identifier(Vector<Token>& out) noexcept
     }
 
     std::uint32_t length = static_cast<std::uint32_t>(this->cursor - start);
-    StringD word = StringD::make_from_c_str(start, length);
-
-    auto kw = keyword_map.find(word);
+    Keyword keyword;
 
-    if(kw != keyword_map.end())
+    if(find_keyword(start, length, keyword))
     {
-        out.emplace_back(std::move(word),
-                         Token::Kind::Keyword,
-                         static_cast<std::uint32_t>(kw->second),
-                         col_start,
-                         line);
+        this->emit(out, Token::Kind::Keyword, static_cast<std::uint32_t>(keyword), start, length, col_start);
 
         return true;
     }
 
-    auto op = operator_map.find(word);
-
-    if(op != operator_map.end())
-    {
-        out.emplace_back(std::move(word),
-                         Token::Kind::Operator,
-                         static_cast<std::uint32_t>(op->second),
-                         col_start,
-                         line);
-
-        return true;
-    }
-
-    out.emplace_back(std::move(word), Token::Kind::Identifier, 0, col_start, line);
+    this->emit(out, Token::Kind::Identifier, 0, start, length, col_start);
 
     return true;
 }
@@ -652,11 +690,7 @@ bool Lexer::lex_delimiter(Vector<Token>& out) noexcept
     {
         this->advance_n(2);
 
-        out.emplace_back(StringD::make_ref(start, 2),
-                         Token::Kind::Delimiter,
-                         static_cast<std::uint32_t>(Delimiter::RightArrow),
-                         col_start,
-                         line);
+        this->emit(out, Token::Kind::Delimiter, static_cast<std::uint32_t>(Delimiter::RightArrow), start, 2, col_start);
 
         return true;
     }
@@ -665,11 +699,7 @@ bool Lexer::lex_delimiter(Vector<Token>& out) noexcept
     {
         this->advance_n(2);
 
-        out.emplace_back(StringD::make_ref(start, 2),
-                         Token::Kind::Operator,
-                         static_cast<std::uint32_t>(Operator::WalrusAssign),
-                         col_start,
-                         line);
+        this->emit(out, Token::Kind::Operator, static_cast<std::uint32_t>(Operator::WalrusAssign), start, 2, col_start);
 
         return true;
     }
@@ -700,11 +730,7 @@ bool Lexer::lex_delimiter(Vector<Token>& out) noexcept
                 break;
         }
 
-        out.emplace_back(std::move(d),
-                         Token::Kind::Delimiter,
-                         static_cast<std::uint32_t>(it->second),
-                         col_start,
-                         line);
+        this->emit(out, Token::Kind::Delimiter, static_cast<std::uint32_t>(it->second), start, 1, col_start);
 
         return true;
     }
@@ -740,11 +766,7 @@ bool Lexer::lex_operator(Vector<Token>& out) noexcept
         {
             this->advance_n(try_len);
 
-            out.emplace_back(std::move(candidate),
-                             Token::Kind::Operator,
-                             static_cast<std::uint32_t>(it->second),
-                             col_start,
-                             line);
+            this->emit(out, Token::Kind::Operator, static_cast<std::uint32_t>(it->second), start, try_len, col_start);
 
             return true;
         }
@@ -758,11 +780,7 @@ bool Lexer::lex_operator(Vector<Token>& out) noexcept
         {
             this->advance();
 
-            out.emplace_back(StringD::make_ref(start, 1),
-                             Token::Kind::Operator,
-                             static_cast<std::uint32_t>(Operator::Bang),
-                             col_start,
-                             line);
+            this->emit(out, Token::Kind::Operator, static_cast<std::uint32_t>(Operator::Bang), start, 1, col_start);
 
             return true;
         }
@@ -783,14 +801,14 @@ bool Lexer::emit_indentation(std::uint32_t spaces, Vector<Token>& out) noexcept
     if(spaces > this->indent_stack.back())
     {
         this->indent_stack.push_back(spaces);
-        out.emplace_back(StringD(), Token::Kind::Indent, spaces, this->column, this->line);
+        this->emit(out, Token::Kind::Indent, 0, this->cursor - spaces, spaces, this->column);
     }
     else if(spaces < this->indent_stack.back())
     {
         while(this->indent_stack.size() > 1 && this->indent_stack.back() > spaces)
         {
             this->indent_stack.pop_back();
-            out.emplace_back(StringD(), Token::Kind::Dedent, spaces, this->column, this->line);
+            this->emit(out, Token::Kind::Dedent, 0, this->cursor, 0, this->column);
         }
 
         if(this->indent_stack.back() != spaces)
@@ -860,7 +878,7 @@ bool Lexer::lex_newline_indent(Vector<Token>& out) noexcept
     }
 
     // Outside brackets: normal newline/indent handling
-    out.emplace_back(StringD(), Token::Kind::Newline, 0, this->column, this->line);
+    this->emit(out, Token::Kind::Newline, 0, this->cursor, 0, this->column);
 
     if(*this->cursor == '\r')
     {
@@ -879,7 +897,7 @@ bool Lexer::lex_newline_indent(Vector<Token>& out) noexcept
 
     while(!this->at_end() && this->is_newline(static_cast<unsigned int>(*this->cursor)))
     {
-        out.emplace_back(StringD(), Token::Kind::Newline, 0, this->column, this->line);
+        this->emit(out, Token::Kind::Newline, 0, this->cursor, 0, this->column);
 
         if(*this->cursor == '\r')
         {
@@ -1060,11 +1078,7 @@ bool Lexer::tokenize(Vector<Token>& out) noexcept
     {
         this->indent_stack.pop_back();
 
-        out.emplace_back(StringD(),
-                         Token::Kind::Dedent,
-                         this->indent_stack.back(),
-                         this->column,
-                         this->line);
+        this->emit(out, Token::Kind::Dedent, 0, this->cursor, 0, this->column);
     }
 
     this->logger->trace("Lex successful");
@@ -1081,6 +1095,53 @@ bool AST::lex(const char* buffer, Vector<Token>& tokens) noexcept
 
 // Parser
 
+// List being built on top of a scratch stack. Lists nest: a list started while this one is being
+// built must be finished (or abandoned) before this one is pushed to again. An unfinished list is
+// popped from the stack when it goes out of scope, so lists abandoned on error paths do not leak
+// into their parent
+
+template<typename T>
+struct ScratchList
+{
+    Vector<T>& stack;
+    std::size_t mark;
+    std::size_t count;
+
+    explicit ScratchList(Vector<T>& stack) noexcept : stack(stack),
+                                                      mark(stack.size()),
+                                                      count(0) {}
+
+    ~ScratchList() noexcept { this->pop(); }
+
+    STDROMANO_NON_COPYABLE(ScratchList);
+
+    void push_back(const T& value) noexcept
+    {
+        STDROMANO_ASSERT(this->stack.size() == this->mark + this->count, "Interleaved scratch lists");
+
+        this->stack.push_back(value);
+        this->count++;
+    }
+
+    std::size_t size() const noexcept { return this->count; }
+    bool empty() const noexcept { return this->count == 0; }
+
+    const T& operator[](const std::size_t i) const noexcept { return this->stack[this->mark + i]; }
+
+    // A list already copied out is empty, and must not truncate lists pushed since
+
+    void pop() noexcept
+    {
+        if(this->count == 0)
+            return;
+
+        while(this->stack.size() > this->mark)
+            this->stack.pop_back();
+
+        this->count = 0;
+    }
+};
+
 struct Parser
 {
     const Vector<Token>& tokens;
@@ -1089,6 +1150,11 @@ struct Parser
     const StringD& source_code;
     std::uint32_t pos;
 
+    // Scratch stacks the lists are built on, reused by all the lists of the parse
+    Vector<Node*> node_scratch;
+    Vector<StringD> string_scratch;
+    Vector<Operator> operator_scratch;
+
     Parser(const Vector<Token>& tokens,
            Arena& arena,
            std::shared_ptr<spdlog::logger>& logger,
@@ -1098,12 +1164,95 @@ struct Parser
                                          source_code(source_code),
                                          pos(0) {}
 
+    ScratchList<Node*> node_list() noexcept { return ScratchList<Node*>(this->node_scratch); }
+    ScratchList<StringD> string_list() noexcept { return ScratchList<StringD>(this->string_scratch); }
+    ScratchList<Operator> operator_list() noexcept { return ScratchList<Operator>(this->operator_scratch); }
+
+    // Strings in the arena arrays reference a copy in the arena, as their destructors never run
+    StringD intern(const StringD& str) noexcept
+    {
+        if(str.empty())
+            return StringD();
+
+        char* data = static_cast<char*>(this->arena.allocate(str.size() + 1));
+        std::memcpy(data, str.data(), str.size());
+        data[str.size()] = '\0';
+
+        return StringD::make_ref(data, str.size());
+    }
+
+    // Copies the elements first, first + stride, ... before last of the list to the arena
+
+    template<typename T>
+    ArenaArray<T> make_array(const ScratchList<T>& list,
+                             const std::size_t first,
+                             const std::size_t last,
+                             const std::size_t stride) noexcept
+    {
+        STDROMANO_ASSERT(list.stack.size() == list.mark + list.count, "Scratch list is not on top of its stack");
+
+        const std::size_t size = first < last ? (last - first + stride - 1) / stride : 0;
+
+        if(size == 0)
+            return ArenaArray<T>();
+
+        T* data = static_cast<T*>(this->arena.allocate(size * sizeof(T), alignof(T)));
+
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            if constexpr(std::is_same_v<T, StringD>)
+                ::new(data + i) T(this->intern(list[first + i * stride]));
+            else
+                ::new(data + i) T(list[first + i * stride]);
+        }
+
+        return ArenaArray<T>(data, static_cast<std::uint32_t>(size));
+    }
+
+    // Copies a complete list to the arena, at its exact size
+    template<typename T>
+    ArenaArray<T> make_list(ScratchList<T>& list) noexcept
+    {
+        ArenaArray<T> array = this->make_array(list, 0, list.size(), 1);
+        list.pop();
+        return array;
+    }
+
+    NodeList make_single(Node* node) noexcept
+    {
+        Node** data = static_cast<Node**>(this->arena.allocate(sizeof(Node*), alignof(Node*)));
+        *data = node;
+
+        return NodeList(data, 1);
+    }
+
+    NodeList make_pair(Node* first, Node* second) noexcept
+    {
+        Node** data = static_cast<Node**>(this->arena.allocate(2 * sizeof(Node*), alignof(Node*)));
+        data[0] = first;
+        data[1] = second;
+
+        return NodeList(data, 2);
+    }
+
+    // Splits a list of interleaved pairs (keys and values of a dict, ...) into two arrays
+    template<typename T>
+    void make_lists(ScratchList<T>& list, ArenaArray<T>& first, ArenaArray<T>& second) noexcept
+    {
+        first = this->make_array(list, 0, list.size(), 2);
+        second = this->make_array(list, 1, list.size(), 2);
+        list.pop();
+    }
+
     bool at_end() const noexcept { return this->pos >= this->tokens.size(); }
 
     const Token& current() const noexcept { return tokens[this->pos]; }
 
     const Token& peek(std::uint32_t offset = 1) const noexcept { return this->tokens[this->pos + offset]; }
 
+    // Text of the current token, referencing the source code
+    StringD current_value() const noexcept { return this->current().value(this->source_code.data()); }
+
     void advance(const std::uint32_t n = 1) noexcept { this->pos += n; }
 
     void rewind(const std::uint32_t n = 1) noexcept { this->pos -= n; }
@@ -1152,7 +1301,7 @@ struct Parser
     {
         return this->error(this->current().line,
                            this->current().column,
-                           static_cast<std::uint32_t>(this->current().value.size()),
+                           this->current().length,
                            fmt,
                            std::forward<Args>(args)...);
     }
@@ -1202,7 +1351,7 @@ struct Parser
 
     bool match_soft_keyword(const char* name) const noexcept
     {
-        return this->check(Token::Kind::Identifier) && this->current().value == name;
+        return this->check(Token::Kind::Identifier) && this->current_value() == name;
     }
 
     bool match_keyword(Keyword kw) const noexcept
@@ -1226,9 +1375,9 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected keyword, got \"{}\"",
-                        this->current().value);
+                        this->current_value());
 
             return false;
         }
@@ -1244,9 +1393,9 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected delimiter, got \"{}\"",
-                        this->current().value);
+                        this->current_value());
 
             return false;
         }
@@ -1262,9 +1411,9 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected newline, got \"{}\"",
-                        this->current().value);
+                        this->current_value());
 
             return false;
         }
@@ -1277,15 +1426,17 @@ struct Parser
 
     // Block
 
-    bool parse_block(Vector<Node*>& body) noexcept
+    bool parse_block(NodeList& body) noexcept
     {
+        auto statements = this->node_list();
+
         this->skip_newlines();
 
         if(!this->check(Token::Kind::Indent))
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected indented block");
 
             return false;
@@ -1311,11 +1462,30 @@ struct Parser
             if(stmt == nullptr)
                 return false;
 
-            body.push_back(stmt);
+            statements.push_back(stmt);
 
             this->skip_semicolons();
         }
 
+        body = this->make_list(statements);
+
+        return true;
+    }
+
+    // Inline statement (if x: return) or indented block
+
+    bool parse_suite(NodeList& body) noexcept
+    {
+        if(this->check(Token::Kind::Newline))
+            return this->parse_block(body);
+
+        Node* stmt = this->parse_statement();
+
+        if(stmt == nullptr)
+            return false;
+
+        body = this->make_single(stmt);
+
         return true;
     }
 
@@ -1323,7 +1493,7 @@ struct Parser
 
     Node* parse_decorated() noexcept
     {
-        Vector<Node*> decorators;
+        auto decorators = this->node_list();
 
         // Collect one or more @expr lines
         while(!this->at_end() && this->match_operator(Operator::MatMul))
@@ -1354,7 +1524,7 @@ struct Parser
         else
         {
             this->error_at_current("Expected \"def\" or \"class\" after decorator, got \"{}\"",
-                                   this->current().value);
+                                   this->current_value());
 
             return nullptr;
         }
@@ -1389,13 +1559,12 @@ struct Parser
         if(!this->check(Token::Kind::Identifier))
         {
             this->error_at_current("Expected type alias name, got \"{}\"",
-                                   this->current().value);
+                                   this->current_value());
 
             return nullptr;
         }
 
-        StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                          this->current().value.size()));
+        StringD name = std::move(this->current_value().copy());
         this->advance();
 
         auto* node = this->arena.emplace<TypeAliasNode>(std::move(name), nullptr, line, column);
@@ -1407,7 +1576,7 @@ struct Parser
         if(!this->match_operator(Operator::Assign))
         {
             this->error_at_current("Expected '=' in type alias, got \"{}\"",
-                                   this->current().value);
+                                   this->current_value());
 
             return nullptr;
         }
@@ -1422,13 +1591,15 @@ struct Parser
         return node;
     }
 
-    bool parse_type_params(Vector<Node*>& type_params) noexcept
+    bool parse_type_params(NodeList& type_params) noexcept
     {
         if(!this->match_delimiter(Delimiter::LBracket))
             return true; // no type params, not an error
 
         this->advance(); // skip '['
 
+        auto params = this->node_list();
+
         while(!this->at_end() && !this->match_delimiter(Delimiter::RBracket))
         {
             std::uint32_t param_line = this->current().line;
@@ -1453,13 +1624,12 @@ struct Parser
             if(!this->check(Token::Kind::Identifier))
             {
                 this->error_at_current("Expected type parameter name, got \"{}\"",
-                                       this->current().value);
+                                       this->current_value());
 
                 return false;
             }
 
-            StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                              this->current().value.size()));
+            StringD name = std::move(this->current_value().copy());
             this->advance();
 
             auto* param = this->arena.emplace<TypeParamNode>(std::move(name), param_line, param_column);
@@ -1479,6 +1649,8 @@ struct Parser
                     auto* tup = this->arena.emplace<TupleNode>(this->current().line,
                                                                this->current().column);
 
+                    auto constraints = this->node_list();
+
                     while(!this->at_end() && !this->match_delimiter(Delimiter::RParen))
                     {
                         Node* constraint = this->parse_expr();
@@ -1486,12 +1658,14 @@ struct Parser
                         if(constraint == nullptr)
                             return false;
 
-                        tup->elts.push_back(constraint);
+                        constraints.push_back(constraint);
 
                         if(this->match_delimiter(Delimiter::Comma))
                             this->advance();
                     }
 
+                    tup->elts = this->make_list(constraints);
+
                     if(!this->expect_delimiter(Delimiter::RParen))
                         return false;
 
@@ -1522,7 +1696,7 @@ struct Parser
                 param->default_value = default_value;
             }
 
-            type_params.push_back(param);
+            params.push_back(param);
 
             if(this->match_delimiter(Delimiter::Comma))
                 this->advance();
@@ -1531,6 +1705,8 @@ struct Parser
         if(!this->expect_delimiter(Delimiter::RBracket))
             return false;
 
+        type_params = this->make_list(params);
+
         return true;
     }
 
@@ -1542,32 +1718,39 @@ struct Parser
         std::uint32_t column = this->current().column;
         this->advance(); // skip 'global' / 'nonlocal' / 'del'
 
-        Node* node = nullptr;
+        auto names = this->node_list();
 
-        std::function<void(Node*)> add_name = [&](Node*) {};
+        do
+        {
+            Node* name = this->parse_expr();
+
+            if(name == nullptr)
+                return nullptr;
+
+            names.push_back(name);
+            this->advance();
+
+        } while(this->match_delimiter(Delimiter::Comma) && (this->advance(), true));
 
         switch(node_type)
         {
             case ASTNodeGlobal:
             {
                 auto* global_node = this->arena.emplace<GlobalNode>(line, column);
-                add_name = [&](Node* name) { global_node->names.emplace_back(std::move(name)); };
-                node = global_node;
-                break;
+                global_node->names = this->make_list(names);
+                return global_node;
             }
             case ASTNodeNonLocal:
             {
                 auto* non_local_node = this->arena.emplace<NonLocalNode>(line, column);
-                add_name = [&](Node* name) { non_local_node->names.emplace_back(std::move(name)); };
-                node = non_local_node;
-                break;
+                non_local_node->names = this->make_list(names);
+                return non_local_node;
             }
             case ASTNodeDel:
             {
                 auto* del_node = this->arena.emplace<DelNode>(line, column);
-                add_name = [&](Node* name) { del_node->names.emplace_back(std::move(name)); };
-                node = del_node;
-                break;
+                del_node->names = this->make_list(names);
+                return del_node;
             }
             default:
             {
@@ -1576,20 +1759,6 @@ struct Parser
                 return nullptr;
             }
         }
-
-        do
-        {
-            Node* name = this->parse_expr();
-
-            if(name == nullptr)
-                return nullptr;
-
-            add_name(name);
-            this->advance();
-
-        } while(this->match_delimiter(Delimiter::Comma) && (this->advance(), true));
-
-        return node;
     }
 
     // Async statements
@@ -1620,7 +1789,7 @@ struct Parser
         }
 
         this->error_at_current("Expected 'def', 'for', or 'with' after 'async', got \"{}\"",
-            this->current().value);
+            this->current_value());
 
         return nullptr;
     }
@@ -1711,11 +1880,12 @@ struct Parser
         return this->parse_expr_or_assign();
     }
 
-    bool parse_func_params(Vector<Node*>& args,
+    bool parse_func_params(NodeList& args,
                            std::int32_t& posonly_index,
                            std::int32_t& kwonly_index,
                            Delimiter end_delim) noexcept
     {
+        auto params = this->node_list();
         std::int32_t arg_count = 0;
 
         while(!this->at_end() && !this->match_delimiter(end_delim))
@@ -1758,7 +1928,7 @@ struct Parser
                         return false;
 
                     static_cast<FunctionArgNode*>(arg)->is_vararg = true;
-                    args.push_back(arg);
+                    params.push_back(arg);
                     arg_count++;
                 }
 
@@ -1781,7 +1951,7 @@ struct Parser
                         return false;
 
                     static_cast<FunctionArgNode*>(arg)->is_kwarg = true;
-                    args.push_back(arg);
+                    params.push_back(arg);
                     arg_count++;
                 }
 
@@ -1799,7 +1969,7 @@ struct Parser
                 if(arg == nullptr)
                     return false;
 
-                args.push_back(arg);
+                params.push_back(arg);
                 arg_count++;
             }
 
@@ -1819,13 +1989,15 @@ struct Parser
                !this->check(Token::Kind::Dedent))
             {
                 this->error_at_current("Unexpected token \"{}\" ({}) in parameter list",
-                                       this->current().value,
+                                       this->current_value(),
                                        this->current().kind);
 
                 return false;
             }
         }
 
+        args = this->make_list(params);
+
         return true;
     }
 
@@ -1835,7 +2007,7 @@ struct Parser
         {
             std::uint32_t name_line = this->current().line;
             std::uint32_t name_column = this->current().column;
-            StringD name = std::move(this->current().value);
+            StringD name = this->current_value().copy();
             Node* annotation = nullptr;
 
             this->advance();
@@ -1854,9 +2026,9 @@ struct Parser
                 {
                     this->error(this->current().line,
                                 this->current().column,
-                                static_cast<std::uint32_t>(this->current().value.size()),
+                                this->current().length,
                                 "Unexpected delimiter \"{}\"",
-                                this->current().value);
+                                this->current_value());
 
                     return nullptr;
                 }
@@ -1893,13 +2065,13 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected function name");
 
             return nullptr;
         }
 
-        StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+        StringD name = std::move(this->current_value().copy());
         this->advance();
 
         auto* node = this->arena.emplace<FunctionDefNode>(std::move(name), line, column);
@@ -1932,9 +2104,7 @@ struct Parser
             return nullptr;
 
         // Inline body
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         return node;
@@ -1953,13 +2123,13 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected function name");
 
             return nullptr;
         }
 
-        StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+        StringD name = std::move(this->current_value().copy());
         this->advance();
 
         auto* node = this->arena.emplace<AsyncFunctionDefNode>(std::move(name), line, column);
@@ -1992,9 +2162,7 @@ struct Parser
             return nullptr;
 
         // Inline body
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         return node;
@@ -2010,13 +2178,13 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected class name");
 
             return nullptr;
         }
 
-        StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+        StringD name = std::move(this->current_value().copy());
         this->advance();
 
         auto* node = this->arena.emplace<ClassDefNode>(std::move(name), line, column);
@@ -2030,6 +2198,8 @@ struct Parser
         {
             this->advance();
 
+            auto bases = this->node_list();
+
             while(!this->at_end() && !this->match_delimiter(Delimiter::RParen))
             {
                 // **expr unpacking
@@ -2044,7 +2214,7 @@ struct Parser
                     if(value == nullptr)
                         return nullptr;
 
-                    node->bases.push_back(this->arena.emplace<KeywordArgNode>(StringD(), value, kw_line, kw_column));
+                    bases.push_back(this->arena.emplace<KeywordArgNode>(StringD(), value, kw_line, kw_column));
                 }
                 else
                 {
@@ -2069,7 +2239,7 @@ struct Parser
                         base = this->arena.emplace<KeywordArgNode>(std::move(kw_name), value, kw_line, kw_column);
                     }
 
-                    node->bases.push_back(base);
+                    bases.push_back(base);
                 }
 
                 if(this->match_delimiter(Delimiter::Comma))
@@ -2078,14 +2248,14 @@ struct Parser
 
             if(!this->expect_delimiter(Delimiter::RParen))
                 return nullptr;
+
+            node->bases = this->make_list(bases);
         }
 
         if(!this->expect_delimiter(Delimiter::Colon))
             return nullptr;
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         return node;
@@ -2121,9 +2291,7 @@ struct Parser
 
         auto* node = arena.emplace<IfNode>(test, line, column);
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         this->skip_newlines();
@@ -2148,7 +2316,7 @@ struct Parser
             if(!this->parse_block(elif_node->body))
                 return nullptr;
 
-            node->orelse.push_back(elif_node);
+            node->orelse = this->make_single(elif_node);
             node = elif_node; // chain further elifs onto this node
 
             this->skip_newlines();
@@ -2185,9 +2353,7 @@ struct Parser
 
         auto* node = this->arena.emplace<WhileNode>(test, line, column);
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         this->skip_newlines();
@@ -2199,9 +2365,7 @@ struct Parser
             if(!this->expect_delimiter(Delimiter::Colon))
                 return nullptr;
 
-            if(!this->check(Token::Kind::Newline))
-                node->orelse.push_back(this->parse_statement());
-            else if(!this->parse_block(node->orelse))
+            if(!this->parse_suite(node->orelse))
                 return nullptr;
         }
 
@@ -2214,7 +2378,7 @@ struct Parser
         std::uint32_t column = this->current().column;
         this->advance();
 
-        Vector<Node*> targets;
+        auto targets = this->node_list();
 
         while(!this->at_end() && !this->match_keyword(Keyword::In))
         {
@@ -2245,11 +2409,9 @@ struct Parser
 
         auto* node = this->arena.emplace<ForNode>(iter, line, column);
 
-        node->targets = std::move(targets);
+        node->targets = this->make_list(targets);
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         this->skip_newlines();
@@ -2278,7 +2440,7 @@ struct Parser
         if(!this->expect_keyword(Keyword::For))
             return nullptr;
 
-        Vector<Node*> targets;
+        auto targets = this->node_list();
 
         while(!this->at_end() && !this->match_keyword(Keyword::In))
         {
@@ -2309,11 +2471,9 @@ struct Parser
 
         auto* node = this->arena.emplace<AsyncForNode>(iter, line, column);
 
-        node->targets = std::move(targets);
+        node->targets = this->make_list(targets);
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         this->skip_newlines();
@@ -2386,13 +2546,15 @@ struct Parser
             this->skip_whitespace_in_bracket();
         }
 
+        auto items = this->node_list();
+
         // Parse first item
         Node* item = this->parse_with_item();
 
         if(item == nullptr)
             return nullptr;
 
-        node->items.push_back(item);
+        items.push_back(item);
 
         // Parse remaining items
         while(this->match_delimiter(Delimiter::Comma))
@@ -2410,7 +2572,7 @@ struct Parser
             if(item == nullptr)
                 return nullptr;
 
-            node->items.push_back(item);
+            items.push_back(item);
         }
 
         if(parenthesized)
@@ -2421,12 +2583,12 @@ struct Parser
                 return nullptr;
         }
 
+        node->items = this->make_list(items);
+
         if(!this->expect_delimiter(Delimiter::Colon))
             return nullptr;
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         return node;
@@ -2453,13 +2615,15 @@ struct Parser
             this->skip_whitespace_in_bracket();
         }
 
+        auto items = this->node_list();
+
         // Parse first item
         Node* item = this->parse_with_item();
 
         if(item == nullptr)
             return nullptr;
 
-        node->items.push_back(item);
+        items.push_back(item);
 
         // Parse remaining items
         while(this->match_delimiter(Delimiter::Comma))
@@ -2477,7 +2641,7 @@ struct Parser
             if(item == nullptr)
                 return nullptr;
 
-            node->items.push_back(item);
+            items.push_back(item);
         }
 
         if(parenthesized)
@@ -2488,12 +2652,12 @@ struct Parser
                 return nullptr;
         }
 
+        node->items = this->make_list(items);
+
         if(!this->expect_delimiter(Delimiter::Colon))
             return nullptr;
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         return node;
@@ -2546,7 +2710,8 @@ struct Parser
             if(this->match_delimiter(Delimiter::Comma))
             {
                 auto* tup = this->arena.emplace<TupleNode>(value->line(), value->column());
-                tup->elts.push_back(value);
+                auto elts = this->node_list();
+                elts.push_back(value);
 
                 while(this->match_delimiter(Delimiter::Comma))
                 {
@@ -2560,9 +2725,11 @@ struct Parser
                     if(elt == nullptr)
                         return nullptr;
 
-                    tup->elts.push_back(elt);
+                    elts.push_back(elt);
                 }
 
+                tup->elts = this->make_list(elts);
+
                 value = tup;
             }
         }
@@ -2641,8 +2808,8 @@ struct Parser
             this->advance();
         }
 
-        Vector<StringD> names;
-        Vector<Node*> types;
+        auto names = this->string_list();
+        auto types = this->node_list();
 
         // Bare 'except:' (no type) — only valid without star
         if(!this->match_delimiter(Delimiter::Colon))
@@ -2665,18 +2832,17 @@ struct Parser
                     if(!this->check(Token::Kind::Identifier))
                     {
                         this->error_at_current("Expected name after 'as', got \"{}\"",
-                                            this->current().value);
+                                            this->current_value());
 
                         return nullptr;
                     }
 
-                    names.emplace_back(StringD::make_from_c_str(this->current().value.c_str(),
-                                                                this->current().value.size()));
+                    names.push_back(this->current_value());
 
                     this->advance();
                 } else {
                     // emplace empty name
-                    names.emplace_back(StringD());
+                    names.push_back(StringD());
                 }
 
                 if(this->match_delimiter(Delimiter::Comma))
@@ -2688,22 +2854,11 @@ struct Parser
             return nullptr;
 
         auto* handler = this->arena.emplace<ExceptNode>(is_star, line, column);
-        handler->types = std::move(types);
-        handler->names = std::move(names);
+        handler->types = this->make_list(types);
+        handler->names = this->make_list(names);
 
-        if(!this->check(Token::Kind::Newline))
-        {
-            Node* stmt = this->parse_statement();
-
-            if(stmt == nullptr)
-                return nullptr;
-
-            handler->body.push_back(stmt);
-        }
-        else if(!this->parse_block(handler->body))
-        {
+        if(!this->parse_suite(handler->body))
             return nullptr;
-        }
 
         return handler;
     }
@@ -2719,23 +2874,14 @@ struct Parser
 
         auto* node = this->arena.emplace<TryNode>(line, column);
 
-        if(!this->check(Token::Kind::Newline))
-        {
-            Node* stmt = this->parse_statement();
-
-            if(stmt == nullptr)
-                return nullptr;
-
-            node->body.push_back(stmt);
-        }
-        else if(!this->parse_block(node->body))
-        {
+        if(!this->parse_suite(node->body))
             return nullptr;
-        }
 
         this->skip_newlines();
 
         // except / except* handlers
+        auto excepts = this->node_list();
+
         while(!this->at_end() && this->match_keyword(Keyword::Except))
         {
             Node* handler = this->parse_except();
@@ -2743,11 +2889,13 @@ struct Parser
             if(handler == nullptr)
                 return nullptr;
 
-            node->excepts.push_back(handler);
+            excepts.push_back(handler);
 
             this->skip_newlines();
         }
 
+        node->excepts = this->make_list(excepts);
+
         // else block
         if(!this->at_end() && this->match_keyword(Keyword::Else))
         {
@@ -2756,19 +2904,8 @@ struct Parser
             if(!this->expect_delimiter(Delimiter::Colon))
                 return nullptr;
 
-            if(!this->check(Token::Kind::Newline))
-            {
-                Node* stmt = this->parse_statement();
-
-                if(stmt == nullptr)
-                    return nullptr;
-
-                node->orelse.push_back(stmt);
-            }
-            else if(!this->parse_block(node->orelse))
-            {
+            if(!this->parse_suite(node->orelse))
                 return nullptr;
-            }
 
             this->skip_newlines();
         }
@@ -2781,19 +2918,8 @@ struct Parser
             if(!this->expect_delimiter(Delimiter::Colon))
                 return nullptr;
 
-            if(!this->check(Token::Kind::Newline))
-            {
-                Node* stmt = this->parse_statement();
-
-                if(stmt == nullptr)
-                    return nullptr;
-
-                node->finalbody.push_back(stmt);
-            }
-            else if(!this->parse_block(node->finalbody))
-            {
+            if(!this->parse_suite(node->finalbody))
                 return nullptr;
-            }
         }
 
         if(node->excepts.empty() && node->finalbody.empty())
@@ -2812,6 +2938,7 @@ struct Parser
         this->advance();
 
         auto* node = this->arena.emplace<ImportNode>(line, column);
+        auto names = this->string_list();
 
         do
         {
@@ -2819,13 +2946,13 @@ struct Parser
             {
                 this->error(this->current().line,
                             this->current().column,
-                            static_cast<std::uint32_t>(this->current().value.size()),
+                            this->current().length,
                             "Expected module name");
 
                 return nullptr;
             }
 
-            StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+            StringD name = this->current_value();
             this->advance();
 
             // Handle dotted names: import os.path
@@ -2837,7 +2964,7 @@ struct Parser
                 {
                     this->error(this->current().line,
                                 this->current().column,
-                                static_cast<std::uint32_t>(this->current().value.size()),
+                                this->current().length,
                                 "Expected name after .");
 
                     return nullptr;
@@ -2860,21 +2987,24 @@ struct Parser
                 {
                     this->error(this->current().line,
                                 this->current().column,
-                                static_cast<std::uint32_t>(this->current().value.size()),
+                                this->current().length,
                                 "Expected alias");
 
                     return nullptr;
                 }
 
-                alias = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+                alias = this->current_value();
                 this->advance();
             }
 
-            node->names.push_back(std::move(name));
-            node->aliases.push_back(std::move(alias));
+            // Name and alias pairs, split once complete
+            names.push_back(name);
+            names.push_back(alias);
 
         } while(match_delimiter(Delimiter::Comma) && (this->advance(), true));
 
+        this->make_lists(names, node->names, node->aliases);
+
         return node;
     }
 
@@ -2888,29 +3018,30 @@ struct Parser
         {
             this->error(this->current().line,
                         this->current().column,
-                        static_cast<std::uint32_t>(this->current().value.size()),
+                        this->current().length,
                         "Expected module name or dotted import");
 
             return nullptr;
         }
 
-        const char* start = this->current().value.c_str();
-        std::size_t count = this->current().value.size();
+        const std::uint32_t start = this->current().offset;
+        std::uint32_t end = start + this->current().length;
 
         this->advance();
 
         while(!this->at_end() && (this->check(Token::Kind::Identifier) || this->match_delimiter(Delimiter::Dot)))
         {
-            count += this->current().value.size();
+            end = this->current().offset + this->current().length;
             this->advance();
         }
 
-        StringD module = std::move(StringD::make_from_c_str(start, count));
+        StringD module = std::move(StringD::make_from_c_str(this->source_code.data() + start, end - start));
 
         if(!this->expect_keyword(Keyword::Import))
             return nullptr;
 
         auto* node = this->arena.emplace<ImportFromNode>(std::move(module), line, column);
+        auto names = this->string_list();
 
         bool parenthesized = false;
 
@@ -2932,13 +3063,13 @@ struct Parser
             {
                 this->error(this->current().line,
                             this->current().column,
-                            static_cast<std::uint32_t>(this->current().value.size()),
+                            this->current().length,
                             "Expected name");
 
                 return nullptr;
             }
 
-            StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+            StringD name = this->current_value();
             this->advance();
 
             StringD alias;
@@ -2951,18 +3082,19 @@ struct Parser
                 {
                     this->error(this->current().line,
                                 this->current().column,
-                                static_cast<std::uint32_t>(this->current().value.size()),
+                                this->current().length,
                                 "Expected alias");
 
                     return nullptr;
                 }
 
-                alias = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+                alias = this->current_value();
                 this->advance();
             }
 
-            node->names.push_back(std::move(name));
-            node->aliases.push_back(std::move(alias));
+            // Name and alias pairs, split once complete
+            names.push_back(name);
+            names.push_back(alias);
 
         } while(this->match_delimiter(Delimiter::Comma) && (this->advance(), true));
 
@@ -2974,6 +3106,8 @@ struct Parser
                 return nullptr;
         }
 
+        this->make_lists(names, node->names, node->aliases);
+
         return node;
     }
 
@@ -3005,6 +3139,8 @@ struct Parser
 
         this->advance(); // skip indent
 
+        auto cases = this->node_list();
+
         while(!this->at_end())
         {
             this->skip_newlines();
@@ -3023,9 +3159,11 @@ struct Parser
             if(case_node == nullptr)
                 return nullptr;
 
-            node->cases.push_back(case_node);
+            cases.push_back(case_node);
         }
 
+        node->cases = this->make_list(cases);
+
         return node;
     }
 
@@ -3037,7 +3175,7 @@ struct Parser
         if(!this->match_soft_keyword("case"))
         {
             this->error_at_current("Expected 'case', got \"{}\"",
-                                   this->current().value);
+                                   this->current_value());
 
             return nullptr;
         }
@@ -3066,9 +3204,7 @@ struct Parser
 
         auto* node = this->arena.emplace<MatchCaseNode>(pattern, guard, line, column);
 
-        if(!this->check(Token::Kind::Newline))
-            node->body.push_back(this->parse_statement());
-        else if(!this->parse_block(node->body))
+        if(!this->parse_suite(node->body))
             return nullptr;
 
         return node;
@@ -3087,7 +3223,8 @@ struct Parser
             return left;
 
         auto* node = this->arena.emplace<MatchOrNode>(left->line(), left->column());
-        node->patterns.push_back(left);
+        auto patterns = this->node_list();
+        patterns.push_back(left);
 
         while(this->match_operator(Operator::BitwiseOr))
         {
@@ -3098,9 +3235,11 @@ struct Parser
             if(alt == nullptr)
                 return nullptr;
 
-            node->patterns.push_back(alt);
+            patterns.push_back(alt);
         }
 
+        node->patterns = this->make_list(patterns);
+
         return node;
     }
 
@@ -3120,13 +3259,12 @@ struct Parser
             if(!this->check(Token::Kind::Identifier))
             {
                 this->error_at_current("Expected name after 'as', got \"{}\"",
-                                       this->current().value);
+                                       this->current_value());
 
                 return nullptr;
             }
 
-            StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                              this->current().value.size()));
+            StringD name = std::move(this->current_value().copy());
             this->advance();
 
             return this->arena.emplace<MatchAsNode>(pattern, std::move(name),
@@ -3148,7 +3286,7 @@ struct Parser
         std::uint32_t column = this->current().column;
 
         // Wildcard: _
-        if(this->check(Token::Kind::Identifier) && this->current().value == "_")
+        if(this->check(Token::Kind::Identifier) && this->current_value() == "_")
         {
             this->advance();
             return this->arena.emplace<MatchAsNode>(nullptr, StringD(), line, column);
@@ -3163,10 +3301,9 @@ struct Parser
 
             if(this->check(Token::Kind::Identifier))
             {
-                if(this->current().value != "_")
+                if(this->current_value() != "_")
                 {
-                    name = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                              this->current().value.size()));
+                    name = std::move(this->current_value().copy());
                 }
 
                 this->advance();
@@ -3206,8 +3343,7 @@ struct Parser
             if(this->check(Token::Kind::Literal))
             {
                 auto* val = this->arena.emplace<ConstantNode>(
-                    std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                       this->current().value.size())),
+                    std::move(this->current_value().copy()),
                     static_cast<Literal>(this->current().type),
                     this->current().line,
                     this->current().column);
@@ -3236,8 +3372,7 @@ struct Parser
                     }
 
                     auto* imag = this->arena.emplace<ConstantNode>(
-                        std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                           this->current().value.size())),
+                        std::move(this->current_value().copy()),
                         static_cast<Literal>(this->current().type),
                         this->current().line,
                         this->current().column);
@@ -3266,6 +3401,7 @@ struct Parser
             this->advance();
 
             auto* node = this->arena.emplace<MatchSequenceNode>(line, column);
+            auto patterns = this->node_list();
 
             while(!this->at_end() && !this->match_delimiter(Delimiter::RBracket))
             {
@@ -3274,7 +3410,7 @@ struct Parser
                 if(pat == nullptr)
                     return nullptr;
 
-                node->patterns.push_back(pat);
+                patterns.push_back(pat);
 
                 if(this->match_delimiter(Delimiter::Comma))
                     this->advance();
@@ -3283,6 +3419,8 @@ struct Parser
             if(!this->expect_delimiter(Delimiter::RBracket))
                 return nullptr;
 
+            node->patterns = this->make_list(patterns);
+
             return node;
         }
 
@@ -3293,6 +3431,9 @@ struct Parser
 
             auto* node = this->arena.emplace<MatchMappingNode>(line, column);
 
+            // Key and pattern pairs, split once complete
+            auto pairs = this->node_list();
+
             while(!this->at_end() && !this->match_delimiter(Delimiter::RBrace))
             {
                 // **rest capture
@@ -3306,8 +3447,7 @@ struct Parser
                         return nullptr;
                     }
 
-                    node->rest = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                                    this->current().value.size()));
+                    node->rest = std::move(this->current_value().copy());
                     this->advance();
 
                     if(this->match_delimiter(Delimiter::Comma))
@@ -3329,8 +3469,8 @@ struct Parser
                 if(pat == nullptr)
                     return nullptr;
 
-                node->keys.push_back(key);
-                node->patterns.push_back(pat);
+                pairs.push_back(key);
+                pairs.push_back(pat);
 
                 if(this->match_delimiter(Delimiter::Comma))
                     this->advance();
@@ -3339,6 +3479,8 @@ struct Parser
             if(!this->expect_delimiter(Delimiter::RBrace))
                 return nullptr;
 
+            this->make_lists(pairs, node->keys, node->patterns);
+
             return node;
         }
 
@@ -3362,7 +3504,8 @@ struct Parser
             if(this->match_delimiter(Delimiter::Comma))
             {
                 auto* seq = this->arena.emplace<MatchSequenceNode>(line, column);
-                seq->patterns.push_back(first);
+                auto patterns = this->node_list();
+                patterns.push_back(first);
 
                 while(this->match_delimiter(Delimiter::Comma))
                 {
@@ -3376,12 +3519,14 @@ struct Parser
                     if(pat == nullptr)
                         return nullptr;
 
-                    seq->patterns.push_back(pat);
+                    patterns.push_back(pat);
                 }
 
                 if(!this->expect_delimiter(Delimiter::RParen))
                     return nullptr;
 
+                seq->patterns = this->make_list(patterns);
+
                 return seq;
             }
 
@@ -3395,8 +3540,7 @@ struct Parser
         // Identifier: capture pattern, value pattern (dotted), or class pattern
         if(this->check(Token::Kind::Identifier))
         {
-            StringD name = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                              this->current().value.size()));
+            StringD name = std::move(this->current_value().copy());
             this->advance();
 
             // Dotted name: Color.RED, module.Class.CONST
@@ -3415,8 +3559,7 @@ struct Parser
                         return nullptr;
                     }
 
-                    StringD attr = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                                      this->current().value.size()));
+                    StringD attr = std::move(this->current_value().copy());
                     this->advance();
 
                     dotted = this->arena.emplace<AttributeNode>(dotted, std::move(attr),
@@ -3442,7 +3585,7 @@ struct Parser
         }
 
         this->error_at_current("Unexpected token \"{}\" ({}) in pattern",
-                               this->current().value,
+                               this->current_value(),
                                this->current().kind);
 
         return nullptr;
@@ -3454,6 +3597,10 @@ struct Parser
 
         auto* node = this->arena.emplace<MatchClassNode>(cls, line, column);
 
+        // Positional patterns, then keyword patterns
+        auto patterns = this->node_list();
+        auto kwd_attrs = this->string_list();
+
         while(!this->at_end() && !this->match_delimiter(Delimiter::RParen))
         {
             // Check for keyword pattern: attr=pattern
@@ -3462,8 +3609,7 @@ struct Parser
                this->tokens[this->pos + 1].kind == Token::Kind::Operator &&
                static_cast<Operator>(this->tokens[this->pos + 1].type) == Operator::Assign)
             {
-                StringD attr = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                                  this->current().value.size()));
+                StringD attr = this->current_value();
                 this->advance(2); // skip name and '='
 
                 Node* pat = this->parse_match_pattern();
@@ -3471,18 +3617,24 @@ struct Parser
                 if(pat == nullptr)
                     return nullptr;
 
-                node->kwd_attrs.push_back(std::move(attr));
-                node->kwd_patterns.push_back(pat);
+                kwd_attrs.push_back(attr);
+                patterns.push_back(pat);
             }
             else
             {
+                if(!kwd_attrs.empty())
+                {
+                    this->error_at_current("Positional patterns follow keyword patterns");
+                    return nullptr;
+                }
+
                 // Positional pattern
                 Node* pat = this->parse_match_pattern();
 
                 if(pat == nullptr)
                     return nullptr;
 
-                node->patterns.push_back(pat);
+                patterns.push_back(pat);
             }
 
             if(this->match_delimiter(Delimiter::Comma))
@@ -3492,13 +3644,21 @@ struct Parser
         if(!this->expect_delimiter(Delimiter::RParen))
             return nullptr;
 
+        const std::size_t num_positional = patterns.size() - kwd_attrs.size();
+
+        node->patterns = this->make_array(patterns, 0, num_positional, 1);
+        node->kwd_patterns = this->make_array(patterns, num_positional, patterns.size(), 1);
+        node->kwd_attrs = this->make_list(kwd_attrs);
+
         return node;
     }
 
     // Comprehension clauses
 
-    bool parse_comp_clauses(Vector<Node*>& generators) noexcept
+    bool parse_comp_clauses(NodeList& generators) noexcept
     {
+        auto comprehensions = this->node_list();
+
         while(!this->at_end() && (this->match_keyword(Keyword::For) || this->match_keyword(Keyword::Async)))
         {
             std::uint32_t comp_line = this->current().line;
@@ -3528,7 +3688,8 @@ struct Parser
             if(this->match_delimiter(Delimiter::Comma))
             {
                 auto* tup = this->arena.emplace<TupleNode>(target->line(), target->column());
-                tup->elts.push_back(target);
+                auto elts = this->node_list();
+                elts.push_back(target);
 
                 while(this->match_delimiter(Delimiter::Comma))
                 {
@@ -3542,9 +3703,11 @@ struct Parser
                     if(elt == nullptr)
                         return false;
 
-                    tup->elts.push_back(elt);
+                    elts.push_back(elt);
                 }
 
+                tup->elts = this->make_list(elts);
+
                 target = tup;
             }
 
@@ -3557,7 +3720,7 @@ struct Parser
             if(iter == nullptr)
                 return false;
 
-            Vector<Node*> ifs;
+            auto ifs = this->node_list();
 
             // Zero or more 'if' filters
             while(!this->at_end() && this->match_keyword(Keyword::If))
@@ -3575,18 +3738,20 @@ struct Parser
             if(is_async)
             {
                 auto* comp = this->arena.emplace<AsyncComprehensionNode>(target, iter, comp_line, comp_column);
-                comp->ifs = std::move(ifs);
-                generators.push_back(comp);
+                comp->ifs = this->make_list(ifs);
+                comprehensions.push_back(comp);
             }
             else
             {
                 auto* comp = this->arena.emplace<ComprehensionNode>(target, iter, comp_line, comp_column);
-                comp->ifs = std::move(ifs);
-                generators.push_back(comp);
+                comp->ifs = this->make_list(ifs);
+                comprehensions.push_back(comp);
             }
 
         }
 
+        generators = this->make_list(comprehensions);
+
         return !generators.empty();
     }
 
@@ -3627,7 +3792,8 @@ struct Parser
                 if(this->match_delimiter(Delimiter::Comma))
                 {
                     auto* tup = this->arena.emplace<TupleNode>(value->line(), value->column());
-                    tup->elts.push_back(value);
+                    auto elts = this->node_list();
+                    elts.push_back(value);
 
                     while(this->match_delimiter(Delimiter::Comma))
                     {
@@ -3641,9 +3807,11 @@ struct Parser
                         if(elt == nullptr)
                             return nullptr;
 
-                        tup->elts.push_back(elt);
+                        elts.push_back(elt);
                     }
 
+                    tup->elts = this->make_list(elts);
+
                     value = tup;
                 }
             }
@@ -3651,7 +3819,7 @@ struct Parser
             return  this->arena.emplace<AnnAssignNode>(left, value, annotation, line, column);
         }
 
-        Vector<Node*> targets;
+        auto targets = this->node_list();
         targets.push_back(left);
 
         // Simple assignment: target = value
@@ -3670,13 +3838,13 @@ struct Parser
                     if(!this->check(Token::Kind::Identifier))
                     {
                         this->error_at_current("Expecting identifier, not \"{}\" ({})",
-                                               this->current().value,
+                                               this->current_value(),
                                                this->current().kind);
 
                         return nullptr;
                     }
 
-                    auto* target = this->arena.emplace<NameNode>(this->current().value,
+                    auto* target = this->arena.emplace<NameNode>(this->current_value().copy(),
                                                                  this->current().line,
                                                                  this->current().column);
 
@@ -3699,7 +3867,8 @@ struct Parser
             if(this->match_delimiter(Delimiter::Comma))
             {
                 auto* tup = this->arena.emplace<TupleNode>(value->line(), value->column());
-                tup->elts.push_back(value);
+                auto elts = this->node_list();
+                elts.push_back(value);
 
                 while(this->match_delimiter(Delimiter::Comma))
                 {
@@ -3713,15 +3882,17 @@ struct Parser
                     if(elt == nullptr)
                         return nullptr;
 
-                    tup->elts.push_back(elt);
+                    elts.push_back(elt);
                 }
 
+                tup->elts = this->make_list(elts);
+
                 value = tup;
             }
 
             auto* node = this->arena.emplace<AssignNode>(value, line, column);
 
-            node->targets = std::move(targets);
+            node->targets = this->make_list(targets);
 
             return node;
         }
@@ -3749,7 +3920,7 @@ struct Parser
             if(this->at_end() || this->check(Token::Kind::Newline))
             {
                 TupleNode* tup = this->arena.emplace<TupleNode>(line, column);
-                tup->elts = std::move(targets);
+                tup->elts = this->make_list(targets);
                 return tup;
             }
 
@@ -3757,7 +3928,7 @@ struct Parser
             if(!this->match_operator(Operator::Assign))
             {
                 this->error_at_current("Expected '=' in multi-assignment, got \"{}\"",
-                                       this->current().value);
+                                       this->current_value());
 
                 return nullptr;
             }
@@ -3765,7 +3936,7 @@ struct Parser
             this->advance(); // skip '='
 
             // Parse values
-            Vector<Node*> values;
+            auto values = this->node_list();
 
             while(!this->at_end() && !this->check(Token::Kind::Newline))
             {
@@ -3789,8 +3960,8 @@ struct Parser
             }
 
             auto* assign = this->arena.emplace<MultiAssignNode>(line, column);
-            assign->targets = std::move(targets);
-            assign->values = std::move(values);
+            assign->values = this->make_list(values);
+            assign->targets = this->make_list(targets);
 
             return assign;
         }
@@ -3817,7 +3988,8 @@ struct Parser
         if(this->match_delimiter(Delimiter::Comma))
         {
             auto* tup = this->arena.emplace<TupleNode>(left->line(), left->column());
-            tup->elts.push_back(left);
+            auto elts = this->node_list();
+            elts.push_back(left);
 
             while(this->match_delimiter(Delimiter::Comma))
             {
@@ -3831,9 +4003,11 @@ struct Parser
                 if(elt == nullptr)
                     return nullptr;
 
-                tup->elts.push_back(elt);
+                elts.push_back(elt);
             }
 
+            tup->elts = this->make_list(elts);
+
             return this->arena.emplace<ExprNode>(tup, line, column);
         }
 
@@ -3969,7 +4143,8 @@ struct Parser
         if(this->match_delimiter(Delimiter::Comma))
         {
             auto* tup = this->arena.emplace<TupleNode>(value->line(), value->column());
-            tup->elts.push_back(value);
+            auto elts = this->node_list();
+            elts.push_back(value);
 
             while(this->match_delimiter(Delimiter::Comma))
             {
@@ -3989,9 +4164,11 @@ struct Parser
                 if(elt == nullptr)
                     return nullptr;
 
-                tup->elts.push_back(elt);
+                elts.push_back(elt);
             }
 
+            tup->elts = this->make_list(elts);
+
             value = tup;
         }
 
@@ -4015,8 +4192,7 @@ struct Parser
                 return nullptr;
 
             auto* node = this->arena.emplace<BoolOpNode>(Operator::LogicalOr, left->line(), left->column());
-            node->values.push_back(left);
-            node->values.push_back(right);
+            node->values = this->make_pair(left, right);
             left = node;
         }
 
@@ -4040,8 +4216,7 @@ struct Parser
                 return nullptr;
 
             auto* node = this->arena.emplace<BoolOpNode>(Operator::LogicalAnd, left->line(), left->column());
-            node->values.push_back(left);
-            node->values.push_back(right);
+            node->values = this->make_pair(left, right);
             left = node;
         }
 
@@ -4145,9 +4320,12 @@ struct Parser
 
         auto* node = arena.emplace<CompareOp>(left, left->line(), left->column());
 
+        auto ops = this->operator_list();
+        auto comparators = this->node_list();
+
         while(match_cmp_op(op, skip))
         {
-            node->ops.push_back(op);
+            ops.push_back(op);
             this->advance(skip);
 
             Node* right = this->parse_bitor();
@@ -4155,9 +4333,12 @@ struct Parser
             if(right == nullptr)
                 return nullptr;
 
-            node->comparators.push_back(right);
+            comparators.push_back(right);
         }
 
+        node->comparators = this->make_list(comparators);
+        node->ops = this->make_list(ops);
+
         return node;
     }
 
@@ -4439,6 +4620,7 @@ struct Parser
                 this->advance();
 
                 auto* call = this->arena.emplace<CallNode>(node, node->line(), node->column());
+                auto args = this->node_list();
 
                 while(!this->at_end() && !this->match_delimiter(Delimiter::RParen))
                 {
@@ -4460,7 +4642,7 @@ struct Parser
                             return nullptr;
 
                         auto* kwarg = this->arena.emplace<KeywordArgNode>(StringD(), value, kw_line, kw_column);
-                        call->args.push_back(kwarg);
+                        args.push_back(kwarg);
                     }
                     else
                     {
@@ -4496,7 +4678,7 @@ struct Parser
                             arg = genexpr;
                         }
 
-                        call->args.push_back(arg);
+                        args.push_back(arg);
                     }
 
                     if(this->match_delimiter(Delimiter::Comma))
@@ -4508,6 +4690,7 @@ struct Parser
                 if(!this->expect_delimiter(Delimiter::RParen))
                     return nullptr;
 
+                call->args = this->make_list(args);
                 node = call;
             }
             else if(this->match_delimiter(Delimiter::LBracket))
@@ -4524,7 +4707,8 @@ struct Parser
                 if(this->match_delimiter(Delimiter::Comma))
                 {
                     auto* tup = this->arena.emplace<TupleNode>(first->line(), first->column());
-                    tup->elts.push_back(first);
+                    auto elts = this->node_list();
+                    elts.push_back(first);
 
                     while(this->match_delimiter(Delimiter::Comma))
                     {
@@ -4539,9 +4723,11 @@ struct Parser
                         if(elt == nullptr)
                             return nullptr;
 
-                        tup->elts.push_back(elt);
+                        elts.push_back(elt);
                     }
 
+                    tup->elts = this->make_list(elts);
+
                     this->skip_whitespace_in_bracket();
 
                     if(!this->expect_delimiter(Delimiter::RBracket))
@@ -4567,13 +4753,13 @@ struct Parser
                 {
                     this->error(this->current().line,
                                 this->current().column,
-                                static_cast<std::uint32_t>(this->current().value.size()),
+                                this->current().length,
                                 "Expected attribute name");
 
                     return nullptr;
                 }
 
-                StringD attr = std::move(StringD::make_from_c_str(this->current().value.c_str(), this->current().value.size()));
+                StringD attr = std::move(this->current_value().copy());
                 this->advance();
 
                 node = this->arena.emplace<AttributeNode>(node, std::move(attr), node->line(), node->column());
@@ -4626,7 +4812,8 @@ struct Parser
         if(this->match_delimiter(Delimiter::Comma))
         {
             auto* tup = this->arena.emplace<TupleNode>(first->line(), first->column());
-            tup->elts.push_back(first);
+            auto elts = this->node_list();
+            elts.push_back(first);
 
             while(this->match_delimiter(Delimiter::Comma))
             {
@@ -4641,9 +4828,11 @@ struct Parser
                 if(elt == nullptr)
                     return nullptr;
 
-                tup->elts.push_back(elt);
+                elts.push_back(elt);
             }
 
+            tup->elts = this->make_list(elts);
+
             this->skip_whitespace_in_bracket();
 
             if(!this->expect_delimiter(Delimiter::RParen))
@@ -4691,7 +4880,7 @@ struct Parser
                             return nullptr;
                         }
 
-                        literal->raw.appends(this->current().value);
+                        literal->raw.appends(this->current_value());
 
                         this->advance();
                     }
@@ -4724,8 +4913,7 @@ struct Parser
                         return nullptr;
                     }
 
-                    StringD attr = std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                                      this->current().value.size()));
+                    StringD attr = std::move(this->current_value().copy());
                     this->advance();
 
                     first = this->arena.emplace<AttributeNode>(first, std::move(attr), first->line(), first->column());
@@ -4735,6 +4923,7 @@ struct Parser
                     this->advance();
 
                     auto* call = this->arena.emplace<CallNode>(first, first->line(), first->column());
+                    auto args = this->node_list();
 
                     while(!this->at_end() && !this->match_delimiter(Delimiter::RParen))
                     {
@@ -4754,7 +4943,7 @@ struct Parser
                             if(value == nullptr)
                                 return nullptr;
 
-                            call->args.push_back(this->arena.emplace<KeywordArgNode>(StringD(), value, kw_line, kw_column));
+                            args.push_back(this->arena.emplace<KeywordArgNode>(StringD(), value, kw_line, kw_column));
                         }
                         else
                         {
@@ -4778,7 +4967,7 @@ struct Parser
                                 arg = this->arena.emplace<KeywordArgNode>(std::move(kw_name), value, kw_line, kw_column);
                             }
 
-                            call->args.push_back(arg);
+                            args.push_back(arg);
                         }
 
                         if(this->match_delimiter(Delimiter::Comma))
@@ -4790,6 +4979,7 @@ struct Parser
                     if(!this->expect_delimiter(Delimiter::RParen))
                         return nullptr;
 
+                    call->args = this->make_list(args);
                     first = call;
                 }
                 else if(this->match_delimiter(Delimiter::LBracket))
@@ -4866,7 +5056,8 @@ struct Parser
 
         // Regular list literal
         auto* node = this->arena.emplace<ListNode>(line, column);
-        node->elts.push_back(first);
+        auto elts = this->node_list();
+        elts.push_back(first);
 
         while(this->match_delimiter(Delimiter::Comma))
         {
@@ -4881,7 +5072,7 @@ struct Parser
             if(elt == nullptr)
                 return nullptr;
 
-            node->elts.push_back(elt);
+            elts.push_back(elt);
         }
 
         this->skip_whitespace_in_bracket();
@@ -4889,6 +5080,8 @@ struct Parser
         if(!this->expect_delimiter(Delimiter::RBracket))
             return nullptr;
 
+        node->elts = this->make_list(elts);
+
         return node;
     }
 
@@ -4938,11 +5131,8 @@ struct Parser
         if(val == nullptr)
             return nullptr;
 
-        auto* node = this->arena.emplace<DictNode>(line, column);
-        node->keys.push_back(nullptr);
-        node->values.push_back(val);
-
-        return this->parse_dict_remaining(node);
+        // Unpacked mappings have a null key
+        return this->parse_dict_remaining(this->arena.emplace<DictNode>(line, column), nullptr, val);
     }
 
     Node* parse_dict_after_first_key(Node* first_key, std::uint32_t line, std::uint32_t column) noexcept
@@ -4971,15 +5161,16 @@ struct Parser
         }
 
         // Regular dict literal
-        auto* node = this->arena.emplace<DictNode>(line, column);
-        node->keys.push_back(first_key);
-        node->values.push_back(value);
-
-        return this->parse_dict_remaining(node);
+        return this->parse_dict_remaining(this->arena.emplace<DictNode>(line, column), first_key, value);
     }
 
-    Node* parse_dict_remaining(DictNode* node) noexcept
+    Node* parse_dict_remaining(DictNode* node, Node* first_key, Node* first_value) noexcept
     {
+        // Keys and values, interleaved
+        auto pairs = this->node_list();
+        pairs.push_back(first_key);
+        pairs.push_back(first_value);
+
         while(this->match_delimiter(Delimiter::Comma))
         {
             this->advance();
@@ -4998,8 +5189,8 @@ struct Parser
                 if(val == nullptr)
                     return nullptr;
 
-                node->keys.push_back(nullptr);
-                node->values.push_back(val);
+                pairs.push_back(nullptr);
+                pairs.push_back(val);
                 continue;
             }
 
@@ -5016,8 +5207,8 @@ struct Parser
             if(val == nullptr)
                 return nullptr;
 
-            node->keys.push_back(key);
-            node->values.push_back(val);
+            pairs.push_back(key);
+            pairs.push_back(val);
         }
 
         this->skip_whitespace_in_bracket();
@@ -5025,6 +5216,8 @@ struct Parser
         if(!this->expect_delimiter(Delimiter::RBrace))
             return nullptr;
 
+        this->make_lists(pairs, node->keys, node->values);
+
         return node;
     }
 
@@ -5046,7 +5239,8 @@ struct Parser
     Node* parse_set_literal(Node* first, std::uint32_t line, std::uint32_t column) noexcept
     {
         auto* node = this->arena.emplace<SetNode>(line, column);
-        node->elts.push_back(first);
+        auto elts = this->node_list();
+        elts.push_back(first);
 
         while(this->match_delimiter(Delimiter::Comma))
         {
@@ -5061,7 +5255,7 @@ struct Parser
             if(elt == nullptr)
                 return nullptr;
 
-            node->elts.push_back(elt);
+            elts.push_back(elt);
         }
 
         this->skip_whitespace_in_bracket();
@@ -5069,6 +5263,8 @@ struct Parser
         if(!this->expect_delimiter(Delimiter::RBrace))
             return nullptr;
 
+        node->elts = this->make_list(elts);
+
         return node;
     }
 
@@ -5078,7 +5274,7 @@ struct Parser
         {
             this->error((this->tokens.end() - 1)->line,
                         (this->tokens.end() - 1)->column,
-                        static_cast<std::uint32_t>((this->tokens.end() - 1)->value.size()),
+                        (this->tokens.end() - 1)->length,
                         "Unexpected end of input");
 
             return nullptr;
@@ -5103,8 +5299,7 @@ struct Parser
         if(this->check(Token::Kind::Identifier))
         {
             auto* node = this->arena.emplace<NameNode>(
-                std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                   this->current().value.size())),
+                std::move(this->current_value().copy()),
                 this->current().line,
                 this->current().column);
 
@@ -5119,8 +5314,7 @@ struct Parser
             Literal lit = static_cast<Literal>(this->current().type);
 
             auto* node = this->arena.emplace<ConstantNode>(
-                std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                   this->current().value.size())),
+                std::move(this->current_value().copy()),
                 lit,
                 this->current().line,
                 this->current().column);
@@ -5136,8 +5330,7 @@ struct Parser
            this->match_keyword(Keyword::None))
         {
             auto* node = this->arena.emplace<ConstantNode>(
-                std::move(StringD::make_from_c_str(this->current().value.c_str(),
-                                                   this->current().value.size())),
+                std::move(this->current_value().copy()),
                 Literal::String,
                 this->current().line,
                 this->current().column);
@@ -5169,7 +5362,7 @@ struct Parser
                 if(!this->expect_delimiter(Delimiter::Dot))
                 {
                     this->error_at_current("Unexpected token \"{}\" ({})",
-                                           this->current().value,
+                                           this->current_value(),
                                            this->current().kind);
 
                     return nullptr;
@@ -5180,20 +5373,28 @@ struct Parser
         }
 
         this->error_at_current("Unexpected token \"{}\" ({})",
-                               this->current().value,
+                               this->current_value(),
                                this->current().kind);
 
         return nullptr;
     }
 };
 
-bool AST::parse(const StringD& source_code, const Vector<Token>& tokens, bool debug) noexcept
+// Parses the tokens into a module allocated in arena. On error, root holds the statements parsed
+// before the error
+
+static bool parse_module(const StringD& source_code,
+                         const Vector<Token>& tokens,
+                         Arena& arena,
+                         std::shared_ptr<spdlog::logger>& logger,
+                         const bool debug,
+                         ModuleNode*& root) noexcept
 {
-    this->_logger->trace("Parsing tokens");
+    logger->trace("Parsing tokens");
 
-    Parser parser(tokens, this->_nodes, this->_logger, source_code);
+    Parser parser(tokens, arena, logger, source_code);
 
-    this->_root = parser.arena.emplace<ModuleNode>();
+    root = parser.arena.emplace<ModuleNode>();
 
     // Helper to extract a source line by line number
     auto get_source_line = [&](std::uint32_t line_num) -> StringD
@@ -5232,6 +5433,8 @@ bool AST::parse(const StringD& source_code, const Vector<Token>& tokens, bool de
         return end_line;
     };
 
+    auto body = parser.node_list();
+
     while(!parser.at_end())
     {
         parser.skip_newlines();
@@ -5242,39 +5445,49 @@ bool AST::parse(const StringD& source_code, const Vector<Token>& tokens, bool de
         Node* stmt = parser.parse_statement();
 
         if(stmt == nullptr)
+        {
+            root->body = parser.make_list(body);
             return false;
+        }
 
         if(debug)
         {
             std::uint32_t start_line = stmt->line();
             std::uint32_t end_line = get_end_line(stmt);
 
-            this->_logger->debug("{0:─^{1}}", "", 60);
+            logger->debug("{0:─^{1}}", "", 60);
 
             for(std::uint32_t l = start_line; l <= end_line; l++)
             {
                 StringD src = get_source_line(l);
-                this->_logger->debug("{:>4} │ {}", l, src);
+                logger->debug("{:>4} │ {}", l, src);
             }
 
-            this->_logger->debug("{0: ^{1}}", "", 60);
+            logger->debug("{0: ^{1}}", "", 60);
 
             visit(stmt, [&](Node* node, std::uint32_t depth) -> bool {
-                node->debug(this->_logger, depth * 2);
+                node->debug(logger, depth * 2);
                 return true;
             });
         }
 
-        this->_root->body.push_back(stmt);
+        body.push_back(stmt);
 
         parser.skip_semicolons();
     }
 
-    this->_logger->trace("Parsing successful");
+    root->body = parser.make_list(body);
+
+    logger->trace("Parsing successful");
 
     return true;
 }
 
+bool AST::parse(const StringD& source_code, const Vector<Token>& tokens, bool debug) noexcept
+{
+    return parse_module(source_code, tokens, this->_nodes, this->_logger, debug, this->_root);
+}
+
 //
 bool AST::from_text(const StringD& source_code, const bool debug) noexcept
 {
@@ -5293,7 +5506,7 @@ bool AST::from_text(const StringD& source_code, const bool debug) noexcept
         for(const auto& token : tokens)
             this->_logger->debug("{} \"{}\" ({}:{})",
                                  Token::kind_as_string(token.kind),
-                                 token.value,
+                                 token.value(source_code.data()),
                                  token.line,
                                  token.column);
 
@@ -5319,7 +5532,156 @@ bool AST::from_text(const StringD& source_code, const bool debug) noexcept
     return true;
 }
 
-void node_children(Node* node, Vector<Node*>& out) noexcept
+// Batch parsing
+
+// Appends the messages logged by a worker to the diagnostics of the file it is parsing
+class DiagnosticsSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>
+{
+public:
+    StringD* target = nullptr;
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override
+    {
+        if(this->target == nullptr)
+            return;
+
+        spdlog::memory_buf_t formatted;
+        this->formatter_->format(msg, formatted);
+
+        this->target->appendc(formatted.data(), formatted.size());
+    }
+
+    void flush_() override {}
+};
+
+struct ASTBatch_
+{
+    static void parse_file(ParsedFile& file,
+                           Arena& arena,
+                           Vector<Token>& tokens,
+                           std::shared_ptr<spdlog::logger>& logger) noexcept
+    {
+        Expected<StringD> content = fs::load_file_content(file.path);
+
+        if(!content.has_value())
+        {
+            logger->error("Cannot read file: {}", content.error().message);
+            return;
+        }
+
+        const StringD& source_code = content.value();
+
+        tokens.clear();
+
+        Lexer lexer(source_code.c_str(), logger);
+
+        if(!lexer.tokenize(tokens))
+            return;
+
+        file.success = parse_module(source_code, tokens, arena, logger, false, file.root);
+    }
+
+    // Files are pulled from a shared counter, so the workers balance themselves
+    static void parse_worker(ASTBatch* batch, std::size_t worker, Atomic<std::size_t>* next) noexcept
+    {
+        auto sink = std::make_shared<DiagnosticsSink>();
+        sink->set_pattern("%v");
+
+        auto logger = std::make_shared<spdlog::logger>(fmt::format("python_batch_{}", worker), sink);
+        logger->set_level(spdlog::level::warn);
+
+        Vector<Token> tokens;
+
+        while(true)
+        {
+            const std::size_t i = next->fetch_add(1, MemoryOrder::Relaxed);
+
+            if(i >= batch->_files.size())
+                break;
+
+            ParsedFile& file = batch->_files[i];
+
+            sink->target = &file.diagnostics;
+
+            ASTBatch_::parse_file(file, batch->_arenas[worker], tokens, logger);
+        }
+    }
+};
+
+bool ASTBatch::parse_files(const Vector<StringD>& paths) noexcept
+{
+    this->_files.clear();
+    this->_num_errors = 0;
+
+    for(const StringD& path : paths)
+    {
+        ParsedFile file;
+        file.path = path.is_ref() ? path.copy() : path;
+
+        this->_files.push_back(std::move(file));
+    }
+
+    const std::size_t num_workers = std::min(global_threadpool().num_workers(), this->_files.size());
+
+    if(num_workers > this->_num_arenas)
+    {
+        this->_arenas.reset(new Arena[num_workers]);
+        this->_num_arenas = num_workers;
+    }
+    else
+    {
+        for(std::size_t i = 0; i < this->_num_arenas; ++i)
+            this->_arenas[i].clear();
+    }
+
+    Atomic<std::size_t> next(0);
+
+    ThreadPoolWaiter waiter;
+
+    for(std::size_t w = 0; w < num_workers; ++w)
+    {
+        global_threadpool().add_work([this, w, &next]() {
+            ASTBatch_::parse_worker(this, w, &next);
+        }, &waiter);
+    }
+
+    waiter.wait();
+
+    for(const ParsedFile& file : this->_files)
+        this->_num_errors += file.success ? 0 : 1;
+
+    return this->_num_errors == 0;
+}
+
+bool ASTBatch::parse_tree(const StringD& path) noexcept
+{
+    if(!fs::path_exists(path))
+    {
+        this->_files.clear();
+        this->_num_errors = 0;
+
+        return false;
+    }
+
+    Vector<StringD> paths;
+
+    for(fs::WalkIterator it(path, fs::WalkFlags_ListFiles | fs::WalkFlags_Recursive); it != fs::WalkIterator(); ++it)
+    {
+        const StringD& file_path = it->get_current_path();
+
+        if(file_path.endswith(".py"))
+            paths.push_back(file_path.is_ref() ? file_path.copy() : file_path);
+    }
+
+    return this->parse_files(paths);
+}
+
+// Calls on_node(child) for each single child field of a node (null if absent), and
+// on_list(children) for each list of children, in traversal order
+
+template<typename OnNode, typename OnList>
+static void for_each_child_field(Node* node, OnNode&& on_node, OnList&& on_list) noexcept
 {
     if(node == nullptr)
         return;
@@ -5329,328 +5691,328 @@ void node_children(Node* node, Vector<Node*>& out) noexcept
         case ASTNodeModule:
         {
             auto* n = static_cast<ModuleNode*>(node);
-            for(auto* c : n->body) out.push_back(c);
+            on_list(n->body);
             break;
         }
         case ASTNodeDecorator:
         {
             auto* n = static_cast<DecoratorNode*>(node);
-            if(n->expr) out.push_back(n->expr);
-            if(n->target) out.push_back(n->target);
+            on_node(n->expr);
+            on_node(n->target);
             break;
         }
         case ASTNodeFunctionArg:
         {
             auto* n = static_cast<FunctionArgNode*>(node);
-            if(n->annotation != nullptr) out.push_back(n->annotation);
-            if(n->default_value != nullptr) out.push_back(n->default_value);
+            on_node(n->annotation);
+            on_node(n->default_value);
             break;
         }
         case ASTNodeFunctionDef:
         {
             auto* n = static_cast<FunctionDefNode*>(node);
-            for(auto* c : n->args) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
-            if(n->return_annotation) out.push_back(n->return_annotation);
-            for(auto* c : n->type_params) out.push_back(c);
+            on_list(n->args);
+            on_list(n->body);
+            on_node(n->return_annotation);
+            on_list(n->type_params);
             break;
         }
         case ASTNodeAsyncFunctionDef:
         {
             auto* n = static_cast<AsyncFunctionDefNode*>(node);
-            for(auto* c : n->args) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
-            if(n->return_annotation) out.push_back(n->return_annotation);
-            for(auto* c : n->type_params) out.push_back(c);
+            on_list(n->args);
+            on_list(n->body);
+            on_node(n->return_annotation);
+            on_list(n->type_params);
             break;
         }
         case ASTNodeClassDef:
         {
             auto* n = static_cast<ClassDefNode*>(node);
-            for(auto* c : n->bases) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
-            for(auto* c : n->type_params) out.push_back(c);
+            on_list(n->bases);
+            on_list(n->body);
+            on_list(n->type_params);
             break;
         }
         case ASTNodeReturn:
         {
             auto* n = static_cast<ReturnNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeAssign:
         {
             auto* n = static_cast<AssignNode*>(node);
-            for(auto* c : n->targets) out.push_back(c);
-            if(n->value) out.push_back(n->value);
+            on_list(n->targets);
+            on_node(n->value);
             break;
         }
         case ASTNodeAnnAssign:
         {
             auto* n = static_cast<AnnAssignNode*>(node);
-            if(n->target) out.push_back(n->target);
-            if(n->value) out.push_back(n->value);
-            if(n->ann) out.push_back(n->ann);
+            on_node(n->target);
+            on_node(n->value);
+            on_node(n->ann);
             break;
         }
         case ASTNodeMultiAssign:
         {
             auto* n = static_cast<MultiAssignNode*>(node);
-            for(auto* t : n->targets) out.push_back(t);
-            for(auto* v : n->values) out.push_back(v);
+            on_list(n->targets);
+            on_list(n->values);
             break;
         }
         case ASTNodeAugAssign:
         {
             auto* n = static_cast<AugAssignNode*>(node);
-            if(n->target) out.push_back(n->target);
-            if(n->value) out.push_back(n->value);
+            on_node(n->target);
+            on_node(n->value);
             break;
         }
         case ASTNodeWalrusAssign:
         {
             auto* n = static_cast<WalrusAssignNode*>(node);
-            if(n->target) out.push_back(n->target);
-            if(n->value) out.push_back(n->value);
+            on_node(n->target);
+            on_node(n->value);
             break;
         }
         case ASTNodeFor:
         {
             auto* n = static_cast<ForNode*>(node);
-            if(n->iter) out.push_back(n->iter);
-            for(auto* c : n->targets) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
-            for(auto* c : n->orelse) out.push_back(c);
+            on_node(n->iter);
+            on_list(n->targets);
+            on_list(n->body);
+            on_list(n->orelse);
             break;
         }
         case ASTNodeAsyncFor:
         {
             auto* n = static_cast<AsyncForNode*>(node);
-            if(n->iter) out.push_back(n->iter);
-            for(auto* c : n->targets) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
-            for(auto* c : n->orelse) out.push_back(c);
+            on_node(n->iter);
+            on_list(n->targets);
+            on_list(n->body);
+            on_list(n->orelse);
             break;
         }
         case ASTNodeWhile:
         {
             auto* n = static_cast<WhileNode*>(node);
-            if(n->test) out.push_back(n->test);
-            for(auto* c : n->body) out.push_back(c);
-            for(auto* c : n->orelse) out.push_back(c);
+            on_node(n->test);
+            on_list(n->body);
+            on_list(n->orelse);
             break;
         }
         case ASTNodeIf:
         {
             auto* n = static_cast<IfNode*>(node);
-            if(n->test) out.push_back(n->test);
-            for(auto* c : n->body) out.push_back(c);
-            for(auto* c : n->orelse) out.push_back(c);
+            on_node(n->test);
+            on_list(n->body);
+            on_list(n->orelse);
             break;
         }
         case ASTNodeExpr:
         {
             auto* n = static_cast<ExprNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeRaise:
         {
             auto* n = static_cast<RaiseNode*>(node);
-            if(n->exc) out.push_back(n->exc);
-            if(n->cause) out.push_back(n->cause);
+            on_node(n->exc);
+            on_node(n->cause);
             break;
         }
         case ASTNodeTry:
         {
             auto* n = static_cast<TryNode*>(node);
-            for(auto* c : n->body) out.push_back(c);
-            for(auto* c : n->excepts) out.push_back(c);
-            for(auto* c : n->orelse) out.push_back(c);
-            for(auto* c : n->finalbody) out.push_back(c);
+            on_list(n->body);
+            on_list(n->excepts);
+            on_list(n->orelse);
+            on_list(n->finalbody);
             break;
         }
         case ASTNodeExcept:
         {
             auto* n = static_cast<ExceptNode*>(node);
-            for(auto* c : n->types) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
+            on_list(n->types);
+            on_list(n->body);
             break;
         }
         case ASTNodeBinOp:
         {
             auto* n = static_cast<BinOpNode*>(node);
-            if(n->left) out.push_back(n->left);
-            if(n->right) out.push_back(n->right);
+            on_node(n->left);
+            on_node(n->right);
             break;
         }
         case ASTNodeUnaryOp:
         {
             auto* n = static_cast<UnaryOpNode*>(node);
-            if(n->operand) out.push_back(n->operand);
+            on_node(n->operand);
             break;
         }
         case ASTNodeTernaryOp:
         {
             auto* n = static_cast<TernaryOpNode*>(node);
-            if(n->body) out.push_back(n->body);
-            if(n->test) out.push_back(n->test);
-            if(n->orelse) out.push_back(n->orelse);
+            on_node(n->body);
+            on_node(n->test);
+            on_node(n->orelse);
             break;
         }
         case ASTNodeBoolOp:
         {
             auto* n = static_cast<BoolOpNode*>(node);
-            for(auto* c : n->values) out.push_back(c);
+            on_list(n->values);
             break;
         }
         case ASTNodeCompareOp:
         {
             auto* n = static_cast<CompareOp*>(node);
-            if(n->left) out.push_back(n->left);
-            for(auto* c : n->comparators) out.push_back(c);
+            on_node(n->left);
+            on_list(n->comparators);
             break;
         }
         case ASTNodeKeywordArg:
         {
             auto* n = static_cast<KeywordArgNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeCall:
         {
             auto* n = static_cast<CallNode*>(node);
-            if(n->func) out.push_back(n->func);
-            for(auto* c : n->args) out.push_back(c);
+            on_node(n->func);
+            on_list(n->args);
             break;
         }
         case ASTNodeAttribute:
         {
             auto* n = static_cast<AttributeNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeSubscript:
         {
             auto* n = static_cast<SubscriptNode*>(node);
-            if(n->value) out.push_back(n->value);
-            if(n->slice) out.push_back(n->slice);
+            on_node(n->value);
+            on_node(n->slice);
             break;
         }
         case ASTNodeStarred:
         {
             auto* n = static_cast<StarredNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeList:
         {
             auto* n = static_cast<ListNode*>(node);
-            for(auto* c : n->elts) out.push_back(c);
+            on_list(n->elts);
             break;
         }
         case ASTNodeSet:
         {
             auto* n = static_cast<SetNode*>(node);
-            for(auto* c : n->elts) out.push_back(c);
+            on_list(n->elts);
             break;
         }
         case ASTNodeTuple:
         {
             auto* n = static_cast<TupleNode*>(node);
-            for(auto* c : n->elts) out.push_back(c);
+            on_list(n->elts);
             break;
         }
         case ASTNodeDict:
         {
             auto* n = static_cast<DictNode*>(node);
-            for(auto* c : n->keys) out.push_back(c);
-            for(auto* c : n->values) out.push_back(c);
+            on_list(n->keys);
+            on_list(n->values);
             break;
         }
         case ASTNodeComprehension:
         {
             auto* n = static_cast<ComprehensionNode*>(node);
-            if(n->target) out.push_back(n->target);
-            if(n->iter) out.push_back(n->iter);
-            for(auto* c : n->ifs) out.push_back(c);
+            on_node(n->target);
+            on_node(n->iter);
+            on_list(n->ifs);
             break;
         }
         case ASTNodeAsyncComprehension:
         {
             auto* n = static_cast<AsyncComprehensionNode*>(node);
-            if(n->target) out.push_back(n->target);
-            if(n->iter) out.push_back(n->iter);
-            for(auto* c : n->ifs) out.push_back(c);
+            on_node(n->target);
+            on_node(n->iter);
+            on_list(n->ifs);
             break;
         }
         case ASTNodeListComp:
         {
             auto* n = static_cast<ListCompNode*>(node);
-            if(n->elt) out.push_back(n->elt);
-            for(auto* c : n->generators) out.push_back(c);
+            on_node(n->elt);
+            on_list(n->generators);
             break;
         }
         case ASTNodeSetComp:
         {
             auto* n = static_cast<SetCompNode*>(node);
-            if(n->elt) out.push_back(n->elt);
-            for(auto* c : n->generators) out.push_back(c);
+            on_node(n->elt);
+            on_list(n->generators);
             break;
         }
         case ASTNodeDictComp:
         {
             auto* n = static_cast<DictCompNode*>(node);
-            if(n->key) out.push_back(n->key);
-            if(n->value) out.push_back(n->value);
-            for(auto* c : n->generators) out.push_back(c);
+            on_node(n->key);
+            on_node(n->value);
+            on_list(n->generators);
             break;
         }
         case ASTNodeGeneratorExpr:
         {
             auto* n = static_cast<GeneratorExprNode*>(node);
-            if(n->elt) out.push_back(n->elt);
-            for(auto* c : n->generators) out.push_back(c);
+            on_node(n->elt);
+            on_list(n->generators);
             break;
         }
         case ASTNodeLambda:
         {
             auto* n = static_cast<LambdaNode*>(node);
-            for(auto* c : n->args) out.push_back(c);
-            if(n->body) out.push_back(n->body);
+            on_list(n->args);
+            on_node(n->body);
             break;
         }
         case ASTNodeMatch:
         {
             auto* n = static_cast<MatchNode*>(node);
-            if(n->subject) out.push_back(n->subject);
-            for(auto* c : n->cases) out.push_back(c);
+            on_node(n->subject);
+            on_list(n->cases);
             break;
         }
         case ASTNodeMatchCase:
         {
             auto* n = static_cast<MatchCaseNode*>(node);
-            if(n->pattern) out.push_back(n->pattern);
-            if(n->guard) out.push_back(n->guard);
-            for(auto* c : n->body) out.push_back(c);
+            on_node(n->pattern);
+            on_node(n->guard);
+            on_list(n->body);
             break;
         }
         case ASTNodeMatchOr:
         {
             auto* n = static_cast<MatchOrNode*>(node);
-            for(auto* c : n->patterns) out.push_back(c);
+            on_list(n->patterns);
             break;
         }
         case ASTNodeMatchAs:
         {
             auto* n = static_cast<MatchAsNode*>(node);
-            if(n->pattern) out.push_back(n->pattern);
+            on_node(n->pattern);
             break;
         }
         case ASTNodeMatchValue:
         {
             auto* n = static_cast<MatchValueNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeMatchSingleton:
@@ -5662,22 +6024,22 @@ void node_children(Node* node, Vector<Node*>& out) noexcept
         case ASTNodeMatchSequence:
         {
             auto* n = static_cast<MatchSequenceNode*>(node);
-            for(auto* c : n->patterns) out.push_back(c);
+            on_list(n->patterns);
             break;
         }
         case ASTNodeMatchMapping:
         {
             auto* n = static_cast<MatchMappingNode*>(node);
-            for(auto* c : n->keys) out.push_back(c);
-            for(auto* c : n->patterns) out.push_back(c);
+            on_list(n->keys);
+            on_list(n->patterns);
             break;
         }
         case ASTNodeMatchClass:
         {
             auto* n = static_cast<MatchClassNode*>(node);
-            if(n->cls) out.push_back(n->cls);
-            for(auto* c : n->patterns) out.push_back(c);
-            for(auto* c : n->kwd_patterns) out.push_back(c);
+            on_node(n->cls);
+            on_list(n->patterns);
+            on_list(n->kwd_patterns);
             break;
         }
         case ASTNodeMatchStar:
@@ -5689,79 +6051,88 @@ void node_children(Node* node, Vector<Node*>& out) noexcept
         case ASTNodeYield:
         {
             auto* n = static_cast<YieldNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeYieldFrom:
         {
             auto* n = static_cast<YieldFromNode*>(node);
-            if(n->value) out.push_back(n->value);
+            on_node(n->value);
             break;
         }
         case ASTNodeTypeParam:
         {
             auto* n = static_cast<TypeParamNode*>(node);
-            if(n->bound) out.push_back(n->bound);
-            if(n->constraint) out.push_back(n->constraint);
+            on_node(n->bound);
+            on_node(n->constraint);
+            on_node(n->default_value);
             break;
         }
         case ASTNodeTypeAlias:
         {
             auto* n = static_cast<TypeAliasNode*>(node);
-            for(auto* c : n->type_params) out.push_back(c);
-            if(n->value) out.push_back(n->value);
+            on_list(n->type_params);
+            on_node(n->value);
             break;
         }
         case ASTNodeGlobal:
         {
             auto* n = static_cast<GlobalNode*>(node);
-            for(auto* c : n->names) out.push_back(c);
+            on_list(n->names);
             break;
         }
         case ASTNodeNonLocal:
         {
             auto* n = static_cast<NonLocalNode*>(node);
-            for(auto* c : n->names) out.push_back(c);
+            on_list(n->names);
             break;
         }
         case ASTNodeDel:
         {
             auto* n = static_cast<DelNode*>(node);
-            for(auto* c : n->names) out.push_back(c);
+            on_list(n->names);
             break;
         }
         case ASTNodeAwait:
         {
             auto* n = static_cast<AwaitNode*>(node);
-            if(n->expr != nullptr) out.push_back(n->expr);
+            on_node(n->expr);
             break;
         }
         case ASTNodeWithItem:
         {
             auto* n = static_cast<WithItemNode*>(node);
-            if(n->context_expr) out.push_back(n->context_expr);
-            if(n->optional_vars) out.push_back(n->optional_vars);
+            on_node(n->context_expr);
+            on_node(n->optional_vars);
             break;
         }
         case ASTNodeWith:
         {
             auto* n = static_cast<WithNode*>(node);
-            for(auto* c : n->items) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
+            on_list(n->items);
+            on_list(n->body);
             break;
         }
         case ASTNodeAsyncWith:
         {
             auto* n = static_cast<AsyncWithNode*>(node);
-            for(auto* c : n->items) out.push_back(c);
-            for(auto* c : n->body) out.push_back(c);
+            on_list(n->items);
+            on_list(n->body);
             break;
         }
         case ASTNodeAssertion:
         {
             auto* n = static_cast<AssertionNode*>(node);
-            if(n->expr) out.push_back(n->expr);
-            if(n->message) out.push_back(n->message);
+            on_node(n->expr);
+            on_node(n->message);
+            break;
+        }
+        case ASTNodeSlice:
+        {
+            auto* n = static_cast<SliceNode*>(node);
+            on_node(n->lower);
+            on_node(n->upper);
+            on_node(n->step);
             break;
         }
         default:
@@ -5769,6 +6140,380 @@ void node_children(Node* node, Vector<Node*>& out) noexcept
     }
 }
 
+void node_children(Node* node, Vector<Node*>& out) noexcept
+{
+    for_each_child_field(node,
+                         [&](Node* child) {
+                             if(child != nullptr)
+                                 out.push_back(child);
+                         },
+                         [&](const NodeList& children) {
+                             for(Node* child : children)
+                                 out.push_back(child);
+                         });
+}
+
+// Flat AST
+
+struct FlatAST_
+{
+    FlatAST* flat;
+
+    // Offsets of the strings already in the string table
+    HashMap<StringD, std::uint32_t> offsets;
+
+    explicit FlatAST_(FlatAST* flat) noexcept : flat(flat) {}
+
+    void word(const std::uint32_t value) noexcept { this->flat->_extra.push_back(value); }
+
+    void string(const StringD& str) noexcept
+    {
+        if(str.empty())
+        {
+            this->word(0);
+            return;
+        }
+
+        auto it = this->offsets.find(str);
+
+        if(it != this->offsets.end())
+        {
+            this->word(it->second);
+            return;
+        }
+
+        const std::uint32_t offset = static_cast<std::uint32_t>(this->flat->_strings.size());
+
+        for(std::size_t i = 0; i < str.size(); ++i)
+            this->flat->_strings.push_back(str[i]);
+
+        this->flat->_strings.push_back('\0');
+
+        // The strings of the tree outlive the conversion
+        this->offsets.insert(std::make_pair(StringD::make_ref(str), offset));
+
+        this->word(offset);
+    }
+
+    void strings(const ArenaArray<StringD>& strs) noexcept
+    {
+        this->word(static_cast<std::uint32_t>(strs.size()));
+
+        for(const StringD& str : strs)
+            this->string(str);
+    }
+
+    void operators(const ArenaArray<Operator>& ops) noexcept
+    {
+        this->word(static_cast<std::uint32_t>(ops.size()));
+
+        for(const Operator op : ops)
+            this->word(static_cast<std::uint32_t>(op));
+    }
+
+    void scalars(const Node* node) noexcept
+    {
+        switch(node->type())
+        {
+            case ASTNodeFunctionArg:
+            {
+                const auto* n = static_cast<const FunctionArgNode*>(node);
+                this->string(n->name);
+                this->word(n->is_vararg);
+                this->word(n->is_kwarg);
+                break;
+            }
+            case ASTNodeFunctionDef:
+            {
+                const auto* n = static_cast<const FunctionDefNode*>(node);
+                this->string(n->name);
+                this->word(static_cast<std::uint32_t>(n->posonly_index));
+                this->word(static_cast<std::uint32_t>(n->kwonly_index));
+                break;
+            }
+            case ASTNodeAsyncFunctionDef:
+            {
+                const auto* n = static_cast<const AsyncFunctionDefNode*>(node);
+                this->string(n->name);
+                this->word(static_cast<std::uint32_t>(n->posonly_index));
+                this->word(static_cast<std::uint32_t>(n->kwonly_index));
+                break;
+            }
+            case ASTNodeClassDef:
+                this->string(static_cast<const ClassDefNode*>(node)->name);
+                break;
+            case ASTNodeAugAssign:
+                this->word(static_cast<std::uint32_t>(static_cast<const AugAssignNode*>(node)->op));
+                break;
+            case ASTNodeImport:
+            {
+                const auto* n = static_cast<const ImportNode*>(node);
+                this->strings(n->names);
+                this->strings(n->aliases);
+                break;
+            }
+            case ASTNodeImportFrom:
+            {
+                const auto* n = static_cast<const ImportFromNode*>(node);
+                this->string(n->module);
+                this->strings(n->names);
+                this->strings(n->aliases);
+                break;
+            }
+            case ASTNodeExcept:
+            {
+                const auto* n = static_cast<const ExceptNode*>(node);
+                this->strings(n->names);
+                this->word(n->is_star);
+                break;
+            }
+            case ASTNodeUnaryOp:
+                this->word(static_cast<std::uint32_t>(static_cast<const UnaryOpNode*>(node)->op));
+                break;
+            case ASTNodeBinOp:
+                this->word(static_cast<std::uint32_t>(static_cast<const BinOpNode*>(node)->op));
+                break;
+            case ASTNodeBoolOp:
+                this->word(static_cast<std::uint32_t>(static_cast<const BoolOpNode*>(node)->op));
+                break;
+            case ASTNodeCompareOp:
+                this->operators(static_cast<const CompareOp*>(node)->ops);
+                break;
+            case ASTNodeKeywordArg:
+                this->string(static_cast<const KeywordArgNode*>(node)->name);
+                break;
+            case ASTNodeName:
+                this->string(static_cast<const NameNode*>(node)->id);
+                break;
+            case ASTNodeConstant:
+            {
+                const auto* n = static_cast<const ConstantNode*>(node);
+                this->string(n->raw);
+                this->word(static_cast<std::uint32_t>(n->literal_type));
+                break;
+            }
+            case ASTNodeAttribute:
+                this->string(static_cast<const AttributeNode*>(node)->attr);
+                break;
+            case ASTNodeLambda:
+            {
+                const auto* n = static_cast<const LambdaNode*>(node);
+                this->word(static_cast<std::uint32_t>(n->posonly_index));
+                this->word(static_cast<std::uint32_t>(n->kwonly_index));
+                break;
+            }
+            case ASTNodeMatchAs:
+                this->string(static_cast<const MatchAsNode*>(node)->name);
+                break;
+            case ASTNodeMatchSingleton:
+                this->word(static_cast<std::uint32_t>(static_cast<const MatchSingletonNode*>(node)->value));
+                break;
+            case ASTNodeMatchMapping:
+                this->string(static_cast<const MatchMappingNode*>(node)->rest);
+                break;
+            case ASTNodeMatchClass:
+                this->strings(static_cast<const MatchClassNode*>(node)->kwd_attrs);
+                break;
+            case ASTNodeMatchStar:
+                this->string(static_cast<const MatchStarNode*>(node)->name);
+                break;
+            case ASTNodeTypeParam:
+            {
+                const auto* n = static_cast<const TypeParamNode*>(node);
+                this->string(n->name);
+                this->word(n->is_paramspec);
+                this->word(n->is_typevartuple);
+                break;
+            }
+            case ASTNodeTypeAlias:
+                this->string(static_cast<const TypeAliasNode*>(node)->name);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+bool FlatAST::from_tree(const Node* root) noexcept
+{
+    this->clear();
+
+    if(root == nullptr)
+        return true;
+
+    // Offset 0 is the empty string
+    this->_strings.push_back('\0');
+
+    // Tree node of each index, and the nodes whose subtree is being visited
+    Vector<Node*> nodes;
+    Vector<std::uint32_t> open;
+
+    bool overflow = false;
+
+    Walker walker;
+    walker.walk(const_cast<Node*>(root),
+                [&](Node* node, std::uint32_t) -> bool {
+                    if(nodes.size() >= FLAT_NONE)
+                    {
+                        overflow = true;
+                        return false;
+                    }
+
+                    const std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+
+                    nodes.push_back(node);
+
+                    this->_types.push_back(static_cast<std::uint8_t>(node->type()));
+                    this->_lines.push_back(node->line());
+                    this->_columns.push_back(node->column());
+                    this->_parents.push_back(open.empty() ? FLAT_NONE : open.back());
+                    this->_ends.push_back(index + 1);
+
+                    open.push_back(index);
+
+                    return true;
+                },
+                [&](Node*, std::uint32_t) {
+                    this->_ends[open.pop_back()] = static_cast<std::uint32_t>(nodes.size());
+                });
+
+    if(overflow)
+    {
+        this->clear();
+        return false;
+    }
+
+    FlatAST_ converter(this);
+
+    for(std::uint32_t i = 0; i < this->size(); ++i)
+    {
+        this->_records.push_back(static_cast<std::uint32_t>(this->_extra.size()));
+
+        converter.scalars(nodes[i]);
+
+        // Children were visited in field order, each subtree following the previous one
+        std::uint32_t next = i + 1;
+
+        const auto child_index = [&](Node* child) -> std::uint32_t {
+            if(child == nullptr)
+                return FLAT_NONE;
+
+            STDROMANO_ASSERT(next < this->_ends[i] && nodes[next] == child, "Children out of traversal order");
+
+            const std::uint32_t index = next;
+            next = this->_ends[index];
+
+            return index;
+        };
+
+        for_each_child_field(nodes[i],
+                             [&](Node* child) {
+                                 converter.word(child_index(child));
+                             },
+                             [&](const NodeList& children) {
+                                 converter.word(static_cast<std::uint32_t>(children.size()));
+
+                                 for(Node* child : children)
+                                     converter.word(child_index(child));
+                             });
+
+        if(this->_extra.size() >= FLAT_NONE || this->_strings.size() >= FLAT_NONE)
+        {
+            this->clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename T>
+static void flat_copy(Vector<T>& dst, const T* src, const std::uint32_t size) noexcept
+{
+    dst.reserve(size);
+
+    for(std::uint32_t i = 0; i < size; ++i)
+        dst.push_back(src[i]);
+}
+
+bool FlatAST::from_arrays(const FlatArrays& arrays) noexcept
+{
+    this->clear();
+
+    const std::uint32_t num_nodes = arrays.num_nodes;
+
+    if(num_nodes == 0)
+        return arrays.extra_size == 0 && arrays.strings_size == 0;
+
+    if(num_nodes == FLAT_NONE || arrays.extra_size == FLAT_NONE || arrays.strings_size == FLAT_NONE)
+        return false;
+
+    // The string table starts with the empty string, and every string is terminated
+    if(arrays.strings_size == 0 || arrays.strings[0] != '\0' || arrays.strings[arrays.strings_size - 1] != '\0')
+        return false;
+
+    for(std::uint32_t i = 0; i < num_nodes; ++i)
+    {
+        if(arrays.types[i] >= ASTNodeCount)
+            return false;
+
+        // Only the first node is a root, parents come before their children
+        if(i == 0 ? arrays.parents[i] != FLAT_NONE : arrays.parents[i] >= i)
+            return false;
+
+        if(arrays.ends[i] <= i || arrays.ends[i] > num_nodes)
+            return false;
+
+        // The subtree of a node is within the subtree of its parent
+        if(i > 0 && (i >= arrays.ends[arrays.parents[i]] || arrays.ends[i] > arrays.ends[arrays.parents[i]]))
+            return false;
+
+        if(arrays.records[i] > arrays.extra_size)
+            return false;
+    }
+
+    flat_copy(this->_types, arrays.types, num_nodes);
+    flat_copy(this->_lines, arrays.lines, num_nodes);
+    flat_copy(this->_columns, arrays.columns, num_nodes);
+    flat_copy(this->_parents, arrays.parents, num_nodes);
+    flat_copy(this->_ends, arrays.ends, num_nodes);
+    flat_copy(this->_records, arrays.records, num_nodes);
+    flat_copy(this->_extra, arrays.extra, arrays.extra_size);
+    flat_copy(this->_strings, arrays.strings, arrays.strings_size);
+
+    return true;
+}
+
+FlatArrays FlatAST::arrays() const noexcept
+{
+    FlatArrays arrays;
+    arrays.types = this->_types.data();
+    arrays.lines = this->_lines.data();
+    arrays.columns = this->_columns.data();
+    arrays.parents = this->_parents.data();
+    arrays.ends = this->_ends.data();
+    arrays.records = this->_records.data();
+    arrays.num_nodes = this->size();
+    arrays.extra = this->_extra.data();
+    arrays.extra_size = static_cast<std::uint32_t>(this->_extra.size());
+    arrays.strings = this->_strings.data();
+    arrays.strings_size = static_cast<std::uint32_t>(this->_strings.size());
+
+    return arrays;
+}
+
+void FlatAST::clear() noexcept
+{
+    this->_types.clear();
+    this->_lines.clear();
+    this->_columns.clear();
+    this->_parents.clear();
+    this->_ends.clear();
+    this->_records.clear();
+    this->_extra.clear();
+    this->_strings.clear();
+}
+
 PYTHON_NAMESPACE_END
 
 STDROMANO_NAMESPACE_END
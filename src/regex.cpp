@@ -3,44 +3,53 @@
 // All rights reserved.
 
 #include "stdromano/regex.hpp"
+#include "stdromano/hashmap.hpp"
+#include "stdromano/atomic.hpp"
 
 #include "spdlog/spdlog.h"
 
 #include <cstring>
 #include <limits>
+#include <mutex>
+
+#if defined(STDROMANO_WIN)
+#include <Windows.h>
+#elif defined(STDROMANO_LINUX)
+#include <sys/mman.h>
+#endif /* defined(STDROMANO_WIN) */
 
 STDROMANO_NAMESPACE_BEGIN
 
 /*
     https://dl.acm.org/doi/pdf/10.1145/363347.363387
+    https://swtch.com/~rsc/regexp/regexp2.html
     https://arxiv.org/pdf/2407.20479
 
     Single-pass recursive descent compiler: regex string -> bytecode directly.
-    Linear VM with group capture support.
+    The bytecode is a Thompson NFA program, executed by a Pike VM: all the threads advance
+    in lockstep over the input, with their own capture slots, giving leftmost-first semantics
+    in O(n * m) time (n = input length, m = program size).
 */
 
 enum RegexInstrOpCode : std::uint8_t
 {
-    RegexInstrOpCode_TestSingle,        /* test char == operand */
-    RegexInstrOpCode_TestNegatedSingle, /* test char != operand */
-    RegexInstrOpCode_TestRange,         /* test char in [lo, hi] */
-    RegexInstrOpCode_TestNegatedRange,  /* test char NOT in [lo, hi] */
-    RegexInstrOpCode_TestAny,           /* test any char (except newline) */
-    RegexInstrOpCode_TestDigit,         /* test isdigit */
-    RegexInstrOpCode_TestWord,          /* test isalnum || '_' */
-    RegexInstrOpCode_TestWhitespace,    /* test isspace */
-    RegexInstrOpCode_TestLowerCase,     /* test islower */
-    RegexInstrOpCode_TestUpperCase,     /* test isupper */
-    RegexInstrOpCode_Jump,              /* jump */
-    RegexInstrOpCode_JumpEq,            /* jump if status_flag == true */
-    RegexInstrOpCode_JumpNeq,           /* jump if status_flag == false */
+    RegexInstrOpCode_TestSingle,        /* consume char == operand */
+    RegexInstrOpCode_TestNegatedSingle, /* consume char != operand */
+    RegexInstrOpCode_TestRange,         /* consume char in [lo, hi] */
+    RegexInstrOpCode_TestNegatedRange,  /* consume char NOT in [lo, hi] */
+    RegexInstrOpCode_TestAny,           /* consume any char (except newline) */
+    RegexInstrOpCode_TestDigit,         /* consume isdigit */
+    RegexInstrOpCode_TestWord,          /* consume isalnum || '_' */
+    RegexInstrOpCode_TestWhitespace,    /* consume isspace */
+    RegexInstrOpCode_TestLowerCase,     /* consume islower */
+    RegexInstrOpCode_TestUpperCase,     /* consume isupper */
+    RegexInstrOpCode_TestClass,         /* consume char in the set (32-byte bitmap) */
+    RegexInstrOpCode_Jump,              /* jump (4-byte offset) */
+    RegexInstrOpCode_Split,             /* fork (two 4-byte offsets), the first one has priority */
     RegexInstrOpCode_Accept,            /* match succeeded */
-    RegexInstrOpCode_Fail,              /* match failed */
     RegexInstrOpCode_GroupStart,        /* record sp as group start  (1-byte id) */
     RegexInstrOpCode_GroupEnd,          /* record sp as group end    (1-byte id) */
-    RegexInstrOpCode_IncPos,            /* ++sp */
-    RegexInstrOpCode_IncPosEq,          /* sp += status_flag ? 1 : 0 */
-    RegexInstrOpCode_SetFlag,           /* status_flag = (bool)operand */
+    RegexInstrOpCode_AcceptPattern,     /* pattern of a RegexSet matched (4-byte index) */
 };
 
 template<typename T, typename = std::enable_if_t<sizeof(T) == 1>>
@@ -67,9 +76,17 @@ inline char CHAR(std::byte b) noexcept
     return c;
 }
 
-// All jumps are relative to the end of the jump instruction (size of a jump instruction is 1 (opcode) + 4 (offset))
+inline unsigned char UCHAR(std::byte b) noexcept
+{
+    return static_cast<unsigned char>(b);
+}
+
+// All jumps are relative to the end of the jump instruction (size of a jump instruction is 1 (opcode) + 4 (offset),
+// size of a split instruction is 1 (opcode) + 4 (offset) + 4 (offset))
 
-static constexpr int JUMP_FAIL = std::numeric_limits<int>::max();
+static constexpr std::size_t REGEX_JUMP_SIZE = 5;
+static constexpr std::size_t REGEX_SPLIT_SIZE = 9;
+static constexpr std::size_t REGEX_CLASS_SIZE = 33;
 
 inline void encode_jump_at(Regex::ByteCode& code, std::size_t pos, int value) noexcept
 {
@@ -88,9 +105,9 @@ inline int decode_jump(const std::byte* p) noexcept
 }
 
 /* Emit a jump instruction, returns the position of the 4-byte offset field */
-inline std::size_t emit_jump(Regex::ByteCode& code, RegexInstrOpCode op) noexcept
+inline std::size_t emit_jump(Regex::ByteCode& code) noexcept
 {
-    code.push_back(BYTE(op));
+    code.push_back(BYTE(RegexInstrOpCode_Jump));
     std::size_t pos = code.size();
     code.push_back(BYTE(std::uint8_t(0)));
     code.push_back(BYTE(std::uint8_t(0)));
@@ -99,20 +116,81 @@ inline std::size_t emit_jump(Regex::ByteCode& code, RegexInstrOpCode op) noexcep
     return pos;
 }
 
-inline std::size_t emit_fail_jump(Regex::ByteCode& code, RegexInstrOpCode op) noexcept
+/* Patch the jump whose offset field is at jump_pos to land on target */
+inline void patch_jump(Regex::ByteCode& code, std::size_t jump_pos, std::size_t target) noexcept
 {
-    code.push_back(BYTE(op));
-    std::size_t pos = code.size();
-    code.push_back(BYTE(static_cast<std::uint8_t>((JUMP_FAIL >> 24) & 0xFF)));
-    code.push_back(BYTE(static_cast<std::uint8_t>((JUMP_FAIL >> 16) & 0xFF)));
-    code.push_back(BYTE(static_cast<std::uint8_t>((JUMP_FAIL >> 8) & 0xFF)));
-    code.push_back(BYTE(static_cast<std::uint8_t>((JUMP_FAIL >> 0) & 0xFF)));
-    return pos;
+    encode_jump_at(code, jump_pos, static_cast<int>(target) - static_cast<int>(jump_pos + 4));
+}
+
+/* Insert a split instruction at pos, whose branches land on x (preferred) and y. x and y are
+   positions in the code after the insertion */
+inline void insert_split(Regex::ByteCode& code, std::size_t pos, std::size_t x, std::size_t y) noexcept
+{
+    code.insert(code.begin() + static_cast<Regex::ByteCode::difference_type>(pos), REGEX_SPLIT_SIZE, BYTE(std::uint8_t(0)));
+    code[pos] = BYTE(RegexInstrOpCode_Split);
+    encode_jump_at(code, pos + 1, static_cast<int>(x) - static_cast<int>(pos + REGEX_SPLIT_SIZE));
+    encode_jump_at(code, pos + 5, static_cast<int>(y) - static_cast<int>(pos + REGEX_SPLIT_SIZE));
+}
+
+inline std::size_t jump_target(const Regex::ByteCode& code, std::size_t pc, std::size_t offset_pos, std::size_t size) noexcept
+{
+    return static_cast<std::size_t>(static_cast<int>(pc + size) + decode_jump(&code[offset_pos]));
+}
+
+inline std::size_t regex_instr_size(const Regex::ByteCode& code, std::size_t pc) noexcept
+{
+    switch(static_cast<std::uint8_t>(code[pc]))
+    {
+        case RegexInstrOpCode_TestSingle:
+        case RegexInstrOpCode_TestNegatedSingle:
+        case RegexInstrOpCode_GroupStart:
+        case RegexInstrOpCode_GroupEnd:
+            return 2;
+        case RegexInstrOpCode_TestRange:
+        case RegexInstrOpCode_TestNegatedRange:
+            return 3;
+        case RegexInstrOpCode_TestClass:
+            return REGEX_CLASS_SIZE;
+        case RegexInstrOpCode_Jump:
+        case RegexInstrOpCode_AcceptPattern:
+            return REGEX_JUMP_SIZE;
+        case RegexInstrOpCode_Split:
+            return REGEX_SPLIT_SIZE;
+        default:
+            return 1;
+    }
 }
 
-inline void patch_jump(Regex::ByteCode& code, std::size_t jump_pos, int offset) noexcept
+/* Test the char c against the consuming instruction at pc */
+STDROMANO_FORCE_INLINE bool regex_test_char(const Regex::ByteCode& code, std::size_t pc, unsigned char c) noexcept
 {
-    encode_jump_at(code, jump_pos, offset);
+    switch(static_cast<std::uint8_t>(code[pc]))
+    {
+        case RegexInstrOpCode_TestSingle:
+            return c == UCHAR(code[pc + 1]);
+        case RegexInstrOpCode_TestNegatedSingle:
+            return c != UCHAR(code[pc + 1]);
+        case RegexInstrOpCode_TestRange:
+            return c >= UCHAR(code[pc + 1]) && c <= UCHAR(code[pc + 2]);
+        case RegexInstrOpCode_TestNegatedRange:
+            return c < UCHAR(code[pc + 1]) || c > UCHAR(code[pc + 2]);
+        case RegexInstrOpCode_TestAny:
+            return c != '\n';
+        case RegexInstrOpCode_TestDigit:
+            return std::isdigit(c);
+        case RegexInstrOpCode_TestWord:
+            return std::isalnum(c) || c == '_';
+        case RegexInstrOpCode_TestWhitespace:
+            return std::isspace(c);
+        case RegexInstrOpCode_TestLowerCase:
+            return std::islower(c);
+        case RegexInstrOpCode_TestUpperCase:
+            return std::isupper(c);
+        case RegexInstrOpCode_TestClass:
+            return (UCHAR(code[pc + 1 + (c >> 3)]) >> (c & 7)) & 1;
+        default:
+            return false;
+    }
 }
 
 struct RegexCompiler
@@ -124,11 +202,26 @@ struct RegexCompiler
     Regex::ByteCode bytecode;
     bool has_error;
 
+    /* Literals extraction: runs of literal chars at the top level of the pattern are required in
+       any match, the one starting the pattern is its prefix */
+    std::uint32_t depth = 0;
+    std::uint32_t num_atoms = 0;
+    int primary_literal = -1;
+    std::uint32_t literal_run_start = 0;
+    StringD literal_run;
+    StringD prefix;
+    StringD required;
+    bool literals_valid = true;
+
     RegexCompiler(const char* pat, std::size_t length) : pattern(pat),
                                                          len(length),
                                                          pos(0),
                                                          next_group_id(1),
-                                                         has_error(false) {}
+                                                         has_error(false)
+    {
+        this->bytecode.push_back(BYTE(RegexInstrOpCode_GroupStart));
+        this->bytecode.push_back(BYTE(std::uint8_t(0)));
+    }
 
     char peek() const noexcept { return this->pos < this->len ? this->pattern[this->pos] : '\0'; }
     char advance() noexcept { return this->pos < this->len ? this->pattern[this->pos++] : '\0'; }
@@ -136,10 +229,47 @@ struct RegexCompiler
 
     void error(const char* msg) noexcept
     {
+        spdlog::error("Regex compilation error at position {}: {}", this->pos, msg);
         this->has_error = true;
     }
 
-    void emit_range_instrs(char lo, char hi, bool add_inc_pos_eq = true, bool negated = false) noexcept
+    void end_literal_run() noexcept
+    {
+        if(this->literal_run.empty())
+            return;
+
+        if(this->literal_run_start == 0)
+            this->prefix = this->literal_run;
+
+        if(this->literal_run.size() > this->required.size())
+            this->required = this->literal_run;
+
+        this->literal_run.clear();
+    }
+
+    /* Called for each top level atom, literal is the char it matches (or -1), repeated is true if
+       the atom is followed by '+' */
+    void add_literal_atom(int literal, bool repeated) noexcept
+    {
+        if(literal < 0)
+        {
+            this->end_literal_run();
+        }
+        else
+        {
+            if(this->literal_run.empty())
+                this->literal_run_start = this->num_atoms;
+
+            this->literal_run.push_back(static_cast<char>(literal));
+
+            if(repeated)
+                this->end_literal_run();
+        }
+
+        this->num_atoms++;
+    }
+
+    void emit_range_instrs(char lo, char hi, bool negated = false) noexcept
     {
         if(negated)
         {
@@ -168,35 +298,56 @@ struct RegexCompiler
                 this->bytecode.push_back(BYTE(hi));
             }
         }
-
-        if(add_inc_pos_eq)
-            this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
     }
 
-    /* alternation = concatenation ('|' concatenation)* */
+    /*
+        alternation = concatenation ('|' concatenation)*
+
+        e1|e2|e3 compiles to:
+
+            split L1, L2
+        L1: e1
+            jump END
+        L2: split L3, L4
+        L3: e2
+            jump END
+        L4: e3
+        END:
+    */
     bool compile_alternation() noexcept
     {
+        std::size_t branch_start = this->bytecode.size();
+
         if(!this->compile_concatenation())
             return false;
 
-        Vector<std::size_t> jumps;
+        Vector<std::size_t> exit_jumps;
 
         while(!this->at_end() && this->peek() == '|')
         {
             this->advance();
 
-            std::size_t jump_over_pos = emit_jump(this->bytecode, RegexInstrOpCode_JumpEq);
-            jumps.push_back(jump_over_pos);
+            /* Top level alternatives have no literal in common */
+            if(this->depth == 0)
+                this->literals_valid = false;
+
+            std::size_t exit_jump = emit_jump(this->bytecode) + REGEX_SPLIT_SIZE;
+            std::size_t next_branch = this->bytecode.size() + REGEX_SPLIT_SIZE;
+
+            insert_split(this->bytecode, branch_start, branch_start + REGEX_SPLIT_SIZE, next_branch);
+
+            exit_jumps.push_back(exit_jump);
+
+            branch_start = next_branch;
 
             if(!this->compile_concatenation())
                 return false;
-
         }
 
-        std::size_t end_label = this->bytecode.size();
+        const std::size_t end_label = this->bytecode.size();
 
-        for(const auto jump : jumps)
-            patch_jump(this->bytecode, jump, static_cast<int>(end_label - (jump + 4)));
+        for(const auto jump : exit_jumps)
+            patch_jump(this->bytecode, jump, end_label);
 
         return true;
     }
@@ -204,96 +355,91 @@ struct RegexCompiler
     /* concatenation = quantified+ (stop at '|', ')', or end) */
     bool compile_concatenation() noexcept
     {
-        bool first = true;
-
-        Vector<std::size_t> jumps;
-
         while(!this->at_end() && this->peek() != ')' && this->peek() != '|')
         {
-            if(!first)
-            {
-                std::size_t fail_jump = emit_jump(this->bytecode, RegexInstrOpCode_JumpNeq);
-                jumps.push_back(fail_jump);
-            }
-
             if(!this->compile_quantified())
                 return false;
-
-            first = false;
         }
 
-        std::size_t end_label = this->bytecode.size();
-
-        for(const auto jump : jumps)
-            patch_jump(this->bytecode, jump, static_cast<int>(end_label - (jump + 4)));
-
         return true;
     }
 
-    /* quantified = primary ('*' | '+' | '?')? */
+    /* quantified = primary (('*' | '+' | '?') '?'?)? */
     bool compile_quantified() noexcept
     {
-        std::size_t primary_start = this->bytecode.size();
+        const std::size_t primary_start = this->bytecode.size();
 
         if(!this->compile_primary())
             return false;
 
-        if(this->at_end())
+        const char q = this->peek();
+
+        if(this->depth == 0)
+        {
+            if(this->at_end() || (q != '*' && q != '+' && q != '?'))
+                this->add_literal_atom(this->primary_literal, false);
+            else
+                this->add_literal_atom(q == '+' ? this->primary_literal : -1, true);
+        }
+
+        if(this->at_end() || (q != '*' && q != '+' && q != '?'))
             return true;
 
-        char q = this->peek();
+        this->advance();
+
+        /* A trailing '?' makes the quantifier lazy: the split prefers exiting the loop */
+        bool lazy = false;
+
+        if(!this->at_end() && this->peek() == '?')
+        {
+            this->advance();
+            lazy = true;
+        }
 
         switch(q)
         {
             case '*':
             {
-                this->advance();
-
-                std::size_t loop_jump = emit_jump(this->bytecode, RegexInstrOpCode_JumpEq);
-                int offset_back = static_cast<int>(primary_start) - static_cast<int>(loop_jump + 4);
-                patch_jump(this->bytecode, loop_jump, offset_back);
-
-                this->bytecode.push_back(BYTE(RegexInstrOpCode_SetFlag));
-                this->bytecode.push_back(BYTE(std::uint8_t(1)));
+                /*
+                    L0: split L1, L2
+                    L1: e
+                        jump L0
+                    L2:
+                */
+                const std::size_t loop_jump = emit_jump(this->bytecode) + REGEX_SPLIT_SIZE;
+                const std::size_t body = primary_start + REGEX_SPLIT_SIZE;
+                const std::size_t exit = this->bytecode.size() + REGEX_SPLIT_SIZE;
+
+                insert_split(this->bytecode, primary_start, lazy ? exit : body, lazy ? body : exit);
+                patch_jump(this->bytecode, loop_jump, primary_start);
 
                 break;
             }
             case '+':
             {
-                this->advance();
-
-                std::size_t primary_end = this->bytecode.size();
-
-                emit_fail_jump(this->bytecode, RegexInstrOpCode_JumpNeq);
-
-                std::size_t loop_start = this->bytecode.size();
-
-                Regex::ByteCode primary_copy(this->bytecode.begin() + static_cast<Regex::ByteCode::difference_type>(primary_start),
-                                             this->bytecode.begin() + static_cast<Regex::ByteCode::difference_type>(primary_end));
-
-                this->bytecode.insert(this->bytecode.end(), primary_copy.begin(), primary_copy.end());
-
-                std::size_t exit_loop_jump = emit_jump(this->bytecode, RegexInstrOpCode_JumpNeq);
-
-                std::size_t loop_jump = emit_jump(this->bytecode, RegexInstrOpCode_JumpEq);
-                int offset_back = static_cast<int>(loop_start) - static_cast<int>(loop_jump + 4);
-                patch_jump(this->bytecode, loop_jump, offset_back);
-
-                patch_jump(this->bytecode,
-                           exit_loop_jump,
-                           static_cast<int>(this->bytecode.size() - (exit_loop_jump + 4)));
+                /*
+                    L1: e
+                        split L1, L2
+                    L2:
+                */
+                const std::size_t split_pos = this->bytecode.size();
+                const std::size_t exit = split_pos + REGEX_SPLIT_SIZE;
 
-                this->bytecode.push_back(BYTE(RegexInstrOpCode_SetFlag));
-                this->bytecode.push_back(BYTE(std::uint8_t(1)));
+                insert_split(this->bytecode, split_pos, lazy ? exit : primary_start, lazy ? primary_start : exit);
 
                 break;
             }
             case '?':
             {
-                this->advance();
+                /*
+                        split L1, L2
+                    L1: e
+                    L2:
+                */
+                const std::size_t body = primary_start + REGEX_SPLIT_SIZE;
+                const std::size_t exit = this->bytecode.size() + REGEX_SPLIT_SIZE;
 
-                this->bytecode.push_back(BYTE(RegexInstrOpCode_SetFlag));
-                this->bytecode.push_back(BYTE(std::uint8_t(1)));
+                insert_split(this->bytecode, primary_start, lazy ? exit : body, lazy ? body : exit);
 
                 break;
             }
@@ -315,6 +461,8 @@ struct RegexCompiler
 
         char c = this->peek();
 
+        this->primary_literal = -1;
+
         switch(c)
         {
             case '(':
@@ -323,6 +471,8 @@ struct RegexCompiler
 
                 std::uint32_t group_id = this->next_group_id++;
 
+                this->depth++;
+
                 this->bytecode.push_back(BYTE(RegexInstrOpCode_GroupStart));
                 this->bytecode.push_back(BYTE(static_cast<std::uint8_t>(group_id & 0xFF)));
 
@@ -337,6 +487,9 @@ struct RegexCompiler
 
                 this->advance();
 
+                this->depth--;
+                this->primary_literal = -1;
+
                 this->bytecode.push_back(BYTE(RegexInstrOpCode_GroupEnd));
                 this->bytecode.push_back(BYTE(static_cast<std::uint8_t>(group_id & 0xFF)));
 
@@ -361,10 +514,6 @@ struct RegexCompiler
                     return false;
                 }
 
-                /* For a multi-range class like [a-zA-Z0-9], we compile each range
-                   as a test and use alternation logic between them:
-                   test_range1 -> if match, jump to end -> test_range2 -> ... */
-
                 struct RangePair { char lo; char hi; inline bool is_range() const { return this->lo != this->hi; } };
                 Vector<RangePair> ranges;
 
@@ -402,49 +551,31 @@ struct RegexCompiler
 
                 this->advance();
 
-                if(ranges.size() == 1 && ranges[0].is_range() && !negated)
+                if(ranges.size() == 1 && ranges[0].is_range())
                 {
-                    this->emit_range_instrs(ranges[0].lo, ranges[0].hi);
+                    this->emit_range_instrs(ranges[0].lo, ranges[0].hi, negated);
                 }
-                else if(ranges.size() == 1 && !ranges[0].is_range() && !negated)
+                else if(ranges.size() == 1)
                 {
-                    this->bytecode.push_back(BYTE(RegexInstrOpCode_TestSingle));
+                    this->bytecode.push_back(BYTE(negated ? RegexInstrOpCode_TestNegatedSingle :
+                                                            RegexInstrOpCode_TestSingle));
                     this->bytecode.push_back(BYTE(ranges[0].lo));
-                    this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
                 }
                 else
                 {
-                    Vector<std::size_t> success_jumps;
+                    /* Multi-range classes like [a-zA-Z0-9] are compiled to a single 256-bit set test */
+                    std::uint8_t set[32] = {};
 
-                    for(std::size_t r = 0; r < ranges.size(); ++r)
+                    for(const RangePair& range : ranges)
                     {
-                        if(ranges[r].is_range())
-                        {
-                            this->emit_range_instrs(ranges[r].lo, ranges[r].hi, false, negated);
-                        }
-                        else
-                        {
-                            if(negated)
-                                this->bytecode.push_back(BYTE(RegexInstrOpCode_TestNegatedSingle));
-                            else
-                                this->bytecode.push_back(BYTE(RegexInstrOpCode_TestSingle));
-
-                            this->bytecode.push_back(BYTE(ranges[r].lo));
-                        }
-
-                        std::size_t jump_pos = emit_jump(this->bytecode, RegexInstrOpCode_JumpEq);
-                        success_jumps.push_back(jump_pos);
+                        for(unsigned int ch = static_cast<unsigned char>(range.lo); ch <= static_cast<unsigned char>(range.hi); ++ch)
+                            set[ch >> 3] |= static_cast<std::uint8_t>(1u << (ch & 7));
                     }
 
-                    this->bytecode.push_back(BYTE(RegexInstrOpCode_SetFlag));
-                    this->bytecode.push_back(BYTE(static_cast<std::uint8_t>(0)));
+                    this->bytecode.push_back(BYTE(RegexInstrOpCode_TestClass));
 
-                    std::size_t success_label = this->bytecode.size();
-
-                    for(std::size_t j = 0; j < success_jumps.size(); ++j)
-                        patch_jump(this->bytecode, success_jumps[j], static_cast<int>(success_label - (success_jumps[j] + 4)));
-
-                    this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
+                    for(std::size_t i = 0; i < 32; ++i)
+                        this->bytecode.push_back(BYTE(static_cast<std::uint8_t>(negated ? ~set[i] : set[i])));
                 }
 
                 return true;
@@ -454,7 +585,6 @@ struct RegexCompiler
             {
                 this->advance();
                 this->bytecode.push_back(BYTE(RegexInstrOpCode_TestAny));
-                this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
                 return true;
             }
 
@@ -474,21 +604,18 @@ struct RegexCompiler
                 {
                     case 'd':
                         this->bytecode.push_back(BYTE(RegexInstrOpCode_TestDigit));
-                        this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
                         break;
                     case 'w':
                         this->bytecode.push_back(BYTE(RegexInstrOpCode_TestWord));
-                        this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
                         break;
                     case 's':
                         this->bytecode.push_back(BYTE(RegexInstrOpCode_TestWhitespace));
-                        this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
                         break;
                     default:
                         /* Escaped literal (handles \\, \., \*, \+, \?, \(, \), \[, \], \|) */
                         this->bytecode.push_back(BYTE(RegexInstrOpCode_TestSingle));
                         this->bytecode.push_back(BYTE(esc));
-                        this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
+                        this->primary_literal = static_cast<unsigned char>(esc);
                         break;
                 }
 
@@ -508,7 +635,8 @@ struct RegexCompiler
 
                 this->bytecode.push_back(BYTE(RegexInstrOpCode_TestSingle));
                 this->bytecode.push_back(BYTE(c));
-                this->bytecode.push_back(BYTE(RegexInstrOpCode_IncPosEq));
+
+                this->primary_literal = static_cast<unsigned char>(c);
 
                 return true;
             }
@@ -516,54 +644,12 @@ struct RegexCompiler
     }
 };
 
+/* Close the implicit whole-match group 0 opened by the compiler, and accept */
 void finalize_bytecode(Regex::ByteCode& bytecode) noexcept
 {
-    // Append the final fail-check, accept, and fail instructions
-    emit_fail_jump(bytecode, RegexInstrOpCode_JumpNeq);
-
+    bytecode.push_back(BYTE(RegexInstrOpCode_GroupEnd));
+    bytecode.push_back(BYTE(std::uint8_t(0)));
     bytecode.push_back(BYTE(RegexInstrOpCode_Accept));
-    bytecode.push_back(BYTE(RegexInstrOpCode_Fail));
-
-    // Resolve all JUMP_FAIL offsets to point to the Fail instruction
-    std::size_t fail_addr = bytecode.size() - 1;
-    std::size_t i = 0;
-
-    while(i < bytecode.size())
-    {
-        switch(static_cast<std::uint8_t>(bytecode[i]))
-        {
-            case RegexInstrOpCode_Jump:
-            case RegexInstrOpCode_JumpEq:
-            case RegexInstrOpCode_JumpNeq:
-            {
-                int offset = decode_jump(&bytecode[i + 1]);
-
-                if(offset == JUMP_FAIL)
-                {
-                    encode_jump_at(bytecode, i + 1, static_cast<int>(fail_addr - (i + 5)));
-                }
-
-                i += 5;
-                break;
-            }
-
-            case RegexInstrOpCode_TestSingle:
-            case RegexInstrOpCode_SetFlag:
-            case RegexInstrOpCode_GroupStart:
-            case RegexInstrOpCode_GroupEnd:
-                i += 2;
-                break;
-
-            case RegexInstrOpCode_TestRange:
-            case RegexInstrOpCode_TestNegatedRange:
-                i += 3;
-                break;
-
-            default:
-                i++;
-                break;
-        }
-    }
 }
 
 /* ======================================================================== */
@@ -576,109 +662,76 @@ static void regex_disasm(const Regex::ByteCode& bytecode) noexcept
 
     while(i < bytecode.size())
     {
-        spdlog::debug("{:04d}: ", i);
-
         switch(static_cast<std::uint8_t>(bytecode[i]))
         {
             case RegexInstrOpCode_TestSingle:
-                spdlog::debug("  TESTSINGLE '{}'", CHAR(bytecode[i + 1]));
-                i += 2;
+                spdlog::debug("{:04d}:   TESTSINGLE '{}'", i, CHAR(bytecode[i + 1]));
                 break;
             case RegexInstrOpCode_TestNegatedSingle:
-                spdlog::debug("  TESTNEGSINGLE '{}'", CHAR(bytecode[i + 1]));
-                i += 2;
+                spdlog::debug("{:04d}:   TESTNEGSINGLE '{}'", i, CHAR(bytecode[i + 1]));
                 break;
             case RegexInstrOpCode_TestRange:
-                spdlog::debug("  TESTRANGE '{}'-'{}'", CHAR(bytecode[i + 1]), CHAR(bytecode[i + 2]));
-                i += 3;
+                spdlog::debug("{:04d}:   TESTRANGE '{}'-'{}'", i, CHAR(bytecode[i + 1]), CHAR(bytecode[i + 2]));
                 break;
             case RegexInstrOpCode_TestNegatedRange:
-                spdlog::debug("  TESTNEGRANGE '{}'-'{}'", CHAR(bytecode[i + 1]), CHAR(bytecode[i + 2]));
-                i += 3;
+                spdlog::debug("{:04d}:   TESTNEGRANGE '{}'-'{}'", i, CHAR(bytecode[i + 1]), CHAR(bytecode[i + 2]));
                 break;
             case RegexInstrOpCode_TestAny:
-                spdlog::debug("  TESTANY");
-                i++;
+                spdlog::debug("{:04d}:   TESTANY", i);
                 break;
             case RegexInstrOpCode_TestDigit:
-                spdlog::debug("  TESTDIGIT");
-                i++;
+                spdlog::debug("{:04d}:   TESTDIGIT", i);
                 break;
             case RegexInstrOpCode_TestWord:
-                spdlog::debug("  TESTWORD");
-                i++;
+                spdlog::debug("{:04d}:   TESTWORD", i);
                 break;
             case RegexInstrOpCode_TestWhitespace:
-                spdlog::debug("  TESTWHITESPACE");
-                i++;
+                spdlog::debug("{:04d}:   TESTWHITESPACE", i);
                 break;
             case RegexInstrOpCode_TestLowerCase:
-                spdlog::debug("  TESTLOWERCASE");
-                i++;
+                spdlog::debug("{:04d}:   TESTLOWERCASE", i);
                 break;
             case RegexInstrOpCode_TestUpperCase:
-                spdlog::debug("  TESTUPPERCASE");
-                i++;
+                spdlog::debug("{:04d}:   TESTUPPERCASE", i);
                 break;
-            case RegexInstrOpCode_Jump:
-            case RegexInstrOpCode_JumpEq:
-            case RegexInstrOpCode_JumpNeq:
+            case RegexInstrOpCode_TestClass:
             {
-                int offset = decode_jump(&bytecode[i + 1]);
-                int target = static_cast<int>(i) + 5 + offset;
-
-                switch(static_cast<std::uint8_t>(bytecode[i]))
-                {
-                    case RegexInstrOpCode_Jump:
-                        spdlog::debug("  JUMP {}{} -> {:04d}", offset > 0 ? "+" : "", offset, target);
-                        break;
-                    case RegexInstrOpCode_JumpEq:
-                        spdlog::debug("  JUMPEQ {}{} -> {:04d}", offset > 0 ? "+" : "", offset, target);
-                        break;
-                    case RegexInstrOpCode_JumpNeq:
-                        spdlog::debug("  JUMPNEQ {}{} -> {:04d}", offset > 0 ? "+" : "", offset, target);
-                        break;
-                    default:
-                        break;
-                }
+                StringD set;
 
-                i += 5;
+                for(unsigned int c = 0; c < 256; ++c)
+                    if(regex_test_char(bytecode, i, static_cast<unsigned char>(c)) && c >= 32 && c < 127)
+                        set.push_back(static_cast<char>(c));
 
+                spdlog::debug("{:04d}:   TESTCLASS [{}]", i, set);
                 break;
             }
+            case RegexInstrOpCode_Jump:
+                spdlog::debug("{:04d}:   JUMP -> {:04d}", i, jump_target(bytecode, i, i + 1, REGEX_JUMP_SIZE));
+                break;
+            case RegexInstrOpCode_Split:
+                spdlog::debug("{:04d}:   SPLIT -> {:04d}, {:04d}",
+                              i,
+                              jump_target(bytecode, i, i + 1, REGEX_SPLIT_SIZE),
+                              jump_target(bytecode, i, i + 5, REGEX_SPLIT_SIZE));
+                break;
             case RegexInstrOpCode_Accept:
-                spdlog::debug("  ACCEPT");
-                i++;
+                spdlog::debug("{:04d}:   ACCEPT", i);
                 break;
-            case RegexInstrOpCode_Fail:
-                spdlog::debug("  FAIL");
-                i++;
+            case RegexInstrOpCode_AcceptPattern:
+                spdlog::debug("{:04d}:   ACCEPTPATTERN {}", i, decode_jump(&bytecode[i + 1]));
                 break;
             case RegexInstrOpCode_GroupStart:
-                spdlog::debug("  GROUPSTART {}", static_cast<std::uint8_t>(bytecode[i + 1]));
-                i += 2;
+                spdlog::debug("{:04d}:   GROUPSTART {}", i, static_cast<std::uint8_t>(bytecode[i + 1]));
                 break;
             case RegexInstrOpCode_GroupEnd:
-                spdlog::debug("  GROUPEND {}", static_cast<std::uint8_t>(bytecode[i + 1]));
-                i += 2;
-                break;
-            case RegexInstrOpCode_IncPos:
-                spdlog::debug("  INCPOS");
-                i++;
-                break;
-            case RegexInstrOpCode_IncPosEq:
-                spdlog::debug("  INCPOSEQ");
-                i++;
-                break;
-            case RegexInstrOpCode_SetFlag:
-                spdlog::debug("  SETFLAG {}", static_cast<std::uint8_t>(bytecode[i + 1]));
-                i += 2;
+                spdlog::debug("{:04d}:   GROUPEND {}", i, static_cast<std::uint8_t>(bytecode[i + 1]));
                 break;
             default:
-                spdlog::debug("  UNKNOWN 0x{:02x}", static_cast<std::uint8_t>(bytecode[i]));
-                i++;
+                spdlog::debug("{:04d}:   UNKNOWN 0x{:02x}", i, static_cast<std::uint8_t>(bytecode[i]));
                 break;
         }
+
+        i += regex_instr_size(bytecode, i);
     }
 }
 
@@ -686,262 +739,1395 @@ static void regex_disasm(const Regex::ByteCode& bytecode) noexcept
 /* Virtual machine                                                          */
 /* ======================================================================== */
 
-struct RegexVM
-{
-    const Regex::ByteCode& bytecode;
-    const char* str;
-    std::size_t str_len;
-    std::size_t sp;         /* string position (relative to str) */
-    std::size_t pc;         /* program counter */
-    bool status_flag;
+static constexpr std::size_t REGEX_UNSET = std::numeric_limits<std::size_t>::max();
 
-    RegexGroup groups[REGEX_MAX_GROUPS];
-    std::uint32_t group_count;
+/* Sparse set of threads, ordered by priority, each thread owning num_slots capture slots */
+struct RegexThreadList
+{
+    Vector<std::uint32_t> sparse;
+    Vector<std::uint32_t> dense;
+    Vector<std::size_t> slots;
+    std::uint32_t size = 0;
 
-    RegexVM(const Regex::ByteCode& bc, const char* s, std::size_t slen, std::uint32_t gc)
-        : bytecode(bc), str(s), str_len(slen), sp(0), pc(0),
-          status_flag(false), group_count(gc)
+    void prepare(std::size_t program_size, std::size_t num_slots) noexcept
     {
-        for(std::uint32_t i = 0; i < REGEX_MAX_GROUPS; ++i)
+        if(this->sparse.size() < program_size)
         {
-            groups[i] = RegexGroup();
+            this->sparse = Vector<std::uint32_t>(program_size, 0);
+            this->dense = Vector<std::uint32_t>(program_size, 0);
         }
+
+        if(this->slots.size() < program_size * num_slots)
+            this->slots = Vector<std::size_t>(program_size * num_slots, REGEX_UNSET);
+
+        this->size = 0;
+    }
+
+    STDROMANO_FORCE_INLINE bool contains(std::uint32_t pc) const noexcept
+    {
+        const std::uint32_t index = this->sparse[pc];
+        return index < this->size && this->dense[index] == pc;
+    }
+
+    STDROMANO_FORCE_INLINE std::uint32_t insert(std::uint32_t pc) noexcept
+    {
+        const std::uint32_t index = this->size++;
+        this->dense[index] = pc;
+        this->sparse[pc] = index;
+        return index;
     }
 };
 
-bool regex_exec(RegexVM* vm) noexcept
+/* Pending work of the epsilon-closure: explore a pc, or restore a capture slot once explored */
+struct RegexFrame
+{
+    std::uint32_t pc;
+    std::uint32_t slot;
+    std::size_t value;
+};
+
+static constexpr std::uint32_t REGEX_FRAME_EXPLORE = std::numeric_limits<std::uint32_t>::max();
+
+struct RegexVM
 {
-    while(vm->pc < vm->bytecode.size())
+    const Regex::ByteCode* bytecode = nullptr;
+    std::size_t num_slots = 0;
+
+    RegexThreadList lists[2];
+    Vector<RegexFrame> stack;
+    Vector<std::size_t> scratch;
+    Vector<std::size_t> matched_slots;
+
+    void prepare(const Regex::ByteCode& bc, std::uint32_t group_count) noexcept
     {
-        std::uint8_t opcode = static_cast<std::uint8_t>(vm->bytecode[vm->pc]);
+        this->bytecode = &bc;
+        this->num_slots = 2 * std::min<std::size_t>(group_count, REGEX_MAX_GROUPS);
+
+        this->lists[0].prepare(bc.size(), this->num_slots);
+        this->lists[1].prepare(bc.size(), this->num_slots);
 
-        switch(opcode)
+        if(this->scratch.size() < this->num_slots)
         {
-            case RegexInstrOpCode_TestSingle:
-            {
-                if(vm->sp >= vm->str_len)
-                {
-                    vm->status_flag = false;
-                    vm->pc += 2;
-                }
-                else
-                {
-                    vm->status_flag = vm->str[vm->sp] == CHAR(vm->bytecode[vm->pc + 1]);
-                    vm->pc += 2;
-                }
+            this->scratch = Vector<std::size_t>(this->num_slots, REGEX_UNSET);
+            this->matched_slots = Vector<std::size_t>(this->num_slots, REGEX_UNSET);
+        }
 
-                break;
+        this->stack.clear();
+    }
+
+    /* Follow the epsilon transitions from pc at position sp, adding the reached consuming/accepting
+       instructions to the list in priority order, with a copy of the scratch capture slots */
+    void add_thread(RegexThreadList& list, std::size_t start_pc, std::size_t sp) noexcept
+    {
+        const Regex::ByteCode& code = *this->bytecode;
+
+        this->stack.push_back({ static_cast<std::uint32_t>(start_pc), REGEX_FRAME_EXPLORE, 0 });
+
+        while(!this->stack.empty())
+        {
+            const RegexFrame frame = this->stack.pop_back();
+
+            if(frame.slot != REGEX_FRAME_EXPLORE)
+            {
+                this->scratch[frame.slot] = frame.value;
+                continue;
             }
-            case RegexInstrOpCode_TestNegatedSingle:
+
+            std::uint32_t pc = frame.pc;
+
+            while(!list.contains(pc))
             {
-                if(vm->sp >= vm->str_len)
-                {
-                    vm->status_flag = false;
-                    vm->pc += 2;
-                }
-                else
+                const std::uint32_t index = list.insert(pc);
+
+                switch(static_cast<std::uint8_t>(code[pc]))
                 {
-                    vm->status_flag = vm->str[vm->sp] != CHAR(vm->bytecode[vm->pc + 1]);
-                    vm->pc += 2;
+                    case RegexInstrOpCode_Jump:
+                        pc = static_cast<std::uint32_t>(jump_target(code, pc, pc + 1, REGEX_JUMP_SIZE));
+                        continue;
+                    case RegexInstrOpCode_Split:
+                        this->stack.push_back({ static_cast<std::uint32_t>(jump_target(code, pc, pc + 5, REGEX_SPLIT_SIZE)),
+                                                REGEX_FRAME_EXPLORE,
+                                                0 });
+                        pc = static_cast<std::uint32_t>(jump_target(code, pc, pc + 1, REGEX_SPLIT_SIZE));
+                        continue;
+                    case RegexInstrOpCode_GroupStart:
+                    case RegexInstrOpCode_GroupEnd:
+                    {
+                        const std::size_t slot = 2 * static_cast<std::size_t>(code[pc + 1]) +
+                                                 (static_cast<std::uint8_t>(code[pc]) == RegexInstrOpCode_GroupEnd ? 1 : 0);
+
+                        if(slot < this->num_slots)
+                        {
+                            this->stack.push_back({ 0, static_cast<std::uint32_t>(slot), this->scratch[slot] });
+                            this->scratch[slot] = sp;
+                        }
+
+                        pc += 2;
+                        continue;
+                    }
+                    default:
+                        std::memcpy(list.slots.data() + index * this->num_slots,
+                                    this->scratch.data(),
+                                    this->num_slots * sizeof(std::size_t));
+                        break;
                 }
 
                 break;
             }
-            case RegexInstrOpCode_TestRange:
+        }
+    }
+
+    /* Runs the program from start, returns true on match with the slots of the highest priority
+       match in matched_slots. When unanchored a new thread is started at every position until a
+       match is found (skipping to the next occurence of prefix when no thread is alive), and when
+       earliest the first match found is returned */
+    bool exec(const char* str,
+              std::size_t str_len,
+              std::size_t start,
+              bool unanchored = false,
+              bool earliest = false,
+              const StringD* prefix = nullptr) noexcept
+    {
+        const Regex::ByteCode& code = *this->bytecode;
+
+        RegexThreadList* clist = &this->lists[0];
+        RegexThreadList* nlist = &this->lists[1];
+
+        clist->size = 0;
+
+        bool matched = false;
+
+        for(std::size_t sp = start; ; ++sp)
+        {
+            /* The thread starting at this position has the lowest priority */
+            if(sp == start || (unanchored && !matched))
             {
-                if(vm->sp >= vm->str_len)
-                {
-                    vm->status_flag = false;
-                    vm->pc += 3;
-                }
-                else
+                if(clist->size == 0 && prefix != nullptr && !prefix->empty())
                 {
-                    vm->status_flag = vm->str[vm->sp] >= CHAR(vm->bytecode[vm->pc + 1]) &&
-                                      vm->str[vm->sp] <= CHAR(vm->bytecode[vm->pc + 2]);
-                    vm->pc += 3;
+                    const char* found = strfind(str + sp, str_len - sp, prefix->data(), prefix->size());
+
+                    if(found == nullptr)
+                        break;
+
+                    sp = static_cast<std::size_t>(found - str);
                 }
 
-                break;
+                for(std::size_t s = 0; s < this->num_slots; ++s)
+                    this->scratch[s] = REGEX_UNSET;
+
+                this->add_thread(*clist, 0, sp);
             }
-            case RegexInstrOpCode_TestNegatedRange:
-            {
-                if(vm->sp >= vm->str_len)
-                {
-                    vm->status_flag = false;
-                    vm->pc += 3;
-                }
-                else
-                {
-                    vm->status_flag = vm->str[vm->sp] < CHAR(vm->bytecode[vm->pc + 1]) ||
-                                      vm->str[vm->sp] > CHAR(vm->bytecode[vm->pc + 2]);
-                    vm->pc += 3;
-                }
 
+            if(clist->size == 0)
                 break;
-            }
-            case RegexInstrOpCode_TestAny:
-            {
-                if(vm->sp >= vm->str_len)
-                {
-                    vm->status_flag = false;
-                }
-                else
-                {
-                    vm->status_flag = (vm->str[vm->sp] != '\n');
-                }
 
-                vm->pc += 1;
+            nlist->size = 0;
 
-                break;
-            }
-            case RegexInstrOpCode_TestDigit:
+            const bool at_end = sp >= str_len;
+            const unsigned char c = at_end ? 0 : static_cast<unsigned char>(str[sp]);
+
+            for(std::uint32_t i = 0; i < clist->size; ++i)
             {
-                if(vm->sp >= vm->str_len)
-                    vm->status_flag = false;
-                else
-                    vm->status_flag = std::isdigit(static_cast<unsigned char>(vm->str[vm->sp]));
+                const std::uint32_t pc = clist->dense[i];
+                const std::size_t* slots = clist->slots.data() + i * this->num_slots;
 
-                vm->pc += 1;
+                const std::uint8_t op = static_cast<std::uint8_t>(code[pc]);
 
-                break;
-            }
-            case RegexInstrOpCode_TestWord:
-            {
-                if(vm->sp >= vm->str_len)
-                    vm->status_flag = false;
-                else
+                if(op == RegexInstrOpCode_Accept || op == RegexInstrOpCode_AcceptPattern)
                 {
-                    char c = vm->str[vm->sp];
-                    vm->status_flag = std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+                    std::memcpy(this->matched_slots.data(), slots, this->num_slots * sizeof(std::size_t));
+                    matched = true;
+
+                    /* Leftmost-first: lower priority threads are cut */
+                    break;
                 }
 
-                vm->pc += 1;
+                if(op < RegexInstrOpCode_Jump && !at_end && regex_test_char(code, pc, c))
+                {
+                    std::memcpy(this->scratch.data(), slots, this->num_slots * sizeof(std::size_t));
+                    this->add_thread(*nlist, pc + regex_instr_size(code, pc), sp + 1);
+                }
+            }
 
+            if(at_end || (matched && earliest))
                 break;
-            }
-            case RegexInstrOpCode_TestWhitespace:
-            {
-                if(vm->sp >= vm->str_len)
-                    vm->status_flag = false;
-                else
-                    vm->status_flag = std::isspace(static_cast<unsigned char>(vm->str[vm->sp]));
 
-                vm->pc += 1;
+            std::swap(clist, nlist);
+        }
 
-                break;
-            }
-            case RegexInstrOpCode_TestLowerCase:
-            {
-                if(vm->sp >= vm->str_len)
-                    vm->status_flag = false;
-                else
-                    vm->status_flag = std::islower(static_cast<unsigned char>(vm->str[vm->sp]));
+        return matched;
+    }
 
-                vm->pc += 1;
+    /* Unanchored run of a RegexSet program, marking every pattern matching somewhere in str */
+    void exec_set(const char* str, std::size_t str_len, std::uint8_t* matched, std::size_t num_patterns) noexcept
+    {
+        const Regex::ByteCode& code = *this->bytecode;
 
-                break;
+        RegexThreadList* clist = &this->lists[0];
+        RegexThreadList* nlist = &this->lists[1];
+
+        clist->size = 0;
+
+        std::size_t num_matched = 0;
+
+        for(std::size_t sp = 0; num_matched < num_patterns; ++sp)
+        {
+            this->add_thread(*clist, 0, sp);
+
+            nlist->size = 0;
+
+            const bool at_end = sp >= str_len;
+            const unsigned char c = at_end ? 0 : static_cast<unsigned char>(str[sp]);
+
+            for(std::uint32_t i = 0; i < clist->size; ++i)
+            {
+                const std::uint32_t pc = clist->dense[i];
+                const std::uint8_t op = static_cast<std::uint8_t>(code[pc]);
+
+                if(op == RegexInstrOpCode_AcceptPattern)
+                {
+                    const std::size_t pattern = static_cast<std::size_t>(decode_jump(&code[pc + 1]));
+
+                    num_matched += matched[pattern] == 0 ? 1 : 0;
+                    matched[pattern] = 1;
+                }
+                else if(op < RegexInstrOpCode_Jump && !at_end && regex_test_char(code, pc, c))
+                {
+                    this->add_thread(*nlist, pc + regex_instr_size(code, pc), sp + 1);
+                }
             }
-            case RegexInstrOpCode_TestUpperCase:
+
+            if(at_end)
+                break;
+
+            std::swap(clist, nlist);
+        }
+    }
+};
+
+/* Scratch VM reused across the calls on the same thread, to avoid allocating per match */
+static RegexVM& regex_thread_vm() noexcept
+{
+    static thread_local RegexVM vm;
+    return vm;
+}
+
+/* ======================================================================== */
+/* Lazy DFA                                                                 */
+/* ======================================================================== */
+
+/*
+    DFA states are built on demand from the NFA program: a state is the ordered list of the
+    consuming/accepting instructions the threads are at (captures are ignored), and transitions
+    are computed the first time a byte is seen in a state. The ordering of the list keeps the
+    thread priorities, so the DFA finds the same leftmost-first match end as the Pike VM.
+
+    The cache is flushed when it exceeds its budget, and the DFA gives up (the caller falls back
+    to the Pike VM) when it keeps flushing during a single run.
+
+    Each thread keeps the DFAs of its most recently used programs, up to REGEX_DFA_MAX_CACHED of
+    them and REGEX_DFA_CACHE_TOTAL_SIZE bytes of states in total. The DFAs of destroyed programs
+    are dropped on the next cache miss.
+*/
+
+static constexpr std::size_t REGEX_DFA_CACHE_SIZE = 2 * 1024 * 1024;
+static constexpr std::size_t REGEX_DFA_MAX_FLUSHES = 8;
+static constexpr std::size_t REGEX_DFA_MAX_CACHED = 64;
+static constexpr std::size_t REGEX_DFA_CACHE_TOTAL_SIZE = 8 * 1024 * 1024;
+
+static constexpr std::int32_t REGEX_DFA_UNKNOWN = -1;
+static constexpr std::int32_t REGEX_DFA_DEAD = -2;
+static constexpr std::int32_t REGEX_DFA_GAVE_UP = -3;
+
+enum RegexDFAResult_ : std::uint32_t
+{
+    RegexDFAResult_NoMatch,
+    RegexDFAResult_Match,
+    RegexDFAResult_GaveUp,
+};
+
+struct RegexDFA
+{
+    bool unanchored;
+
+    /* RegexSet programs: every pattern is matched, so no thread is cut after a match */
+    bool set_mode;
+
+    HashMap<StringD, std::int32_t> state_ids;
+    Vector<std::uint32_t> state_pcs;     /* pcs of all the states, concatenated */
+    Vector<std::uint32_t> state_offsets; /* start of each state in state_pcs, plus the end */
+    Vector<std::uint8_t> state_is_match;
+    Vector<std::int32_t> transitions;    /* 256 per state */
+
+    std::int32_t start_state = REGEX_DFA_UNKNOWN;
+    std::size_t memory_usage = 0;
+    std::size_t num_flushes = 0;
+
+    /* Scratch buffers of the closure computation */
+    RegexThreadList set;
+    Vector<std::uint32_t> stack;
+    Vector<std::uint32_t> pcs;
+
+    RegexDFA(bool unanchored_, bool set_mode_) : unanchored(unanchored_), set_mode(set_mode_) {}
+
+    void flush() noexcept
+    {
+        this->state_ids.clear();
+        this->state_pcs.clear();
+        this->state_offsets.clear();
+        this->state_is_match.clear();
+        this->transitions.clear();
+        this->start_state = REGEX_DFA_UNKNOWN;
+        this->memory_usage = 0;
+        this->num_flushes++;
+    }
+
+    /* Add the instructions reachable from pc through epsilon transitions to the set, in priority order */
+    void closure(const Regex::ByteCode& code, std::uint32_t start_pc) noexcept
+    {
+        this->stack.push_back(start_pc);
+
+        while(!this->stack.empty())
+        {
+            std::uint32_t pc = this->stack.pop_back();
+
+            while(!this->set.contains(pc))
             {
-                if(vm->sp >= vm->str_len)
-                    vm->status_flag = false;
-                else
-                    vm->status_flag = std::isupper(static_cast<unsigned char>(vm->str[vm->sp]));
+                this->set.insert(pc);
+
+                switch(static_cast<std::uint8_t>(code[pc]))
+                {
+                    case RegexInstrOpCode_Jump:
+                        pc = static_cast<std::uint32_t>(jump_target(code, pc, pc + 1, REGEX_JUMP_SIZE));
+                        continue;
+                    case RegexInstrOpCode_Split:
+                        this->stack.push_back(static_cast<std::uint32_t>(jump_target(code, pc, pc + 5, REGEX_SPLIT_SIZE)));
+                        pc = static_cast<std::uint32_t>(jump_target(code, pc, pc + 1, REGEX_SPLIT_SIZE));
+                        continue;
+                    case RegexInstrOpCode_GroupStart:
+                    case RegexInstrOpCode_GroupEnd:
+                        pc += 2;
+                        continue;
+                    default:
+                        break;
+                }
+
+                break;
+            }
+        }
+    }
+
+    /* Turns the content of the set into a state, returns its id */
+    std::int32_t add_state(const Regex::ByteCode& code) noexcept
+    {
+        this->pcs.clear();
+
+        bool is_match = false;
+
+        for(std::uint32_t i = 0; i < this->set.size; ++i)
+        {
+            const std::uint32_t pc = this->set.dense[i];
+            const std::uint8_t op = static_cast<std::uint8_t>(code[pc]);
+
+            const bool accept = op == RegexInstrOpCode_Accept || op == RegexInstrOpCode_AcceptPattern;
+
+            if(op < RegexInstrOpCode_Jump || accept)
+                this->pcs.push_back(pc);
+
+            is_match |= accept;
+        }
+
+        if(this->pcs.empty())
+            return REGEX_DFA_DEAD;
+
+        /* StringD copies the byte after the key too (its null terminator), a zeroed word keeps that
+           read in the buffer */
+        const std::size_t key_size = this->pcs.size() * sizeof(std::uint32_t);
+
+        this->pcs.push_back(0);
+
+        const StringD key(reinterpret_cast<const char*>(this->pcs.data()), key_size);
+
+        this->pcs.pop_back();
+
+        const auto it = this->state_ids.find(key);
+
+        if(it != this->state_ids.end())
+            return it->second;
+
+        const std::int32_t id = static_cast<std::int32_t>(this->state_is_match.size());
+
+        if(this->state_offsets.empty())
+            this->state_offsets.push_back(0);
+
+        for(const std::uint32_t pc : this->pcs)
+            this->state_pcs.push_back(pc);
+
+        this->state_offsets.push_back(static_cast<std::uint32_t>(this->state_pcs.size()));
+        this->state_is_match.push_back(is_match ? 1 : 0);
+
+        for(std::size_t c = 0; c < 256; ++c)
+            this->transitions.push_back(REGEX_DFA_UNKNOWN);
+
+        this->state_ids.insert(std::make_pair(key, id));
+
+        this->memory_usage += 256 * sizeof(std::int32_t) + 3 * key.size() + 64;
+
+        return id;
+    }
+
+    std::int32_t compute_start(const Regex::ByteCode& code) noexcept
+    {
+        this->set.prepare(code.size(), 0);
+        this->closure(code, 0);
+        this->start_state = this->add_state(code);
+
+        return this->start_state;
+    }
+
+    /* Computes the transition from state on byte c, flushing the cache when it is full */
+    std::int32_t compute_next(const Regex::ByteCode& code, std::int32_t state, unsigned char c) noexcept
+    {
+        this->set.prepare(code.size(), 0);
+
+        for(std::uint32_t i = this->state_offsets[state]; i < this->state_offsets[state + 1]; ++i)
+        {
+            const std::uint32_t pc = this->state_pcs[i];
+
+            const std::uint8_t op = static_cast<std::uint8_t>(code[pc]);
+
+            /* Leftmost-first: the threads after a match have a lower priority and are cut */
+            if((op == RegexInstrOpCode_Accept || op == RegexInstrOpCode_AcceptPattern) && !this->set_mode)
+                break;
+
+            if(regex_test_char(code, pc, c))
+                this->closure(code, static_cast<std::uint32_t>(pc + regex_instr_size(code, pc)));
+        }
+
+        /* Unanchored search: a new thread starts at every position, with the lowest priority */
+        if(this->unanchored)
+            this->closure(code, 0);
+
+        if(this->memory_usage > REGEX_DFA_CACHE_SIZE)
+        {
+            if(this->num_flushes >= REGEX_DFA_MAX_FLUSHES)
+                return REGEX_DFA_GAVE_UP;
+
+            /* The set is kept, the next state is rebuilt in the empty cache */
+            this->flush();
+
+            return this->add_state(code);
+        }
+
+        const std::int32_t next = this->add_state(code);
+
+        this->transitions[static_cast<std::size_t>(state) * 256 + c] = next;
+
+        return next;
+    }
+
+    /* Runs from start, for an anchored DFA match_end is the end of the leftmost-first match,
+       for an unanchored DFA it is the end of the earliest match */
+    RegexDFAResult_ run(const Regex::ByteCode& code,
+                        const char* str,
+                        std::size_t str_len,
+                        std::size_t start,
+                        const StringD& prefix,
+                        std::size_t* match_end) noexcept
+    {
+        this->num_flushes = 0;
+
+        std::int32_t state = this->start_state != REGEX_DFA_UNKNOWN ? this->start_state : this->compute_start(code);
+
+        if(state == REGEX_DFA_DEAD)
+            return RegexDFAResult_NoMatch;
+
+        bool matched = false;
+
+        if(this->state_is_match[state])
+        {
+            *match_end = start;
+            matched = true;
+
+            if(this->unanchored)
+                return RegexDFAResult_Match;
+        }
+
+        for(std::size_t sp = start; sp < str_len; ++sp)
+        {
+            /* Only the thread starting at this position is alive, skip to the next possible start */
+            if(this->unanchored && state == this->start_state && !prefix.empty())
+            {
+                const char* found = strfind(str + sp, str_len - sp, prefix.data(), prefix.size());
+
+                if(found == nullptr)
+                    break;
+
+                sp = static_cast<std::size_t>(found - str);
+            }
+
+            const unsigned char c = static_cast<unsigned char>(str[sp]);
+
+            std::int32_t next = this->transitions[static_cast<std::size_t>(state) * 256 + c];
+
+            if(next == REGEX_DFA_UNKNOWN)
+                next = this->compute_next(code, state, c);
+
+            if(next == REGEX_DFA_GAVE_UP)
+                return RegexDFAResult_GaveUp;
+
+            if(next == REGEX_DFA_DEAD)
+                break;
+
+            state = next;
+
+            if(this->state_is_match[state])
+            {
+                *match_end = sp + 1;
+                matched = true;
+
+                if(this->unanchored)
+                    return RegexDFAResult_Match;
+            }
+        }
+
+        return matched ? RegexDFAResult_Match : RegexDFAResult_NoMatch;
+    }
+
+    /* Marks the patterns of the matching states reached. Scans the whole input, unless all the
+       patterns have matched */
+    RegexDFAResult_ run_set(const Regex::ByteCode& code,
+                            const char* str,
+                            std::size_t str_len,
+                            std::uint8_t* matched,
+                            std::size_t num_patterns) noexcept
+    {
+        this->num_flushes = 0;
+
+        std::size_t num_matched = 0;
+
+        const auto mark = [&](std::int32_t state) noexcept {
+            for(std::uint32_t i = this->state_offsets[state]; i < this->state_offsets[state + 1]; ++i)
+            {
+                const std::uint32_t pc = this->state_pcs[i];
+
+                if(static_cast<std::uint8_t>(code[pc]) != RegexInstrOpCode_AcceptPattern)
+                    continue;
+
+                const std::size_t pattern = static_cast<std::size_t>(decode_jump(&code[pc + 1]));
+
+                num_matched += matched[pattern] == 0 ? 1 : 0;
+                matched[pattern] = 1;
+            }
+        };
+
+        std::int32_t state = this->start_state != REGEX_DFA_UNKNOWN ? this->start_state : this->compute_start(code);
+
+        if(state == REGEX_DFA_DEAD)
+            return RegexDFAResult_NoMatch;
+
+        if(this->state_is_match[state])
+            mark(state);
+
+        for(std::size_t sp = 0; sp < str_len && num_matched < num_patterns; ++sp)
+        {
+            const unsigned char c = static_cast<unsigned char>(str[sp]);
+
+            std::int32_t next = this->transitions[static_cast<std::size_t>(state) * 256 + c];
+
+            if(next == REGEX_DFA_UNKNOWN)
+                next = this->compute_next(code, state, c);
+
+            if(next == REGEX_DFA_GAVE_UP)
+                return RegexDFAResult_GaveUp;
+
+            if(next == REGEX_DFA_DEAD)
+                break;
+
+            state = next;
+
+            if(this->state_is_match[state])
+                mark(state);
+        }
+
+        return num_matched > 0 ? RegexDFAResult_Match : RegexDFAResult_NoMatch;
+    }
+};
+
+/* Per-thread DFAs of the programs, keyed by program id, so the lazy states need no locking */
+struct RegexDFACacheEntry
+{
+    RegexDFA* dfa;
+    std::uint64_t last_use;
+
+    /* Expires when the program is destroyed, its DFA is then dropped */
+    std::weak_ptr<const Regex::Program> program;
+};
+
+struct RegexDFACache
+{
+    HashMap<std::uint64_t, RegexDFACacheEntry> dfas;
+    std::uint64_t clock = 0;
+
+    /* Sum of the memory usage of the DFAs */
+    std::size_t memory_usage = 0;
+
+    /* Scratch buffer of drop_expired */
+    Vector<std::uint64_t> expired;
+
+    ~RegexDFACache()
+    {
+        this->clear();
+    }
+
+    void clear() noexcept
+    {
+        for(auto& it : this->dfas)
+            delete it.second.dfa;
+
+        this->dfas.clear();
+        this->memory_usage = 0;
+    }
+
+    void erase(std::uint64_t key) noexcept
+    {
+        const auto it = this->dfas.find(key);
+
+        this->memory_usage -= it->second.dfa->memory_usage;
+
+        delete it->second.dfa;
+        this->dfas.erase(it);
+    }
+
+    /* Evicts the least recently used DFA, so that cycling through many programs does not throw
+       away the states of the hot ones */
+    void evict_one() noexcept
+    {
+        auto lru = this->dfas.begin();
+
+        for(auto it = this->dfas.begin(); it != this->dfas.end(); ++it)
+            if(it->second.last_use < lru->second.last_use)
+                lru = it;
+
+        this->erase(lru->first);
+    }
+
+    /* Drops the DFAs of the programs that have been destroyed */
+    void drop_expired() noexcept
+    {
+        this->expired.clear();
+
+        for(auto& it : this->dfas)
+            if(it.second.program.expired())
+                this->expired.push_back(it.first);
+
+        for(const std::uint64_t key : this->expired)
+            this->erase(key);
+    }
+
+    RegexDFA* get(const std::shared_ptr<const Regex::Program>& program, bool unanchored, bool set_mode) noexcept
+    {
+        const std::uint64_t key = program->id * 4 + (unanchored ? 1 : 0) + (set_mode ? 2 : 0);
+
+        const auto it = this->dfas.find(key);
+
+        if(it != this->dfas.end())
+        {
+            it->second.last_use = ++this->clock;
+            return it->second.dfa;
+        }
+
+        this->drop_expired();
+
+        if(this->dfas.size() >= REGEX_DFA_MAX_CACHED)
+            this->evict_one();
+
+        RegexDFA* dfa = new RegexDFA(unanchored, set_mode);
+        this->dfas.insert(std::make_pair(key, RegexDFACacheEntry{ dfa, ++this->clock, program }));
+
+        return dfa;
+    }
+
+    /* Accounts for the states added (or flushed) by a run of dfa, and evicts the least recently
+       used DFAs (dfa being the most recently used one) while the cache is over its budget */
+    void update(const RegexDFA* dfa, std::size_t memory_usage_before) noexcept
+    {
+        this->memory_usage = this->memory_usage - memory_usage_before + dfa->memory_usage;
+
+        while(this->memory_usage > REGEX_DFA_CACHE_TOTAL_SIZE && this->dfas.size() > 1)
+            this->evict_one();
+    }
+};
+
+static thread_local RegexDFACache g_regex_dfa_cache;
+
+static RegexDFAResult_ regex_dfa_run(const std::shared_ptr<const Regex::Program>& program,
+                                     bool unanchored,
+                                     const StringD& str,
+                                     std::size_t start,
+                                     const StringD& prefix,
+                                     std::size_t* match_end) noexcept
+{
+    RegexDFA* dfa = g_regex_dfa_cache.get(program, unanchored, false);
+
+    const std::size_t memory_usage = dfa->memory_usage;
+
+    const RegexDFAResult_ result = dfa->run(program->bytecode, str.data(), str.size(), start, prefix, match_end);
+
+    g_regex_dfa_cache.update(dfa, memory_usage);
+
+    return result;
+}
+
+static RegexDFAResult_ regex_dfa_run_set(const std::shared_ptr<const Regex::Program>& program,
+                                         const StringD& str,
+                                         std::uint8_t* matched,
+                                         std::size_t num_patterns) noexcept
+{
+    RegexDFA* dfa = g_regex_dfa_cache.get(program, true, true);
+
+    const std::size_t memory_usage = dfa->memory_usage;
+
+    const RegexDFAResult_ result = dfa->run_set(program->bytecode, str.data(), str.size(), matched, num_patterns);
+
+    g_regex_dfa_cache.update(dfa, memory_usage);
+
+    return result;
+}
+
+static Atomic<std::uint64_t> g_regex_next_program_id(1);
+
+/* ======================================================================== */
+/* JIT (x86-64)                                                             */
+/* ======================================================================== */
+
+/*
+    Programs with at most 64 consuming/accepting instructions are translated to native code
+    running the NFA bit-parallel: the active instructions are the bits of a register, the
+    epsilon-closures are computed at translation time, and each consuming instruction becomes an
+    inline test of the current byte (compare for single chars and ranges, 256-bit bitmap
+    otherwise), without any dispatch. Captures are not tracked, the code only tells if (and where
+    the earliest) match ends.
+
+    When only the start instructions are active in an unanchored search, the input is skipped 16
+    bytes at a time with SSE2 to the next byte that can start a match (up to 3 distinct bytes, or
+    a single range).
+*/
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define STDROMANO_REGEX_JIT
+#endif /* defined(__x86_64__) || defined(_M_X64) */
+
+#if defined(STDROMANO_REGEX_JIT)
+
+static constexpr std::size_t REGEX_JIT_MAX_STATES = 64;
+
+/* NFA of a program, each state being a consuming or an accepting instruction */
+struct RegexJitNFA
+{
+    Vector<std::uint32_t> state_pcs;
+    Vector<std::uint64_t> follow;     /* closure after consuming, per state */
+    Vector<std::uint64_t> bitmaps;    /* 256-bit set of the bytes consumed, 4 per state */
+
+    std::uint64_t start_mask = 0;
+    std::uint64_t accept_mask = 0;
+
+    bool build(const Regex::ByteCode& code) noexcept
+    {
+        Vector<std::int32_t> state_of_pc(code.size(), -1);
+
+        for(std::size_t pc = 0; pc < code.size(); pc += regex_instr_size(code, pc))
+        {
+            const std::uint8_t op = static_cast<std::uint8_t>(code[pc]);
+
+            if(op >= RegexInstrOpCode_Jump && op != RegexInstrOpCode_Accept && op != RegexInstrOpCode_AcceptPattern)
+                continue;
+
+            if(this->state_pcs.size() == REGEX_JIT_MAX_STATES)
+                return false;
+
+            state_of_pc[pc] = static_cast<std::int32_t>(this->state_pcs.size());
+            this->state_pcs.push_back(static_cast<std::uint32_t>(pc));
+
+            if(op >= RegexInstrOpCode_Jump)
+            {
+                this->accept_mask |= std::uint64_t(1) << state_of_pc[pc];
+
+                for(std::size_t w = 0; w < 4; ++w)
+                    this->bitmaps.push_back(0);
+
+                continue;
+            }
+
+            for(std::size_t w = 0; w < 4; ++w)
+            {
+                std::uint64_t bits = 0;
+
+                for(std::size_t b = 0; b < 64; ++b)
+                {
+                    if(regex_test_char(code, pc, static_cast<unsigned char>(w * 64 + b)))
+                        bits |= std::uint64_t(1) << b;
+                }
+
+                this->bitmaps.push_back(bits);
+            }
+        }
+
+        RegexThreadList set;
+        Vector<std::uint32_t> stack;
+
+        const auto closure = [&](std::size_t start_pc) noexcept {
+            std::uint64_t mask = 0;
+
+            set.prepare(code.size(), 0);
+            stack.push_back(static_cast<std::uint32_t>(start_pc));
+
+            while(!stack.empty())
+            {
+                std::uint32_t pc = stack.pop_back();
+
+                while(!set.contains(pc))
+                {
+                    set.insert(pc);
+
+                    switch(static_cast<std::uint8_t>(code[pc]))
+                    {
+                        case RegexInstrOpCode_Jump:
+                            pc = static_cast<std::uint32_t>(jump_target(code, pc, pc + 1, REGEX_JUMP_SIZE));
+                            continue;
+                        case RegexInstrOpCode_Split:
+                            stack.push_back(static_cast<std::uint32_t>(jump_target(code, pc, pc + 5, REGEX_SPLIT_SIZE)));
+                            pc = static_cast<std::uint32_t>(jump_target(code, pc, pc + 1, REGEX_SPLIT_SIZE));
+                            continue;
+                        case RegexInstrOpCode_GroupStart:
+                        case RegexInstrOpCode_GroupEnd:
+                            pc += 2;
+                            continue;
+                        default:
+                            mask |= std::uint64_t(1) << state_of_pc[pc];
+                            break;
+                    }
+
+                    break;
+                }
+            }
+
+            return mask;
+        };
+
+        this->start_mask = closure(0);
+
+        for(const std::uint32_t pc : this->state_pcs)
+        {
+            const bool accept = static_cast<std::uint8_t>(code[pc]) >= RegexInstrOpCode_Jump;
+            this->follow.push_back(accept ? 0 : closure(pc + regex_instr_size(code, pc)));
+        }
+
+        return true;
+    }
+};
+
+/* Minimal x86-64 encoder for the JIT, jumps are always rel32 */
+struct RegexJitAssembler
+{
+    Vector<std::uint8_t> code;
+    Vector<std::uint8_t> data;
+
+    /* rip-relative displacements to patch once the data is placed after the code */
+    Vector<std::pair<std::size_t, std::size_t>> data_refs;
+
+    /* Jumps to patch once their label is bound */
+    Vector<std::pair<std::size_t, std::size_t>> jump_refs;
+    Vector<std::size_t> labels;
+
+    void emit(std::initializer_list<std::uint8_t> bytes) noexcept
+    {
+        for(const std::uint8_t b : bytes)
+            this->code.push_back(b);
+    }
+
+    void emit_u32(std::uint32_t value) noexcept
+    {
+        for(std::size_t i = 0; i < 4; ++i)
+            this->code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+
+    void emit_u64(std::uint64_t value) noexcept
+    {
+        for(std::size_t i = 0; i < 8; ++i)
+            this->code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+
+    /* Reference to the data at offset, as the disp32 ending the current instruction */
+    void emit_data_ref(std::size_t offset) noexcept
+    {
+        this->data_refs.push_back(std::make_pair(this->code.size(), offset));
+        this->emit_u32(0);
+    }
+
+    std::size_t add_data(const void* bytes, std::size_t size) noexcept
+    {
+        while(this->data.size() % 16 != 0)
+            this->data.push_back(0);
+
+        const std::size_t offset = this->data.size();
+
+        for(std::size_t i = 0; i < size; ++i)
+            this->data.push_back(static_cast<const std::uint8_t*>(bytes)[i]);
+
+        return offset;
+    }
+
+    std::size_t new_label() noexcept
+    {
+        this->labels.push_back(SIZE_MAX);
+        return this->labels.size() - 1;
+    }
+
+    void bind(std::size_t label) noexcept
+    {
+        this->labels[label] = this->code.size();
+    }
+
+    void jmp(std::size_t label) noexcept
+    {
+        this->emit({ 0xE9 });
+        this->jump_refs.push_back(std::make_pair(this->code.size(), label));
+        this->emit_u32(0);
+    }
+
+    /* cc is the low nibble of the 0F 8x opcode: 2 = jb, 3 = jae, 4 = je, 5 = jne, 6 = jbe, 7 = ja */
+    void jcc(std::uint8_t cc, std::size_t label) noexcept
+    {
+        this->emit({ 0x0F, static_cast<std::uint8_t>(0x80 | cc) });
+        this->jump_refs.push_back(std::make_pair(this->code.size(), label));
+        this->emit_u32(0);
+    }
+
+    /* r8/r9/r10 = imm64 */
+    void mov_r64_imm64(std::uint8_t reg, std::uint64_t value) noexcept
+    {
+        this->emit({ 0x49, static_cast<std::uint8_t>(0xB8 + (reg - 8)) });
+        this->emit_u64(value);
+    }
+
+    /* or r9, mask */
+    void or_r9_mask(std::uint64_t mask) noexcept
+    {
+        if(mask < 0x80000000ull)
+        {
+            this->emit({ 0x49, 0x81, 0xC9 });
+            this->emit_u32(static_cast<std::uint32_t>(mask));
+        }
+        else
+        {
+            this->mov_r64_imm64(10, mask);
+            this->emit({ 0x4D, 0x09, 0xD1 });
+        }
+    }
+
+    /* Resolves the jumps and the data references, returns code + data */
+    Vector<std::uint8_t> link() noexcept
+    {
+        for(const auto& ref : this->jump_refs)
+        {
+            const std::int32_t rel = static_cast<std::int32_t>(this->labels[ref.second]) - static_cast<std::int32_t>(ref.first + 4);
+            std::memcpy(&this->code[ref.first], &rel, 4);
+        }
+
+        while(this->code.size() % 16 != 0)
+            this->code.push_back(0xCC);
+
+        const std::size_t data_start = this->code.size();
+
+        for(const auto& ref : this->data_refs)
+        {
+            const std::int32_t rel = static_cast<std::int32_t>(data_start + ref.second) - static_cast<std::int32_t>(ref.first + 4);
+            std::memcpy(&this->code[ref.first], &rel, 4);
+        }
+
+        Vector<std::uint8_t> image = this->code;
+
+        for(const std::uint8_t b : this->data)
+            image.push_back(b);
+
+        return image;
+    }
+};
+
+/*
+    Emits size_t f(const char* str, size_t len, size_t start). Registers:
+    rdi = current position, rsi = end, r11 = str, r8 = active states, r9 = next states,
+    eax = current byte, rcx/r10 = scratch, xmm1-3 = broadcast constants of the skip loop
+*/
+static void regex_jit_emit_function(RegexJitAssembler& a, const RegexJitNFA& nfa, bool unanchored) noexcept
+{
+    const std::size_t num_states = nfa.state_pcs.size();
+
+    const std::size_t loop = a.new_label();
+    const std::size_t body = a.new_label();
+    const std::size_t matched = a.new_label();
+    const std::size_t no_match = a.new_label();
+
+    /* Prologue, arguments moved to rdi, rsi, rdx */
+#if defined(STDROMANO_WIN)
+    a.emit({ 0x57, 0x56 });             /* push rdi; push rsi */
+    a.emit({ 0x48, 0x89, 0xCF });       /* mov rdi, rcx */
+    a.emit({ 0x48, 0x89, 0xD6 });       /* mov rsi, rdx */
+    a.emit({ 0x4C, 0x89, 0xC2 });       /* mov rdx, r8 */
+#endif /* defined(STDROMANO_WIN) */
+
+    a.emit({ 0x49, 0x89, 0xFB });       /* mov r11, rdi */
+    a.emit({ 0x48, 0x01, 0xFE });       /* add rsi, rdi */
+    a.emit({ 0x48, 0x01, 0xD7 });       /* add rdi, rdx */
+    a.mov_r64_imm64(8, nfa.start_mask);
+
+    if(nfa.start_mask & nfa.accept_mask)
+        a.jmp(matched);
+
+    /* Bytes that can start a match, for the skip loop */
+    std::uint64_t first_bytes[4] = { 0, 0, 0, 0 };
+
+    for(std::size_t i = 0; i < num_states; ++i)
+    {
+        if(nfa.start_mask & (std::uint64_t(1) << i))
+        {
+            for(std::size_t w = 0; w < 4; ++w)
+                first_bytes[w] |= nfa.bitmaps[i * 4 + w];
+        }
+    }
+
+    std::uint8_t bytes[3];
+    std::size_t num_bytes = 0;
+    std::size_t range_lo = 256;
+    std::size_t range_hi = 0;
+    std::size_t num_first = 0;
+
+    for(std::size_t c = 0; c < 256; ++c)
+    {
+        if(!((first_bytes[c / 64] >> (c % 64)) & 1))
+            continue;
+
+        if(num_bytes < 3)
+            bytes[num_bytes] = static_cast<std::uint8_t>(c);
+
+        num_bytes++;
+        num_first++;
+        range_lo = std::min(range_lo, c);
+        range_hi = c;
+    }
+
+    const bool skip_bytes = unanchored && num_first > 0 && num_first <= 3;
+    const bool skip_range = unanchored && !skip_bytes && num_first > 0 && num_first < 256 &&
+                            num_first == range_hi - range_lo + 1;
+
+    if(skip_bytes || skip_range)
+    {
+        std::uint8_t constants[3][16];
+
+        if(skip_bytes)
+        {
+            for(std::size_t k = 0; k < 3; ++k)
+                std::memset(constants[k], bytes[k < num_bytes ? k : 0], 16);
+        }
+        else
+        {
+            std::memset(constants[0], static_cast<int>(range_lo), 16);
+            std::memset(constants[1], static_cast<int>(range_hi - range_lo), 16);
+            std::memset(constants[2], 0, 16);
+        }
+
+        const std::size_t offset = a.add_data(constants, sizeof(constants));
+
+        a.emit({ 0xF3, 0x0F, 0x6F, 0x0D }); /* movdqu xmm1, [rip + disp] */
+        a.emit_data_ref(offset);
+        a.emit({ 0xF3, 0x0F, 0x6F, 0x15 }); /* movdqu xmm2, [rip + disp] */
+        a.emit_data_ref(offset + 16);
+        a.emit({ 0xF3, 0x0F, 0x6F, 0x1D }); /* movdqu xmm3, [rip + disp] */
+        a.emit_data_ref(offset + 32);
+    }
+
+    Vector<std::size_t> bitmap_offsets;
+
+    for(std::size_t i = 0; i < num_states; ++i)
+        bitmap_offsets.push_back(a.add_data(&nfa.bitmaps[i * 4], 32));
+
+    a.bind(loop);
+    a.emit({ 0x48, 0x39, 0xF7 });       /* cmp rdi, rsi */
+    a.jcc(0x3, no_match);               /* jae */
+
+    if(skip_bytes || skip_range)
+    {
+        const std::size_t simd = a.new_label();
+        const std::size_t found = a.new_label();
+        const std::size_t tail = a.new_label();
+
+        a.mov_r64_imm64(10, nfa.start_mask);
+        a.emit({ 0x4D, 0x39, 0xD0 });   /* cmp r8, r10 */
+        a.jcc(0x5, body);               /* jne */
+        a.emit({ 0x4C, 0x8D, 0x56, 0xF0 }); /* lea r10, [rsi - 16] */
+
+        a.bind(simd);
+        a.emit({ 0x4C, 0x39, 0xD7 });   /* cmp rdi, r10 */
+        a.jcc(0x7, tail);               /* ja */
+        a.emit({ 0xF3, 0x0F, 0x6F, 0x07 }); /* movdqu xmm0, [rdi] */
+
+        if(skip_bytes)
+        {
+            a.emit({ 0x66, 0x0F, 0x6F, 0xE8 }); /* movdqa xmm5, xmm0 */
+            a.emit({ 0x66, 0x0F, 0x74, 0xE9 }); /* pcmpeqb xmm5, xmm1 */
+            a.emit({ 0x66, 0x0F, 0x6F, 0xE0 }); /* movdqa xmm4, xmm0 */
+            a.emit({ 0x66, 0x0F, 0x74, 0xE2 }); /* pcmpeqb xmm4, xmm2 */
+            a.emit({ 0x66, 0x0F, 0xEB, 0xEC }); /* por xmm5, xmm4 */
+            a.emit({ 0x66, 0x0F, 0x6F, 0xE0 }); /* movdqa xmm4, xmm0 */
+            a.emit({ 0x66, 0x0F, 0x74, 0xE3 }); /* pcmpeqb xmm4, xmm3 */
+            a.emit({ 0x66, 0x0F, 0xEB, 0xEC }); /* por xmm5, xmm4 */
+        }
+        else
+        {
+            /* c in [lo, hi] <=> min(c - lo, hi - lo) == c - lo (unsigned) */
+            a.emit({ 0x66, 0x0F, 0x6F, 0xE8 }); /* movdqa xmm5, xmm0 */
+            a.emit({ 0x66, 0x0F, 0xF8, 0xE9 }); /* psubb xmm5, xmm1 */
+            a.emit({ 0x66, 0x0F, 0x6F, 0xE5 }); /* movdqa xmm4, xmm5 */
+            a.emit({ 0x66, 0x0F, 0xDA, 0xE2 }); /* pminub xmm4, xmm2 */
+            a.emit({ 0x66, 0x0F, 0x74, 0xEC }); /* pcmpeqb xmm5, xmm4 */
+        }
+
+        a.emit({ 0x66, 0x0F, 0xD7, 0xCD }); /* pmovmskb ecx, xmm5 */
+        a.emit({ 0x85, 0xC9 });             /* test ecx, ecx */
+        a.jcc(0x5, found);                  /* jne */
+        a.emit({ 0x48, 0x83, 0xC7, 0x10 }); /* add rdi, 16 */
+        a.jmp(simd);
+
+        a.bind(found);
+        a.emit({ 0x0F, 0xBC, 0xC9 });       /* bsf ecx, ecx */
+        a.emit({ 0x48, 0x01, 0xCF });       /* add rdi, rcx */
+        a.jmp(body);
+
+        a.bind(tail);
+        a.emit({ 0x48, 0x39, 0xF7 });       /* cmp rdi, rsi */
+        a.jcc(0x3, no_match);               /* jae */
+    }
+
+    a.bind(body);
+    a.emit({ 0x0F, 0xB6, 0x07 });       /* movzx eax, byte [rdi] */
+    a.emit({ 0x45, 0x31, 0xC9 });       /* xor r9d, r9d */
+
+    for(std::size_t i = 0; i < num_states; ++i)
+    {
+        if(nfa.accept_mask & (std::uint64_t(1) << i))
+            continue;
+
+        const std::size_t skip = a.new_label();
+
+        a.emit({ 0x49, 0x0F, 0xBA, 0xE0, static_cast<std::uint8_t>(i) }); /* bt r8, i */
+        a.jcc(0x3, skip);                                                 /* jnc */
+
+        const std::uint64_t* bitmap = &nfa.bitmaps[i * 4];
+
+        std::size_t count = 0;
+        std::size_t lo = 256;
+        std::size_t hi = 0;
+
+        for(std::size_t c = 0; c < 256; ++c)
+        {
+            if((bitmap[c / 64] >> (c % 64)) & 1)
+            {
+                count++;
+                lo = std::min(lo, c);
+                hi = c;
+            }
+        }
+
+        const std::size_t complement = 256 - count;
+
+        if(count == 0)
+        {
+            a.jmp(skip);
+        }
+        else if(count == 1)
+        {
+            a.emit({ 0x3C, static_cast<std::uint8_t>(lo) }); /* cmp al, c */
+            a.jcc(0x5, skip);                                /* jne */
+        }
+        else if(count == hi - lo + 1)
+        {
+            a.emit({ 0x8D, 0x88 });                          /* lea ecx, [rax - lo] */
+            a.emit_u32(static_cast<std::uint32_t>(-static_cast<std::int32_t>(lo)));
+            a.emit({ 0x81, 0xF9 });                          /* cmp ecx, hi - lo */
+            a.emit_u32(static_cast<std::uint32_t>(hi - lo));
+            a.jcc(0x7, skip);                                /* ja */
+        }
+        else if(complement == 1)
+        {
+            std::size_t excluded = 0;
+
+            while((bitmap[excluded / 64] >> (excluded % 64)) & 1)
+                excluded++;
+
+            a.emit({ 0x3C, static_cast<std::uint8_t>(excluded) }); /* cmp al, c */
+            a.jcc(0x4, skip);                                      /* je */
+        }
+        else if(count < 256)
+        {
+            a.emit({ 0x4C, 0x8D, 0x15 });                    /* lea r10, [rip + bitmap] */
+            a.emit_data_ref(bitmap_offsets[i]);
+            a.emit({ 0x89, 0xC1 });                          /* mov ecx, eax */
+            a.emit({ 0xC1, 0xE9, 0x06 });                    /* shr ecx, 6 */
+            a.emit({ 0x4D, 0x8B, 0x14, 0xCA });              /* mov r10, [r10 + rcx * 8] */
+            a.emit({ 0x49, 0x0F, 0xA3, 0xC2 });              /* bt r10, rax */
+            a.jcc(0x3, skip);                                /* jnc */
+        }
+
+        a.or_r9_mask(nfa.follow[i]);
+        a.bind(skip);
+    }
+
+    a.emit({ 0x48, 0xFF, 0xC7 });       /* inc rdi */
+
+    if(unanchored)
+        a.or_r9_mask(nfa.start_mask);
+
+    a.emit({ 0x4D, 0x89, 0xC8 });       /* mov r8, r9 */
+
+    if(nfa.accept_mask < 0x80000000ull)
+    {
+        a.emit({ 0x49, 0xF7, 0xC0 });   /* test r8, imm32 */
+        a.emit_u32(static_cast<std::uint32_t>(nfa.accept_mask));
+    }
+    else
+    {
+        a.mov_r64_imm64(10, nfa.accept_mask);
+        a.emit({ 0x4D, 0x85, 0xD0 });   /* test r8, r10 */
+    }
+
+    a.jcc(0x5, matched);                /* jne */
+
+    if(!unanchored)
+    {
+        a.emit({ 0x4D, 0x85, 0xC0 });   /* test r8, r8 */
+        a.jcc(0x4, no_match);           /* je */
+    }
+
+    a.jmp(loop);
+
+    a.bind(matched);
+    a.emit({ 0x48, 0x89, 0xF8 });       /* mov rax, rdi */
+    a.emit({ 0x4C, 0x29, 0xD8 });       /* sub rax, r11 */
+    a.emit({ 0x48, 0xFF, 0xC0 });       /* inc rax */
+#if defined(STDROMANO_WIN)
+    a.emit({ 0x5E, 0x5F });             /* pop rsi; pop rdi */
+#endif /* defined(STDROMANO_WIN) */
+    a.emit({ 0xC3 });                   /* ret */
+
+    a.bind(no_match);
+    a.emit({ 0x31, 0xC0 });             /* xor eax, eax */
+#if defined(STDROMANO_WIN)
+    a.emit({ 0x5E, 0x5F });             /* pop rsi; pop rdi */
+#endif /* defined(STDROMANO_WIN) */
+    a.emit({ 0xC3 });                   /* ret */
+
+    while(a.code.size() % 16 != 0)
+        a.code.push_back(0xCC);
+}
+
+static void* regex_jit_alloc_executable(const Vector<std::uint8_t>& image) noexcept
+{
+#if defined(STDROMANO_WIN)
+    void* memory = VirtualAlloc(nullptr, image.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+    if(memory == nullptr)
+        return nullptr;
+
+    std::memcpy(memory, image.data(), image.size());
+
+    DWORD old_protect;
+
+    if(!VirtualProtect(memory, image.size(), PAGE_EXECUTE_READ, &old_protect))
+    {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        return nullptr;
+    }
+
+    FlushInstructionCache(GetCurrentProcess(), memory, image.size());
+
+    return memory;
+#else
+    void* memory = mmap(nullptr, image.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(memory == MAP_FAILED)
+        return nullptr;
+
+    std::memcpy(memory, image.data(), image.size());
+
+    if(mprotect(memory, image.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, image.size());
+        return nullptr;
+    }
+
+    return memory;
+#endif /* defined(STDROMANO_WIN) */
+}
+
+static void regex_jit_free_executable(void* memory, std::size_t size) noexcept
+{
+#if defined(STDROMANO_WIN)
+    STDROMANO_UNUSED(size);
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif /* defined(STDROMANO_WIN) */
+}
+
+/* Translates the program, leaves it interpreted if it is not supported */
+static void regex_jit_compile(Regex::Program& program, bool debug) noexcept
+{
+    RegexJitNFA nfa;
 
-                vm->pc += 1;
+    if(!nfa.build(program.bytecode))
+    {
+        if(debug)
+            spdlog::debug("Regex JIT: too many states, the program is interpreted");
 
-                break;
-            }
-            case RegexInstrOpCode_Jump:
-            {
-                int jmp = decode_jump(&vm->bytecode[vm->pc + 1]);
-                vm->pc = static_cast<std::size_t>(static_cast<int>(vm->pc) + 5 + jmp);
+        return;
+    }
 
-                break;
-            }
-            case RegexInstrOpCode_JumpEq:
-            {
-                if(vm->status_flag)
-                {
-                    int jmp = decode_jump(&vm->bytecode[vm->pc + 1]);
-                    vm->pc = static_cast<std::size_t>(static_cast<int>(vm->pc) + 5 + jmp);
-                }
-                else
-                {
-                    vm->pc += 5;
-                }
+    RegexJitAssembler a;
 
-                break;
-            }
-            case RegexInstrOpCode_JumpNeq:
-            {
-                if(!vm->status_flag)
-                {
-                    int jmp = decode_jump(&vm->bytecode[vm->pc + 1]);
-                    vm->pc = static_cast<std::size_t>(static_cast<int>(vm->pc) + 5 + jmp);
-                }
-                else
-                {
-                    vm->pc += 5;
-                }
+    regex_jit_emit_function(a, nfa, false);
 
-                break;
-            }
-            case RegexInstrOpCode_Accept:
-                return true;
-            case RegexInstrOpCode_Fail:
-                return false;
-            case RegexInstrOpCode_GroupStart:
-            {
-                std::uint8_t gid = static_cast<std::uint8_t>(vm->bytecode[vm->pc + 1]);
+    const std::size_t unanchored_offset = a.code.size();
 
-                if(gid < REGEX_MAX_GROUPS)
-                {
-                    vm->groups[gid].start = vm->sp;
-                }
+    regex_jit_emit_function(a, nfa, true);
 
-                vm->pc += 2;
-                break;
-            }
-            case RegexInstrOpCode_GroupEnd:
-            {
-                std::uint8_t gid = static_cast<std::uint8_t>(vm->bytecode[vm->pc + 1]);
+    const Vector<std::uint8_t> image = a.link();
 
-                if(gid < REGEX_MAX_GROUPS)
-                {
-                    vm->groups[gid].end = vm->sp;
-                }
+    void* memory = regex_jit_alloc_executable(image);
 
-                vm->pc += 2;
-                break;
-            }
-            case RegexInstrOpCode_IncPos:
-            {
-                vm->sp++;
-                vm->pc++;
-                break;
-            }
-            case RegexInstrOpCode_IncPosEq:
-            {
-                vm->sp += static_cast<std::size_t>(vm->status_flag);
-                vm->pc++;
-                break;
-            }
-            case RegexInstrOpCode_SetFlag:
-            {
-                vm->status_flag = static_cast<bool>(vm->bytecode[vm->pc + 1]);
-                vm->pc += 2;
-                break;
-            }
-            default:
-            {
-                spdlog::error("Unknown instruction in regex VM: 0x{:02x} (pc {})", opcode, vm->pc);
-                return false;
-            }
-        }
+    if(memory == nullptr)
+    {
+        spdlog::warn("Regex JIT: cannot allocate executable memory, the program is interpreted");
+        return;
     }
 
-    return vm->status_flag;
+    program.jit_memory = memory;
+    program.jit_memory_size = image.size();
+    program.jit_anchored = reinterpret_cast<Regex::Program::JitFunc>(memory);
+    program.jit_unanchored = reinterpret_cast<Regex::Program::JitFunc>(static_cast<std::uint8_t*>(memory) + unanchored_offset);
+
+    if(debug)
+        spdlog::debug("Regex JIT: {} states, {} bytes of code and data", nfa.state_pcs.size(), image.size());
+}
+
+#endif /* defined(STDROMANO_REGEX_JIT) */
+
+Regex::Program::~Program()
+{
+#if defined(STDROMANO_REGEX_JIT)
+    if(this->jit_memory != nullptr)
+        regex_jit_free_executable(this->jit_memory, this->jit_memory_size);
+#endif /* defined(STDROMANO_REGEX_JIT) */
 }
 
 /* ======================================================================== */
@@ -950,8 +2136,7 @@ bool regex_exec(RegexVM* vm) noexcept
 
 bool Regex::compile(const StringD& regex, std::uint32_t flags) noexcept
 {
-    this->_bytecode.clear();
-    this->_group_count = 0;
+    this->_program.reset();
 
     if(flags & RegexFlags_DebugCompilation)
     {
@@ -972,173 +2157,476 @@ bool Regex::compile(const StringD& regex, std::uint32_t flags) noexcept
         return false;
     }
 
-    this->_bytecode = std::move(compiler.bytecode);
+    compiler.end_literal_run();
+
+    std::shared_ptr<Program> program = std::make_shared<Program>();
+
+    program->bytecode = std::move(compiler.bytecode);
 
-    finalize_bytecode(this->_bytecode);
+    finalize_bytecode(program->bytecode);
 
-    this->_group_count = compiler.next_group_id;
+    program->group_count = compiler.next_group_id;
+    program->id = g_regex_next_program_id.fetch_add(1);
+
+    if(compiler.literals_valid)
+    {
+        program->prefix = std::move(compiler.prefix);
+        program->required = std::move(compiler.required);
+    }
 
     if(flags & RegexFlags_DebugCompilation)
     {
-        spdlog::debug("Regex disasm ({} groups)", this->_group_count);
-        regex_disasm(this->_bytecode);
+        spdlog::debug("Regex disasm ({} groups, prefix \"{}\", required \"{}\")",
+                      program->group_count,
+                      program->prefix,
+                      program->required);
+        regex_disasm(program->bytecode);
     }
 
+#if defined(STDROMANO_REGEX_JIT)
+    if(flags & RegexFlags_Jit)
+        regex_jit_compile(*program, flags & RegexFlags_DebugCompilation);
+#endif /* defined(STDROMANO_REGEX_JIT) */
+
+    this->_program = std::move(program);
+
     return true;
 }
 
+static void regex_copy_groups(const RegexVM& vm, RegexGroup* groups) noexcept
+{
+    for(std::size_t g = 0; 2 * g < vm.num_slots; ++g)
+    {
+        const std::size_t start = vm.matched_slots[2 * g];
+        const std::size_t end = vm.matched_slots[2 * g + 1];
+
+        if(start != REGEX_UNSET && end != REGEX_UNSET)
+            groups[g] = RegexGroup(start, end);
+    }
+}
+
 bool Regex::exec_at(const StringD& str, std::size_t start_pos,
                     RegexGroup* groups) const noexcept
 {
-    RegexVM vm(this->_bytecode,
-               str.data() + start_pos,
-               str.size() - start_pos,
-               this->_group_count);
+    RegexVM& vm = regex_thread_vm();
+    vm.prepare(this->_program->bytecode, this->_program->group_count);
 
-    bool result = regex_exec(&vm);
+    bool result = vm.exec(str.data(), str.size(), start_pos);
 
     if(result && groups != nullptr)
-    {
-        groups[0] = RegexGroup(start_pos, std::min(start_pos + vm.sp, str.size()));
+        regex_copy_groups(vm, groups);
 
-        for(std::uint32_t g = 1; g < this->_group_count && g < REGEX_MAX_GROUPS; ++g)
-        {
-            if(vm.groups[g].matched())
-            {
-                groups[g] = RegexGroup(start_pos + vm.groups[g].start,
-                                       start_pos + vm.groups[g].end);
-            }
-        }
+    return result;
+}
+
+bool Regex::search_at(const StringD& str, std::size_t start_pos,
+                      RegexGroup* groups) const noexcept
+{
+    /* A literal required by any match rejects the input without running the VM */
+    if(!this->_program->required.empty() &&
+       strfind(str.data() + start_pos, str.size() - start_pos, this->_program->required.data(), this->_program->required.size()) == nullptr)
+    {
+        return false;
     }
 
+    RegexVM& vm = regex_thread_vm();
+    vm.prepare(this->_program->bytecode, this->_program->group_count);
+
+    bool result = vm.exec(str.data(), str.size(), start_pos, true, false, &this->_program->prefix);
+
+    if(result && groups != nullptr)
+        regex_copy_groups(vm, groups);
+
     return result;
 }
 
 RegexMatch Regex::match(const StringD& str) const noexcept
 {
-    if(this->_bytecode.empty())
+    if(!this->valid())
+        return RegexMatch();
+
+    if(str.size() < this->_program->prefix.size() || std::memcmp(str.data(), this->_program->prefix.data(), this->_program->prefix.size()) != 0)
         return RegexMatch();
 
     RegexGroup groups[REGEX_MAX_GROUPS] = {};
 
+    /* The native code rejects quickly, the VM only runs to extract the captures */
+    if(this->_program->jit_anchored != nullptr && this->_program->group_count > 1)
+    {
+        if(this->_program->jit_anchored(str.data(), str.size(), 0) == 0)
+            return RegexMatch();
+
+        if(this->exec_at(str, 0, groups))
+            return RegexMatch(str.data(), true, groups, this->_program->group_count);
+
+        return RegexMatch();
+    }
+
+    /* The DFA rejects quickly, and gives the whole match when there is no group to capture */
+    std::size_t match_end = 0;
+
+    const RegexDFAResult_ dfa_result = regex_dfa_run(this->_program,
+                                                     false,
+                                                     str,
+                                                     0,
+                                                     this->_program->prefix,
+                                                     &match_end);
+
+    if(dfa_result == RegexDFAResult_NoMatch)
+        return RegexMatch();
+
+    if(dfa_result == RegexDFAResult_Match && this->_program->group_count <= 1)
+    {
+        groups[0] = RegexGroup(0, match_end);
+        return RegexMatch(str.data(), true, groups, this->_program->group_count);
+    }
+
     bool result = this->exec_at(str, 0, groups);
 
     if(result)
-        return RegexMatch(str, true, groups, this->_group_count);
+        return RegexMatch(str.data(), true, groups, this->_program->group_count);
 
     return RegexMatch();
 }
 
 RegexMatch Regex::search(const StringD& str) const noexcept
 {
-    if(this->_bytecode.empty())
+    if(!this->valid())
+        return RegexMatch();
+
+    if(!this->test(str))
         return RegexMatch();
 
-    for(std::size_t start = 0; start <= str.size(); ++start)
+    RegexGroup groups[REGEX_MAX_GROUPS] = {};
+
+    if(this->search_at(str, 0, groups))
+        return RegexMatch(str.data(), true, groups, this->_program->group_count);
+
+    return RegexMatch();
+}
+
+bool Regex::test(const StringD& str) const noexcept
+{
+    if(!this->valid())
+        return false;
+
+    if(!this->_program->required.empty() &&
+       strfind(str.data(), str.size(), this->_program->required.data(), this->_program->required.size()) == nullptr)
     {
-        RegexGroup groups[REGEX_MAX_GROUPS] = {};
+        return false;
+    }
+
+    if(this->_program->jit_unanchored != nullptr)
+        return this->_program->jit_unanchored(str.data(), str.size(), 0) != 0;
 
-        if(this->exec_at(str, start, groups))
-            if(groups[0].start < groups[0].end || start == str.size())
-                return RegexMatch(str, true, groups, this->_group_count);
+    std::size_t match_end = 0;
+
+    switch(regex_dfa_run(this->_program, true, str, 0, this->_program->prefix, &match_end))
+    {
+        case RegexDFAResult_Match:
+            return true;
+        case RegexDFAResult_NoMatch:
+            return false;
+        default:
+            break;
     }
 
-    return RegexMatch();
+    RegexVM& vm = regex_thread_vm();
+    vm.prepare(this->_program->bytecode, this->_program->group_count);
+
+    return vm.exec(str.data(), str.size(), 0, true, true, &this->_program->prefix);
+}
+
+Vector<RegexMatch> Regex::match_all(const StringD& str) const noexcept
+{
+    Vector<RegexMatch> results;
+
+    this->match_iter(str, [&results](const RegexMatch& m) {
+        results.push_back(m);
+    });
+
+    return results;
+}
+
+std::size_t Regex::match_all(const StringD& str, RegexMatches& matches) const noexcept
+{
+    matches.clear();
+    matches._source = str.data();
+    matches._group_count = std::max<std::uint32_t>(this->group_count(), 1);
+
+    this->match_iter(str, [&](const RegexMatch& m) {
+        for(std::uint32_t g = 0; g < matches._group_count; ++g)
+            matches._groups.push_back(m.group(g));
+    });
+
+    return matches.size();
+}
+
+StringD Regex::replace_all(const StringD& str, const StringD& replace) const noexcept
+{
+    return this->replace_iter(str, [&](const RegexMatch&, StringD& out) {
+        out.appends(replace);
+    });
 }
 
-void Regex::match_iter(const StringD& str,
-                       const std::function<void(const RegexMatch&)>& callback) const noexcept
+/* ======================================================================== */
+/* Regex set                                                                */
+/* ======================================================================== */
+
+RegexSet::RegexSet(const Vector<StringD>& patterns, std::uint32_t flags)
 {
-    if(this->_bytecode.empty())
+    if(patterns.empty())
         return;
 
-    std::size_t search_start = 0;
+    std::shared_ptr<Regex::Program> program = std::make_shared<Regex::Program>();
 
-    while(search_start <= str.size())
+    for(std::size_t i = 0; i < patterns.size(); ++i)
     {
-        RegexGroup groups[REGEX_MAX_GROUPS] = {};
+        Regex regex(patterns[i], flags);
 
-        if(this->exec_at(str, search_start, groups))
+        if(!regex.valid())
         {
-            std::size_t match_end = groups[0].end;
+            spdlog::error("Invalid pattern {} in regex set: {}", i, patterns[i]);
+            this->_regexes.clear();
+            return;
+        }
 
-            /* Skip empty matches to avoid infinite loops */
-            if(match_end <= search_start)
-            {
-                search_start++;
-                continue;
-            }
+        /* The program of a pattern ends with Accept, replaced by AcceptPattern i. Offsets are
+           relative, so the code is position independent */
+        const Regex::ByteCode& code = regex._program->bytecode;
+        const std::size_t alternative_size = code.size() - 1 + REGEX_JUMP_SIZE;
 
-            RegexMatch m(str, true, groups, this->_group_count);
-            callback(m);
+        Regex::ByteCode& bytecode = program->bytecode;
 
-            search_start = match_end;
-        }
-        else
+        if(i + 1 < patterns.size())
         {
-            search_start++;
+            const std::size_t pos = bytecode.size();
+            insert_split(bytecode, pos, pos + REGEX_SPLIT_SIZE, pos + REGEX_SPLIT_SIZE + alternative_size);
         }
+
+        for(std::size_t pc = 0; pc + 1 < code.size(); ++pc)
+            bytecode.push_back(code[pc]);
+
+        bytecode.push_back(BYTE(RegexInstrOpCode_AcceptPattern));
+        bytecode.insert(bytecode.end(), REGEX_JUMP_SIZE - 1, BYTE(std::uint8_t(0)));
+        encode_jump_at(bytecode, bytecode.size() - 4, static_cast<int>(i));
+
+        this->_regexes.push_back(std::move(regex));
+    }
+
+    program->id = g_regex_next_program_id.fetch_add(1);
+
+    if(flags & RegexFlags_DebugCompilation)
+    {
+        spdlog::debug("Regex set disasm ({} patterns)", patterns.size());
+        regex_disasm(program->bytecode);
+    }
+
+    this->_program = std::move(program);
+}
+
+void RegexSet::scan(const StringD& str, std::uint8_t* flags) const noexcept
+{
+    const Regex::ByteCode& code = this->_program->bytecode;
+
+    if(regex_dfa_run_set(this->_program, str, flags, this->size()) != RegexDFAResult_GaveUp)
+        return;
+
+    /* The flags set before giving up stay valid, the Pike VM completes them */
+    RegexVM& vm = regex_thread_vm();
+    vm.prepare(code, 0);
+    vm.exec_set(str.data(), str.size(), flags, this->size());
+}
+
+bool RegexSet::test(const StringD& str) const noexcept
+{
+    if(!this->valid())
+        return false;
+
+    std::size_t match_end = 0;
+
+    switch(regex_dfa_run(this->_program, true, str, 0, StringD(), &match_end))
+    {
+        case RegexDFAResult_Match:
+            return true;
+        case RegexDFAResult_NoMatch:
+            return false;
+        default:
+            break;
+    }
+
+    RegexVM& vm = regex_thread_vm();
+    vm.prepare(this->_program->bytecode, 0);
+
+    return vm.exec(str.data(), str.size(), 0, true, true);
+}
+
+bool RegexSet::matches(const StringD& str, Vector<std::uint32_t>& indices) const noexcept
+{
+    indices.clear();
+
+    if(!this->valid())
+        return false;
+
+    Vector<std::uint8_t> flags(this->size(), 0);
+
+    this->scan(str, flags.data());
+
+    for(std::size_t i = 0; i < flags.size(); ++i)
+    {
+        if(flags[i] != 0)
+            indices.push_back(static_cast<std::uint32_t>(i));
     }
+
+    return !indices.empty();
 }
 
-StringD Regex::replace_iter(const StringD& str,
-                            const std::function<StringD(const RegexMatch&)>& callback) const noexcept
+bool RegexSet::search_all(const StringD& str, Vector<RegexSetMatch>& matches) const noexcept
 {
-    if(this->_bytecode.empty())
-        return StringD();
+    matches.clear();
 
-    StringD res;
+    if(!this->valid())
+        return false;
+
+    Vector<std::uint8_t> flags(this->size(), 0);
 
-    std::size_t search_start = 0;
+    this->scan(str, flags.data());
 
-    while(search_start <= str.size())
+    for(std::size_t i = 0; i < flags.size(); ++i)
     {
+        if(flags[i] == 0)
+            continue;
+
         RegexGroup groups[REGEX_MAX_GROUPS] = {};
 
-        if(this->exec_at(str, search_start, groups))
-        {
-            std::size_t match_end = groups[0].end;
+        if(this->_regexes[i].search_at(str, 0, groups))
+            matches.push_back({ static_cast<std::uint32_t>(i), groups[0] });
+    }
 
-            if(match_end <= search_start)
-            {
-                res.push_back(str[search_start++]);
-                continue;
-            }
+    return !matches.empty();
+}
+
+/* ======================================================================== */
+/* Regex cache                                                              */
+/* ======================================================================== */
 
-            RegexMatch m(str, true, groups, this->_group_count);
+struct RegexCacheEntry
+{
+    std::shared_ptr<const Regex::Program> program;
+    std::uint64_t last_use;
+};
+
+struct RegexCache
+{
+    std::mutex mutex;
+    HashMap<StringD, RegexCacheEntry> entries;
+    std::size_t capacity = REGEX_CACHE_DEFAULT_CAPACITY;
+    std::uint64_t clock = 0;
+
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+
+    /* Evicts the least recently used entries until there are at most max_size of them */
+    void evict(std::size_t max_size) noexcept
+    {
+        while(this->entries.size() > max_size)
+        {
+            auto lru = this->entries.begin();
 
-            res.appends(callback(m));
+            for(auto it = this->entries.begin(); it != this->entries.end(); ++it)
+                if(it->second.last_use < lru->second.last_use)
+                    lru = it;
 
-            search_start = match_end;
+            this->entries.erase(lru);
+            this->evictions++;
         }
-        else
+    }
+};
+
+static RegexCache& regex_cache() noexcept
+{
+    static RegexCache cache;
+    return cache;
+}
+
+Regex regex_cache_get(const StringD& pattern, std::uint32_t flags) noexcept
+{
+    RegexCache& cache = regex_cache();
+
+    StringD key = StringD::make_fmt("{}:{}", flags, pattern);
+
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+
+        auto it = cache.entries.find(key);
+
+        if(it != cache.entries.end())
         {
-            if(search_start < str.size())
-                res.push_back(str[search_start++]);
-            else
-                search_start++;
+            it->second.last_use = ++cache.clock;
+            cache.hits++;
+
+            return Regex(it->second.program);
         }
+
+        cache.misses++;
     }
 
-    return res;
+    /* Compiled outside of the lock, if another thread compiled the same pattern meanwhile its
+       program is kept */
+    Regex regex(pattern, flags);
+
+    if(!regex.valid())
+        return regex;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto it = cache.entries.find(key);
+
+    if(it != cache.entries.end())
+    {
+        it->second.last_use = ++cache.clock;
+        return Regex(it->second.program);
+    }
+
+    if(cache.capacity == 0)
+        return regex;
+
+    cache.evict(cache.capacity - 1);
+    cache.entries.insert(std::make_pair(std::move(key), RegexCacheEntry{ regex._program, ++cache.clock }));
+
+    return regex;
 }
 
-Vector<RegexMatch> Regex::match_all(const StringD& str) const noexcept
+RegexCacheStats regex_cache_stats() noexcept
 {
-    Vector<RegexMatch> results;
+    RegexCache& cache = regex_cache();
 
-    this->match_iter(str, [&results](const RegexMatch& m) {
-        results.push_back(m);
-    });
+    std::lock_guard<std::mutex> lock(cache.mutex);
 
-    return results;
+    return RegexCacheStats{ cache.hits, cache.misses, cache.evictions, cache.entries.size(), cache.capacity };
 }
 
-StringD Regex::replace_all(const StringD& str, const StringD& replace) const noexcept
+void regex_cache_set_capacity(std::size_t capacity) noexcept
 {
-    return this->replace_iter(str, [&](const RegexMatch&) {
-        return replace;
-    });
+    RegexCache& cache = regex_cache();
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    cache.capacity = capacity;
+    cache.evict(capacity);
+}
+
+void regex_cache_clear() noexcept
+{
+    RegexCache& cache = regex_cache();
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    cache.entries.clear();
+    cache.hits = 0;
+    cache.misses = 0;
+    cache.evictions = 0;
 }
 
 STDROMANO_NAMESPACE_END
@@ -4,6 +4,7 @@
 
 #include "stdromano/string.hpp"
 #include "stdromano/simd.hpp"
+#include "stdromano/bits.hpp"
 
 extern "C" bool asm__detail_strcmp_cs(const char* lhs,
                                       const char* rhs,
@@ -592,6 +593,124 @@ char* strrstr(const char* haystack, const char* needle) noexcept
     return result;
 }
 
+/*
+    Substring search comparing the first and the last char of the needle at 16/32 positions at
+    once, full comparisons are done only on the candidates
+    http://0x80.pl/notesen/2016-11-28-simd-strfind.html
+*/
+
+const char* strfind_scalar_kernel(const char* haystack,
+                                  std::size_t haystack_size,
+                                  const char* needle,
+                                  std::size_t needle_size) noexcept
+{
+    const char* end = haystack + haystack_size - needle_size + 1;
+
+    for(const char* p = haystack; p < end; ++p)
+    {
+        p = static_cast<const char*>(std::memchr(p, needle[0], static_cast<std::size_t>(end - p)));
+
+        if(p == nullptr)
+            return nullptr;
+
+        if(std::memcmp(p, needle, needle_size) == 0)
+            return p;
+    }
+
+    return nullptr;
+}
+
+const char* strfind_sse_kernel(const char* haystack,
+                               std::size_t haystack_size,
+                               const char* needle,
+                               std::size_t needle_size) noexcept
+{
+    constexpr std::size_t simd_width = 16;
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+
+    std::size_t i = 0;
+
+    for(; i + needle_size - 1 + simd_width <= haystack_size; i += simd_width)
+    {
+        const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i));
+        const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + needle_size - 1));
+
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                                                        _mm_cmpeq_epi8(last, block_last))));
+
+        while(mask != 0)
+        {
+            const std::size_t candidate = i + ctz_u64(mask);
+
+            if(std::memcmp(haystack + candidate, needle, needle_size) == 0)
+                return haystack + candidate;
+
+            mask &= mask - 1;
+        }
+    }
+
+    return strfind_scalar_kernel(haystack + i, haystack_size - i, needle, needle_size);
+}
+
+const char* strfind_avx_kernel(const char* haystack,
+                               std::size_t haystack_size,
+                               const char* needle,
+                               std::size_t needle_size) noexcept
+{
+    constexpr std::size_t simd_width = 32;
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+
+    std::size_t i = 0;
+
+    for(; i + needle_size - 1 + simd_width <= haystack_size; i += simd_width)
+    {
+        const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i));
+        const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i + needle_size - 1));
+
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                                                              _mm256_cmpeq_epi8(last, block_last))));
+
+        while(mask != 0)
+        {
+            const std::size_t candidate = i + ctz_u64(mask);
+
+            if(std::memcmp(haystack + candidate, needle, needle_size) == 0)
+                return haystack + candidate;
+
+            mask &= mask - 1;
+        }
+    }
+
+    return strfind_scalar_kernel(haystack + i, haystack_size - i, needle, needle_size);
+}
+
+const char* strfind(const char* haystack,
+                    std::size_t haystack_size,
+                    const char* needle,
+                    std::size_t needle_size) noexcept
+{
+    if(needle_size == 0)
+        return haystack;
+
+    if(needle_size > haystack_size)
+        return nullptr;
+
+    switch(simd_get_vectorization_mode())
+    {
+        case VectorizationMode_SSE:
+            return strfind_sse_kernel(haystack, haystack_size, needle, needle_size);
+        case VectorizationMode_AVX:
+        case VectorizationMode_AVX2:
+            return strfind_avx_kernel(haystack, haystack_size, needle, needle_size);
+        default:
+            return strfind_scalar_kernel(haystack, haystack_size, needle, needle_size);
+    }
+}
+
 bool case_insensitive_less(char lhs, char rhs) noexcept
 {
     return to_lower(static_cast<int>(lhs)) < to_lower(static_cast<int>(rhs));
@@ -392,6 +392,45 @@ TEST_CASE(test_write_file_content_append)
     stdromano::fs::removefile(file_path);
 }
 
+/* map_file */
+
+TEST_CASE(test_map_file)
+{
+    const stdromano::StringD tmp = stdromano::fs::tmp_dir().unwrap();
+    const stdromano::StringD file_path = stdromano::StringD("{}/stdromano_test_map.txt", tmp);
+
+    const char* data = "mapped content";
+    ASSERT(!stdromano::fs::write_file_content(data, 14, file_path).has_error());
+
+    auto result = stdromano::fs::map_file(file_path);
+    ASSERT(!result.has_error());
+
+    stdromano::fs::MappedFile mapped = result.unwrap();
+    ASSERT(mapped.is_mapped());
+    ASSERT_EQUAL(static_cast<std::size_t>(14), mapped.size());
+    ASSERT(std::memcmp(mapped.data(), data, 14) == 0);
+
+    /* Copy-on-write mappings can be modified without touching the file */
+    stdromano::fs::MappedFile cow = stdromano::fs::map_file(file_path, stdromano::fs::MapFileFlags_CopyOnWrite).unwrap();
+    cow.data()[0] = 'M';
+
+    stdromano::fs::MappedFile moved = std::move(cow);
+    ASSERT(!cow.is_mapped());
+    ASSERT_EQUAL('M', moved.data()[0]);
+    ASSERT(stdromano::fs::load_file_content(file_path).unwrap()[0] == 'm');
+
+    mapped.unmap();
+    ASSERT(!mapped.is_mapped());
+
+    stdromano::fs::removefile(file_path);
+}
+
+TEST_CASE(test_map_file_nonexistent)
+{
+    auto result = stdromano::fs::map_file("/nonexistent/path/to/file.txt");
+    ASSERT(result.has_error());
+}
+
 /* list_dir */
 
 TEST_CASE(test_list_dir_all)
@@ -733,6 +772,8 @@ int main()
     runner.add_test("WriteFileContent", test_write_file_content);
     runner.add_test("WriteFileContent_CreatesParentDirs", test_write_file_content_creates_parent_dirs);
     runner.add_test("WriteFileContent_Append", test_write_file_content_append);
+    runner.add_test("MapFile", test_map_file);
+    runner.add_test("MapFile_Nonexistent", test_map_file_nonexistent);
     runner.add_test("WriteThenLoad_Roundtrip", test_write_then_load_roundtrip);
 
     /* list_dir */
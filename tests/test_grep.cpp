@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2025 - Present Romain Augier
+// All rights reserved.
+
+#include "stdromano/grep.hpp"
+#include "stdromano/filesystem.hpp"
+
+#include "test.hpp"
+
+static stdromano::StringD make_tree(const char* name)
+{
+    const stdromano::StringD tmp = stdromano::fs::tmp_dir().unwrap();
+    const stdromano::StringD root = stdromano::StringD("{}/{}", tmp, stdromano::StringD(name));
+
+    stdromano::fs::removedir(root, true);
+
+    ASSERT(!stdromano::fs::makedir(root).has_error());
+
+    return root;
+}
+
+static void write_file(const stdromano::StringD& path, const stdromano::StringD& content)
+{
+    ASSERT(!stdromano::fs::write_file_content(content.data(), content.size(), path, "wb").has_error());
+}
+
+struct GrepResult
+{
+    stdromano::StringD path;
+    stdromano::StringD line;
+    std::size_t line_number;
+    std::size_t match_start;
+    std::size_t match_end;
+};
+
+static stdromano::Vector<GrepResult> run_grep(stdromano::Grep& grep, const stdromano::StringD& path)
+{
+    stdromano::Vector<GrepResult> results;
+
+    ASSERT(grep.search(path, [&](const stdromano::GrepLine& line) {
+        results.push_back({ line.path.copy(), line.line.copy(), line.line_number, line.match_start, line.match_end });
+    }));
+
+    return results;
+}
+
+TEST_CASE(test_grep_buffer)
+{
+    const stdromano::StringD text("first line\nan error here\nerror and error\n\nlast error");
+
+    stdromano::Grep grep("error", stdromano::GrepFlags_Literal);
+    ASSERT(grep.valid());
+
+    stdromano::Vector<GrepResult> results;
+
+    ASSERT(grep.search_buffer(text.data(), text.size(), "buffer", [&](const stdromano::GrepLine& line) {
+        results.push_back({ line.path.copy(), line.line.copy(), line.line_number, line.match_start, line.match_end });
+    }));
+
+    ASSERT(results.size() == 3);
+    ASSERT(results[0].line == "an error here");
+    ASSERT(results[0].line_number == 2);
+    ASSERT(results[0].match_start == 3);
+    ASSERT(results[0].match_end == 8);
+    ASSERT(results[1].line == "error and error");
+    ASSERT(results[1].line_number == 3);
+    ASSERT(results[1].match_start == 0);
+    ASSERT(results[2].line == "last error");
+    ASSERT(results[2].line_number == 5);
+    ASSERT(results[2].path == "buffer");
+    ASSERT(grep.num_lines() == 3);
+
+    stdromano::Grep digits("\\d+ms");
+    stdromano::Vector<std::size_t> line_numbers;
+
+    const stdromano::StringD timings("took 12ms\nnothing\n\nx 3ms y 4ms\n");
+
+    ASSERT(digits.search_buffer(timings.data(), timings.size(), "timings", [&](const stdromano::GrepLine& line) {
+        line_numbers.push_back(line.line_number);
+
+        if(line.line_number == 4)
+        {
+            ASSERT(line.match_start == 2);
+            ASSERT(line.match_end == 5);
+        }
+    }));
+
+    ASSERT(line_numbers.size() == 2);
+    ASSERT(line_numbers[0] == 1);
+    ASSERT(line_numbers[1] == 4);
+
+    ASSERT(!stdromano::Grep("", stdromano::GrepFlags_Literal).valid());
+    ASSERT(!stdromano::Grep("(unclosed").valid());
+}
+
+TEST_CASE(test_grep_tree)
+{
+    const stdromano::StringD root = make_tree("stdromano_test_grep");
+
+    ASSERT(!stdromano::fs::makedir(stdromano::StringD("{}/sub", root)).has_error());
+    ASSERT(!stdromano::fs::makedir(stdromano::StringD("{}/sub/deeper", root)).has_error());
+
+    write_file(stdromano::StringD("{}/a.txt", root), "needle at the start\nno match\n");
+    write_file(stdromano::StringD("{}/b.txt", root), "nothing to see\n");
+    write_file(stdromano::StringD("{}/empty.txt", root), "");
+    write_file(stdromano::StringD("{}/sub/c.txt", root), "one\ntwo needle\nthree\nneedle needle\n");
+    write_file(stdromano::StringD("{}/sub/deeper/d.txt", root), "deep needle");
+
+    stdromano::StringD binary("needle");
+    binary.push_back('\0');
+    binary.appends(stdromano::StringD("binary needle"));
+    write_file(stdromano::StringD("{}/sub/e.bin", root), binary);
+
+    /* Many files, to have more files than slots in flight */
+    for(std::size_t i = 0; i < 300; ++i)
+    {
+        stdromano::StringD content;
+
+        for(std::size_t l = 0; l < i % 7; ++l)
+            content.appendf("line {} {}\n", l, l == 3 ? "needle" : "hay");
+
+        write_file(stdromano::StringD::make_fmt("{}/sub/many_{}.txt", root, i), content);
+    }
+
+    stdromano::Grep grep("needle", stdromano::GrepFlags_Literal);
+    const stdromano::Vector<GrepResult> results = run_grep(grep, root);
+
+    /* Results are in walk order, lines in order within a file */
+    stdromano::Vector<stdromano::StringD> walk_order;
+
+    for(stdromano::fs::WalkIterator it(root, stdromano::fs::WalkFlags_ListFiles | stdromano::fs::WalkFlags_Recursive); it != stdromano::fs::WalkIterator(); ++it)
+        walk_order.push_back(it->get_current_path());
+
+    std::size_t walk_index = 0;
+
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        while(walk_index < walk_order.size() && walk_order[walk_index] != results[i].path)
+            walk_index++;
+
+        ASSERT(walk_index < walk_order.size());
+
+        if(i > 0 && results[i - 1].path == results[i].path)
+            ASSERT(results[i - 1].line_number < results[i].line_number);
+    }
+
+    std::size_t num_many = 0;
+    std::size_t num_c = 0;
+
+    for(const GrepResult& result : results)
+    {
+        ASSERT(result.line.substr(result.match_start, result.match_end - result.match_start) == "needle");
+        ASSERT(!result.path.endswith(".bin"));
+
+        if(result.path.endswith("c.txt"))
+            num_c++;
+        else if(stdromano::fs::filename(result.path).startswith("many_"))
+            num_many++;
+    }
+
+    /* The files with more than 3 lines have a match */
+    std::size_t expected_many = 0;
+
+    for(std::size_t i = 0; i < 300; ++i)
+        expected_many += i % 7 > 3 ? 1 : 0;
+
+    ASSERT(num_c == 2);
+    ASSERT(num_many == expected_many);
+    ASSERT(results.size() == 1 + 2 + 1 + num_many);
+    ASSERT(grep.num_lines() == results.size());
+    ASSERT(grep.num_binary_files() == 1);
+
+    /* Binary files are searched on request */
+    stdromano::Grep binary_grep("needle", stdromano::GrepFlags_Literal | stdromano::GrepFlags_Binary);
+    ASSERT(run_grep(binary_grep, root).size() == results.size() + 1);
+
+    /* Regex, and a single file */
+    stdromano::Grep regex_grep("t\\w+ needle");
+    const stdromano::Vector<GrepResult> regex_results = run_grep(regex_grep, stdromano::StringD("{}/sub/c.txt", root));
+    ASSERT(regex_results.size() == 1);
+    ASSERT(regex_results[0].line_number == 2);
+    ASSERT(regex_grep.num_files() == 1);
+
+    stdromano::Grep missing("needle", stdromano::GrepFlags_Literal);
+    ASSERT(!missing.search(stdromano::StringD("{}/does_not_exist", root), [](const stdromano::GrepLine&) {}));
+
+    stdromano::fs::removedir(root, true);
+}
+
+TEST_CASE(test_grep_hidden)
+{
+    const stdromano::StringD root = make_tree("stdromano_test_grep_hidden");
+
+    ASSERT(!stdromano::fs::makedir(stdromano::StringD("{}/.hidden", root)).has_error());
+
+    write_file(stdromano::StringD("{}/a.txt", root), "needle\n");
+    write_file(stdromano::StringD("{}/.b.txt", root), "needle\n");
+    write_file(stdromano::StringD("{}/.hidden/c.txt", root), "needle\n");
+
+    stdromano::Grep grep("needle", stdromano::GrepFlags_Literal);
+    ASSERT(run_grep(grep, root).size() == 1);
+
+    /* Hidden files and directories are searched, without walking "." and ".." */
+    stdromano::Grep hidden_grep("needle", stdromano::GrepFlags_Literal | stdromano::GrepFlags_Hidden);
+    const stdromano::Vector<GrepResult> results = run_grep(hidden_grep, root);
+
+    ASSERT(results.size() == 3);
+
+    for(const GrepResult& result : results)
+    {
+        ASSERT(result.path.startswith(root));
+        ASSERT(result.path.find("/./") == -1);
+        ASSERT(result.path.find("/../") == -1);
+    }
+
+    stdromano::fs::removedir(root, true);
+}
+
+TEST_CASE(test_grep_large)
+{
+    const stdromano::StringD root = make_tree("stdromano_test_grep_large");
+
+    /* Large enough to be memory-mapped instead of read */
+    stdromano::StringD content;
+
+    for(std::size_t i = 0; i < 40000; ++i)
+        content.appendf("line {} {}\n", i, i % 1000 == 999 ? "needle" : "some hay to make the file larger");
+
+    ASSERT(content.size() > 1024 * 1024);
+
+    const stdromano::StringD path("{}/large.txt", root);
+    write_file(path, content);
+
+    stdromano::Grep grep("needle", stdromano::GrepFlags_Literal);
+    const stdromano::Vector<GrepResult> results = run_grep(grep, root);
+
+    ASSERT(results.size() == 40);
+    ASSERT(grep.num_files() == 1);
+    ASSERT(grep.num_errors() == 0);
+
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        ASSERT(results[i].line_number == (i + 1) * 1000);
+        ASSERT(results[i].line == stdromano::StringD::make_fmt("line {} needle", (i + 1) * 1000 - 1));
+    }
+
+    stdromano::fs::removedir(root, true);
+}
+
+int main()
+{
+    TestRunner runner("grep");
+
+    runner.add_test("Grep Buffer", test_grep_buffer);
+    runner.add_test("Grep Tree", test_grep_tree);
+    runner.add_test("Grep Hidden", test_grep_hidden);
+    runner.add_test("Grep Large", test_grep_large);
+
+    runner.run_all();
+
+    return 0;
+}
@@ -4,26 +4,1079 @@
 
 #include "stdromano/json.hpp"
 #include "stdromano/filesystem.hpp"
+#include "stdromano/atomic.hpp"
 
 #define STDROMANO_ENABLE_PROFILING
 #include "stdromano/profiling.hpp"
 
-int main()
+#include "test.hpp"
+
+struct JsonTestPoint
+{
+    double x = 0.0;
+    double y = 0.0;
+};
+
+STDROMANO_JSON_FIELDS(JsonTestPoint, x, y)
+
+struct JsonTestMessage
+{
+    std::uint32_t id = 0;
+    std::int16_t delta = 0;
+    bool enabled = false;
+    stdromano::StringD name;
+    stdromano::Vector<JsonTestPoint> points;
+    stdromano::Vector<std::uint64_t> ids;
+};
+
+STDROMANO_JSON_FIELDS(JsonTestMessage, id, delta, enabled, name, points, ids)
+
+TEST_CASE(test_json_dict_find_small)
+{
+    stdromano::Json json;
+
+    const char* doc = R"({"a": 1, "bb": 2, "ccc": "three", "a_longer_key": [1, 2]})";
+
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    stdromano::JsonObject* root = json.root();
+
+    ASSERT(root->is_dict());
+    ASSERT_EQUAL(4, root->dict_size());
+    ASSERT_EQUAL(1, root->dict_find("a")->get_u64());
+    ASSERT_EQUAL(2, root->dict_find("bb")->get_u64());
+    ASSERT(std::strcmp(root->dict_find("ccc")->get_str(), "three") == 0);
+    ASSERT_EQUAL(2, root->dict_find("a_longer_key")->array_size());
+    ASSERT(root->dict_find("b") == nullptr);
+    ASSERT(root->dict_find("cccc") == nullptr);
+    ASSERT(root->dict_find("bb_", 2) != nullptr);
+}
+
+TEST_CASE(test_json_dict_find_large)
+{
+    stdromano::Json json;
+
+    stdromano::JsonObject* dict = json.make_dict();
+    json.set_root(dict);
+
+    constexpr std::size_t num_keys = 5000;
+
+    for(std::size_t i = 0; i < num_keys; i++)
+    {
+        const stdromano::StringD key = stdromano::StringD::make_fmt("key_{}", i);
+        json.dict_append(dict, key.c_str(), json.make_u64(i), true);
+    }
+
+    ASSERT_EQUAL(num_keys, dict->dict_size());
+
+    for(std::size_t i = 0; i < num_keys; i++)
+    {
+        const stdromano::StringD key = stdromano::StringD::make_fmt("key_{}", i);
+        stdromano::JsonObject* value = dict->dict_find(key.c_str());
+
+        ASSERT(value != nullptr);
+        ASSERT_EQUAL(i, value->get_u64());
+    }
+
+    ASSERT(dict->dict_find("key_") == nullptr);
+    ASSERT(dict->dict_find("key_5000") == nullptr);
+
+    /* Insertion order is preserved for iteration */
+    std::size_t i = 0;
+
+    for(auto [key, value] : dict->dict_items())
+    {
+        ASSERT(stdromano::StringD::make_ref(key, std::strlen(key)) == stdromano::StringD::make_fmt("key_{}", i));
+        ASSERT_EQUAL(i, value->get_u64());
+        i++;
+    }
+
+    ASSERT_EQUAL(num_keys, i);
+}
+
+TEST_CASE(test_json_dict_pop)
+{
+    stdromano::Json json;
+
+    stdromano::JsonObject* dict = json.make_dict();
+    json.set_root(dict);
+
+    for(std::size_t i = 0; i < 100; i++)
+        json.dict_append(dict, stdromano::StringD::make_fmt("{}", i).c_str(), json.make_u64(i), true);
+
+    for(std::size_t i = 0; i < 100; i += 2)
+        json.dict_pop(dict, stdromano::StringD::make_fmt("{}", i).c_str());
+
+    json.dict_pop(dict, "not_a_key");
+
+    ASSERT_EQUAL(50, dict->dict_size());
+
+    for(std::size_t i = 0; i < 100; i++)
+    {
+        stdromano::JsonObject* value = dict->dict_find(stdromano::StringD::make_fmt("{}", i).c_str());
+
+        if(i % 2 == 0)
+        {
+            ASSERT(value == nullptr);
+        }
+        else
+        {
+            ASSERT(value != nullptr);
+            ASSERT_EQUAL(i, value->get_u64());
+        }
+    }
+
+    json.dict_append(dict, "0", json.make_bool(true), true);
+
+    ASSERT(dict->dict_find("0")->get_bool());
+    ASSERT_EQUAL(51, dict->dict_size());
+
+    std::size_t i = 1;
+
+    for(auto [key, value] : dict->dict_items())
+    {
+        if(i < 100)
+            ASSERT_EQUAL(i, value->get_u64());
+        else
+            ASSERT(value->is_bool());
+
+        i += 2;
+    }
+}
+
+TEST_CASE(test_json_array_access)
+{
+    stdromano::Json json;
+
+    const char* doc = R"([0, 1, [2, 3, [4]], {"k": [5, 6]}, 7])";
+
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    stdromano::JsonObject* root = json.root();
+
+    ASSERT_EQUAL(5, root->array_size());
+    ASSERT_EQUAL(0, root->array_at(0)->get_u64());
+    ASSERT_EQUAL(7, root->array_at(4)->get_u64());
+    ASSERT(root->array_at(5) == nullptr);
+    ASSERT_EQUAL(3, root->array_at(2)->array_size());
+    ASSERT_EQUAL(4, root->array_at(2)->array_at(2)->array_at(0)->get_u64());
+    ASSERT_EQUAL(6, root->array_at(3)->dict_find("k")->array_at(1)->get_u64());
+
+    stdromano::JsonObject* array = json.make_array();
+    json.array_reserve(array, 10);
+
+    for(std::size_t i = 0; i < 1000; i++)
+        json.array_append(array, json.make_u64(i), true);
+
+    ASSERT_EQUAL(1000, array->array_size());
+
+    std::size_t i = 0;
+
+    for(auto* value : array->array_items())
+        ASSERT_EQUAL(i++, value->get_u64());
+
+    json.array_pop(array, 999);
+    json.array_pop(array, 0);
+    json.array_pop(array, 500);
+    json.array_pop(array, 1000);
+
+    ASSERT_EQUAL(997, array->array_size());
+    ASSERT_EQUAL(1, array->array_at(0)->get_u64());
+    ASSERT_EQUAL(500, array->array_at(499)->get_u64());
+    ASSERT_EQUAL(502, array->array_at(500)->get_u64());
+    ASSERT_EQUAL(998, array->array_at(996)->get_u64());
+}
+
+TEST_CASE(test_json_roundtrip)
+{
+    stdromano::Json json;
+
+    const char* doc = R"({"name": "stdromano", "values": [1, -2, 3.5, true, null], "nested": {"key": "va\"lue"}})";
+
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    const stdromano::StringD dumped = json.dumps();
+
+    stdromano::Json other;
+    ASSERT(other.loads(dumped.c_str(), dumped.size()));
+
+    stdromano::JsonObject* root = other.root();
+
+    ASSERT(std::strcmp(root->dict_find("name")->get_str(), "stdromano") == 0);
+    ASSERT_EQUAL(5, root->dict_find("values")->array_size());
+    ASSERT(std::strcmp(root->dict_find("nested")->dict_find("key")->get_str(), "va\"lue") == 0);
+}
+
+TEST_CASE(test_json_zero_copy)
+{
+    char doc[] = R"({"plain": "no escapes", "escaped": "tab\there", "list": ["a", "b"]})";
+    const std::size_t doc_sz = std::strlen(doc);
+
+    {
+        stdromano::Json json;
+
+        ASSERT(json.loads_inplace(doc, doc_sz));
+
+        stdromano::JsonObject* plain = json.root()->dict_find("plain");
+
+        /* Unescaped strings point into the input buffer */
+        ASSERT(plain->get_str() > doc && plain->get_str() < doc + doc_sz);
+        ASSERT(std::strcmp(plain->get_str(), "no escapes") == 0);
+        ASSERT_EQUAL(10, plain->get_str_size());
+
+        stdromano::JsonObject* escaped = json.root()->dict_find("escaped");
+
+        ASSERT(!(escaped->get_str() > doc && escaped->get_str() < doc + doc_sz));
+        ASSERT(std::strcmp(escaped->get_str(), "tab\there") == 0);
+        ASSERT(std::strcmp(json.root()->dict_find("list")->array_at(1)->get_str(), "b") == 0);
+    }
+
+    const stdromano::StringD tmp = stdromano::fs::tmp_dir().unwrap();
+    const stdromano::StringD file_path = stdromano::StringD("{}/stdromano_test_zero_copy.json", tmp);
+
+    const char* file_doc = R"({"name": "mapped", "values": [1, 2, 3], "nested": {"key": "va\"lue"}})";
+
+    ASSERT(!stdromano::fs::write_file_content(file_doc, std::strlen(file_doc), file_path).has_error());
+
+    {
+        stdromano::Json json;
+
+        ASSERT(json.loadf(file_path, stdromano::JsonLoadFlags_ZeroCopy));
+        ASSERT(std::strcmp(json.root()->dict_find("name")->get_str(), "mapped") == 0);
+        ASSERT_EQUAL(3, json.root()->dict_find("values")->array_at(2)->get_u64());
+        ASSERT(std::strcmp(json.root()->dict_find("nested")->dict_find("key")->get_str(), "va\"lue") == 0);
+
+        const stdromano::StringD dumped = json.dumps();
+
+        stdromano::Json other;
+        ASSERT(other.loadf(file_path));
+        ASSERT(other.dumps() == dumped);
+    }
+
+    /* The file itself is never modified */
+    ASSERT(stdromano::fs::load_file_content(file_path).unwrap() == stdromano::StringD(file_doc));
+
+    stdromano::fs::removefile(file_path);
+}
+
+TEST_CASE(test_json_lazy)
+{
+    const char* doc = R"({
+        "skipped": {"deep": [[1, 2, {"x": "]}"}], "\"[{"], "str": "a\\b"},
+        "a": {"b": [0.5, -3, 7, 2.25e2, [true, false, null]], "es\"caped": "tab\there"},
+        "last": 42
+    })";
+
+    stdromano::JsonLazy lazy;
+
+    ASSERT(lazy.loads(doc, std::strlen(doc)));
+    ASSERT(lazy.root().is_dict());
+    ASSERT_EQUAL(3, lazy.root().dict_size());
+
+    ASSERT(lazy["a"]["b"][0].is_f64());
+    ASSERT(lazy["a"]["b"][0].get_f64() == 0.5);
+    ASSERT(lazy["a"]["b"][1].is_i64());
+    ASSERT_EQUAL(-3, lazy["a"]["b"][1].get_i64());
+    ASSERT_EQUAL(7, lazy["a"]["b"][2].get_u64());
+    ASSERT(lazy["a"]["b"][3].get_f64() == 225.0);
+    ASSERT(lazy["a"]["b"][4][0].get_bool());
+    ASSERT(!lazy["a"]["b"][4][1].get_bool());
+    ASSERT(lazy["a"]["b"][4][2].is_null());
+    ASSERT_EQUAL(5, lazy["a"]["b"].array_size());
+    ASSERT_EQUAL(42, lazy["last"].get_u64());
+
+    ASSERT(lazy["a"]["es\"caped"].get_str() == stdromano::StringD("tab\there"));
+    ASSERT(lazy["skipped"]["str"].get_str() == stdromano::StringD("a\\b"));
+    ASSERT(lazy["skipped"]["deep"][0][2]["x"].get_str() == stdromano::StringD("]}"));
+
+    /* Missing paths propagate as invalid values */
+    ASSERT(!lazy["missing"].is_valid());
+    ASSERT(!lazy["a"]["b"][5].is_valid());
+    ASSERT(!lazy["last"]["a"][0].is_valid());
+    ASSERT_EQUAL(0, lazy["missing"]["b"].get_u64());
+
+    std::size_t i = 0;
+
+    for(const stdromano::JsonLazyValue value : lazy["a"]["b"].array_items())
+    {
+        ASSERT(value.is_valid());
+        i++;
+    }
+
+    ASSERT_EQUAL(5, i);
+
+    stdromano::Json json;
+    stdromano::JsonObject* b = lazy["a"]["b"].materialize(json);
+
+    ASSERT(b != nullptr);
+    ASSERT_EQUAL(5, b->array_size());
+    ASSERT_EQUAL(7, b->array_at(2)->get_u64());
+
+    /* Structural validation */
+    for(const char* invalid : { "{\"a\": [1, 2}", "[\"abc]", "{\"a\": 1} 2", "]", "[[]" })
+    {
+        stdromano::JsonLazy other;
+        ASSERT(!other.loads(invalid, std::strlen(invalid)));
+        ASSERT(!other.root().is_valid());
+    }
+
+    /* Separators are only checked when the values are accessed */
+    const char* missing_comma = "[1 2]";
+
+    stdromano::JsonLazy unchecked;
+    ASSERT(unchecked.loads(missing_comma, std::strlen(missing_comma)));
+    ASSERT_EQUAL(1, unchecked[0].get_u64());
+    ASSERT(!unchecked[1].is_valid());
+}
+
+TEST_CASE(test_json_writer)
+{
+    {
+        stdromano::StringD out;
+
+        {
+            stdromano::JsonWriter writer(&out, 2);
+
+            writer.dict_start();
+            writer.key("a");
+            writer.array_start();
+            writer.value_u64(1);
+            writer.value_i64(-2);
+            writer.value_null();
+            writer.array_end();
+            writer.key("b");
+            writer.dict_start();
+            writer.dict_end();
+            writer.key("c");
+            writer.value_str("x\"y");
+            writer.dict_end();
+        }
+
+        ASSERT(out == stdromano::StringD("{\n  \"a\": [\n    1,\n    -2,\n    null\n  ],\n  \"b\": {\n  },\n  \"c\": \"x\\\"y\"\n}"));
+    }
+
+    /* Long strings with escapes at every position of the simd blocks, through a small buffer */
+    stdromano::StringD long_str;
+
+    for(std::size_t i = 0; i < 300; i++)
+        long_str.appendc(i % 37 == 0 ? "\"" : (i % 41 == 0 ? "\n" : (i % 43 == 0 ? "\x01" : "a")), 1);
+
+    stdromano::Json json;
+    stdromano::JsonObject* array = json.make_array();
+    json.set_root(array);
+
+    for(std::size_t i = 0; i < 100; i++)
+    {
+        stdromano::JsonObject* dict = json.make_dict();
+        json.dict_append(dict, "str", json.make_str(long_str.c_str()), true);
+        json.dict_append(dict, "index", json.make_u64(i), true);
+        json.array_append(array, dict, true);
+    }
+
+    stdromano::StringD small_buffer_out;
+
+    {
+        stdromano::JsonWriter writer(&small_buffer_out, 4, 16);
+        ASSERT(writer.write(json.root()));
+    }
+
+    ASSERT(small_buffer_out == json.dumps(4));
+
+    stdromano::Json parsed;
+    ASSERT(parsed.loads(small_buffer_out.c_str(), small_buffer_out.size()));
+    ASSERT_EQUAL(100, parsed.root()->array_size());
+    ASSERT_EQUAL(99, parsed.root()->array_at(99)->dict_find("index")->get_u64());
+    ASSERT_EQUAL(long_str.size(), parsed.root()->array_at(99)->dict_find("str")->get_str_size());
+
+    const stdromano::StringD tmp = stdromano::fs::tmp_dir().unwrap();
+    const stdromano::StringD file_path = stdromano::StringD("{}/stdromano_test_writer.json", tmp);
+
+    ASSERT(json.dumpf(0, file_path));
+    ASSERT(stdromano::fs::load_file_content(file_path).unwrap() == json.dumps());
+
+    stdromano::fs::removefile(file_path);
+}
+
+class JsonEventRecorder : public stdromano::JsonStreamHandler
+{
+public:
+    stdromano::StringD events;
+    std::size_t max_events = static_cast<std::size_t>(-1);
+    std::size_t num_events = 0;
+
+    bool record(const stdromano::StringD& event) noexcept
+    {
+        this->events.appendf("{} ", event);
+        return ++this->num_events < this->max_events;
+    }
+
+    bool dict_start() noexcept override { return this->record("{"); }
+    bool dict_end() noexcept override { return this->record("}"); }
+    bool array_start() noexcept override { return this->record("["); }
+    bool array_end() noexcept override { return this->record("]"); }
+
+    bool key(const char* key, std::size_t key_sz) noexcept override
+    {
+        return this->record(stdromano::StringD::make_fmt("k:{}", std::string(key, key_sz)));
+    }
+
+    bool value_null() noexcept override { return this->record("null"); }
+    bool value_bool(bool b) noexcept override { return this->record(b ? "true" : "false"); }
+    bool value_u64(std::uint64_t u64) noexcept override { return this->record(stdromano::StringD::make_fmt("u:{}", u64)); }
+    bool value_i64(std::int64_t i64) noexcept override { return this->record(stdromano::StringD::make_fmt("i:{}", i64)); }
+    bool value_f64(double f64) noexcept override { return this->record(stdromano::StringD::make_fmt("f:{}", f64)); }
+
+    bool value_str(const char* str, std::size_t str_sz) noexcept override
+    {
+        return this->record(stdromano::StringD::make_fmt("s:{}", std::string(str, str_sz)));
+    }
+};
+
+TEST_CASE(test_json_stream)
+{
+    const char* doc = R"({"name": "stream\"ed", "values": [1, -20, 3.5, 1e2, true, false, null],
+                         "nested": {"empty_array": [], "empty_dict": {}, "es\\cape": "\u0041\t"}} 12 "end")";
+    const std::size_t doc_sz = std::strlen(doc);
+
+    const stdromano::StringD expected = "{ k:name s:stream\"ed k:values [ u:1 i:-20 f:3.5 f:100 true false null ] "
+                                        "k:nested { k:empty_array [ ] k:empty_dict { } k:es\\cape s:?\t } } u:12 s:end ";
+
+    /* Every possible chunk size, splitting every token at every position */
+    for(std::size_t chunk_sz = 1; chunk_sz <= doc_sz; chunk_sz++)
+    {
+        JsonEventRecorder recorder;
+        stdromano::JsonStreamParser parser(&recorder);
+
+        for(std::size_t i = 0; i < doc_sz; i += chunk_sz)
+            ASSERT(parser.feed(doc + i, std::min(chunk_sz, doc_sz - i)));
+
+        ASSERT(parser.finish());
+        ASSERT(recorder.events == expected);
+        ASSERT_EQUAL(doc_sz, parser.offset());
+    }
+
+    /* Incomplete and invalid inputs */
+    for(const char* invalid : { "{\"a\": [1, 2}", "[1 2]", "{\"a\" 1}", "[tru]", "[1.]", "{1: 2}", "]" })
+    {
+        JsonEventRecorder recorder;
+        stdromano::JsonStreamParser parser(&recorder);
+
+        ASSERT(!parser.feed(invalid, std::strlen(invalid)) || !parser.finish());
+    }
+
+    {
+        JsonEventRecorder recorder;
+        stdromano::JsonStreamParser parser(&recorder);
+
+        ASSERT(parser.feed("[1, {\"a\": ", 10));
+        ASSERT(!parser.finish());
+
+        parser.reset();
+
+        ASSERT(parser.feed("[1, 2]", 6));
+        ASSERT(parser.finish());
+    }
+
+    /* The handler can stop the parsing */
+    {
+        JsonEventRecorder recorder;
+        recorder.max_events = 3;
+
+        stdromano::JsonStreamParser parser(&recorder);
+
+        ASSERT(!parser.feed("[1, 2, 3, 4]", 12));
+        ASSERT(recorder.events == stdromano::StringD("[ u:1 u:2 "));
+        ASSERT(!parser.feed("5", 1));
+    }
+}
+
+TEST_CASE(test_json_lines)
+{
+    constexpr std::size_t num_lines = 20000;
+
+    stdromano::StringD lines;
+
+    for(std::size_t i = 0; i < num_lines; i++)
+    {
+        lines.appendf("{{\"id\": {}, \"name\": \"record_{}\", \"values\": [1, 2, 3]}}\n", i, i);
+
+        if(i % 1000 == 0)
+            lines.appendc("\n", 1);
+    }
+
+    {
+        stdromano::JsonLinesReader reader(stdromano::JsonLinesFlags_Ordered, 4096);
+
+        std::size_t expected_id = 0;
+        std::size_t last_offset = 0;
+        bool in_order = true;
+
+        ASSERT(reader.read(lines.c_str(), lines.size(), [&](stdromano::JsonObject* record, std::size_t offset) {
+            in_order &= record->dict_find("id")->get_u64() == expected_id++;
+            in_order &= offset >= last_offset && lines.c_str()[offset] == '{';
+            last_offset = offset;
+        }));
+
+        ASSERT(in_order);
+        ASSERT_EQUAL(num_lines, expected_id);
+        ASSERT_EQUAL(num_lines, reader.num_records());
+    }
+
+    {
+        stdromano::JsonLinesReader reader(0, 4096);
+
+        stdromano::Atomic<std::size_t> count{0};
+        stdromano::Atomic<std::size_t> sum{0};
+
+        ASSERT(reader.read(lines.c_str(), lines.size(), [&](stdromano::JsonObject* record, std::size_t offset) {
+            STDROMANO_UNUSED(offset);
+            count.fetch_add(1);
+            sum.fetch_add(record->dict_find("id")->get_u64());
+        }));
+
+        ASSERT_EQUAL(num_lines, count.load());
+        ASSERT_EQUAL(num_lines * (num_lines - 1) / 2, sum.load());
+    }
+
+    {
+        /* The slots of the first read are reused by the next ones */
+        stdromano::JsonLinesReader reader(stdromano::JsonLinesFlags_Ordered, 4096);
+
+        for(std::size_t round = 0; round < 3; round++)
+        {
+            std::size_t expected_id = 0;
+
+            ASSERT(reader.read(lines.c_str(), lines.size(), [&](stdromano::JsonObject* record, std::size_t) {
+                ASSERT_EQUAL(expected_id++, record->dict_find("id")->get_u64());
+            }));
+
+            ASSERT_EQUAL(num_lines, reader.num_records());
+        }
+    }
+
+    const char* invalid = "{\"a\": 1}\n{\"a\": \n[1, 2]\r\n";
+
+    /* The invalid line is reported, the records before it are delivered */
+    for(const std::uint32_t flags : { static_cast<std::uint32_t>(stdromano::JsonLinesFlags_Ordered), 0u })
+    {
+        stdromano::JsonLinesReader reader(flags);
+
+        stdromano::Atomic<std::size_t> count{0};
+
+        ASSERT(!reader.read(invalid, std::strlen(invalid), [&](stdromano::JsonObject* record, std::size_t offset) {
+            ASSERT_EQUAL(0, offset);
+            ASSERT_EQUAL(1, record->dict_find("a")->get_u64());
+            count.fetch_add(1);
+        }));
+
+        ASSERT_EQUAL(1, count.load());
+        ASSERT_EQUAL(1, reader.num_records());
+        ASSERT_EQUAL(9, reader.error_offset());
+    }
+
+    {
+        stdromano::JsonLinesReader reader(stdromano::JsonLinesFlags_Ordered | stdromano::JsonLinesFlags_SkipInvalid);
+        ASSERT(reader.read(invalid, std::strlen(invalid), [](stdromano::JsonObject*, std::size_t) {}));
+        ASSERT_EQUAL(2, reader.num_records());
+        ASSERT_EQUAL(1, reader.num_invalid());
+    }
+
+    const stdromano::StringD tmp = stdromano::fs::tmp_dir().unwrap();
+    const stdromano::StringD file_path = stdromano::StringD("{}/stdromano_test_lines.ndjson", tmp);
+
+    ASSERT(!stdromano::fs::write_file_content(lines.c_str(), lines.size(), file_path).has_error());
+
+    {
+        stdromano::JsonLinesReader reader(stdromano::JsonLinesFlags_Ordered);
+        ASSERT(reader.readf(file_path, [](stdromano::JsonObject*, std::size_t) {}));
+        ASSERT_EQUAL(num_lines, reader.num_records());
+    }
+
+    stdromano::fs::removefile(file_path);
+}
+
+TEST_CASE(test_json_reset)
 {
-    spdlog::set_level(spdlog::level::debug);
+    const char* doc = R"({"id": 42, "name": "payload", "tags": ["a", "b", "c"]})";
 
     stdromano::Json json;
 
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    const stdromano::JsonObject* first_root = json.root();
+
+    json.reset();
+
+    ASSERT(json.root() == nullptr);
+
+    /* The arenas are rewound, the same document is parsed at the same addresses */
+    ASSERT(json.loads(doc, std::strlen(doc)));
+    ASSERT(json.root() == first_root);
+    ASSERT_EQUAL(42, json.root()->dict_find("id")->get_u64());
+
+    stdromano::Json moved(std::move(json));
+
+    ASSERT(json.root() == nullptr);
+    ASSERT(moved.root() == first_root);
+    ASSERT_EQUAL(3, moved.root()->dict_find("tags")->array_size());
+
+    /* A moved-from document is empty, and can be reused */
+    ASSERT(json.loads("[1, 2]", 6));
+    ASSERT_EQUAL(2, json.root()->array_size());
+    json.reset();
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    stdromano::Json assigned;
+    ASSERT(assigned.loads("[1]", 3));
+
+    assigned = std::move(moved);
+
+    ASSERT(assigned.root() == first_root);
+    ASSERT(std::strcmp(assigned.root()->dict_find("name")->get_str(), "payload") == 0);
+
+    stdromano::JsonPool pool(2);
+
+    stdromano::Json* a = pool.acquire();
+    stdromano::Json* b = pool.acquire();
+    stdromano::Json* c = pool.acquire();
+
+    ASSERT(a->loads(doc, std::strlen(doc)));
+    ASSERT(b->loads("[1, 2]", 6));
+
+    pool.release(a);
+    pool.release(b);
+    pool.release(c);
+
+    ASSERT_EQUAL(2, pool.size());
+
+    stdromano::Json* reused = pool.acquire();
+
+    ASSERT(reused == a || reused == b);
+    ASSERT(reused->root() == nullptr);
+    ASSERT(reused->loads(doc, std::strlen(doc)));
+    ASSERT_EQUAL(42, reused->root()->dict_find("id")->get_u64());
+
+    pool.release(reused);
+
+    ASSERT_EQUAL(2, pool.size());
+
+    /* A warm pool parses without allocating, arrays included */
+    const char* array_doc = R"({"id":42,"tags":["a","b","c"]})";
+
+    for(std::size_t i = 0; i < 2; ++i)
+    {
+        stdromano::Json* warm = pool.acquire();
+        ASSERT(warm->loads(array_doc, std::strlen(array_doc)));
+        pool.release(warm);
+    }
+
+    const std::uint64_t allocated = stdromano::mem_thread_allocated_bytes();
+
+    for(std::size_t i = 0; i < 1000; ++i)
+    {
+        stdromano::Json* warm = pool.acquire();
+        ASSERT(warm->loads(array_doc, std::strlen(array_doc)));
+        ASSERT_EQUAL(3, warm->root()->dict_find("tags")->array_size());
+        pool.release(warm);
+    }
+
+    ASSERT(stdromano::mem_thread_allocated_bytes() == allocated);
+}
+
+TEST_CASE(test_json_fields)
+{
+    const char* doc = R"({
+        "id": 7,
+        "unknown": {"nested": [1, {"deep": null}], "s": "}"},
+        "delta": -12,
+        "enabled": true,
+        "name": "line\nbreak",
+        "points": [{"x": 1.5, "y": -2}, {"y": 3}],
+        "ids": [1, 2, 18446744073709551615],
+        "na\"me": 13
+    })";
+
+    JsonTestMessage message;
+
+    ASSERT(stdromano::json_loads(doc, std::strlen(doc), message));
+    ASSERT_EQUAL(7, message.id);
+    ASSERT_EQUAL(-12, message.delta);
+    ASSERT(message.enabled);
+    ASSERT(message.name == stdromano::StringD("line\nbreak"));
+    ASSERT_EQUAL(2, message.points.size());
+    ASSERT(message.points[0].x == 1.5 && message.points[0].y == -2.0);
+    ASSERT(message.points[1].x == 0.0 && message.points[1].y == 3.0);
+    ASSERT_EQUAL(3, message.ids.size());
+    ASSERT(message.ids[2] == 18446744073709551615ULL);
+
+    const stdromano::StringD dumped = stdromano::json_dumps(message);
+
+    JsonTestMessage reloaded;
+
+    ASSERT(stdromano::json_loads(dumped.c_str(), dumped.size(), reloaded));
+    ASSERT_EQUAL(message.id, reloaded.id);
+    ASSERT_EQUAL(message.delta, reloaded.delta);
+    ASSERT(reloaded.name == message.name);
+    ASSERT_EQUAL(2, reloaded.points.size());
+    ASSERT(reloaded.points[0].x == 1.5);
+    ASSERT(reloaded.ids[2] == message.ids[2]);
+
+    /* The dumped dict matches the tree writer output */
+    stdromano::Json json;
+    ASSERT(json.loads(dumped.c_str(), dumped.size()));
+    ASSERT(json.dumps() == dumped);
+
+    /* Type, range and syntax errors */
+    const char* invalid[] = {
+        R"({"id": -1})",
+        R"({"id": 4294967296})",
+        R"({"delta": 40000})",
+        R"({"enabled": 1})",
+        R"({"name": 3})",
+        R"({"points": [{"x": "1"}]})",
+        R"({"ids": [1, 2,]})",
+        R"({"id": 1,})",
+        R"({"id": 1} [])",
+        R"({"id" 1})",
+        R"([1, 2])",
+    };
+
+    for(const char* str : invalid)
+    {
+        JsonTestMessage m;
+        ASSERT(!stdromano::json_loads(str, std::strlen(str), m));
+    }
+
+    stdromano::Vector<JsonTestPoint> points;
+    const char* array = "[]";
+
+    ASSERT(stdromano::json_loads(array, 2, points));
+    ASSERT_EQUAL(0, points.size());
+}
+
+TEST_CASE(test_json_path)
+{
+    const char* doc = R"({
+        "store": {
+            "books": [
+                {"title": "A", "author": "Tolkien", "price": 10, "tags": ["fantasy"]},
+                {"title": "B", "author": "Herbert", "price": 8.5, "available": true},
+                {"title": "C", "author": "Tolkien", "price": -3},
+                {"title": "D", "author": "Le Guin", "price": 10.0, "available": false}
+            ],
+            "a/b": {"m~n": 42}
+        },
+        "empty": []
+    })";
+
+    stdromano::Json json;
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    stdromano::JsonLazy lazy;
+    ASSERT(lazy.loads(doc, std::strlen(doc)));
+
+    const auto titles = [&](const char* path) -> stdromano::StringD {
+        const stdromano::JsonPath compiled(path);
+
+        stdromano::StringD res;
+
+        if(!compiled.valid())
+            return stdromano::StringD("invalid");
+
+        stdromano::Vector<stdromano::JsonObject*> tree_matches;
+        stdromano::Vector<stdromano::JsonLazyValue> lazy_matches;
+
+        compiled.find_all(json.root(), tree_matches);
+        compiled.find_all(lazy.root(), lazy_matches);
+
+        if(tree_matches.size() != lazy_matches.size())
+            return stdromano::StringD("mismatch");
+
+        for(std::size_t i = 0; i < tree_matches.size(); i++)
+        {
+            stdromano::JsonObject* title = tree_matches[i]->dict_find("title");
+
+            if(title == nullptr || !(lazy_matches[i]["title"].get_str() == stdromano::StringD(title->get_str())))
+                return stdromano::StringD("mismatch");
+
+            res.push_back(title->get_str()[0]);
+        }
+
+        return res;
+    };
+
+    ASSERT(titles("$.store.books[*]") == stdromano::StringD("ABCD"));
+    ASSERT(titles("$['store']['books'].*") == stdromano::StringD("ABCD"));
+    ASSERT(titles("$.store.books[1]") == stdromano::StringD("B"));
+    ASSERT(titles("$.store.books[-1]") == stdromano::StringD("D"));
+    ASSERT(titles("$.store.books[1:3]") == stdromano::StringD("BC"));
+    ASSERT(titles("$.store.books[::2]") == stdromano::StringD("AC"));
+    ASSERT(titles("$.store.books[-2:]") == stdromano::StringD("CD"));
+    ASSERT(titles("$.store.books[::-1]") == stdromano::StringD("DCBA"));
+    ASSERT(titles("$.store.books[2:0:-1]") == stdromano::StringD("CB"));
+    ASSERT(titles("$.store.books[?(@.author == 'Tolkien')]") == stdromano::StringD("AC"));
+    ASSERT(titles("$.store.books[?(@.author != 'Tolkien')]") == stdromano::StringD("BD"));
+    ASSERT(titles("$.store.books[?(@.price == 10)]") == stdromano::StringD("AD"));
+    ASSERT(titles("$.store.books[?(@.price == -3)]") == stdromano::StringD("C"));
+    ASSERT(titles("$.store.books[?(@.available == true)]") == stdromano::StringD("B"));
+    ASSERT(titles("$.store.books[?(@['tags'][0] == 'fantasy')]") == stdromano::StringD("invalid"));
+    ASSERT(titles("$.store.books[?(@.missing == null)]") == stdromano::StringD(""));
+    ASSERT(titles("$.store.books[10]") == stdromano::StringD(""));
+    ASSERT(titles("$.empty[*]") == stdromano::StringD(""));
+
+    /* JSON Pointer */
+    stdromano::JsonPath pointer("/store/books/2/author");
+    ASSERT(pointer.valid() && pointer.is_single());
+    ASSERT(std::strcmp(pointer.find(json.root())->get_str(), "Tolkien") == 0);
+    ASSERT(pointer.find(lazy.root()).get_str() == stdromano::StringD("Tolkien"));
+
+    stdromano::JsonPath escaped("/store/a~1b/m~0n");
+    ASSERT(escaped.valid());
+    ASSERT_EQUAL(42, escaped.find(json.root())->get_u64());
+    ASSERT_EQUAL(42, escaped.find(lazy.root()).get_u64());
+
+    ASSERT(stdromano::JsonPath("").find(json.root()) == json.root());
+    ASSERT(stdromano::JsonPath("/store/books/01").find(json.root()) == nullptr);
+    ASSERT(!stdromano::JsonPath("/store/books/-").find(lazy.root()).is_valid());
+    ASSERT(!stdromano::JsonPath("/a~2").valid());
+    ASSERT(!stdromano::JsonPath("store").valid());
+    ASSERT(!stdromano::JsonPath("$..title").valid());
+    ASSERT(!stdromano::JsonPath("$.store.books[::0]").valid());
+    ASSERT(!stdromano::JsonPath("$.store.books[?(@.a < 1)]").valid());
+    ASSERT(!stdromano::JsonPath("$.store.books[*].title").is_single());
+}
+
+TEST_CASE(test_json_binary)
+{
+    const char* doc = R"({"name": "binary", "values": [1, -2, 3.25, true, false, null, "str"],
+                         "nested": {"zeta": 1, "alpha": {"name": "inner"}, "mid": []}, "": "empty_key"})";
+
+    stdromano::Json json;
+    ASSERT(json.loads(doc, std::strlen(doc)));
+
+    const stdromano::StringD tmp = stdromano::fs::tmp_dir().unwrap();
+    const stdromano::StringD file_path = stdromano::StringD("{}/stdromano_test_binary.bjson", tmp);
+
+    ASSERT(json.dumpb(file_path));
+
+    /* Reload into a tree, with and without copying the strings */
+    for(const std::uint32_t flags : { 0u, static_cast<std::uint32_t>(stdromano::JsonLoadFlags_ZeroCopy) })
+    {
+        stdromano::Json loaded;
+        ASSERT(loaded.loadb(file_path, flags));
+        ASSERT(loaded.dumps() == json.dumps());
+        ASSERT(std::strcmp(loaded.root()->dict_find("nested")->dict_find("alpha")->dict_find("name")->get_str(), "inner") == 0);
+    }
+
+    const stdromano::StringD content = stdromano::fs::load_file_content(file_path).unwrap();
+
+    {
+        stdromano::Json loaded;
+        ASSERT(loaded.loadb(content.data(), content.size()));
+        ASSERT(loaded.dumps() == json.dumps());
+
+        /* Truncated or corrupted inputs are rejected */
+        ASSERT(!loaded.loadb(content.data(), content.size() - 1));
+        ASSERT(!loaded.loadb(content.data() + 4, content.size() - 4));
+    }
+
+    const stdromano::StringD crafted_path = stdromano::StringD("{}/stdromano_test_binary_crafted.bjson", tmp);
+
+    {
+        /* A str without its null terminator is rejected */
+        stdromano::Json str;
+        str.set_root(str.make_str("abc"));
+        ASSERT(str.dumpb(crafted_path));
+
+        stdromano::StringD str_content = stdromano::fs::load_file_content(crafted_path).unwrap();
+
+        stdromano::Json loaded;
+        ASSERT(loaded.loadb(str_content.data(), str_content.size()));
+
+        str_content[8 + 8 + 3] = 'd';
+        ASSERT(!loaded.loadb(str_content.data(), str_content.size()));
+    }
+
+    {
+        /* Arrays sharing their children are rejected instead of expanding exponentially: each
+           array references the previous one twice, giving 2^40 values once loaded */
+        stdromano::Json pair;
+        pair.set_root(pair.make_array());
+        pair.array_append(pair.root(), pair.make_null());
+        pair.array_append(pair.root(), pair.make_null());
+        ASSERT(pair.dumpb(crafted_path));
+
+        const stdromano::StringD pair_content = stdromano::fs::load_file_content(crafted_path).unwrap();
+
+        const auto read_u32 = [](const char* data, std::size_t offset) {
+            std::uint32_t value;
+            std::memcpy(&value, data + offset, sizeof(std::uint32_t));
+            return value;
+        };
+
+        const std::uint32_t null_tag = read_u32(pair_content.data(), 8);
+        const std::uint32_t array_tag = read_u32(pair_content.data(), read_u32(pair_content.data(), pair_content.size() - 4));
+
+        stdromano::Vector<std::uint32_t> words;
+        words.push_back(read_u32(pair_content.data(), 0));
+        words.push_back(read_u32(pair_content.data(), 4));
+        words.push_back(null_tag);
+        words.push_back(0);
+
+        std::uint32_t child = 8;
+
+        for(std::size_t i = 0; i < 40; i++)
+        {
+            const std::uint32_t offset = static_cast<std::uint32_t>(words.size() * 4);
+
+            words.push_back(array_tag);
+            words.push_back(2);
+            words.push_back(child);
+            words.push_back(child);
+
+            child = offset;
+        }
+
+        words.push_back(child);
+
+        stdromano::Json loaded;
+        ASSERT(loaded.loadb(pair_content.data(), pair_content.size()));
+        ASSERT(!loaded.loadb(reinterpret_cast<const char*>(words.data()), words.size() * 4));
+
+        /* Deeply nested one-element arrays are rejected instead of overflowing the stack */
+        const auto make_nested = [&](std::size_t depth) {
+            stdromano::Vector<std::uint32_t> nested;
+            nested.push_back(read_u32(pair_content.data(), 0));
+            nested.push_back(read_u32(pair_content.data(), 4));
+            nested.push_back(null_tag);
+            nested.push_back(0);
+
+            std::uint32_t nested_child = 8;
+
+            for(std::size_t i = 0; i < depth; i++)
+            {
+                const std::uint32_t offset = static_cast<std::uint32_t>(nested.size() * 4);
+
+                nested.push_back(array_tag);
+                nested.push_back(1);
+                nested.push_back(nested_child);
+
+                nested_child = offset;
+            }
+
+            nested.push_back(nested_child);
+
+            return nested;
+        };
+
+        const stdromano::Vector<std::uint32_t> nested = make_nested(1000);
+        ASSERT(loaded.loadb(reinterpret_cast<const char*>(nested.data()), nested.size() * 4));
+
+        const stdromano::Vector<std::uint32_t> bomb = make_nested(1000000);
+        ASSERT(!loaded.loadb(reinterpret_cast<const char*>(bomb.data()), bomb.size() * 4));
+    }
+
+    stdromano::fs::removefile(crafted_path);
+
+    /* Navigation without loading */
+    stdromano::JsonBinary binary;
+    ASSERT(binary.loadf(file_path));
+
+    stdromano::JsonBinaryValue root = binary.root();
+
+    ASSERT(root.is_dict());
+    ASSERT_EQUAL(4, root.dict_size());
+    ASSERT(std::strcmp(root.dict_key_at(0), "name") == 0);
+    ASSERT(std::strcmp(root.dict_find("name").get_str(), "binary") == 0);
+    ASSERT_EQUAL(6, root.dict_find("name").get_str_size());
+    ASSERT(std::strcmp(root.dict_find("").get_str(), "empty_key") == 0);
+
+    stdromano::JsonBinaryValue values = root.dict_find("values");
+
+    ASSERT_EQUAL(7, values.array_size());
+    ASSERT_EQUAL(1, values.array_at(0).get_u64());
+    ASSERT_EQUAL(-2, values.array_at(1).get_i64());
+    ASSERT(values.array_at(2).get_f64() == 3.25);
+    ASSERT(values.array_at(3).get_bool());
+    ASSERT(values.array_at(4).is_bool() && !values.array_at(4).get_bool());
+    ASSERT(values.array_at(5).is_null());
+    ASSERT(std::strcmp(values.array_at(6).get_str(), "str") == 0);
+    ASSERT(!values.array_at(7).is_valid());
+
+    stdromano::JsonBinaryValue nested = root.dict_find("nested");
+
+    ASSERT_EQUAL(1, nested.dict_find("zeta").get_u64());
+    ASSERT(std::strcmp(nested.dict_find("alpha").dict_find("name").get_str(), "inner") == 0);
+    ASSERT(nested.dict_find("mid").is_array());
+    ASSERT_EQUAL(0, nested.dict_find("mid").array_size());
+    ASSERT(!nested.dict_find("beta").is_valid());
+    ASSERT(!nested.dict_find("zzz").is_valid());
+    ASSERT(!values.dict_find("name").is_valid());
+
+    stdromano::fs::removefile(file_path);
+
+    /* Large dicts go through the sorted table */
+    stdromano::Json wide;
+    stdromano::JsonObject* dict = wide.make_dict();
+    wide.set_root(dict);
+
+    for(std::size_t i = 0; i < 1000; i++)
+        wide.dict_append(dict, stdromano::StringD::make_fmt("key_{}", i).c_str(), wide.make_u64(i), true);
+
+    ASSERT(wide.dumpb(file_path));
+    ASSERT(binary.loadf(file_path));
+
+    for(std::size_t i = 0; i < 1000; i++)
+        ASSERT_EQUAL(i, binary.root().dict_find(stdromano::StringD::make_fmt("key_{}", i).c_str()).get_u64());
+
+    stdromano::fs::removefile(file_path);
+}
+
+TEST_CASE(test_json_files)
+{
+    stdromano::Json json;
+
     for(const auto file : { "twitter", "citm_catalog", "canada" })
     {
+        const stdromano::StringD file_path("{}/json/{}.json", TESTS_DATA_DIR, file);
+
+        if(!stdromano::fs::path_exists(file_path))
+        {
+            spdlog::warn("Json file {} does not exist, discarding", file_path);
+            continue;
+        }
+
         SCOPED_PROFILE_START(stdromano::ProfileUnit::MilliSeconds, json_loadf);
-        json.loadf(stdromano::StringD("{}/json/{}.json", TESTS_DATA_DIR, file));
+        ASSERT(json.loadf(file_path));
         SCOPED_PROFILE_STOP(json_loadf);
 
         SCOPED_PROFILE_START(stdromano::ProfileUnit::MilliSeconds, json_dumpf);
-        json.dumpf(2, stdromano::StringD("{}/json/out_{}.json", TESTS_DATA_DIR, file));
+        ASSERT(json.dumpf(2, stdromano::StringD("{}/json/out_{}.json", TESTS_DATA_DIR, file)));
         SCOPED_PROFILE_STOP(json_dumpf);
     }
+}
+
+int main()
+{
+    TestRunner runner("json");
+
+    runner.add_test("Json Dict Find Small", test_json_dict_find_small);
+    runner.add_test("Json Dict Find Large", test_json_dict_find_large);
+    runner.add_test("Json Dict Pop", test_json_dict_pop);
+    runner.add_test("Json Array Access", test_json_array_access);
+    runner.add_test("Json Roundtrip", test_json_roundtrip);
+    runner.add_test("Json Zero Copy", test_json_zero_copy);
+    runner.add_test("Json Lazy", test_json_lazy);
+    runner.add_test("Json Writer", test_json_writer);
+    runner.add_test("Json Stream", test_json_stream);
+    runner.add_test("Json Lines", test_json_lines);
+    runner.add_test("Json Reset", test_json_reset);
+    runner.add_test("Json Fields", test_json_fields);
+    runner.add_test("Json Path", test_json_path);
+    runner.add_test("Json Binary", test_json_binary);
+    runner.add_test("Json Files", test_json_files);
+
+    runner.run_all();
 
     return 0;
 }
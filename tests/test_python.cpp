@@ -10,6 +10,8 @@
 
 #include "spdlog/sinks/stdout_color_sinks.h"
 
+#include <cstring>
+
 int main()
 {
     auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
@@ -22,6 +24,391 @@ int main()
 
     stdromano::Python::AST ast(logger);
 
+    {
+        // Names are copied out of the source code, which does not need to outlive the AST
+        stdromano::StringD inline_source("from os.path import join as j\nif lambda_ is not None:\n    value = lambda_ + 1\n");
+
+        if(!ast.from_text(inline_source))
+        {
+            spdlog::error("Cannot parse inline source code");
+            return 1;
+        }
+
+        inline_source = stdromano::StringD("# overwritten #######################################################");
+
+        const auto& body = ast.root()->body;
+        const auto* import_from = static_cast<const stdromano::Python::ImportFromNode*>(body[0]);
+
+        if(body.size() != 2 ||
+           body[0]->type() != stdromano::Python::ASTNodeImportFrom ||
+           import_from->module != "os.path" ||
+           import_from->names[0] != "join" ||
+           import_from->aliases[0] != "j" ||
+           body[1]->type() != stdromano::Python::ASTNodeIf)
+        {
+            spdlog::error("Unexpected AST for inline source code");
+            return 1;
+        }
+    }
+
+    {
+        // Child lists of the parser: bodies, arguments, elements, comparison chains and patterns
+        stdromano::StringD lists_source("def f(a, b, *c, d=1, **e):\n"
+                                        "    x = [a, b, 3]\n"
+                                        "    y = (a, b)\n"
+                                        "    return a < b <= x[0] != y\n"
+                                        "match p:\n"
+                                        "    case Point(1, y, z=2, w=3):\n"
+                                        "        pass\n"
+                                        "    case _:\n"
+                                        "        pass\n");
+
+        if(!ast.from_text(lists_source) || ast.root()->body.size() != 2)
+        {
+            spdlog::error("Cannot parse lists source code");
+            return 1;
+        }
+
+        const auto* function = static_cast<const stdromano::Python::FunctionDefNode*>(ast.root()->body[0]);
+        const auto& args = function->args;
+
+        if(function->type() != stdromano::Python::ASTNodeFunctionDef ||
+           args.size() != 5 ||
+           function->body.size() != 3)
+        {
+            spdlog::error("Unexpected function definition ({} args, {} statements)", args.size(), function->body.size());
+            return 1;
+        }
+
+        const char* arg_names[] = { "a", "b", "c", "d", "e" };
+
+        for(std::size_t i = 0; i < 5; ++i)
+        {
+            const auto* arg = static_cast<const stdromano::Python::FunctionArgNode*>(args[i]);
+
+            if(arg->name != arg_names[i] ||
+               arg->is_vararg != (i == 2) ||
+               arg->is_kwarg != (i == 4) ||
+               (arg->default_value != nullptr) != (i == 3))
+            {
+                spdlog::error("Unexpected function argument {}", i);
+                return 1;
+            }
+        }
+
+        const auto* list_assign = static_cast<const stdromano::Python::AssignNode*>(function->body[0]);
+        const auto* tuple_assign = static_cast<const stdromano::Python::AssignNode*>(function->body[1]);
+        const auto* list = static_cast<const stdromano::Python::ListNode*>(list_assign->value);
+        const auto* tuple = static_cast<const stdromano::Python::TupleNode*>(tuple_assign->value);
+
+        if(list_assign->targets.size() != 1 ||
+           list->type() != stdromano::Python::ASTNodeList ||
+           list->elts.size() != 3 ||
+           list->elts[2]->type() != stdromano::Python::ASTNodeConstant ||
+           tuple->type() != stdromano::Python::ASTNodeTuple ||
+           tuple->elts.size() != 2 ||
+           static_cast<const stdromano::Python::NameNode*>(tuple->elts[1])->id != "b")
+        {
+            spdlog::error("Unexpected list or tuple elements");
+            return 1;
+        }
+
+        const auto* compare = static_cast<const stdromano::Python::CompareOp*>(
+            static_cast<const stdromano::Python::ReturnNode*>(function->body[2])->value);
+
+        if(compare->type() != stdromano::Python::ASTNodeCompareOp ||
+           compare->ops.size() != 3 ||
+           compare->comparators.size() != 3 ||
+           compare->ops[0] != stdromano::Python::ComparatorLessThan ||
+           compare->ops[1] != stdromano::Python::ComparatorLessEqualsThan ||
+           compare->ops[2] != stdromano::Python::ComparatorNotEquals ||
+           compare->comparators[1]->type() != stdromano::Python::ASTNodeSubscript ||
+           static_cast<const stdromano::Python::NameNode*>(compare->comparators[2])->id != "y")
+        {
+            spdlog::error("Unexpected comparison chain ({} operators)", compare->ops.size());
+            return 1;
+        }
+
+        const auto* match = static_cast<const stdromano::Python::MatchNode*>(ast.root()->body[1]);
+        const auto* first_case = static_cast<const stdromano::Python::MatchCaseNode*>(match->cases[0]);
+        const auto* cls = static_cast<const stdromano::Python::MatchClassNode*>(first_case->pattern);
+
+        if(match->cases.size() != 2 ||
+           first_case->body.size() != 1 ||
+           cls->type() != stdromano::Python::ASTNodeMatchClass ||
+           cls->patterns.size() != 2 ||
+           cls->kwd_attrs.size() != 2 ||
+           cls->kwd_patterns.size() != 2 ||
+           cls->patterns[0]->type() != stdromano::Python::ASTNodeMatchValue ||
+           cls->patterns[1]->type() != stdromano::Python::ASTNodeMatchAs ||
+           cls->kwd_attrs[0] != "z" ||
+           cls->kwd_attrs[1] != "w" ||
+           cls->kwd_patterns[1]->type() != stdromano::Python::ASTNodeMatchValue)
+        {
+            spdlog::error("Unexpected class pattern ({} positional, {} keyword)", cls->patterns.size(), cls->kwd_patterns.size());
+            return 1;
+        }
+
+        if(ast.from_text(stdromano::StringD("match p:\n    case C(x=1, y):\n        pass\n")))
+        {
+            spdlog::error("Positional pattern after a keyword pattern has been accepted");
+            return 1;
+        }
+    }
+
+    {
+        // Visitor hooks, and walks matching the recursive visit
+        struct Counter : stdromano::Python::Visitor<Counter>
+        {
+            std::size_t num_calls = 0;
+            std::size_t num_nodes = 0;
+            std::size_t num_left = 0;
+            std::uint32_t max_depth = 0;
+
+            bool pre(stdromano::Python::Node*, std::uint32_t depth) noexcept
+            {
+                this->num_nodes++;
+                this->max_depth = std::max(this->max_depth, depth);
+                return true;
+            }
+
+            void post(stdromano::Python::Node*, std::uint32_t) noexcept { this->num_left++; }
+
+            bool visit_Call(stdromano::Python::CallNode*) noexcept
+            {
+                this->num_calls++;
+                return true;
+            }
+
+            // The body of functions is skipped
+            bool visit_FunctionDef(stdromano::Python::FunctionDefNode*) noexcept { return false; }
+        };
+
+        stdromano::StringD visitor_source("print(len(x))\ndef f():\n    g(1)\nh()\n");
+
+        if(!ast.from_text(visitor_source))
+        {
+            spdlog::error("Cannot parse visitor source code");
+            return 1;
+        }
+
+        Counter counter;
+        counter.walk(ast.root());
+
+        std::size_t num_visited = 0;
+
+        stdromano::Python::visit(ast.root(), [&](stdromano::Python::Node* node, std::uint32_t) -> bool {
+            num_visited++;
+            return node->type() != stdromano::Python::ASTNodeFunctionDef;
+        });
+
+        if(counter.num_calls != 3 ||
+           counter.num_nodes != num_visited ||
+           counter.num_left != counter.num_nodes - 1 ||
+           counter.max_depth != 4 ||
+           std::strcmp(ast.root()->body[1]->type_str(), "FUNC_DEF") != 0)
+        {
+            spdlog::error("Unexpected visitor result ({} calls, {} nodes)", counter.num_calls, counter.num_nodes);
+            return 1;
+        }
+    }
+
+    {
+        // Flat AST, matching the tree
+        stdromano::StringD flat_source("def f(a, b=2):\n    return a[1:b] + b\nf(1, b=f)\n");
+
+        if(!ast.from_text(flat_source))
+        {
+            spdlog::error("Cannot parse flat AST source code");
+            return 1;
+        }
+
+        stdromano::Python::FlatAST flat;
+
+        std::uint32_t num_nodes = 0;
+
+        stdromano::Python::visit(ast.root(), [&](stdromano::Python::Node*, std::uint32_t) -> bool {
+            num_nodes++;
+            return true;
+        });
+
+        if(!flat.from_tree(ast.root()) ||
+           flat.size() != num_nodes ||
+           flat.type(0) != stdromano::Python::ASTNodeModule ||
+           flat.end(0) != flat.size() ||
+           flat.parent(0) != stdromano::Python::FLAT_NONE)
+        {
+            spdlog::error("Unexpected flat AST ({} nodes, {} in the tree)", flat.size(), num_nodes);
+            return 1;
+        }
+
+        std::uint32_t num_f = 0;
+
+        for(std::uint32_t i = 1; i < flat.size(); ++i)
+        {
+            const std::uint32_t parent = flat.parent(i);
+
+            if(parent >= i || flat.end(i) > flat.end(parent))
+            {
+                spdlog::error("Flat AST node {} is not in the subtree of its parent", i);
+                return 1;
+            }
+
+            if(flat.type(i) == stdromano::Python::ASTNodeName && flat.string(flat.record(i).word()) == "f")
+                num_f++;
+        }
+
+        // Module body: the function definition, then the call expression
+        stdromano::Python::FlatList body = flat.record(0).list();
+
+        stdromano::Python::FlatRecord function = flat.record(body[0]);
+        const stdromano::StringD function_name = flat.string(function.word());
+        function.word(); // posonly_index
+        function.word(); // kwonly_index
+        stdromano::Python::FlatList args = function.list();
+        stdromano::Python::FlatList function_body = function.list();
+
+        if(body.size != 2 ||
+           function_name != "f" ||
+           args.size != 2 ||
+           function_body.size != 1 ||
+           flat.type(function_body[0]) != stdromano::Python::ASTNodeReturn ||
+           flat.type(body[1]) != stdromano::Python::ASTNodeExpr ||
+           num_f != 2)
+        {
+            spdlog::error("Unexpected flat AST records");
+            return 1;
+        }
+
+        // Round trip through the raw arrays, as when saved to and read from a file
+        stdromano::Python::FlatAST moved(std::move(flat));
+
+        const stdromano::Python::FlatArrays arrays = moved.arrays();
+
+        stdromano::Vector<std::uint8_t> types(arrays.types, arrays.types + arrays.num_nodes);
+        stdromano::Vector<std::uint32_t> nodes;
+
+        for(const std::uint32_t* array : { arrays.lines, arrays.columns, arrays.parents, arrays.ends, arrays.records })
+            for(std::uint32_t i = 0; i < arrays.num_nodes; ++i)
+                nodes.push_back(array[i]);
+
+        stdromano::Vector<std::uint32_t> extra(arrays.extra, arrays.extra + arrays.extra_size);
+        stdromano::Vector<char> strings(arrays.strings, arrays.strings + arrays.strings_size);
+
+        stdromano::Python::FlatArrays loaded_arrays;
+        loaded_arrays.types = types.data();
+        loaded_arrays.lines = nodes.data();
+        loaded_arrays.columns = nodes.data() + arrays.num_nodes;
+        loaded_arrays.parents = nodes.data() + arrays.num_nodes * 2;
+        loaded_arrays.ends = nodes.data() + arrays.num_nodes * 3;
+        loaded_arrays.records = nodes.data() + arrays.num_nodes * 4;
+        loaded_arrays.num_nodes = arrays.num_nodes;
+        loaded_arrays.extra = extra.data();
+        loaded_arrays.extra_size = arrays.extra_size;
+        loaded_arrays.strings = strings.data();
+        loaded_arrays.strings_size = arrays.strings_size;
+
+        stdromano::Python::FlatAST loaded;
+
+        if(!flat.empty() || moved.size() != num_nodes || !loaded.from_arrays(loaded_arrays))
+        {
+            spdlog::error("Cannot move or load the flat AST");
+            return 1;
+        }
+
+        for(std::uint32_t i = 0; i < loaded.size(); ++i)
+        {
+            stdromano::Python::FlatRecord a = moved.record(i);
+            stdromano::Python::FlatRecord b = loaded.record(i);
+
+            if(loaded.type(i) != moved.type(i) ||
+               loaded.line(i) != moved.line(i) ||
+               loaded.column(i) != moved.column(i) ||
+               loaded.parent(i) != moved.parent(i) ||
+               loaded.end(i) != moved.end(i) ||
+               a.word() != b.word())
+            {
+                spdlog::error("Loaded flat AST differs at node {}", i);
+                return 1;
+            }
+        }
+
+        stdromano::Python::FlatList loaded_body = loaded.record(0).list();
+        stdromano::Python::FlatRecord loaded_function = loaded.record(loaded_body[0]);
+
+        if(loaded_body.size != 2 || loaded.string(loaded_function.word()) != "f")
+        {
+            spdlog::error("Unexpected loaded flat AST records");
+            return 1;
+        }
+
+        // A node whose parent does not come before it is rejected
+        nodes[arrays.num_nodes * 2 + 1] = 2;
+
+        if(loaded.from_arrays(loaded_arrays) || !loaded.empty())
+        {
+            spdlog::error("Inconsistent flat AST arrays have been loaded");
+            return 1;
+        }
+
+        // A node whose parent ends before it is rejected
+        nodes[arrays.num_nodes * 2 + 1] = moved.parent(1);
+
+        const std::uint32_t last = arrays.num_nodes - 1;
+        std::uint32_t leaf = 1;
+
+        while(moved.end(leaf) != leaf + 1)
+            leaf++;
+
+        nodes[arrays.num_nodes * 2 + last] = leaf;
+
+        if(leaf >= last || loaded.from_arrays(loaded_arrays) || !loaded.empty())
+        {
+            spdlog::error("Flat AST arrays with a node outside of its parent have been loaded");
+            return 1;
+        }
+    }
+
+    {
+        // Batch parsing of a tree, with a file that does not parse
+        const stdromano::StringD root = stdromano::StringD("{}/stdromano_test_python_batch", stdromano::fs::tmp_dir().unwrap());
+
+        stdromano::fs::removedir(root, true);
+        stdromano::fs::makedir(stdromano::StringD("{}/sub", root));
+
+        const auto write_file = [](const stdromano::StringD& path, const stdromano::StringD& content) {
+            stdromano::fs::write_file_content(content.data(), content.size(), path, "wb");
+        };
+
+        write_file(stdromano::StringD("{}/a.py", root), "import os\n\ndef f(x):\n    return x + 1\n");
+        write_file(stdromano::StringD("{}/sub/b.py", root), "values = [v * 2 for v in range(10) if v]\n");
+        write_file(stdromano::StringD("{}/sub/broken.py", root), "def f(:\n    pass\n");
+        write_file(stdromano::StringD("{}/sub/notes.txt", root), "def f(:\n");
+
+        stdromano::Python::ASTBatch batch;
+
+        if(batch.parse_tree(root) || batch.num_files() != 3 || batch.num_errors() != 1)
+        {
+            spdlog::error("Unexpected batch parsing result ({} files, {} errors)", batch.num_files(), batch.num_errors());
+            return 1;
+        }
+
+        for(const stdromano::Python::ParsedFile& file : batch.files())
+        {
+            const bool broken = file.path.endswith("broken.py");
+
+            if(file.success == broken ||
+               file.diagnostics.empty() != !broken ||
+               (!broken && (file.root == nullptr || file.root->body.empty())))
+            {
+                spdlog::error("Unexpected batch parsing result for file: {}", file.path);
+                return 1;
+            }
+        }
+
+        stdromano::fs::removedir(root, true);
+    }
+
     const stdromano::StringD source_code_path("{}/python/test_all.py", TESTS_DATA_DIR);
 
     if(!stdromano::fs::path_exists(source_code_path))
@@ -4,35 +4,43 @@
 
 #include "stdromano/regex.hpp"
 #include "stdromano/hashmap.hpp"
+#include "stdromano/atomic.hpp"
+#include "stdromano/memory.hpp"
 
 #include "test.hpp"
 
 #include "spdlog/spdlog.h"
 
+#include <thread>
+
 /* Helper: assert a match succeeded and the full-match string equals expected */
 #define ASSERT_MATCH(re, input, expected_str)                                  \
     do {                                                                       \
-        auto _m = (re).match(stdromano::StringD(input));                       \
+        const stdromano::StringD _input(input);                                \
+        auto _m = (re).match(_input);                                          \
         ASSERT(_m.matched());                                                  \
         ASSERT(_m.str() == stdromano::StringD(expected_str));                   \
     } while(0)
 
 #define ASSERT_NO_MATCH(re, input)                                             \
     do {                                                                       \
-        auto _m = (re).match(stdromano::StringD(input));                       \
+        const stdromano::StringD _input(input);                                \
+        auto _m = (re).match(_input);                                          \
         ASSERT(!_m.matched());                                                 \
     } while(0)
 
 #define ASSERT_SEARCH(re, input, expected_str)                                 \
     do {                                                                       \
-        auto _m = (re).search(stdromano::StringD(input));                      \
+        const stdromano::StringD _input(input);                                \
+        auto _m = (re).search(_input);                                         \
         ASSERT(_m.matched());                                                  \
         ASSERT(_m.str() == stdromano::StringD(expected_str));                   \
     } while(0)
 
 #define ASSERT_NO_SEARCH(re, input)                                            \
     do {                                                                       \
-        auto _m = (re).search(stdromano::StringD(input));                      \
+        const stdromano::StringD _input(input);                                \
+        auto _m = (re).search(_input);                                         \
         ASSERT(!_m.matched());                                                 \
     } while(0)
 
@@ -74,7 +82,7 @@ TEST_CASE(test_plus_quantifier_digits)
 TEST_CASE(test_alternation_star_and_literal)
 {
     stdromano::Regex re("a*b|cd", stdromano::RegexFlags_DebugCompilation);
-    ASSERT(re.match("aaaaaacd").matched());
+    ASSERT_NO_MATCH(re, "aaaaaacd");           /* neither a*b nor cd match at the start */
     ASSERT(re.match("abd").matched());
     ASSERT(re.match("bd").matched());
     ASSERT(re.match("cd").matched());
@@ -225,7 +233,8 @@ TEST_CASE(test_negated_class_lowercase)
 TEST_CASE(test_group_email_like)
 {
     stdromano::Regex re("(\\w+)@(\\w+)");
-    auto m = re.match(stdromano::StringD("user@host"));
+    const stdromano::StringD input("user@host");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 0, "user@host");
     ASSERT_GROUP(m, 1, "user");
@@ -235,61 +244,129 @@ TEST_CASE(test_group_email_like)
 TEST_CASE(test_group_alpha_digits)
 {
     stdromano::Regex re("([a-z]+)([0-9]+)");
-    auto m = re.match(stdromano::StringD("abc123"));
+    const stdromano::StringD input("abc123");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 0, "abc123");
     ASSERT_GROUP(m, 1, "abc");
     ASSERT_GROUP(m, 2, "123");
 }
 
-TEST_CASE(test_group_nested_disabled)
+TEST_CASE(test_group_nested)
 {
-    // TODO: add backtracking to support greedy patterns
-#if 0
     stdromano::Regex re("((\\w+)_(\\w+))", stdromano::RegexFlags_DebugCompilation);
-    auto m = re.match(stdromano::StringD("hello_world"));
+    const stdromano::StringD input("hello_world");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 0, "hello_world");
     ASSERT_GROUP(m, 1, "hello_world");
     ASSERT_GROUP(m, 2, "hello");
     ASSERT_GROUP(m, 3, "world");
-#endif // 0
 }
 
 TEST_CASE(test_group_with_alternation)
 {
     stdromano::Regex re("(cat|dog)s");
-    auto m = re.match(stdromano::StringD("cats"));
+    const stdromano::StringD input("cats");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 1, "cat");
 
-    auto m2 = re.match(stdromano::StringD("dogs"));
+    const stdromano::StringD input2("dogs");
+    auto m2 = re.match(input2);
     ASSERT(m2.matched());
     ASSERT_GROUP(m2, 1, "dog");
 
     ASSERT_NO_MATCH(re, "birds");
 }
 
-TEST_CASE(test_group_with_quantifier_disabled)
+TEST_CASE(test_group_with_quantifier)
 {
-    // TODO: review the regex vm to exit when appropriate
-#if 0
     stdromano::Regex re("(ab)+", stdromano::RegexFlags_DebugCompilation);
-    auto m = re.match(stdromano::StringD("ababab"));
+    const stdromano::StringD input("ababab");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 0, "ababab");
     ASSERT(m.group(1).matched());
-#endif // 0
+    ASSERT(m.group(1).start == 4); /* last iteration */
 }
 
 /* ================================================================== */
-/* 9. RegexMatch API                                                  */
+/* 9. Leftmost-first semantics                                        */
+/* ================================================================== */
+
+TEST_CASE(test_lazy_quantifiers)
+{
+    stdromano::Regex star("<(.*?)>");
+    const stdromano::StringD input("<a><b>");
+    auto m = star.match(input);
+    ASSERT(m.matched());
+    ASSERT_GROUP(m, 0, "<a>");
+    ASSERT_GROUP(m, 1, "a");
+
+    stdromano::Regex greedy("<(.*)>");
+    ASSERT_MATCH(greedy, "<a><b>", "<a><b>");
+
+    stdromano::Regex plus("\\d+?");
+    ASSERT_MATCH(plus, "12345", "1");
+
+    stdromano::Regex optional("ab??");
+    ASSERT_MATCH(optional, "ab", "a");
+}
+
+TEST_CASE(test_alternation_priority)
+{
+    /* The first alternative that matches wins, even if a later one is longer */
+    stdromano::Regex re("(a|ab)(c|bcd)");
+    const stdromano::StringD input("abcd");
+    auto m = re.match(input);
+    ASSERT(m.matched());
+    ASSERT_GROUP(m, 0, "abcd");
+    ASSERT_GROUP(m, 1, "a");
+    ASSERT_GROUP(m, 2, "bcd");
+
+    stdromano::Regex re2("ab|abc");
+    ASSERT_MATCH(re2, "abc", "ab");
+}
+
+TEST_CASE(test_greedy_needs_backtracking)
+{
+    stdromano::Regex re("(\\w+)_(\\w+)");
+    const stdromano::StringD input("a_b_c");
+    auto m = re.match(input);
+    ASSERT(m.matched());
+    ASSERT_GROUP(m, 1, "a_b");
+    ASSERT_GROUP(m, 2, "c");
+
+    stdromano::Regex re2(".*foo");
+    ASSERT_MATCH(re2, "xfooyfoo", "xfooyfoo");
+    ASSERT_NO_MATCH(re2, "xfoyfo");
+}
+
+TEST_CASE(test_pathological_linear)
+{
+    /* Exponential for a backtracking engine, linear for the Pike VM */
+    stdromano::StringD input;
+
+    for(std::size_t i = 0; i < 4096; ++i)
+        input.push_back('a');
+
+    stdromano::Regex re("(a*)*(a|b)*c");
+    ASSERT(!re.match(input).matched());
+
+    stdromano::Regex re2("(a?)*a*");
+    ASSERT(re2.match(input).end() == input.size());
+}
+
+/* ================================================================== */
+/* 10. RegexMatch API                                                 */
 /* ================================================================== */
 
 TEST_CASE(test_match_api_basic)
 {
     stdromano::Regex re("(\\w+)");
-    auto m = re.match(stdromano::StringD("hello"));
+    const stdromano::StringD input("hello");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT(static_cast<bool>(m));
     ASSERT(m.start() == 0);
@@ -301,7 +378,8 @@ TEST_CASE(test_match_api_basic)
 TEST_CASE(test_match_api_no_match)
 {
     stdromano::Regex re("xyz");
-    auto m = re.match(stdromano::StringD("abc"));
+    const stdromano::StringD input("abc");
+    auto m = re.match(input);
     ASSERT(!m.matched());
     ASSERT(!static_cast<bool>(m));
 }
@@ -309,7 +387,8 @@ TEST_CASE(test_match_api_no_match)
 TEST_CASE(test_match_api_out_of_range_group)
 {
     stdromano::Regex re("hello");
-    auto m = re.match(stdromano::StringD("hello"));
+    const stdromano::StringD input("hello");
+    auto m = re.match(input);
     ASSERT(m.matched());
     auto g = m.group(99);
     ASSERT(!g.matched());
@@ -317,7 +396,7 @@ TEST_CASE(test_match_api_out_of_range_group)
 }
 
 /* ================================================================== */
-/* 10. search()                                                       */
+/* 11. search()                                                       */
 /* ================================================================== */
 
 TEST_CASE(test_search_digits)
@@ -329,7 +408,8 @@ TEST_CASE(test_search_digits)
 TEST_CASE(test_search_with_groups)
 {
     stdromano::Regex re("(\\w+)@(\\w+)");
-    auto m = re.search(stdromano::StringD("contact: user@host please"));
+    const stdromano::StringD input("contact: user@host please");
+    auto m = re.search(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 0, "user@host");
     ASSERT_GROUP(m, 1, "user");
@@ -347,20 +427,166 @@ TEST_CASE(test_search_no_match)
 TEST_CASE(test_search_first_occurrence)
 {
     stdromano::Regex re("[0-9]+");
-    auto m = re.search(stdromano::StringD("aaa111bbb222"));
+    const stdromano::StringD input("aaa111bbb222");
+    auto m = re.search(input);
     ASSERT(m.matched());
     ASSERT(m.str() == stdromano::StringD("111"));
     ASSERT(m.start() == 3);
 }
 
+TEST_CASE(test_search_test)
+{
+    stdromano::Regex re("err(or)?: \\d+");
+    ASSERT(re.test(stdromano::StringD("2025-01-01 error: 42 while loading")));
+    ASSERT(re.test(stdromano::StringD("err: 1")));
+    ASSERT(!re.test(stdromano::StringD("warning: 42")));
+    ASSERT(!re.test(stdromano::StringD("")));
+
+    /* Results of the DFA without captures must agree with the VM */
+    stdromano::Regex no_groups("a+b*?");
+    ASSERT_MATCH(no_groups, "aaabbb", "aaa");
+
+    stdromano::Regex empty("x*");
+    ASSERT(empty.test(stdromano::StringD("abc")));
+}
+
+TEST_CASE(test_search_dfa_cache_flush)
+{
+    /* The DFA of this pattern has 2^12 states, more than the cache can hold */
+    stdromano::Regex re("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)c");
+
+    stdromano::StringD input;
+
+    std::uint32_t x = 0x12345678;
+
+    for(std::size_t i = 0; i < 200000; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        input.push_back((x & 1) ? 'a' : 'b');
+    }
+
+    ASSERT(!re.test(input));
+
+    input.appends(stdromano::StringD("abbbbbbbbbbbc"));
+
+    ASSERT(re.test(input));
+}
+
+TEST_CASE(test_search_dfa_cache_many)
+{
+    /* More programs than the thread keeps DFAs for, with a hot one used between each of them */
+    stdromano::Regex hot("[a-c]+x[0-9]*");
+
+    for(std::size_t i = 0; i < 200; ++i)
+    {
+        stdromano::Regex re(stdromano::StringD::make_fmt("k{}[a-z]*", i));
+        stdromano::StringD input = stdromano::StringD::make_fmt("k{}abc", i);
+
+        ASSERT_MATCH(re, input.c_str(), input.c_str());
+        ASSERT_NO_MATCH(re, "zzz");
+        ASSERT_MATCH(hot, "abcx42", "abcx42");
+        ASSERT_NO_MATCH(hot, "x42");
+    }
+
+    /* Programs evicted from the cache get a new DFA when used again */
+    for(std::size_t i = 0; i < 200; ++i)
+    {
+        stdromano::Regex re(stdromano::StringD::make_fmt("k{}[a-z]*", i));
+        stdromano::StringD input = stdromano::StringD::make_fmt("k{}z", i);
+
+        ASSERT_MATCH(re, input.c_str(), input.c_str());
+    }
+
+    /* Programs with large DFAs, more than the thread keeps states for in total */
+    stdromano::Vector<stdromano::Regex> large;
+
+    for(const char end : { 'c', 'd', 'e', 'f', 'g', 'h' })
+        large.emplace_back(stdromano::StringD::make_fmt("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b){}", end));
+
+    stdromano::StringD input;
+
+    std::uint32_t x = 0x9E3779B9;
+
+    for(std::size_t i = 0; i < 50000; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        input.push_back((x & 1) ? 'a' : 'b');
+    }
+
+    input.appends(stdromano::StringD("abbbbbbbbbbe"));
+
+    for(std::size_t round = 0; round < 2; ++round)
+        for(std::size_t i = 0; i < large.size(); ++i)
+            ASSERT(large[i].test(input) == (i == 2));
+}
+
+TEST_CASE(test_search_literals)
+{
+    stdromano::StringD text;
+
+    for(std::size_t i = 0; i < 10000; ++i)
+        text.appendc("lorem ipsum dolor ");
+
+    text.appendc("id=12345 end");
+
+    /* Prefix "id=" */
+    stdromano::Regex prefix("id=(\\d+)");
+    auto m = prefix.search(text);
+    ASSERT(m.matched());
+    ASSERT(m.start() == 180000);
+    ASSERT_GROUP(m, 1, "12345");
+
+    /* Required inner literal "=" */
+    stdromano::Regex inner("\\w+=\\d+ end");
+    auto m2 = inner.search(text);
+    ASSERT(m2.matched());
+    ASSERT(m2.start() == 180000);
+
+    stdromano::Regex absent("\\w+=\\d+ begin");
+    ASSERT_NO_SEARCH(absent, text);
+
+    /* Top level alternation has no required literal */
+    stdromano::Regex alternation("cat|dog");
+    ASSERT_SEARCH(alternation, "hotdog", "dog");
+
+    /* The repeated literal is required once */
+    stdromano::Regex plus("a+b");
+    const stdromano::StringD input3("xxaaab");
+    auto m3 = plus.search(input3);
+    ASSERT(m3.matched());
+    ASSERT(m3.start() == 2);
+    ASSERT(m3.str() == stdromano::StringD("aaab"));
+}
+
+TEST_CASE(test_search_linear)
+{
+    /* Quadratic when searching from every start position */
+    stdromano::StringD input;
+
+    for(std::size_t i = 0; i < 100000; ++i)
+        input.push_back('a');
+
+    stdromano::Regex re("[ab]*[cd]");
+    ASSERT_NO_SEARCH(re, input);
+
+    stdromano::Regex re2("(a*)(b|c)");
+    ASSERT_NO_SEARCH(re2, input);
+    ASSERT(re2.match_all(input).size() == 0);
+}
+
 /* ================================================================== */
-/* 11. match_iter() and match_all()                                   */
+/* 12. match_iter() and match_all()                                   */
 /* ================================================================== */
 
 TEST_CASE(test_match_all_digits)
 {
     stdromano::Regex re("[0-9]+");
-    auto matches = re.match_all(stdromano::StringD("abc123def456ghi789"));
+    const stdromano::StringD input("abc123def456ghi789");
+    auto matches = re.match_all(input);
 
     ASSERT(matches.size() == 3);
     ASSERT(matches[0].str() == stdromano::StringD("123"));
@@ -371,7 +597,8 @@ TEST_CASE(test_match_all_digits)
 TEST_CASE(test_match_all_words)
 {
     stdromano::Regex re("\\w+");
-    auto matches = re.match_all(stdromano::StringD("hello world foo"));
+    const stdromano::StringD input("hello world foo");
+    auto matches = re.match_all(input);
 
     ASSERT(matches.size() == 3);
     ASSERT(matches[0].str() == stdromano::StringD("hello"));
@@ -404,14 +631,16 @@ TEST_CASE(test_match_iter_with_groups)
 TEST_CASE(test_match_all_empty_result)
 {
     stdromano::Regex re("[0-9]+");
-    auto matches = re.match_all(stdromano::StringD("no digits here"));
+    const stdromano::StringD input("no digits here");
+    auto matches = re.match_all(input);
     ASSERT(matches.size() == 0);
 }
 
 TEST_CASE(test_match_all_positions)
 {
     stdromano::Regex re("[a-z]+");
-    auto matches = re.match_all(stdromano::StringD("123abc456def"));
+    const stdromano::StringD input("123abc456def");
+    auto matches = re.match_all(input);
 
     ASSERT(matches.size() == 2);
     ASSERT(matches[0].start() == 3);
@@ -420,8 +649,61 @@ TEST_CASE(test_match_all_positions)
     ASSERT(matches[1].end() == 12);
 }
 
+TEST_CASE(test_match_all_buffer)
+{
+    stdromano::Regex re("(\\w+)=(\\d+)");
+    const stdromano::StringD input("a=1 b=22 c=333");
+
+    stdromano::RegexMatches matches;
+    ASSERT(re.match_all(input, matches) == 3);
+    ASSERT(matches[0].group_str(1) == stdromano::StringD("a"));
+    ASSERT(matches[1].group_str(2) == stdromano::StringD("22"));
+    ASSERT(matches[2].str() == stdromano::StringD("c=333"));
+    ASSERT(matches.group(2, 2).start == 11);
+
+    /* The buffer is reset on each call */
+    const stdromano::StringD input2("x=9");
+    ASSERT(re.match_all(input2, matches) == 1);
+    ASSERT(matches[0].str() == stdromano::StringD("x=9"));
+
+    const stdromano::StringD input3("nothing");
+    ASSERT(re.match_all(input3, matches) == 0);
+    ASSERT(matches.empty());
+}
+
+TEST_CASE(test_match_iter_no_allocation)
+{
+    stdromano::Regex re("(\\w+)=(\\d+)");
+
+    stdromano::StringD input;
+
+    for(std::size_t i = 0; i < 10000; ++i)
+        input.appendf("key{}={} ", i, i);
+
+    stdromano::RegexMatches matches;
+
+    /* Warm up the VM and the buffer */
+    ASSERT(re.match_all(input, matches) == 10000);
+
+    const std::uint64_t allocated = stdromano::mem_thread_allocated_bytes();
+
+    std::size_t num_matches = 0;
+    std::size_t value_sizes = 0;
+
+    re.match_iter(input, [&](const stdromano::RegexMatch& m) {
+        num_matches++;
+        value_sizes += m.group_str(2).size();
+    });
+
+    ASSERT(re.match_all(input, matches) == 10000);
+
+    ASSERT(stdromano::mem_thread_allocated_bytes() == allocated);
+    ASSERT(num_matches == 10000);
+    ASSERT(value_sizes == 10 + 90 * 2 + 900 * 3 + 9000 * 4);
+}
+
 /* ================================================================== */
-/* 12. replace_iter / replace_all                                     */
+/* 13. replace_iter / replace_all                                     */
 /* ================================================================== */
 
 TEST_CASE(test_replace_all_simple)
@@ -457,8 +739,30 @@ TEST_CASE(test_replace_iter_with_map)
     ASSERT(res == "value2 string with value1 and value3");
 }
 
+TEST_CASE(test_replace_iter_append)
+{
+    stdromano::Regex re("(\\d+)");
+
+    auto append_func = [](const stdromano::RegexMatch& m, stdromano::StringD& out) {
+        out.push_back('<');
+        out.appends(m.group_str(1));
+        out.push_back('>');
+    };
+
+    const stdromano::StringD res = re.replace_iter(stdromano::StringD("a1b22c"), append_func);
+
+    ASSERT(res == "a<1>b<22>c");
+}
+
+TEST_CASE(test_replace_all_empty_matches)
+{
+    stdromano::Regex re("x*");
+    ASSERT(re.replace_all(stdromano::StringD("abxxc"), stdromano::StringD("-")) == "ab-c");
+    ASSERT(re.replace_all(stdromano::StringD("abc"), stdromano::StringD("-")) == "abc");
+}
+
 /* ================================================================== */
-/* 13. Edge cases                                                     */
+/* 14. Edge cases                                                     */
 /* ================================================================== */
 
 TEST_CASE(test_edge_empty_pattern)
@@ -503,19 +807,313 @@ TEST_CASE(test_edge_email_like_pattern)
 TEST_CASE(test_edge_multiple_groups_and_quantifiers)
 {
     stdromano::Regex re("([a-z]+)_([0-9]+)\\.(txt|log)");
-    auto m = re.match(stdromano::StringD("report_2025.txt"));
+    const stdromano::StringD input("report_2025.txt");
+    auto m = re.match(input);
     ASSERT(m.matched());
     ASSERT_GROUP(m, 1, "report");
     ASSERT_GROUP(m, 2, "2025");
     ASSERT_GROUP(m, 3, "txt");
 
-    auto m2 = re.match(stdromano::StringD("error_42.log"));
+    const stdromano::StringD input2("error_42.log");
+    auto m2 = re.match(input2);
     ASSERT(m2.matched());
     ASSERT_GROUP(m2, 1, "error");
     ASSERT_GROUP(m2, 2, "42");
     ASSERT_GROUP(m2, 3, "log");
 }
 
+/* ================================================================== */
+/* 15. Regex cache                                                    */
+/* ================================================================== */
+
+TEST_CASE(test_regex_cache)
+{
+    stdromano::regex_cache_clear();
+    stdromano::regex_cache_set_capacity(stdromano::REGEX_CACHE_DEFAULT_CAPACITY);
+
+    for(std::size_t i = 0; i < 100; ++i)
+    {
+        stdromano::Regex re = stdromano::regex_cache_get("(\\w+)=(\\d+)");
+        ASSERT(re.valid());
+        ASSERT(re.group_count() == 3);
+        ASSERT(re.match(stdromano::StringD("key=42")).matched());
+    }
+
+    stdromano::RegexCacheStats stats = stdromano::regex_cache_stats();
+    ASSERT(stats.misses == 1);
+    ASSERT(stats.hits == 99);
+    ASSERT(stats.size == 1);
+
+    /* Flags are part of the key */
+    ASSERT(stdromano::regex_cache_get("(\\w+)=(\\d+)", stdromano::RegexFlags_DebugCompilation).valid());
+    ASSERT(stdromano::regex_cache_stats().size == 2);
+
+    /* Invalid patterns are not cached */
+    ASSERT(!stdromano::regex_cache_get("(abc").valid());
+    ASSERT(stdromano::regex_cache_stats().size == 2);
+}
+
+TEST_CASE(test_regex_cache_eviction)
+{
+    stdromano::regex_cache_clear();
+    stdromano::regex_cache_set_capacity(4);
+
+    stdromano::Regex first = stdromano::regex_cache_get("a0");
+
+    for(std::size_t i = 1; i < 8; ++i)
+    {
+        stdromano::StringD pattern = stdromano::StringD::make_fmt("a{}", i);
+        ASSERT(stdromano::regex_cache_get(pattern).valid());
+
+        /* Keeps the first pattern as the most recently used one */
+        ASSERT(stdromano::regex_cache_get("a0").valid());
+    }
+
+    stdromano::RegexCacheStats stats = stdromano::regex_cache_stats();
+    ASSERT(stats.size == 4);
+    ASSERT(stats.evictions == 4);
+
+    const std::size_t hits = stats.hits;
+    stdromano::regex_cache_get("a0");
+    ASSERT(stdromano::regex_cache_stats().hits == hits + 1);
+
+    /* The evicted programs stay alive in the Regex objects */
+    stdromano::regex_cache_clear();
+    ASSERT_MATCH(first, "a0", "a0");
+
+    stdromano::regex_cache_set_capacity(stdromano::REGEX_CACHE_DEFAULT_CAPACITY);
+}
+
+TEST_CASE(test_regex_cache_threads)
+{
+    stdromano::regex_cache_clear();
+
+    stdromano::Atomic<std::uint32_t> num_matches(0);
+
+    stdromano::Vector<std::thread> threads;
+
+    for(std::size_t t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&num_matches]() {
+            for(std::size_t i = 0; i < 1000; ++i)
+            {
+                stdromano::StringD pattern = stdromano::StringD::make_fmt("id=(\\d+)_{}", i % 16);
+                stdromano::StringD input = stdromano::StringD::make_fmt("id=1234_{}", i % 16);
+
+                if(stdromano::regex_cache_get(pattern).search(input).matched())
+                    num_matches.fetch_add(1);
+            }
+        });
+    }
+
+    for(std::thread& thread : threads)
+        thread.join();
+
+    ASSERT(num_matches.load() == 8000);
+
+    stdromano::RegexCacheStats stats = stdromano::regex_cache_stats();
+    ASSERT(stats.size == 16);
+    ASSERT(stats.hits + stats.misses == 8000);
+}
+
+/* ================================================================== */
+/* 16. Regex set                                                      */
+/* ================================================================== */
+
+TEST_CASE(test_regex_set)
+{
+    stdromano::Vector<stdromano::StringD> patterns;
+    patterns.push_back("error");
+    patterns.push_back("warn(ing)?");
+    patterns.push_back("\\d+ms");
+    patterns.push_back("^never$");
+
+    stdromano::RegexSet set(patterns);
+    ASSERT(set.valid());
+    ASSERT(set.size() == 4);
+
+    stdromano::Vector<std::uint32_t> indices;
+
+    ASSERT(set.matches(stdromano::StringD("warning: request took 120ms, error"), indices));
+    ASSERT(indices.size() == 3);
+    ASSERT(indices[0] == 0);
+    ASSERT(indices[1] == 1);
+    ASSERT(indices[2] == 2);
+
+    ASSERT(set.matches(stdromano::StringD("took 5ms"), indices));
+    ASSERT(indices.size() == 1);
+    ASSERT(indices[0] == 2);
+
+    ASSERT(!set.matches(stdromano::StringD("all good"), indices));
+    ASSERT(indices.empty());
+
+    ASSERT(set.test(stdromano::StringD("an error")));
+    ASSERT(!set.test(stdromano::StringD("nothing")));
+
+    stdromano::Vector<stdromano::RegexSetMatch> matches;
+
+    ASSERT(set.search_all(stdromano::StringD("12ms then warn"), matches));
+    ASSERT(matches.size() == 2);
+    ASSERT(matches[0].index == 1);
+    ASSERT(matches[0].location.start == 10);
+    ASSERT(matches[0].location.end == 14);
+    ASSERT(matches[1].index == 2);
+    ASSERT(matches[1].location.start == 0);
+    ASSERT(matches[1].location.end == 4);
+
+    /* Overlapping patterns all match */
+    stdromano::Vector<stdromano::StringD> overlapping;
+    overlapping.push_back("abc");
+    overlapping.push_back("b");
+    overlapping.push_back("a.*d");
+
+    stdromano::RegexSet overlapping_set(overlapping);
+
+    ASSERT(overlapping_set.matches(stdromano::StringD("xxabcxd"), indices));
+    ASSERT(indices.size() == 3);
+}
+
+TEST_CASE(test_regex_set_invalid)
+{
+    stdromano::Vector<stdromano::StringD> patterns;
+    patterns.push_back("ok");
+    patterns.push_back("(broken");
+
+    stdromano::RegexSet set(patterns);
+    ASSERT(!set.valid());
+
+    stdromano::Vector<std::uint32_t> indices;
+    ASSERT(!set.matches(stdromano::StringD("ok"), indices));
+    ASSERT(!stdromano::RegexSet().valid());
+}
+
+TEST_CASE(test_regex_set_many)
+{
+    stdromano::Vector<stdromano::StringD> patterns;
+
+    for(std::size_t i = 0; i < 64; ++i)
+        patterns.push_back(stdromano::StringD::make_fmt("key{}=(\\d+)", i));
+
+    stdromano::RegexSet set(patterns);
+    ASSERT(set.valid());
+
+    stdromano::StringD input;
+
+    for(std::size_t i = 0; i < 64; i += 3)
+        input.appendf("key{}={} ", i, i * 7);
+
+    stdromano::Vector<std::uint32_t> indices;
+    ASSERT(set.matches(input, indices));
+
+    /* "key1=" is a prefix of "key12=", "key15=", ... so the count includes these */
+    for(const std::uint32_t index : indices)
+    {
+        ASSERT(set.regex(index).test(input));
+    }
+
+    for(std::size_t i = 0; i < 64; ++i)
+    {
+        const bool expected = set.regex(i).test(input);
+        bool found = false;
+
+        for(const std::uint32_t index : indices)
+            found |= index == i;
+
+        ASSERT(found == expected);
+    }
+}
+
+/* ================================================================== */
+/* 17. JIT                                                            */
+/* ================================================================== */
+
+TEST_CASE(test_regex_jit)
+{
+    static constexpr const char* patterns[] = {
+        "abc", "a+b*c?", "(cat|dog|eel)s?", "[0-9]+x", "[a-f0-9]+_x", "\\w+@\\w+\\.com",
+        "[^a]b", "x.*y", "(a|b)*abb", "\\s+\\d\\d?", "[A-Z][a-z]+", "a?", "[^\\n]z",
+        "[aeiou][^aeiou]", "(\\d+)-(\\d+)", "\\W\\D\\S",
+    };
+
+    static constexpr const char* inputs[] = {
+        "", "abc", "xxabcxx", "aaab", "dogs and cats", "eel", "12x", "   1234x", "foo@bar.com",
+        "zb", "ab", "x\ny", "xy", "babababb", "  7", "Hello World", "\nz", "az", "qe!",
+        "12-34", "a-b", "----------------------------------------abc-----------------------",
+        "0123456789abcdef0123456789abcdef0123456789abcdef_x", "! ~",
+    };
+
+    for(const char* pattern : patterns)
+    {
+        stdromano::Regex interpreted(pattern);
+        stdromano::Regex jitted(pattern, stdromano::RegexFlags_Jit);
+
+        ASSERT(interpreted.valid() == jitted.valid());
+
+        if(!jitted.valid())
+            continue;
+
+#if defined(__x86_64__) || defined(_M_X64)
+        ASSERT(jitted.jitted());
+#endif /* defined(__x86_64__) || defined(_M_X64) */
+        ASSERT(!interpreted.jitted());
+
+        for(const char* input : inputs)
+        {
+            const stdromano::StringD str(input);
+
+            ASSERT(interpreted.test(str) == jitted.test(str));
+
+            const stdromano::RegexMatch m1 = interpreted.match(str);
+            const stdromano::RegexMatch m2 = jitted.match(str);
+
+            ASSERT(m1.matched() == m2.matched());
+            ASSERT(m1.str() == m2.str());
+
+            const stdromano::RegexMatch s1 = interpreted.search(str);
+            const stdromano::RegexMatch s2 = jitted.search(str);
+
+            ASSERT(s1.matched() == s2.matched());
+            ASSERT(s1.start() == s2.start());
+            ASSERT(s1.str() == s2.str());
+        }
+    }
+}
+
+TEST_CASE(test_regex_jit_large)
+{
+    /* More states than the DFA cache can hold, linear in native code */
+    stdromano::Regex re("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)c", stdromano::RegexFlags_Jit);
+
+    stdromano::StringD input;
+
+    std::uint32_t x = 0x12345678;
+
+    for(std::size_t i = 0; i < 200000; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        input.push_back((x & 1) ? 'a' : 'b');
+    }
+
+    ASSERT(!re.test(input));
+
+    input.appends(stdromano::StringD("abbbbbbbbbbbc"));
+
+    ASSERT(re.test(input));
+
+    /* Too many states for the JIT, interpreted */
+    stdromano::StringD long_pattern;
+
+    for(std::size_t i = 0; i < 100; ++i)
+        long_pattern.push_back('a' + static_cast<char>(i % 26));
+
+    stdromano::Regex too_large(long_pattern, stdromano::RegexFlags_Jit);
+    ASSERT(too_large.valid());
+    ASSERT(!too_large.jitted());
+    ASSERT(too_large.test(long_pattern));
+}
+
 int main()
 {
     spdlog::set_level(spdlog::level::debug);
@@ -542,9 +1140,13 @@ int main()
     runner.add_test("Negated Class Lowercase", test_negated_class_lowercase);
     runner.add_test("Group Email Like", test_group_email_like);
     runner.add_test("Group Alpha Digits", test_group_alpha_digits);
-    runner.add_test("Group Nested Disabled", test_group_nested_disabled);
+    runner.add_test("Group Nested", test_group_nested);
     runner.add_test("Group With Alternation", test_group_with_alternation);
-    runner.add_test("Group With Quantifier Disabled", test_group_with_quantifier_disabled);
+    runner.add_test("Group With Quantifier", test_group_with_quantifier);
+    runner.add_test("Lazy Quantifiers", test_lazy_quantifiers);
+    runner.add_test("Alternation Priority", test_alternation_priority);
+    runner.add_test("Greedy Needs Backtracking", test_greedy_needs_backtracking);
+    runner.add_test("Pathological Linear", test_pathological_linear);
     runner.add_test("Match Api Basic", test_match_api_basic);
     runner.add_test("Match Api No Match", test_match_api_no_match);
     runner.add_test("Match Api Out Of Range Group", test_match_api_out_of_range_group);
@@ -552,19 +1154,36 @@ int main()
     runner.add_test("Search With Groups", test_search_with_groups);
     runner.add_test("Search No Match", test_search_no_match);
     runner.add_test("Search First Occurrence", test_search_first_occurrence);
+    runner.add_test("Search Test", test_search_test);
+    runner.add_test("Search Dfa Cache Flush", test_search_dfa_cache_flush);
+    runner.add_test("Search Dfa Cache Many", test_search_dfa_cache_many);
+    runner.add_test("Search Literals", test_search_literals);
+    runner.add_test("Search Linear", test_search_linear);
     runner.add_test("Match All Digits", test_match_all_digits);
     runner.add_test("Match All Words", test_match_all_words);
     runner.add_test("Match Iter With Groups", test_match_iter_with_groups);
     runner.add_test("Match All Empty Result", test_match_all_empty_result);
     runner.add_test("Match All Positions", test_match_all_positions);
+    runner.add_test("Match All Buffer", test_match_all_buffer);
+    runner.add_test("Match Iter No Allocation", test_match_iter_no_allocation);
     runner.add_test("Replace All Simple", test_replace_all_simple);
     runner.add_test("Replace Iter With Map", test_replace_iter_with_map);
+    runner.add_test("Replace Iter Append", test_replace_iter_append);
+    runner.add_test("Replace All Empty Matches", test_replace_all_empty_matches);
     runner.add_test("Edge Empty Pattern", test_edge_empty_pattern);
     runner.add_test("Edge Single Char", test_edge_single_char);
     runner.add_test("Edge Long Alternation", test_edge_long_alternation);
     runner.add_test("Edge Quantifier On Group", test_edge_quantifier_on_group);
     runner.add_test("Edge Email Like Pattern", test_edge_email_like_pattern);
     runner.add_test("Edge Multiple Groups And Quantifiers", test_edge_multiple_groups_and_quantifiers);
+    runner.add_test("Regex Cache", test_regex_cache);
+    runner.add_test("Regex Cache Eviction", test_regex_cache_eviction);
+    runner.add_test("Regex Cache Threads", test_regex_cache_threads);
+    runner.add_test("Regex Set", test_regex_set);
+    runner.add_test("Regex Set Invalid", test_regex_set_invalid);
+    runner.add_test("Regex Set Many", test_regex_set_many);
+    runner.add_test("Regex Jit", test_regex_jit);
+    runner.add_test("Regex Jit Large", test_regex_jit_large);
     runner.run_all();
 
     spdlog::info("Finished Regex tests");
@@ -767,6 +767,37 @@ TEST_CASE(test_utf8_iterator)
     }
 }
 
+TEST_CASE(test_strfind)
+{
+    StringD haystack;
+
+    for(std::size_t i = 0; i < 200; ++i)
+        haystack.push_back(static_cast<char>('a' + i % 7));
+
+    haystack.appendc("needle");
+
+    for(std::size_t i = 0; i < 50; ++i)
+        haystack.push_back('z');
+
+    const char* found = stdromano::strfind(haystack.data(), haystack.size(), "needle", 6);
+    ASSERT(found == haystack.data() + 200);
+
+    /* Single char, at the boundaries of the SIMD blocks */
+    ASSERT(stdromano::strfind(haystack.data(), haystack.size(), "n", 1) == haystack.data() + 200);
+    ASSERT(stdromano::strfind(haystack.data(), haystack.size(), "a", 1) == haystack.data());
+    ASSERT(stdromano::strfind(haystack.data(), haystack.size(), "zz", 2) == haystack.data() + 206);
+    ASSERT(stdromano::strfind(haystack.data() + 240, haystack.size() - 240, "zzzzzz", 6) == haystack.data() + 240);
+
+    /* Not found, needle longer than the haystack, empty needle */
+    ASSERT(stdromano::strfind(haystack.data(), haystack.size(), "needles", 7) == nullptr);
+    ASSERT(stdromano::strfind(haystack.data(), 3, "abcd", 4) == nullptr);
+    ASSERT(stdromano::strfind(haystack.data(), haystack.size(), "", 0) == haystack.data());
+
+    /* Match ending exactly at the end of the haystack */
+    ASSERT(stdromano::strfind(haystack.data(), 206, "needle", 6) == haystack.data() + 200);
+    ASSERT(stdromano::strfind(haystack.data(), 205, "needle", 6) == nullptr);
+}
+
 int main()
 {
     TestRunner runner;
@@ -801,6 +832,7 @@ int main()
     runner.add_test("ToString", test_to_string);
     runner.add_test("UTF-8 Validation", test_utf8_validation);
     runner.add_test("UTF-8 Iterator", test_utf8_iterator);
+    runner.add_test("StrFind", test_strfind);
 
     runner.run_all();
 